@@ -421,10 +421,11 @@ ax203_eeprom_wait_ready(Camera *camera)
 	return GP_OK;
 }
 
+/* Read count consecutive sectors starting at sector with a single transfer */
 static int
-ax203_read_sector(Camera *camera, int sector, char *buf)
+ax203_read_sectors(Camera *camera, int sector, int count, char *buf)
 {
-	int ret;
+	int ret, size = count * SPI_EEPROM_SECTOR_SIZE;
 	if (camera->pl->mem_dump) {
 		ret = fseek (camera->pl->mem_dump,
 			     sector * SPI_EEPROM_SECTOR_SIZE, SEEK_SET);
@@ -433,9 +434,8 @@ ax203_read_sector(Camera *camera, int sector, char *buf)
 				"seeking in memdump: %s", strerror(errno));
 			return GP_ERROR_IO_READ;
 		}
-		ret = fread (buf, 1, SPI_EEPROM_SECTOR_SIZE,
-			     camera->pl->mem_dump);
-		if (ret != SPI_EEPROM_SECTOR_SIZE) {
+		ret = fread (buf, 1, size, camera->pl->mem_dump);
+		if (ret != size) {
 			if (ret < 0)
 				gp_log (GP_LOG_ERROR, "ax203",
 					"reading memdump: %s",
@@ -448,15 +448,16 @@ ax203_read_sector(Camera *camera, int sector, char *buf)
 	} else {
 		CHECK (ax203_eeprom_read (camera,
 					  sector * SPI_EEPROM_SECTOR_SIZE,
-					  buf, SPI_EEPROM_SECTOR_SIZE))
+					  buf, size))
 	}
 	return GP_OK;
 }
 
+/* Write count consecutive (erased) sectors starting at sector */
 static int
-ax203_write_sector(Camera *camera, int sector, char *buf)
+ax203_write_sectors(Camera *camera, int sector, int count, char *buf)
 {
-	int ret;
+	int ret, size = count * SPI_EEPROM_SECTOR_SIZE;
 	if (camera->pl->mem_dump) {
 		ret = fseek (camera->pl->mem_dump,
 			     sector * SPI_EEPROM_SECTOR_SIZE, SEEK_SET);
@@ -465,9 +466,8 @@ ax203_write_sector(Camera *camera, int sector, char *buf)
 				"seeking in memdump: %s", strerror(errno));
 			return GP_ERROR_IO_WRITE;
 		}
-		ret = fwrite (buf, 1, SPI_EEPROM_SECTOR_SIZE,
-			      camera->pl->mem_dump);
-		if (ret != SPI_EEPROM_SECTOR_SIZE) {
+		ret = fwrite (buf, 1, size, camera->pl->mem_dump);
+		if (ret != size) {
 			gp_log (GP_LOG_ERROR, "ax203",
 				"writing memdump: %s", strerror(errno));
 			return GP_ERROR_IO_WRITE;
@@ -475,7 +475,9 @@ ax203_write_sector(Camera *camera, int sector, char *buf)
 	} else {
 		int i, base = sector * SPI_EEPROM_SECTOR_SIZE;
 
-		for (i = 0; i < SPI_EEPROM_SECTOR_SIZE; i += 256) {
+		/* Plain SPI eeproms can only program one 256 byte page at a
+		   time, and need to be idle before accepting the next one */
+		for (i = 0; i < size; i += 256) {
 			CHECK (ax203_eeprom_write_enable (camera))
 			CHECK (ax203_eeprom_program_page (camera, base + i,
 							  buf + i, 256, 0))
@@ -513,47 +515,65 @@ ax203_erase64k_sector(Camera *camera, int sector)
 	return GP_OK;
 }
 
+/* Make sure sectors sector - sector + count - 1 are in our memory cache.
+   Runs of missing sectors get read with a single transfer (of at most
+   AX203_MAX_READ_SECTORS sectors, or AX203_MAX_DUMP_READ_SECTORS from a
+   memory dump). A run which starts inside the requested range may be
+   extended by up to readahead sectors beyond it, so that sequential reads
+   do not cause a transfer per sector. */
 static int
-ax203_check_sector_present(Camera *camera, int sector)
+ax203_check_sectors_present(Camera *camera, int sector, int count,
+	int readahead)
 {
-	int ret;
+	int ret, run, end = sector + count, limit;
+	int mem_sectors = camera->pl->mem_size / SPI_EEPROM_SECTOR_SIZE;
+	int max_run = camera->pl->mem_dump ? AX203_MAX_DUMP_READ_SECTORS :
+					     AX203_MAX_READ_SECTORS;
 
-	if ((sector + 1) * SPI_EEPROM_SECTOR_SIZE > camera->pl->mem_size) {
+	if (end > mem_sectors) {
 		gp_log (GP_LOG_ERROR, "ax203", "access beyond end of memory");
 		return GP_ERROR_CORRUPTED_DATA;
 	}
 
-	if (camera->pl->sector_is_present[sector])
-		return GP_OK;
+	limit = end + readahead;
+	if (limit > mem_sectors)
+		limit = mem_sectors;
 
-	ret = ax203_read_sector(camera, sector, camera->pl->mem +
-				sector * SPI_EEPROM_SECTOR_SIZE);
-	if (ret == 0)
-		camera->pl->sector_is_present[sector] = 1;
+	while (sector < end) {
+		if (camera->pl->sector_is_present[sector]) {
+			sector++;
+			continue;
+		}
 
-	return ret;
+		for (run = 1; run < max_run &&
+			      (sector + run) < limit &&
+			      !camera->pl->sector_is_present[sector + run];
+		     run++);
+
+		ret = ax203_read_sectors (camera, sector, run,
+					  camera->pl->mem +
+					  sector * SPI_EEPROM_SECTOR_SIZE);
+		if (ret < 0)
+			return ret;
+
+		for (; run; run--, sector++)
+			camera->pl->sector_is_present[sector] = 1;
+	}
+	return GP_OK;
 }
 
 static int
 ax203_read_mem(Camera *camera, int offset,
 	void *buf, int len)
 {
-	int to_copy, sector = offset / SPI_EEPROM_SECTOR_SIZE;
-
-	while (len) {
-		CHECK (ax203_check_sector_present (camera, sector))
+	int sector = offset / SPI_EEPROM_SECTOR_SIZE;
+	int count = (offset + len + SPI_EEPROM_SECTOR_SIZE - 1) /
+		    SPI_EEPROM_SECTOR_SIZE - sector;
 
-		to_copy = SPI_EEPROM_SECTOR_SIZE -
-			  (offset % SPI_EEPROM_SECTOR_SIZE);
-		if (to_copy > len)
-			to_copy = len;
+	CHECK (ax203_check_sectors_present (camera, sector, count,
+					    AX203_READAHEAD_SECTORS))
 
-		memcpy(buf, camera->pl->mem + offset, to_copy);
-		buf += to_copy;
-		len -= to_copy;
-		offset += to_copy;
-		sector++;
-	}
+	memcpy(buf, camera->pl->mem + offset, len);
 	return GP_OK;
 }
 
@@ -561,24 +581,16 @@ static int
 ax203_write_mem(Camera *camera, int offset,
 	void *buf, int len)
 {
-	int to_copy, sector = offset / SPI_EEPROM_SECTOR_SIZE;
+	int i, sector = offset / SPI_EEPROM_SECTOR_SIZE;
+	int count = (offset + len + SPI_EEPROM_SECTOR_SIZE - 1) /
+		    SPI_EEPROM_SECTOR_SIZE - sector;
 
-	while (len) {
-		CHECK (ax203_check_sector_present (camera, sector))
+	CHECK (ax203_check_sectors_present (camera, sector, count, 0))
 
-		to_copy = SPI_EEPROM_SECTOR_SIZE -
-			  (offset % SPI_EEPROM_SECTOR_SIZE);
-		if (to_copy > len)
-			to_copy = len;
-
-		memcpy(camera->pl->mem + offset, buf, to_copy);
-		camera->pl->sector_dirty[sector] = 1;
+	memcpy(camera->pl->mem + offset, buf, len);
+	for (i = 0; i < count; i++)
+		camera->pl->sector_dirty[sector + i] = 1;
 
-		buf += to_copy;
-		len -= to_copy;
-		offset += to_copy;
-		sector++;
-	}
 	return GP_OK;
 }
 
@@ -1583,18 +1595,26 @@ static int
 ax203_commit_block_4k(Camera *camera, int bss)
 {
 	int block_sector_size = SPI_EEPROM_BLOCK_SIZE / SPI_EEPROM_SECTOR_SIZE;
-	int i;
+	int i, j;
 
-	for (i = 0; i < block_sector_size; i++) {
-		if (!camera->pl->sector_dirty[bss + i])
+	for (i = 0; i < block_sector_size; i = j) {
+		if (!camera->pl->sector_dirty[bss + i]) {
+			j = i + 1;
 			continue;
+		}
 
-		CHECK (ax203_erase4k_sector (camera, bss + i))
-		CHECK (ax203_write_sector (camera, bss + i,
-					   camera->pl->mem +
-					   (bss + i) *
-					   SPI_EEPROM_SECTOR_SIZE))
-		camera->pl->sector_dirty[bss + i] = 0;
+		/* Erase the entire run of dirty sectors, and then program
+		   it in one go */
+		for (j = i; j < block_sector_size &&
+			    camera->pl->sector_dirty[bss + j]; j++)
+			CHECK (ax203_erase4k_sector (camera, bss + j))
+
+		CHECK (ax203_write_sectors (camera, bss + i, j - i,
+					    camera->pl->mem +
+					    (bss + i) *
+					    SPI_EEPROM_SECTOR_SIZE))
+		memset (camera->pl->sector_dirty + bss + i, 0,
+			(j - i) * sizeof (camera->pl->sector_dirty[0]));
 	}
 	return GP_OK;
 }
@@ -1606,20 +1626,18 @@ ax203_commit_block_64k(Camera *camera, int bss)
 	int i;
 
 	/* Make sure we have read the entire block before erasing it !! */
-	for (i = 0; i < block_sector_size; i++)
-		CHECK (ax203_check_sector_present (camera, bss + i))
+	CHECK (ax203_check_sectors_present (camera, bss, block_sector_size, 0))
 
 	/* Erase the block */
 	CHECK (ax203_erase64k_sector (camera, bss))
 
 	/* And re-program all sectors in the block */
-	for (i = 0; i < block_sector_size; i++) {
-		CHECK (ax203_write_sector (camera, bss + i,
-					   camera->pl->mem +
-					   (bss + i) *
-					   SPI_EEPROM_SECTOR_SIZE))
+	CHECK (ax203_write_sectors (camera, bss, block_sector_size,
+				    camera->pl->mem +
+				    bss * SPI_EEPROM_SECTOR_SIZE))
+	for (i = 0; i < block_sector_size; i++)
 		camera->pl->sector_dirty[bss + i] = 0;
-	}
+
 	return GP_OK;
 }
 
@@ -1642,8 +1660,7 @@ ax203_commit_block_64k_at_once(Camera *camera, int bss)
 	}
 
 	/* Make sure we have read the entire block before erasing it !! */
-	for (i = 0; i < block_sector_size; i++)
-		CHECK (ax203_check_sector_present (camera, bss + i))
+	CHECK (ax203_check_sectors_present (camera, bss, block_sector_size, 0))
 
 	if (!camera->pl->block_protection_removed) {
 		CHECK (ax203_eeprom_write_enable (camera))
@@ -73,6 +73,15 @@
 #define SPI_EEPROM_RDP		0xab /* Release from Deep Powerdown */
 #define SPI_EEPROM_ERASE_64K	0xd8
 
+/* Maximum number of sectors to read in a single transfer. The frame gets
+   one eeprom read command per sector, larger reads have not been tried
+   against real hardware. Memory dumps are read in runs of up to a 64k
+   block, including up to AX203_READAHEAD_SECTORS sectors beyond what was
+   asked for. */
+#define AX203_MAX_READ_SECTORS		1
+#define AX203_MAX_DUMP_READ_SECTORS	(SPI_EEPROM_BLOCK_SIZE / SPI_EEPROM_SECTOR_SIZE)
+#define AX203_READAHEAD_SECTORS		8
+
 #define CHECK(result) {int r=(result); if (r<0) return (r);}
 
 enum ax203_version {
@@ -0,0 +1,240 @@
+/*
+ * jidctint.c
+ *
+ * Copyright (C) 1994-1998, Thomas G. Lane.
+ * This file is part of the Independent JPEG Group's software.
+ *
+ * The authors make NO WARRANTY or representation, either express or implied,
+ * with respect to this software, its quality, accuracy, merchantability, or
+ * fitness for a particular purpose.  This software is provided "AS IS", and you,
+ * its user, assume the entire risk as to its quality and accuracy.
+ *
+ * This software is copyright (C) 1991-1998, Thomas G. Lane.
+ * All Rights Reserved except as specified below.
+ *
+ * Permission is hereby granted to use, copy, modify, and distribute this
+ * software (or portions thereof) for any purpose, without fee, subject to these
+ * conditions:
+ * (1) If any part of the source code for this software is distributed, then this
+ * README file must be included, with this copyright and no-warranty notice
+ * unaltered; and any additions, deletions, or changes to the original files
+ * must be clearly indicated in accompanying documentation.
+ * (2) If only executable code is distributed, then the accompanying
+ * documentation must state that "this software is based in part on the work of
+ * the Independent JPEG Group".
+ * (3) Permission for use of this software is granted only if the user accepts
+ * full responsibility for any undesirable consequences; the authors accept
+ * NO LIABILITY for damages of any kind.
+ *
+ * These conditions apply to any software derived from or based on the IJG code,
+ * not just to the unmodified library.  If you use our work, you ought to
+ * acknowledge us.
+ *
+ * Permission is NOT granted for the use of any IJG author's name or company name
+ * in advertising or publicity relating to this software or products derived from
+ * it.  This software may be referred to only as "the Independent JPEG Group's
+ * software".
+ *
+ * We specifically permit and encourage the use of this software as the basis of
+ * commercial products, provided that all warranty or liability claims are
+ * assumed by the product vendor.
+ *
+ *
+ * This file contains a slow-but-accurate integer implementation of the
+ * inverse DCT (Discrete Cosine Transform).  In the IJG code, this routine
+ * must also perform dequantization of the input coefficients.
+ *
+ * It uses the same LL&M algorithm as the IJG jidctint.c, but rather than
+ * doing the 1-D IDCT one column (row) at a time, it does all 8 columns
+ * (rows) in lock-step without any data dependent branches. With gcc / clang
+ * this is done on 4 lanes at a time using generic vector types, which get
+ * compiled to SSE2 / NEON / ... instructions as available. Other compilers
+ * get the same code operating on a single lane.
+ */
+
+#include "config.h"
+#include <stdint.h>
+#include <string.h>
+#include "tinyjpeg-internal.h"
+
+#define DCTSIZE	   8
+#define DCTSIZE2   (DCTSIZE*DCTSIZE)
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+#define FIX_0_298631336  ((int32_t)  2446)	/* FIX(0.298631336) */
+#define FIX_0_390180644  ((int32_t)  3196)	/* FIX(0.390180644) */
+#define FIX_0_541196100  ((int32_t)  4433)	/* FIX(0.541196100) */
+#define FIX_0_765366865  ((int32_t)  6270)	/* FIX(0.765366865) */
+#define FIX_0_899976223  ((int32_t)  7373)	/* FIX(0.899976223) */
+#define FIX_1_175875602  ((int32_t)  9633)	/* FIX(1.175875602) */
+#define FIX_1_501321110  ((int32_t) 12299)	/* FIX(1.501321110) */
+#define FIX_1_847759065  ((int32_t) 15137)	/* FIX(1.847759065) */
+#define FIX_1_961570560  ((int32_t) 16069)	/* FIX(1.961570560) */
+#define FIX_2_053119869  ((int32_t) 16819)	/* FIX(2.053119869) */
+#define FIX_2_562915447  ((int32_t) 20995)	/* FIX(2.562915447) */
+#define FIX_3_072711026  ((int32_t) 25172)	/* FIX(3.072711026) */
+
+#if defined(__GNUC__)
+typedef int32_t lanes_t __attribute__ ((vector_size (16)));
+#else
+typedef int32_t lanes_t;
+#endif
+#define NR_LANES (sizeof(lanes_t) / sizeof(int32_t))
+
+#define LOAD(v, p)  memcpy(&(v), (p), sizeof(lanes_t))
+#define STORE(p, v) memcpy((p), &(v), sizeof(lanes_t))
+
+/*
+ * 1-D IDCT on 8 lanes at once. in[k * 8 + lane] is input coefficient k of
+ * lane, the result for lane gets stored in out[k * 8 + lane] the same way,
+ * descaled by shift bits.
+ */
+static inline void
+idct_1d_8lanes(const int32_t *in, int32_t *out, int shift)
+{
+  lanes_t tmp0, tmp1, tmp2, tmp3;
+  lanes_t tmp10, tmp11, tmp12, tmp13;
+  lanes_t z1, z2, z3, z4, z5, res;
+  int32_t round = 1 << (shift - 1);
+  unsigned int l;
+
+  for (l = 0; l < DCTSIZE; l += NR_LANES) {
+    /* Even part: reverse the even part of the forward DCT. */
+
+    LOAD(z2, &in[DCTSIZE*2 + l]);
+    LOAD(z3, &in[DCTSIZE*6 + l]);
+
+    z1 = (z2 + z3) * FIX_0_541196100;
+    tmp2 = z1 - z3 * FIX_1_847759065;
+    tmp3 = z1 + z2 * FIX_0_765366865;
+
+    LOAD(z2, &in[DCTSIZE*0 + l]);
+    LOAD(z3, &in[DCTSIZE*4 + l]);
+
+    tmp0 = (z2 + z3) * (1 << CONST_BITS);
+    tmp1 = (z2 - z3) * (1 << CONST_BITS);
+
+    tmp10 = tmp0 + tmp3;
+    tmp13 = tmp0 - tmp3;
+    tmp11 = tmp1 + tmp2;
+    tmp12 = tmp1 - tmp2;
+
+    /* Odd part per figure 8; the matrix is unitary and hence its
+     * transpose is its inverse.
+     */
+
+    LOAD(tmp0, &in[DCTSIZE*7 + l]);
+    LOAD(tmp1, &in[DCTSIZE*5 + l]);
+    LOAD(tmp2, &in[DCTSIZE*3 + l]);
+    LOAD(tmp3, &in[DCTSIZE*1 + l]);
+
+    z1 = tmp0 + tmp3;
+    z2 = tmp1 + tmp2;
+    z3 = tmp0 + tmp2;
+    z4 = tmp1 + tmp3;
+    z5 = (z3 + z4) * FIX_1_175875602; /* sqrt(2) * c3 */
+
+    tmp0 = tmp0 * FIX_0_298631336; /* sqrt(2) * (-c1+c3+c5-c7) */
+    tmp1 = tmp1 * FIX_2_053119869; /* sqrt(2) * ( c1+c3-c5+c7) */
+    tmp2 = tmp2 * FIX_3_072711026; /* sqrt(2) * ( c1+c3+c5-c7) */
+    tmp3 = tmp3 * FIX_1_501321110; /* sqrt(2) * ( c1+c3-c5-c7) */
+    z1 = z1 * -FIX_0_899976223; /* sqrt(2) * ( c7-c3) */
+    z2 = z2 * -FIX_2_562915447; /* sqrt(2) * (-c1-c3) */
+    z3 = z3 * -FIX_1_961570560; /* sqrt(2) * (-c3-c5) */
+    z4 = z4 * -FIX_0_390180644; /* sqrt(2) * ( c5-c3) */
+
+    z3 += z5;
+    z4 += z5;
+
+    tmp0 += z1 + z3;
+    tmp1 += z2 + z4;
+    tmp2 += z2 + z3;
+    tmp3 += z1 + z4;
+
+    /* Final output stage */
+
+    res = (tmp10 + tmp3 + round) >> shift;
+    STORE(&out[DCTSIZE*0 + l], res);
+    res = (tmp10 - tmp3 + round) >> shift;
+    STORE(&out[DCTSIZE*7 + l], res);
+    res = (tmp11 + tmp2 + round) >> shift;
+    STORE(&out[DCTSIZE*1 + l], res);
+    res = (tmp11 - tmp2 + round) >> shift;
+    STORE(&out[DCTSIZE*6 + l], res);
+    res = (tmp12 + tmp1 + round) >> shift;
+    STORE(&out[DCTSIZE*2 + l], res);
+    res = (tmp12 - tmp1 + round) >> shift;
+    STORE(&out[DCTSIZE*5 + l], res);
+    res = (tmp13 + tmp0 + round) >> shift;
+    STORE(&out[DCTSIZE*3 + l], res);
+    res = (tmp13 - tmp0 + round) >> shift;
+    STORE(&out[DCTSIZE*4 + l], res);
+  }
+}
+
+/*
+ * Perform dequantization and inverse DCT on one block of coefficients.
+ */
+
+void
+tinyjpeg_idct_int (struct component *compptr, uint8_t *output_buf, int stride)
+{
+  int32_t coef[DCTSIZE2], workspace[DCTSIZE2];
+  int i, j, v, ac = 0;
+
+  /* Dequantize, the coefficients are in natural (row major) order */
+  for (i = 0; i < DCTSIZE2; i++)
+    coef[i] = compptr->DCT[i] * compptr->Qi_table[i];
+
+  /* With typical images and quantization tables a lot of blocks have
+   * only a DC term, in which case all outputs are equal to the (descaled)
+   * DC coefficient. This gives the exact same result as the full IDCT.
+   */
+  for (i = 1; i < DCTSIZE2; i++)
+    ac |= coef[i];
+
+  if (!ac) {
+    v = ((coef[0] * (1 << PASS1_BITS) + (1 << (PASS1_BITS+2))) >>
+         (PASS1_BITS+3)) + 128;
+    if (v < 0)
+      v = 0;
+    if (v > 255)
+      v = 255;
+    for (i = 0; i < DCTSIZE; i++) {
+      memset(output_buf, v, DCTSIZE);
+      output_buf += stride;
+    }
+    return;
+  }
+
+  /* Pass 1: process all columns from input at once, store into work
+   * array. The results are scaled up by sqrt(8) compared to a true IDCT;
+   * furthermore, we scale the results by 2**PASS1_BITS.
+   */
+  idct_1d_8lanes(coef, workspace, CONST_BITS-PASS1_BITS);
+
+  /* Transpose, so that the lanes of pass 2 are the rows of the block */
+  for (i = 0; i < DCTSIZE; i++)
+    for (j = 0; j < DCTSIZE; j++)
+      coef[j*DCTSIZE + i] = workspace[i*DCTSIZE + j];
+
+  /* Pass 2: process all rows from work array at once, descale by the
+   * factor of 8 and 2**PASS1_BITS left over from pass 1.
+   */
+  idct_1d_8lanes(coef, workspace, CONST_BITS+PASS1_BITS+3);
+
+  /* workspace is transposed, workspace[k * 8 + row] holds column k of row */
+  for (i = 0; i < DCTSIZE; i++) {
+    for (j = 0; j < DCTSIZE; j++) {
+      v = workspace[j*DCTSIZE + i] + 128;
+      if (v < 0)
+	v = 0;
+      if (v > 255)
+	v = 255;
+      output_buf[j] = v;
+    }
+    output_buf += stride;
+  }
+}
@@ -0,0 +1,126 @@
+/* test-idct.c
+ *
+ * Runs the integer IDCT of tinyjpeg on seeded coefficient blocks and
+ * compares every sample with the float IDCT it replaced, which may differ
+ * by at most 1. Covers blocks with only a DC term, which the integer IDCT
+ * fills without a transform and which have to match exactly, sparse
+ * blocks like those of heavily quantized images, and dense blocks that
+ * clip, written with a stride into a wider buffer like the luma blocks of
+ * an MCU.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "tinyjpeg-internal.h"
+
+#define NBLOCKS	20000
+#define STRIDE	16
+
+/* the scaling of the float quantization table, see tinyjpeg.c */
+static const double aanscalefactor[8] = {
+	1.0, 1.387039845, 1.306562965, 1.175875602,
+	1.0, 0.785694958, 0.541196100, 0.275899379
+};
+
+static unsigned int seed;
+
+static int
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* Fills a block of the given kind: DC only, sparse, or dense */
+static void
+make_block (struct component *c, int kind, int n)
+{
+	int i, q;
+
+	for (i = 0; i < 64; i++) {
+		q = (kind == 0) ? 1 + n % 8 : 1 + rnd () % 32;
+		c->Qi_table[i] = q;
+		c->Q_table[i] = q * aanscalefactor[i / 8] * aanscalefactor[i % 8];
+		c->DCT[i] = 0;
+	}
+	switch (kind) {
+	case 0:
+		/* every DC value, with small quantizers */
+		c->DCT[0] = (n % 2048) - 1024;
+		break;
+	case 1:
+		c->DCT[0] = rnd () % 256 - 128;
+		for (i = 1; i < 64; i++)
+			if (rnd () % 100 >= 80)
+				c->DCT[i] = rnd () % 41 - 20;
+		break;
+	default:
+		for (i = 0; i < 64; i++)
+			c->DCT[i] = rnd () % 201 - 100;
+		break;
+	}
+}
+
+int
+main (void)
+{
+	struct component	c;
+	float			qf[64];
+	int32_t			qi[64];
+	uint8_t			want[8 * STRIDE], have[8 * STRIDE];
+	int			kind, n, i, d, worst[3] = { 0, 0, 0 }, failed = 0;
+
+	memset (&c, 0, sizeof (c));
+	c.Q_table = qf;
+	c.Qi_table = qi;
+	seed = 1;
+	for (kind = 0; kind < 3; kind++) {
+		for (n = 0; n < NBLOCKS; n++) {
+			make_block (&c, kind, n);
+			memset (want, 0xaa, sizeof (want));
+			memset (have, 0xaa, sizeof (have));
+			tinyjpeg_idct_float (&c, want, STRIDE);
+			tinyjpeg_idct_int (&c, have, STRIDE);
+			for (i = 0; i < 8 * STRIDE; i++) {
+				d = abs (want[i] - have[i]);
+				if (d > worst[kind])
+					worst[kind] = d;
+				/* right of the block, nothing may be written */
+				if ((i % STRIDE >= 8) && (have[i] != 0xaa))
+					d = 256;
+				/* the DC only shortcut gives what the full
+				 * transform gives, which rounds like the float one */
+				if ((d > 1) || (!kind && d)) {
+					printf ("FAIL: block kind %d number %d: sample %d is %d, float IDCT %d\n",
+						kind, n, i, have[i], want[i]);
+					failed++;
+					break;
+				}
+			}
+			if (failed > 10)
+				return 1;
+		}
+	}
+	printf ("largest difference: %d for DC only, %d sparse, %d dense blocks\n",
+		worst[0], worst[1], worst[2]);
+	return failed ? 1 : 0;
+}
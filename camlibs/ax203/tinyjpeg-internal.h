@@ -76,6 +76,7 @@ struct component
   unsigned int Hfactor;
   unsigned int Vfactor;
   float *Q_table;		/* Pointer to the quantisation table to use */
+  int32_t *Qi_table;		/* Same table, unscaled for the integer IDCT */
   struct huffman_table *AC_table;
   struct huffman_table *DC_table;
   short int previous_DC;	/* Previous DC coefficient */
@@ -102,6 +103,7 @@ struct jdec_private
 
   struct component component_infos[COMPONENTS];
   float Q_tables[COMPONENTS][64];		/* quantization tables */
+  int32_t Qi_tables[COMPONENTS][64];	/* integer IDCT quantization tables */
   struct huffman_table HTDC[HUFFMAN_TABLES];	/* DC huffman tables   */
   struct huffman_table HTAC[HUFFMAN_TABLES];	/* AC huffman tables   */
   int default_huffman_table_initialized;
@@ -116,7 +118,8 @@ struct jdec_private
   char error_string[256];
 };
 
-#define IDCT tinyjpeg_idct_float
+#define IDCT tinyjpeg_idct_int
 void tinyjpeg_idct_float (struct component *compptr, uint8_t *output_buf, int stride);
+void tinyjpeg_idct_int (struct component *compptr, uint8_t *output_buf, int stride);
 
 #endif /* !defined(CAMLIBS_AX203_TINYJPEG_INTERNAL_H) */
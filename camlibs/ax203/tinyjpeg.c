@@ -386,16 +386,35 @@ static int build_huffman_table(struct jdec_private *priv, const unsigned char *b
  *
  ******************************************************************************/
 
-static unsigned char clamp(int i)
+static inline unsigned char clamp(int i)
 {
-  if (i<0)
-    return 0;
-  else if (i>255)
-    return 255;
-  else
-    return i;
+  /* Written as min / max so that it vectorizes, see below */
+  i = i < 0 ? 0 : i;
+  return i > 255 ? 255 : i;
 }
 
+#define SCALEBITS       10
+#define ONE_HALF        (1UL << (SCALEBITS-1))
+#define FIX(x)          ((int)((x) * (1UL<<SCALEBITS) + 0.5))
+
+/*
+ * Compute the per chroma sample R, G and B offsets for one row of 8 chroma
+ * samples. This and the per pixel loops in the converters below use fixed
+ * trip counts and no branches, so that the compiler can vectorize them.
+ */
+static inline void YCrCb_row_offsets(const unsigned char *Cb, const unsigned char *Cr,
+                                     int *add_r, int *add_g, int *add_b)
+{
+  int j, cb, cr;
+
+  for (j=0; j<8; j++) {
+     cb = Cb[j] - 128;
+     cr = Cr[j] - 128;
+     add_r[j] = FIX(1.40200) * cr + ONE_HALF;
+     add_g[j] = - FIX(0.34414) * cb - FIX(0.71414) * cr + ONE_HALF;
+     add_b[j] = FIX(1.77200) * cb + ONE_HALF;
+  }
+}
 
 /**
  *  YCrCb -> RGB24 (1x1)
@@ -407,49 +426,29 @@ static void YCrCB_to_RGB24_1x1(struct jdec_private *priv)
 {
   const unsigned char *Y, *Cb, *Cr;
   unsigned char *p;
-  int i,j;
-  int offset_to_next_row;
-
-#define SCALEBITS       10
-#define ONE_HALF        (1UL << (SCALEBITS-1))
-#define FIX(x)          ((int)((x) * (1UL<<SCALEBITS) + 0.5))
+  int add_r[8], add_g[8], add_b[8];
+  int i, j, y;
 
   p = priv->plane[0];
   Y = priv->Y;
   Cb = priv->Cb;
   Cr = priv->Cr;
-  offset_to_next_row = priv->width*3 - 8*3;
   for (i=0; i<8; i++) {
 
-    for (j=0; j<8; j++) {
-
-       int y, cb, cr;
-       int add_r, add_g, add_b;
-       int r, g , b;
-
-       y  = (*Y++) << SCALEBITS;
-       cb = *Cb++ - 128;
-       cr = *Cr++ - 128;
-       add_r = FIX(1.40200) * cr + ONE_HALF;
-       add_g = - FIX(0.34414) * cb - FIX(0.71414) * cr + ONE_HALF;
-       add_b = FIX(1.77200) * cb + ONE_HALF;
-
-       r = (y + add_r) >> SCALEBITS;
-       *p++ = clamp(r);
-       g = (y + add_g) >> SCALEBITS;
-       *p++ = clamp(g);
-       b = (y + add_b) >> SCALEBITS;
-       *p++ = clamp(b);
+    YCrCb_row_offsets(Cb, Cr, add_r, add_g, add_b);
 
+    for (j=0; j<8; j++) {
+       y = Y[j] << SCALEBITS;
+       p[3*j + 0] = clamp((y + add_r[j]) >> SCALEBITS);
+       p[3*j + 1] = clamp((y + add_g[j]) >> SCALEBITS);
+       p[3*j + 2] = clamp((y + add_b[j]) >> SCALEBITS);
     }
 
-    p += offset_to_next_row;
+    Y  += 8;
+    Cb += 8;
+    Cr += 8;
+    p  += priv->width*3;
   }
-
-#undef SCALEBITS
-#undef ONE_HALF
-#undef FIX
-
 }
 
 /**
@@ -464,76 +463,42 @@ static void YCrCB_to_RGB24_2x2(struct jdec_private *priv)
 {
   const unsigned char *Y, *Cb, *Cr;
   unsigned char *p, *p2;
-  int i,j;
-  int offset_to_next_row;
-
-#define SCALEBITS       10
-#define ONE_HALF        (1UL << (SCALEBITS-1))
-#define FIX(x)          ((int)((x) * (1UL<<SCALEBITS) + 0.5))
+  int add_r[8], add_g[8], add_b[8];
+  int i, j, y;
 
   p = priv->plane[0];
   p2 = priv->plane[0] + priv->width*3;
   Y = priv->Y;
   Cb = priv->Cb;
   Cr = priv->Cr;
-  offset_to_next_row = (priv->width*3*2) - 16*3;
   for (i=0; i<8; i++) {
 
-    for (j=0; j<8; j++) {
+    YCrCb_row_offsets(Cb, Cr, add_r, add_g, add_b);
+
+    for (j=0; j<16; j++) {
+       y = Y[j] << SCALEBITS;
+       p[3*j + 0] = clamp((y + add_r[j/2]) >> SCALEBITS);
+       p[3*j + 1] = clamp((y + add_g[j/2]) >> SCALEBITS);
+       p[3*j + 2] = clamp((y + add_b[j/2]) >> SCALEBITS);
 
-       int y, cb, cr;
-       int add_r, add_g, add_b;
-       int r, g , b;
-
-       cb = *Cb++ - 128;
-       cr = *Cr++ - 128;
-       add_r = FIX(1.40200) * cr + ONE_HALF;
-       add_g = - FIX(0.34414) * cb - FIX(0.71414) * cr + ONE_HALF;
-       add_b = FIX(1.77200) * cb + ONE_HALF;
-
-       y  = (*Y++) << SCALEBITS;
-       r = (y + add_r) >> SCALEBITS;
-       *p++ = clamp(r);
-       g = (y + add_g) >> SCALEBITS;
-       *p++ = clamp(g);
-       b = (y + add_b) >> SCALEBITS;
-       *p++ = clamp(b);
-
-       y  = (*Y++) << SCALEBITS;
-       r = (y + add_r) >> SCALEBITS;
-       *p++ = clamp(r);
-       g = (y + add_g) >> SCALEBITS;
-       *p++ = clamp(g);
-       b = (y + add_b) >> SCALEBITS;
-       *p++ = clamp(b);
-
-       y  = (Y[16-2]) << SCALEBITS;
-       r = (y + add_r) >> SCALEBITS;
-       *p2++ = clamp(r);
-       g = (y + add_g) >> SCALEBITS;
-       *p2++ = clamp(g);
-       b = (y + add_b) >> SCALEBITS;
-       *p2++ = clamp(b);
-
-       y  = (Y[16-1]) << SCALEBITS;
-       r = (y + add_r) >> SCALEBITS;
-       *p2++ = clamp(r);
-       g = (y + add_g) >> SCALEBITS;
-       *p2++ = clamp(g);
-       b = (y + add_b) >> SCALEBITS;
-       *p2++ = clamp(b);
+       y = Y[16 + j] << SCALEBITS;
+       p2[3*j + 0] = clamp((y + add_r[j/2]) >> SCALEBITS);
+       p2[3*j + 1] = clamp((y + add_g[j/2]) >> SCALEBITS);
+       p2[3*j + 2] = clamp((y + add_b[j/2]) >> SCALEBITS);
     }
-    Y  += 16;
-    p  += offset_to_next_row;
-    p2 += offset_to_next_row;
+
+    Y  += 32;
+    Cb += 8;
+    Cr += 8;
+    p  += priv->width*3*2;
+    p2 += priv->width*3*2;
   }
+}
 
 #undef SCALEBITS
 #undef ONE_HALF
 #undef FIX
 
-}
-
 /*
  * Decode all the 3 components for 1x1
  */
@@ -594,7 +559,7 @@ static void decode_MCU_2x2_3planes(struct jdec_private *priv, int block_nr)
 }
 
 
-static void build_quantization_table(float *qtable, const unsigned char *ref_table)
+static void build_quantization_table(float *qtable, int32_t *qitable, const unsigned char *ref_table)
 {
   /* Taken from libjpeg. Copyright Independent JPEG Group's LLM idct.
    * For float AA&N IDCT method, divisors are equal to quantization
@@ -614,6 +579,8 @@ static void build_quantization_table(float *qtable, const unsigned char *ref_tab
 
   for (i=0; i<8; i++) {
      for (j=0; j<8; j++) {
+       /* The integer (LL&M) IDCT wants the plain divisors */
+       *qitable++ = ref_table[*zz];
        *qtable++ = ref_table[*zz++] * aanscalefactor[i] * aanscalefactor[j];
      }
    }
@@ -641,7 +608,7 @@ static int parse_DQT(struct jdec_private *priv, const unsigned char *stream)
 	 COMPONENTS, qi + 1);
 #endif
      table = priv->Q_tables[qi];
-     build_quantization_table(table, stream);
+     build_quantization_table(table, priv->Qi_tables[qi], stream);
      stream += 64;
    }
   trace("< DQT marker\n");
@@ -805,6 +772,7 @@ int tinyjpeg_parse_header(struct jdec_private *priv, const unsigned char *buf, u
        error("Invalid AC huffman table nr: %d\n", stream[11 + i]);
 
      c->Q_table = priv->Q_tables[stream[5 + i]];
+     c->Qi_table = priv->Qi_tables[stream[5 + i]];
      c->DC_table = &priv->HTDC[stream[8 + i]];
      c->AC_table = &priv->HTAC[stream[11 + i]];
      trace("Component:%d  factor:%dx%d  QT:%d AC:%d DC:%d\n",
@@ -3496,6 +3496,43 @@ canon_int_get_file (Camera *camera, const char *name, unsigned char **data, unsi
         }
 }
 
+/**
+ * canon_int_get_file_to_file:
+ * @camera:
+ * @name: name of file to fetch
+ * @file: #CameraFile to append the file contents to
+ * @length: to receive the length of the file
+ * @context: context for error reporting
+ *
+ * Like canon_int_get_file(), but writes the file into @file. Over USB
+ * the file is streamed there as it arrives.
+ *
+ * Returns: gphoto2 error code, length of file in @length.
+ *
+ */
+int
+canon_int_get_file_to_file (Camera *camera, const char *name, CameraFile *file,
+                            unsigned int *length, GPContext *context)
+{
+        unsigned char *data = NULL;
+        int res;
+
+        switch (camera->port->type) {
+                case GP_PORT_USB:
+                        return canon_usb_get_file_to_file (camera, name, file, length, context);
+                        break;
+                case GP_PORT_SERIAL:
+                        data = canon_serial_get_file (camera, name, length, context);
+                        if (!data)
+                                return GP_ERROR_OS_FAILURE;
+                        res = gp_file_append (file, (char *)data, *length);
+                        free (data);
+                        return res;
+                        break;
+                GP_PORT_DEFAULT
+        }
+}
+
 /**
  * canon_int_get_thumbnail:
  * @camera: camera to work with
@@ -485,6 +485,11 @@ struct _CameraPrivateLibrary
 	unsigned char seq_tx;
 	unsigned char seq_rx;
 
+	/* serial receive state, see canon_serial_recv_frame() */
+	unsigned char rx_cache[1024]; /* raw bytes read from the port */
+	int rx_pos, rx_end;           /* unconsumed part of rx_cache */
+	unsigned char rx_frame[5000]; /* unescaped contents of the last frame */
+
 	/* driver settings
 	 * leave these as int, as gp_widget_get_value sets them as int!
 	 */
@@ -693,6 +698,7 @@ int canon_int_list_directory (Camera *camera, const char *folder, CameraList *li
 int canon_int_get_info_func (Camera *camera, const char *folder, const char *filename, CameraFileInfo * info, GPContext *context);
 
 int canon_int_get_file(Camera *camera, const char *name, unsigned char **data, unsigned int *length, GPContext *context);
+int canon_int_get_file_to_file(Camera *camera, const char *name, CameraFile *file, unsigned int *length, GPContext *context);
 int canon_int_get_thumbnail(Camera *camera, const char *name, unsigned char **retdata, unsigned int *length, GPContext *context);
 int canon_int_put_file(Camera *camera, CameraFile *file, const char *filename, const char *destname, const char *destpath, GPContext *context);
 int canon_int_wait_for_event (Camera *camera, int timeout, CameraEventType *eventtype, void **eventdata, GPContext *context);
@@ -714,7 +714,7 @@ get_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 	unsigned char *data = NULL, *thumbdata = NULL;
 	const char *thumbname = NULL;
 	const char *audioname = NULL;
-	int ret;
+	int ret, streamed = 0;
 	unsigned int datalen;
 	char canon_path[300];
 
@@ -759,8 +759,10 @@ get_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 	/* fetch file/thumbnail/exif/audio/whatever */
 	switch (type) {
 		case GP_FILE_TYPE_NORMAL:
-			ret = canon_int_get_file (camera, canon_path, &data, &datalen,
-						  context);
+			/* Large files go straight into the CameraFile */
+			ret = canon_int_get_file_to_file (camera, canon_path, file,
+							  &datalen, context);
+			streamed = 1;
 			if (ret == GP_OK) {
 				/* 0 also marks image as downloaded */
 				uint8_t attr = 0;
@@ -789,8 +791,9 @@ get_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 		case GP_FILE_TYPE_AUDIO:
 			if (*audioname != '\0') {
 				/* extra audio file */
-				ret = canon_int_get_file (camera, audioname, &data, &datalen,
-							  context);
+				ret = canon_int_get_file_to_file (camera, audioname, file,
+								  &datalen, context);
+				streamed = 1;
 			} else {
 				/* internal audio file; not handled yet */
 				ret = GP_ERROR_NOT_SUPPORTED;
@@ -868,6 +871,19 @@ get_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 		return ret;
 	}
 
+	if (streamed) {
+		if (datalen < 256) {
+			GP_DEBUG ("get_file_func: datalen < 256 (datalen = %i = 0x%x)", datalen,
+				  datalen);
+			return GP_ERROR_CORRUPTED_DATA;
+		}
+		if (type == GP_FILE_TYPE_AUDIO)
+			gp_file_set_mime_type (file, GP_MIME_WAV);
+		else
+			gp_file_set_mime_type (file, filename2mimetype (filename));
+		return GP_OK;
+	}
+
 	if (data == NULL) {
 		GP_DEBUG ("get_file_func: Fatal error: data == NULL");
 		return GP_ERROR_CORRUPTED_DATA;
@@ -913,15 +929,6 @@ get_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 			gp_file_set_mime_type (file, GP_MIME_JPEG);	/* always */
 			break;
 
-		case GP_FILE_TYPE_AUDIO:
-			gp_file_set_mime_type (file, GP_MIME_WAV);
-			gp_file_set_data_and_size (file, (char *)data, datalen);
-			break;
-
-		case GP_FILE_TYPE_NORMAL:
-			gp_file_set_mime_type (file, filename2mimetype (filename));
-			gp_file_set_data_and_size (file, (char *)data, datalen);
-			break;
 #ifdef HAVE_LIBEXIF
 		case GP_FILE_TYPE_EXIF:
 			if ( !is_cr2 ( filename ) )
@@ -205,41 +205,41 @@ serial_set_timeout (GPPort *gdev, int to)
 }
 
 /**
- * canon_serial_get_byte
- * @gdev: serial port to use
+ * canon_serial_fill_cache
+ * @camera: Camera object to work with
+ * @want: number of bytes the current frame is known to still contain
  *
- * Gets the next byte from the serial line.
- * Actually the function reads chunks of data and keeps them in a cache.
- * Only one byte per call will be returned.
+ * Makes sure there is unconsumed data in the receive cache.  If the
+ * cache is empty, it is refilled with a single read of @want bytes
+ * (capped to the size of the cache). Callers never ask for more than
+ * the frame being received is guaranteed to hold, so the read returns
+ * as soon as those bytes have arrived and never eats into the next
+ * frame.
  *
- * Returns: the byte on success, -1 on error.
+ * Returns: number of bytes available in the cache, -1 on error.
  *
  */
 static int
-canon_serial_get_byte (GPPort *gdev)
+canon_serial_fill_cache (Camera *camera, int want)
 {
-	static unsigned char cache[512];
-	static unsigned char *cachep = cache;
-	static unsigned char *cachee = cache;
+	CameraPrivateLibrary *pl = camera->pl;
 	int recv;
 
-	/* if still data in cache, get it */
-	if (cachep < cachee) {
-		return (int) *cachep++;
-	}
-
-	recv = gp_port_read (gdev, (char *)cache, 1);
-	if (recv < 0)		/* An error occurred */
-		return -1;
+	if (pl->rx_pos < pl->rx_end)
+		return pl->rx_end - pl->rx_pos;
 
-	cachep = cache;
-	cachee = cache + recv;
+	if (want < 1)
+		want = 1;
+	if (want > (int) sizeof (pl->rx_cache))
+		want = sizeof (pl->rx_cache);
 
-	if (recv) {
-		return (int) *cachep++;
-	}
+	recv = gp_port_read (camera->port, (char *)pl->rx_cache, want);
+	if (recv <= 0)		/* An error occurred */
+		return -1;
 
-	return -1;
+	pl->rx_pos = 0;
+	pl->rx_end = recv;
+	return recv;
 }
 
 /* ------------------------- Frame-level processing ------------------------- */
@@ -288,37 +288,87 @@ canon_serial_send_frame (Camera *camera, const unsigned char *pkt, int len)
  * canon_serial_recv_frame
  * @camera: Camera object to work with
  * @len:    to receive the length of the buffer
+ * @packet: whether the frame carries a packet header
  *
  * Receive a frame from the camera
  *
+ * For frames carrying a packet (see canon_serial_recv_packet()), the
+ * header tells how many bytes are still to come, which lets the port
+ * be read in bulk instead of byte by byte.
+ *
  * Returns: a buffer containing a frame from the camera, or NULL on error.
  *          On success, @len will contain the length of the buffer.
  *
  */
 static unsigned char *
-canon_serial_recv_frame (Camera *camera, int *len)
+canon_serial_recv_frame (Camera *camera, int *len, int packet)
 {
-	static unsigned char buffer[5000];
+	CameraPrivateLibrary *pl = camera->pl;
 
 	/* more than enough :-) (allow for a few run-together packets) */
+	unsigned char *buffer = pl->rx_frame;
 	unsigned char *p = buffer;
-	int c;
+	unsigned char *s, *fbeg, *fend, *esc;
+	int n, run, need, expected, escaped = 0;
 
-	while ((c = canon_serial_get_byte (camera->port)) != CANON_FBEG) {
-		if (c == -1)
+	/* skip everything up to the beginning of the frame */
+	while (1) {
+		n = canon_serial_fill_cache (camera, 1);
+		if (n < 0)
 			return NULL;
+		s = pl->rx_cache + pl->rx_pos;
+		fbeg = memchr (s, CANON_FBEG, n);
+		if (fbeg) {
+			pl->rx_pos += fbeg - s + 1;
+			break;
+		}
+		pl->rx_pos = pl->rx_end;
 	}
-	while ((c = canon_serial_get_byte (camera->port)) != CANON_FEND) {
-		if (c < 0)
+
+	while (1) {
+		/* The frame still holds at least the unescaped bytes we know
+		 * about plus CANON_FEND; escaping only ever adds to that. */
+		need = 1;
+		if (packet) {
+			expected = PKT_HDR_LEN + 2;
+			if (p - buffer >= PKT_HDR_LEN && buffer[PKT_TYPE] == PKT_MSG)
+				expected += buffer[PKT_LEN_LSB] | (buffer[PKT_LEN_MSB] << 8);
+			if (p - buffer < expected)
+				need += expected - (p - buffer);
+		}
+		n = canon_serial_fill_cache (camera, need);
+		if (n < 0)
 			return NULL;
-		if (c == CANON_ESC)
-			c = canon_serial_get_byte (camera->port) ^ CANON_XOR;
-		if (p < buffer ||
-		    (unsigned int)(p - buffer) >= sizeof (buffer)) {
+		s = pl->rx_cache + pl->rx_pos;
+
+		if (escaped) {
+			run = 1;
+			fend = esc = NULL;
+		} else {
+			/* copy everything up to the next delimiter in one go */
+			fend = memchr (s, CANON_FEND, n);
+			esc = memchr (s, CANON_ESC, fend ? fend - s : n);
+			run = (esc ? esc : fend ? fend : s + n) - s;
+		}
+		if (run > (int) sizeof (pl->rx_frame) - (p - buffer)) {
 			GP_DEBUG ("FATAL ERROR: receive buffer overflow");
 			return NULL;
 		}
-		*p++ = c;
+		memcpy (p, s, run);
+		if (escaped) {
+			*p ^= CANON_XOR;
+			escaped = 0;
+		}
+		p += run;
+		pl->rx_pos += run;
+
+		if (esc) {
+			pl->rx_pos++;
+			escaped = 1;
+		} else if (fend) {
+			pl->rx_pos++;
+			break;
+		}
 	}
 
 	GP_LOG_DATA ((char *)buffer, p - buffer, "RECV (without CANON_FBEG and CANON_FEND bytes)");
@@ -402,7 +452,7 @@ canon_serial_recv_packet (Camera *camera, unsigned char *type, unsigned char *se
 	unsigned short crc;
 	int raw_length, length = 0;
 
-	pkt = canon_serial_recv_frame (camera, &raw_length);
+	pkt = canon_serial_recv_frame (camera, &raw_length, 1);
 	if (!pkt)
 		return NULL;
 	if (raw_length < PKT_HDR_LEN) {
@@ -1321,7 +1371,7 @@ canon_serial_ready (Camera *camera, GPContext *context)
 			gp_context_error (context, _("Communication error 1"));
 			return GP_ERROR;
 		}
-		pkt = canon_serial_recv_frame (camera, &len);
+		pkt = canon_serial_recv_frame (camera, &len, 0);
 		gp_context_progress_update (context, id, try + 1);
 		if (pkt)
 			break;
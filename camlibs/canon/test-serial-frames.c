@@ -0,0 +1,198 @@
+/* test-serial-frames.c
+ *
+ * Receives packets through canon_serial_recv_packet() from a stand-in for
+ * gp_port_read(), which serves a stream of escaped frames with line noise
+ * between them in pieces of a given size, like a UART does. Checks that
+ * every packet arrives with its type, sequence number and payload, that
+ * a frame with a bad CRC is dropped without losing the next one, and that
+ * no read asks for bytes past the end of the frame being received.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "serial.c"
+
+#define NPACKETS	400
+#define BAD_CRC		77	/* this packet is sent with a broken CRC */
+
+static unsigned char	stream[NPACKETS * 2200];
+static int		frame_end[NPACKETS];	/* offset after each CANON_FEND */
+static int		stream_len, pos, chunk, nframes, overreads;
+static unsigned int	seed;
+
+static int
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* payload bytes, with plenty of the framing bytes that need escaping */
+static unsigned char
+payload_byte (int i, int j)
+{
+	static const unsigned char special[] = { CANON_FBEG, CANON_FEND, CANON_ESC, CANON_XOR };
+
+	if ((i + j) % 5 == 0)
+		return special[(i + j) % 4];
+	return (i * 7 + j * 13) & 0xff;
+}
+
+static int
+packet_type (int i)
+{
+	return (i % 10 == 3) ? PKT_EOT : (i % 10 == 6) ? PKT_ACK : PKT_MSG;
+}
+
+static int
+packet_len (int i)
+{
+	return (packet_type (i) == PKT_MSG) ? 1 + (i * 37) % 1000 : 0;
+}
+
+static void
+build_stream (void)
+{
+	unsigned char	pkt[1100];
+	int		i, j, n, crc;
+
+	seed = 1;
+	stream_len = 0;
+	for (i = 0; i < NPACKETS; i++) {
+		/* noise on the line before the frame */
+		n = rnd () % 4;
+		while (n--)
+			stream[stream_len++] = (rnd () % 3) ? rnd () & 0x7f : CANON_FEND;
+
+		pkt[PKT_SEQ] = i;
+		pkt[PKT_TYPE] = packet_type (i);
+		pkt[PKT_LEN_LSB] = packet_len (i);
+		pkt[PKT_LEN_MSB] = packet_len (i) >> 8;
+		n = PKT_HDR_LEN;
+		for (j = 0; j < packet_len (i); j++)
+			pkt[n++] = payload_byte (i, j);
+		/* ACK and EOT packets carry two bytes past the header */
+		if (packet_type (i) != PKT_MSG) {
+			pkt[n++] = CANON_FEND;
+			pkt[n++] = i;
+		}
+		crc = canon_psa50_gen_crc (pkt, n);
+		if (i == BAD_CRC)
+			crc ^= 1;
+		pkt[n++] = crc;
+		pkt[n++] = crc >> 8;
+
+		stream[stream_len++] = CANON_FBEG;
+		for (j = 0; j < n; j++) {
+			if (pkt[j] == CANON_FBEG || pkt[j] == CANON_FEND || pkt[j] == CANON_ESC) {
+				stream[stream_len++] = CANON_ESC;
+				stream[stream_len++] = pkt[j] ^ CANON_XOR;
+			} else
+				stream[stream_len++] = pkt[j];
+		}
+		stream[stream_len++] = CANON_FEND;
+		frame_end[i] = stream_len;
+	}
+}
+
+/* The camera side: at most chunk bytes per read. A read may not reach
+ * past the end of the frame it starts in, the driver could not know
+ * those bytes are there. */
+int
+gp_port_read (GPPort *port, char *data, int size)
+{
+	int i;
+
+	if (pos >= stream_len)
+		return GP_ERROR_TIMEOUT;
+	while (nframes < NPACKETS && frame_end[nframes] <= pos)
+		nframes++;
+	if (pos + size > frame_end[nframes])
+		overreads++;
+	if (size > chunk)
+		size = chunk;
+	if (size > stream_len - pos)
+		size = stream_len - pos;
+	for (i = 0; i < size; i++)
+		data[i] = stream[pos + i];
+	pos += size;
+	return size;
+}
+
+static int
+receive_all (Camera *camera, int piece)
+{
+	unsigned char	*pkt, type, seq;
+	int		i, j, len;
+
+	pos = nframes = overreads = 0;
+	chunk = piece;
+	camera->pl->rx_pos = camera->pl->rx_end = 0;
+	for (i = 0; i < NPACKETS; i++) {
+		if (i == BAD_CRC) {
+			if (canon_serial_recv_packet (camera, &type, &seq, &len)) {
+				printf ("FAIL: %d byte reads: packet with bad CRC accepted\n", piece);
+				return 1;
+			}
+			continue;
+		}
+		pkt = canon_serial_recv_packet (camera, &type, &seq, &len);
+		if (!pkt || (type != packet_type (i)) || (seq != (i & 0xff)) ||
+		    (len != packet_len (i))) {
+			printf ("FAIL: %d byte reads: packet %d lost or mangled\n", piece, i);
+			return 1;
+		}
+		/* ACK and EOT packets are returned with their header */
+		if ((type != PKT_MSG) && ((pkt[PKT_HDR_LEN] != CANON_FEND) ||
+					  (pkt[PKT_HDR_LEN + 1] != (i & 0xff)))) {
+			printf ("FAIL: %d byte reads: packet %d differs\n", piece, i);
+			return 1;
+		}
+		for (j = 0; j < len; j++)
+			if (pkt[j] != payload_byte (i, j)) {
+				printf ("FAIL: %d byte reads: payload of packet %d differs\n", piece, i);
+				return 1;
+			}
+	}
+	if (canon_serial_recv_packet (camera, &type, &seq, &len)) {
+		printf ("FAIL: %d byte reads: packet after the end of the stream\n", piece);
+		return 1;
+	}
+	if (overreads) {
+		printf ("FAIL: %d byte reads: %d reads past the end of a frame\n", piece, overreads);
+		return 1;
+	}
+	printf ("%d byte reads: %d packets\n", piece, NPACKETS - 1);
+	return 0;
+}
+
+int
+main (void)
+{
+	Camera *camera;
+
+	build_stream ();
+	gp_camera_new (&camera);
+	camera->pl = calloc (1, sizeof (CameraPrivateLibrary));
+
+	if (receive_all (camera, 1) || receive_all (camera, 3) ||
+	    receive_all (camera, 64) || receive_all (camera, 4096))
+		return 1;
+
+	free (camera->pl);
+	camera->pl = NULL;
+	gp_camera_free (camera);
+	return 0;
+}
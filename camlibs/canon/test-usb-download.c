@@ -0,0 +1,195 @@
+/* test-usb-download.c
+ *
+ * Downloads files over a stand-in for the USB port functions, which
+ * answers a GET_FILE request with the length packet and then streams the
+ * file contents like bulk reads do. Checks that the data arrives intact,
+ * in memory and streamed into an fd-backed CameraFile, that no read asks
+ * for more than the transfer length the camera announced, and that short
+ * reads by the camera are handled.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gphoto2/gphoto2.h>
+
+#include "canon.h"
+#include "usb.h"
+
+#define NAME	"D:\\DCIM\\100CANON\\IMG_0001.CR2"
+
+static unsigned int	file_size, camera_max, pos, state;
+static unsigned int	nreads, max_request;
+
+static unsigned char
+byte_at (unsigned int i)
+{
+	return (unsigned char)(i * 2654435761u >> 13);
+}
+
+/* The camera side: every command is a GET_FILE, the first read after it
+ * gets the length packet, later reads get at most camera_max bytes of
+ * the file */
+int
+gp_port_usb_msg_write (GPPort *port, int request, int value, int index,
+		       char *bytes, int size)
+{
+	state = 1;
+	pos = 0;
+	return size;
+}
+
+int
+gp_port_usb_msg_read (GPPort *port, int request, int value, int index,
+		      char *bytes, int size)
+{
+	return GP_ERROR_IO_READ;
+}
+
+int
+gp_port_read (GPPort *port, char *data, int size)
+{
+	unsigned int i, n = size;
+
+	if (state == 1) {
+		memset (data, 0, size);
+		data[6] = file_size;
+		data[7] = file_size >> 8;
+		data[8] = file_size >> 16;
+		data[9] = file_size >> 24;
+		state = 2;
+		return size;
+	}
+	nreads++;
+	if (n > max_request)
+		max_request = n;
+	if (n > camera_max)
+		n = camera_max;
+	if (n > file_size - pos)
+		n = file_size - pos;
+	for (i = 0; i < n; i++)
+		data[i] = byte_at (pos + i);
+	pos += n;
+	return n;
+}
+
+static int
+same_data (const unsigned char *data, unsigned int len)
+{
+	unsigned int i;
+
+	if (len != file_size)
+		return 0;
+	for (i = 0; i < len; i++)
+		if (data[i] != byte_at (i))
+			return 0;
+	return 1;
+}
+
+static int
+download (Camera *camera, unsigned int size, unsigned int xfer_length,
+	  unsigned int cam_max)
+{
+	CameraFile	*file;
+	unsigned char	*data = NULL;
+	unsigned int	len = 0;
+	char		path[] = "/tmp/gphoto2-canon-XXXXXX";
+	const char	*fdata;
+	unsigned long	fsize;
+	int		fd, ret;
+
+	file_size = size;
+	camera_max = cam_max;
+	camera->pl->xfer_length = xfer_length;
+
+	/* into memory */
+	nreads = max_request = 0;
+	ret = canon_usb_get_file (camera, NAME, &data, &len, NULL);
+	if ((ret != GP_OK) || !same_data (data, len)) {
+		printf ("FAIL: %u bytes in memory: %d, data differs\n", size, ret);
+		return 1;
+	}
+	free (data);
+	if (max_request > xfer_length) {
+		printf ("FAIL: read of %u bytes, camera announced %u\n", max_request, xfer_length);
+		return 1;
+	}
+
+	/* streamed into a file */
+	nreads = max_request = 0;
+	fd = mkstemp (path);
+	if (fd == -1) {
+		perror ("mkstemp");
+		return 1;
+	}
+	gp_file_new_from_fd (&file, fd);
+	ret = canon_usb_get_file_to_file (camera, NAME, file, &len, NULL);
+	gp_file_unref (file);
+	close (fd);
+	gp_file_new (&file);
+	gp_file_open (file, path);
+	gp_file_get_data_and_size (file, &fdata, &fsize);
+	if ((ret != GP_OK) || (len != fsize) || !same_data ((unsigned char *)fdata, fsize)) {
+		printf ("FAIL: %u bytes to file: %d, data differs\n", size, ret);
+		return 1;
+	}
+	gp_file_unref (file);
+	unlink (path);
+	if (max_request > xfer_length) {
+		printf ("FAIL: read of %u bytes, camera announced %u\n", max_request, xfer_length);
+		return 1;
+	}
+
+	printf ("%8u bytes, transfer length 0x%x, camera delivers up to 0x%x: %u reads\n",
+		size, xfer_length, cam_max, nreads);
+	return 0;
+}
+
+int
+main (void)
+{
+	static struct canonCamModelData	md;
+	const struct canonCamModelData	*m;
+	Camera				*camera;
+
+	gp_camera_new (&camera);
+	camera->pl = calloc (1, sizeof (CameraPrivateLibrary));
+	for (m = models; strcmp (m->id_str, "Canon:EOS D60"); m++)
+		;
+	md = *m;
+	md.max_movie_size = 0;
+	camera->pl->md = &md;
+
+	if (download (camera, 100, USB_BULK_READ_SIZE, 0x100000) ||
+	    download (camera, 333, USB_BULK_READ_SIZE, 0x100000) ||
+	    download (camera, 1000003, USB_BULK_READ_SIZE, 0x100000) ||
+	    download (camera, 3 * 1024 * 1024 + 7, USB_BULK_READ_SIZE, 0x100000) ||
+	    /* the camera takes more per read than the default */
+	    download (camera, 3 * 1024 * 1024 + 7, 0x10000, 0x100000) ||
+	    /* the camera delivers less than it was asked for */
+	    download (camera, 1000003, USB_BULK_READ_SIZE, 0x1000))
+		return 1;
+
+	free (camera->pl);
+	camera->pl = NULL;
+	gp_camera_free (camera);
+	return 0;
+}
@@ -1632,35 +1632,17 @@ canon_usb_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned int
 }
 
 
-/**
- * canon_usb_long_dialogue:
- * @camera: the Camera to work with
- * @canon_funct: integer constant that identifies function we are execute
- * @data: Pointer to pointer to allocated memory holding the data returned from the camera
- * @data_length: Pointer to where you want the number of bytes read from the camera
- * @max_data_size: Max realistic data size so that we can abort if something goes wrong
- * @payload: data we are to send to the camera
- * @payload_length: length of #payload
- * @display_status: Whether you want progress bar for this operation or not
- * @context: context for error reporting
- *
- * This function is used to invoke camera commands which return L (long) data.
- * It calls #canon_usb_dialogue(), if it gets a good response it will malloc()
- * memory and read the entire returned data into this malloc'd memory and store
- * a pointer to the malloc'd memory in 'data'.
- *
- * Returns: gphoto2 error code
- *
- */
-int
-canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned char **data,
-                         unsigned int *data_length, unsigned int max_data_size, const unsigned char *payload,
-                         unsigned int payload_length, int display_status, GPContext *context)
+static int
+canon_usb_long_dialogue_full (Camera *camera, canonCommandIndex canon_funct, unsigned char **data,
+                              CameraFile *file, unsigned int *data_length, unsigned int max_data_size,
+                              const unsigned char *payload, unsigned int payload_length,
+                              int display_status, GPContext *context)
 {
-        int bytes_read;
+        int bytes_read, res;
 	unsigned int dialogue_len;
-        unsigned int total_data_size = 0, bytes_received = 0, read_bytes = camera->pl->xfer_length;
+        unsigned int total_data_size = 0, bytes_received = 0, read_bytes, buffer_size;
         unsigned char *lpacket;         /* "length packet" */
+        unsigned char *buffer;
         unsigned int id = 0;
 
         /* indicate there is no data if we bail out somewhere */
@@ -1701,10 +1683,15 @@ canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned
                           max_data_size);
                 return GP_ERROR_CORRUPTED_DATA;
         }
-        *data = malloc (total_data_size);
-        if (!*data) {
+
+        /* With a file to write to, we only need room for one read */
+        buffer_size = total_data_size;
+        if (file && buffer_size > camera->pl->xfer_length)
+                buffer_size = camera->pl->xfer_length;
+        buffer = malloc (buffer_size ? buffer_size : 1);
+        if (!buffer) {
                 GP_DEBUG ("canon_usb_long_dialogue: "
-                          "ERROR: Could not allocate %i bytes of memory", total_data_size);
+                          "ERROR: Could not allocate %i bytes of memory", buffer_size);
                 return GP_ERROR_NO_MEMORY;
         }
 
@@ -1723,12 +1710,12 @@ canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned
                 GP_DEBUG ("canon_usb_long_dialogue: total_data_size = %i, "
                           "bytes_received = %i, read_bytes = %i (0x%x)", total_data_size,
                           bytes_received, read_bytes, read_bytes);
-                bytes_read = gp_port_read (camera->port, (char *)*data + bytes_received, read_bytes);
+                bytes_read = gp_port_read (camera->port,
+                                           (char *)buffer + (file ? 0 : bytes_received), read_bytes);
                 if (bytes_read < 1) {
                         GP_DEBUG ("canon_usb_long_dialogue: gp_port_read() returned error (%i) or no data",
                                   bytes_read);
-                        free (*data);
-                        *data = NULL;
+                        free (buffer);
 
                         /* here, it is an error to get 0 bytes from gp_port_read()
                          * too, but 0 is GP_OK so if bytes_read is 0 return GP_ERROR_CORRUPTED_DATA
@@ -1742,6 +1729,13 @@ canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned
                 } else if ((unsigned int)bytes_read < read_bytes)
                         GP_DEBUG ("canon_usb_long_dialogue: WARNING: gp_port_read() resulted in short read "
                                   "(returned %i bytes, expected %i)", bytes_read, read_bytes);
+                if (file) {
+                        res = gp_file_append (file, (char *)buffer, bytes_read);
+                        if (res < GP_OK) {
+                                free (buffer);
+                                return res;
+                        }
+                }
                 bytes_received += bytes_read;
 
                 if (display_status)
@@ -1750,32 +1744,82 @@ canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned
         if (display_status)
                 gp_context_progress_stop (context, id);
 
+        if (file)
+                free (buffer);
+        else
+                *data = buffer;
         *data_length = total_data_size;
 
         return GP_OK;
 }
 
 /**
- * canon_usb_get_file:
- * @camera: camera to use
- * @name: name of file to fetch
- * @data: to receive image data
- * @length: to receive length of image data
+ * canon_usb_long_dialogue:
+ * @camera: the Camera to work with
+ * @canon_funct: integer constant that identifies function we are execute
+ * @data: Pointer to pointer to allocated memory holding the data returned from the camera
+ * @data_length: Pointer to where you want the number of bytes read from the camera
+ * @max_data_size: Max realistic data size so that we can abort if something goes wrong
+ * @payload: data we are to send to the camera
+ * @payload_length: length of #payload
+ * @display_status: Whether you want progress bar for this operation or not
  * @context: context for error reporting
  *
- * Get a file from a USB-connected Canon camera.
+ * This function is used to invoke camera commands which return L (long) data.
+ * It calls #canon_usb_dialogue(), if it gets a good response it will malloc()
+ * memory and read the entire returned data into this malloc'd memory and store
+ * a pointer to the malloc'd memory in 'data'.
  *
- * Returns: gphoto2 error code, length in @length, and image data in @data.
+ * Returns: gphoto2 error code
  *
  */
 int
-canon_usb_get_file (Camera *camera, const char *name, unsigned char **data, unsigned int *length,
-                    GPContext *context)
+canon_usb_long_dialogue (Camera *camera, canonCommandIndex canon_funct, unsigned char **data,
+                         unsigned int *data_length, unsigned int max_data_size, const unsigned char *payload,
+                         unsigned int payload_length, int display_status, GPContext *context)
 {
-        char payload[100];
-        int payload_length, res, offset;
+        return canon_usb_long_dialogue_full (camera, canon_funct, data, NULL, data_length,
+                                             max_data_size, payload, payload_length,
+                                             display_status, context);
+}
 
-        GP_DEBUG ("canon_usb_get_file() called for file '%s'", name);
+/**
+ * canon_usb_long_dialogue_to_file:
+ * @camera: the Camera to work with
+ * @canon_funct: integer constant that identifies function we are execute
+ * @file: #CameraFile to append the data returned from the camera to
+ * @data_length: Pointer to where you want the number of bytes read from the camera
+ * @max_data_size: Max realistic data size so that we can abort if something goes wrong
+ * @payload: data we are to send to the camera
+ * @payload_length: length of #payload
+ * @display_status: Whether you want progress bar for this operation or not
+ * @context: context for error reporting
+ *
+ * Like canon_usb_long_dialogue(), but each chunk read from the camera is
+ * appended to @file right away instead of collecting the entire data in
+ * memory first. For files backed by a file descriptor or a handler, memory
+ * use no longer grows with the size of the file.
+ *
+ * Returns: gphoto2 error code
+ *
+ */
+int
+canon_usb_long_dialogue_to_file (Camera *camera, canonCommandIndex canon_funct, CameraFile *file,
+                                 unsigned int *data_length, unsigned int max_data_size,
+                                 const unsigned char *payload, unsigned int payload_length,
+                                 int display_status, GPContext *context)
+{
+        return canon_usb_long_dialogue_full (camera, canon_funct, NULL, file, data_length,
+                                             max_data_size, payload, payload_length,
+                                             display_status, context);
+}
+
+/* Builds the payload of a CANON_USB_FUNCTION_GET_FILE request */
+static int
+canon_usb_get_file_payload (Camera *camera, const char *name, char *payload, size_t size,
+                            int *payload_length)
+{
+        int offset;
 
         /* Construct payload containing file name, buffer size and
          * function request.  See the file Protocol.xml in the doc/
@@ -1783,32 +1827,60 @@ canon_usb_get_file (Camera *camera, const char *name, unsigned char **data, unsi
          */
         if ( camera->pl->md->model == CANON_CLASS_6 ) {
                 offset = 4;
-                if ( offset + strlen (name) > sizeof (payload) - 2 ) {
+                if ( offset + strlen (name) > size - 2 ) {
                         GP_DEBUG ("canon_usb_get_file: ERROR: "
                                   "Supplied file name '%s' does not fit in payload buffer.", name);
                         return GP_ERROR_BAD_PARAMETERS;
                 }
                 htole32a (payload, 0x0);        /* get picture */
-                strncpy ( payload+offset, name, sizeof(payload)-offset-1 );
+                strncpy ( payload+offset, name, size-offset-1 );
                 payload[offset + strlen (payload+offset)] = 0;
-                payload_length = offset + strlen (payload+offset) + 2;
+                *payload_length = offset + strlen (payload+offset) + 2;
                 GP_DEBUG ( "canon_usb_get_file: payload 0x%08x:%s",
                            le32atoh(payload), payload+offset );
         }
         else {
                 offset = 8;
-                if ( offset + strlen (name) > sizeof (payload) - 1 ) {
+                if ( offset + strlen (name) > size - 1 ) {
                         GP_DEBUG ("canon_usb_get_file: ERROR: "
                                   "Supplied file name '%s' does not fit in payload buffer.", name);
                         return GP_ERROR_BAD_PARAMETERS;
                 }
                 htole32a (payload, 0x0);        /* get picture */
                 htole32a (payload + 0x4, camera->pl->xfer_length);
-                strncpy ( payload+offset, name, sizeof(payload)-offset );
-                payload_length = offset + strlen (payload+offset) + 1;
+                strncpy ( payload+offset, name, size-offset );
+                *payload_length = offset + strlen (payload+offset) + 1;
                 GP_DEBUG ( "canon_usb_get_file: payload 0x%08x:0x%08x:%s",
                            le32atoh(payload), le32atoh(payload+4), payload+offset );
         }
+        return GP_OK;
+}
+
+/**
+ * canon_usb_get_file:
+ * @camera: camera to use
+ * @name: name of file to fetch
+ * @data: to receive image data
+ * @length: to receive length of image data
+ * @context: context for error reporting
+ *
+ * Get a file from a USB-connected Canon camera.
+ *
+ * Returns: gphoto2 error code, length in @length, and image data in @data.
+ *
+ */
+int
+canon_usb_get_file (Camera *camera, const char *name, unsigned char **data, unsigned int *length,
+                    GPContext *context)
+{
+        char payload[100];
+        int payload_length, res;
+
+        GP_DEBUG ("canon_usb_get_file() called for file '%s'", name);
+
+        res = canon_usb_get_file_payload (camera, name, payload, sizeof (payload), &payload_length);
+        if (res != GP_OK)
+                return res;
 
         /* the 1 is to show status */
         res = canon_usb_long_dialogue (camera, CANON_USB_FUNCTION_GET_FILE, data, length,
@@ -1823,6 +1895,45 @@ canon_usb_get_file (Camera *camera, const char *name, unsigned char **data, unsi
         return GP_OK;
 }
 
+/**
+ * canon_usb_get_file_to_file:
+ * @camera: camera to use
+ * @name: name of file to fetch
+ * @file: #CameraFile to append the file contents to
+ * @length: to receive length of the file
+ * @context: context for error reporting
+ *
+ * Like canon_usb_get_file(), but streams the file into @file.
+ *
+ * Returns: gphoto2 error code, length in @length.
+ *
+ */
+int
+canon_usb_get_file_to_file (Camera *camera, const char *name, CameraFile *file,
+                            unsigned int *length, GPContext *context)
+{
+        char payload[100];
+        int payload_length, res;
+
+        GP_DEBUG ("canon_usb_get_file_to_file() called for file '%s'", name);
+
+        res = canon_usb_get_file_payload (camera, name, payload, sizeof (payload), &payload_length);
+        if (res != GP_OK)
+                return res;
+
+        /* the 1 is to show status */
+        res = canon_usb_long_dialogue_to_file (camera, CANON_USB_FUNCTION_GET_FILE, file, length,
+                                               camera->pl->md->max_movie_size,
+                                               (unsigned char *)payload, payload_length, 1, context);
+        if (res != GP_OK) {
+                GP_DEBUG ("canon_usb_get_file_to_file: canon_usb_long_dialogue_to_file() "
+                          "returned error (%i).", res);
+                return res;
+        }
+
+        return GP_OK;
+}
+
 /**
  * canon_usb_get_thumbnail:
  * @camera: camera to use
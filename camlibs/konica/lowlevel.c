@@ -152,50 +152,172 @@ l_init (GPPort *p, GPContext *c)
 	return (result);
 }
 
+/*
+ * Everything l_receive reads goes through a KReader. The port is only
+ * ever asked for as many bytes as the packet being received is known to
+ * still contain (ESC quotes only add to that), so a read returns as soon
+ * as those bytes arrived and never swallows data the camera sends after
+ * our next ACK or NACK.
+ */
+typedef struct {
+	GPPort *p;
+	unsigned char buf[4096];
+	unsigned int pos, end;
+} KReader;
+
+static int
+l_fill (KReader *r, unsigned int want)
+{
+	int result;
+
+	if (r->pos < r->end)
+		return (GP_OK);
+	if (want < 1)
+		want = 1;
+	if (want > sizeof (r->buf))
+		want = sizeof (r->buf);
+	result = gp_port_read (r->p, (char *)r->buf, want);
+	CHECK (result);
+	if (!result)
+		return (GP_ERROR_TIMEOUT);
+	r->pos = 0;
+	r->end = result;
+	return (GP_OK);
+}
+
+static int
+l_read (KReader *r, unsigned char *c, unsigned int want)
+{
+	CHECK (l_fill (r, want));
+	*c = r->buf[r->pos++];
+	return (GP_OK);
+}
+
+/*
+ * STX, ETX, ENQ, ACK, XOFF, XON, NACK, and ETB have to be masked by
+ * ESC. The HP PhotoSmart does not escape every special code, only some,
+ * and it gets confused if we check all of them. With LESSER_ESCAPES,
+ * only STX, XOFF, and XON are rejected when received unmasked.
+ */
+#define K_UNMASKED	0x01	/* must not appear without ESC */
+#define K_MASKABLE	0x02	/* may follow ESC (after unmasking) */
+#define K_ESC		0x04	/* the mask itself */
+
+static unsigned char l_esc_class[256];
+
+static void
+l_esc_class_init (void)
+{
+	static const unsigned char quoted[] = {STX, ETX, ENQ, ACK, XOFF, XON,
+					       NACK, ETB, ESC};
+	unsigned int i;
+
+	if (l_esc_class[ESC])
+		return;
+	for (i = 0; i < sizeof (quoted); i++)
+		l_esc_class[quoted[i]] = K_MASKABLE;
+#ifndef LESSER_ESCAPES
+	for (i = 0; i < sizeof (quoted) - 1; i++)
+		l_esc_class[quoted[i]] |= K_UNMASKED;
+#else /* LESSER_ESCAPES */
+	l_esc_class[STX]  |= K_UNMASKED;
+	l_esc_class[XOFF] |= K_UNMASKED;
+	l_esc_class[XON]  |= K_UNMASKED;
+#endif /* LESSER_ESCAPES */
+	l_esc_class[ESC] |= K_ESC;
+}
+
 static int
-l_esc_read (GPPort *p, unsigned char *c)
+l_esc_read (KReader *r, unsigned char *c, unsigned int want)
 {
-	CHECK_NULL (p && c);
+	CHECK_NULL (r && c);
 
-	CHECK (gp_port_read (p, (char *)c, 1));
+	CHECK (l_read (r, c, want));
 
 	/*
-	 * STX, ETX, ENQ, ACK, XOFF, XON, NACK, and ETB have to be masked by
-	 * ESC. If we receive one of those (except ETX and ETB) without mask,
-	 * we will not report an error, as it will be recovered automatically
-	 * later. If we receive ETX or ETB, we reached the end of the packet
-	 * and report a transmission error, so that the error can be
-	 * recovered.
+	 * If we receive one of the special codes (except ETX and ETB)
+	 * without mask, we will not report an error, as it will be
+	 * recovered automatically later. If we receive ETX or ETB, we
+	 * reached the end of the packet and report a transmission error,
+	 * so that the error can be recovered.
 	 * If the camera sends us ESC (the mask), we will not count this byte
 	 * and read a second one. This will be reverted and processed. It
 	 * then must be one of STX, ETX, ENQ, ACK, XOFF, XON, NACK, ETB, or
 	 * ESC. As before, if it is not one of those, we'll not report an
 	 * error, as it will be recovered automatically later.
 	 */
-	 /* The HP PhotoSmart does not escape every special code, only
-	  * some and it gets confused if we do this checks. By relaxing
-	  * these, it now downloads images etc.
-	  */
-#ifndef LESSER_ESCAPES
-	if ((*c == STX ) || (*c == ETX) || (*c == ENQ ) || (*c == ACK) ||
-	    (*c == XOFF) || (*c == XON) || (*c == NACK) || (*c == ETB)) {
-#else /* LESSER_ESCAPES */
-	if ((*c == STX ) || (*c == XOFF) || (*c == XON)) {
-#endif /* LESSER_ESCAPES */
+	if (l_esc_class[*c] & K_UNMASKED) {
 		GP_DEBUG ("Wrong ESC masking!");
 		if ((*c == ETX) || (*c == ETB))
 			return (GP_ERROR_CORRUPTED_DATA);
 	} else if (*c == ESC) {
-		CHECK (gp_port_read (p, (char *)c, 1));
+		CHECK (l_read (r, c, want));
 		*c = (~*c & 0xff);
-		if ((*c != STX ) && (*c != ETX ) && (*c != ENQ) &&
-		    (*c != ACK ) && (*c != XOFF) && (*c != XON) &&
-		    (*c != NACK) && (*c != ETB ) && (*c != ESC))
+		if (!(l_esc_class[*c] & K_MASKABLE))
 			GP_DEBUG ("Wrong ESC masking!");
 	}
 	return (GP_OK);
 }
 
+/*
+ * Reads 'size' bytes of data plus ESC quotes into 'data', adding them
+ * to 'checksum'. Unlike in the packet header, wrong masking in the data
+ * is reported as an error (GP_ERROR_CORRUPTED_DATA).
+ */
+static int
+l_esc_read_data (KReader *r, unsigned char *data, unsigned int size,
+		 unsigned char *checksum)
+{
+	unsigned char c, sum = *checksum;
+	unsigned char *s, *e;
+	unsigned int n = 0;
+	int result = GP_OK;
+
+	while (n < size) {
+
+		/* ETX or ETB and the checksum follow the data. */
+		CHECK (l_fill (r, size - n + 2));
+		s = r->buf + r->pos;
+		e = r->buf + r->end;
+		while ((s < e) && (n < size)) {
+			c = *s++;
+			if (!(l_esc_class[c] & (K_UNMASKED | K_ESC))) {
+				data[n++] = c;
+				sum += c;
+				continue;
+			}
+			if (l_esc_class[c] & K_UNMASKED) {
+				GP_DEBUG ("Wrong ESC masking!");
+				result = GP_ERROR_CORRUPTED_DATA;
+				break;
+			}
+			if (s == e) {
+
+				/* ESC is the last byte we have */
+				r->pos = r->end;
+				result = l_fill (r, size - n + 2);
+				if (result < 0)
+					break;
+				s = r->buf + r->pos;
+				e = r->buf + r->end;
+			}
+			c = ~*s++ & 0xff;
+			if (!(l_esc_class[c] & K_MASKABLE)) {
+				GP_DEBUG ("Wrong ESC masking!");
+				result = GP_ERROR_CORRUPTED_DATA;
+				break;
+			}
+			data[n++] = c;
+			sum += c;
+		}
+		r->pos = s - r->buf;
+		if (result < 0)
+			break;
+	}
+	*checksum = sum;
+	return (result);
+}
+
 
 static int
 l_send (GPPort *p, GPContext *context, unsigned char *send_buffer,
@@ -308,14 +430,18 @@ l_receive (GPPort *p, GPContext *context,
 	int error_flag;
 	unsigned int i, j, rbs_internal, id = 0;
 	unsigned char checksum;
-	int result;
 	KCommand command;
+	KReader r;
 
 	CHECK_NULL (p && rb && rbs);
 
+	l_esc_class_init ();
+	r.p = p;
+	r.pos = r.end = 0;
+
 	for (i = 0; ; ) {
 		CHECK (gp_port_set_timeout (p, timeout));
-		CHECK (gp_port_read (p, (char *)&c, 1));
+		CHECK (l_read (&r, &c, 1));
 		CHECK (gp_port_set_timeout (p, DEFAULT_TIMEOUT));
 		switch (c) {
 		case ENQ:
@@ -350,7 +476,7 @@ l_receive (GPPort *p, GPContext *context,
 			 * error).
 			 */
 			for (;;) {
-				CHECK (gp_port_read (p, (char *)&c, 1));
+				CHECK (l_read (&r, &c, 1));
 				if (c == ENQ)
 					break;
 			}
@@ -371,7 +497,7 @@ l_receive (GPPort *p, GPContext *context,
 	CHECK (gp_port_write (p, "\6", 1));
 	for (*rbs = 0; ; ) {
 		for (j = 0; ; j++) {
-			CHECK (gp_port_read (p, (char *)&c, 1));
+			CHECK (l_read (&r, &c, 1));
 			switch (c) {
 			case STX:
 
@@ -387,11 +513,12 @@ l_receive (GPPort *p, GPContext *context,
 
 			/*
 			 * Read 2 bytes for size (low order byte, high order
-			 * byte) plus ESC quotes.
+			 * byte) plus ESC quotes. At least ETX or ETB and
+			 * the checksum follow.
 			 */
-			CHECK (l_esc_read (p, &c));
+			CHECK (l_esc_read (&r, &c, 4));
 			checksum = c;
-			CHECK (l_esc_read (p, &d));
+			CHECK (l_esc_read (&r, &d, 3));
 			checksum += d;
 			rbs_internal = (d << 8) | c;
 			if (*rbs == 0)
@@ -401,68 +528,10 @@ l_receive (GPPort *p, GPContext *context,
 					sizeof (char) * (*rbs + rbs_internal));
 
 			/* Read 'rbs_internal' bytes data plus ESC quotes. */
-			error_flag = 0;
-{
-unsigned int read = 0, r = 0;
-while (read < rbs_internal) {
-
-	/*
-	 * Read the specified amount of bytes. We will probably read more
-	 * because some bytes will be quoted.
-	 */
-	GP_DEBUG ("Reading %i bytes (%i of %i already read)...",
-		  rbs_internal - read, read, rbs_internal);
-	result = gp_port_read (p, (char *)&((*rb)[*rbs + read]),
-			       rbs_internal - read);
-	if (result < 0) {
-		error_flag = 1;
-		break;
-	}
-	r = rbs_internal - read;
-
-	/* Unescape the data we just read */
-	for (i = read; i < read + r; i++) {
-		unsigned char *buf = &(*rb)[*rbs + i];
-
-		 /* The HP PhotoSmart does not escape every special code, only
-		  * some and it gets confused if we do this checks. By relaxing
-		  * these, it now downloads images etc.
-		  */
-#ifndef LESSER_ESCAPES
-	        if ((*buf == STX) || (*buf == ETX) || (*buf == ENQ ) ||
-		    (*buf == ACK) || (*buf == XOFF) || (*buf == XON) ||
-		    (*buf == NACK) || (*buf == ETB)) {
-#else /* LESSER_ESCAPES */
-	        if ((*buf == STX) ||  (*buf == XOFF) || (*buf == XON)) {
-#endif /* LESSER_ESCAPES */
-			GP_DEBUG ("Wrong ESC masking!");
-			error_flag = 1;
-			break;
-		} else if (*buf == ESC) {
-			if (i == read + r - 1) {
-				/* ESC is last char of packet */
-				CHECK (gp_port_read (p, (char *)buf, 1));
-			} else {
-				memmove (buf, buf + 1, read + r - i - 1);
-				r--;
-			}
-			*buf = ~*buf & 0xff;
-			if ((*buf != STX ) && (*buf != ETX ) && (*buf != ENQ) &&
-			    (*buf != ACK ) && (*buf != XOFF) && (*buf != XON) &&
-			    (*buf != NACK) && (*buf != ETB ) && (*buf != ESC)) {
-				GP_DEBUG ("Wrong ESC masking!");
-				error_flag = 1;
-				break;
-			}
-		}
-		checksum += (*rb)[*rbs + i];
-	}
-	if (error_flag)
-		break;
-	read += r;
-}}
+			error_flag = (l_esc_read_data (&r, &((*rb)[*rbs]),
+					rbs_internal, &checksum) < 0);
 			if (!error_flag) {
-				CHECK (gp_port_read (p, (char *)&d, 1));
+				CHECK (l_read (&r, &d, 2));
 				switch (d) {
 				case ETX:
 
@@ -493,8 +562,7 @@ while (read < rbs_internal) {
 					 * reject the packet.
 					 */
 					while ((d != ETX) && (d != ETB)) {
-						CHECK (gp_port_read (p,
-								     (char *)&d, 1));
+						CHECK (l_read (&r, &d, 1));
 					}
 					error_flag = 1;
 					break;
@@ -503,7 +571,7 @@ while (read < rbs_internal) {
 			checksum += d;
 
 			/* Read 1 byte for checksum plus ESC quotes. */
-			CHECK (l_esc_read (p, &c));
+			CHECK (l_esc_read (&r, &c, 1));
 			if ((c == checksum) && (!error_flag)) {
 				*rbs += rbs_internal;
 
@@ -529,7 +597,7 @@ while (read < rbs_internal) {
 				continue;
 			}
 		}
-		CHECK (gp_port_read (p, (char *)&c, 1));
+		CHECK (l_read (&r, &c, 1));
 		switch (c) {
 			case EOT:
 
@@ -560,7 +628,7 @@ while (read < rbs_internal) {
 		case ETB:
 
 			/* We expect more data. Read ENQ. */
-			CHECK (gp_port_read (p, (char *)&c, 1));
+			CHECK (l_read (&r, &c, 1));
 			switch (c) {
 			case ENQ:
 
@@ -0,0 +1,214 @@
+/* test-receive.c
+ *
+ * Receives data through l_receive() from a stand-in for the serial port,
+ * which plays the camera side of the protocol: ENQ, the packets with ESC
+ * quotes, ETB or ETX and the checksum, EOT, and a resend after a NACK.
+ * The port hands out what the camera has sent in pieces of a given size.
+ * Checks that the data arrives intact, that packets with a malformed ESC
+ * quote, a wrong checksum or a byte too many are refused and taken on the
+ * resend, and that no read asks for more than the camera has sent before
+ * it waits for our ACK or NACK.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "lowlevel.c"
+
+#define NPACKETS	60
+#define PSZ		1000
+
+/* the camera's view: what it has sent and we did not read yet, which
+ * packet it is at, and whether it already sent that packet once */
+static unsigned char	out[6 * PSZ + 32];
+static unsigned int	out_pos, out_end;
+static int		packet, resent, waiting, chunk;
+static int		nacks, overreads;
+
+int
+k_cancel (GPPort *p, GPContext *c, KCommand *command)
+{
+	return (GP_ERROR);
+}
+
+/* data bytes, with plenty of the codes that need ESC quotes */
+static unsigned char
+val (int i, int j)
+{
+	static const unsigned char special[] = {STX, ETX, ENQ, ACK, XOFF, XON,
+						NACK, ETB, ESC, EOT};
+
+	if ((i + j) % 3 == 0)
+		return (special[(i + j) % sizeof (special)]);
+	return ((i * 31 + j * 7 + (j >> 3)) & 0xff);
+}
+
+/* Even packets quote only what has to be quoted, odd ones all codes. */
+static void
+put (unsigned char v, unsigned char *sum)
+{
+	if (sum)
+		*sum += v;
+	if ((v == ESC) || (v == STX) || (v == XOFF) || (v == XON) ||
+	    ((packet & 1) && (l_esc_class[v] & K_MASKABLE))) {
+		out[out_end++] = ESC;
+		out[out_end++] = ~v;
+	} else
+		out[out_end++] = v;
+}
+
+static void
+send_packet (void)
+{
+	unsigned char sum = 0, end;
+	int j;
+
+	/* what we did not read of a refused packet stays in the line */
+	memmove (out, out + out_pos, out_end - out_pos);
+	out_end -= out_pos;
+	out_pos = 0;
+
+	/* the first time, some packets are sent broken: with a malformed
+	 * ESC quote, a wrong checksum, or a byte too many */
+	out[out_end++] = STX;
+	put (PSZ & 0xff, &sum);
+	put (PSZ >> 8, &sum);
+	for (j = 0; j < PSZ; j++) {
+		if (!resent && (packet % 20 == 7) && (j == PSZ / 2)) {
+			out[out_end++] = ESC;
+			out[out_end++] = 0x41;
+			sum += 0xbe;
+		} else
+			put (val (packet, j), &sum);
+	}
+	if (!resent && (packet % 20 == 13))
+		sum++;
+	if (!resent && (packet % 20 == 17))
+		put (0x55, &sum);
+	end = (packet == NPACKETS - 1) ? ETX : ETB;
+	out[out_end++] = end;
+	sum += end;
+	put (sum, NULL);
+	waiting = 1;
+}
+
+int
+gp_port_set_timeout (GPPort *port, int timeout)
+{
+	return (GP_OK);
+}
+
+int
+gp_port_write (GPPort *port, const char *data, int size)
+{
+	if (!waiting) {
+
+		/* ACK to ENQ */
+		out_pos = out_end = 0;
+		send_packet ();
+		return (size);
+	}
+	if (data[0] == NACK) {
+		if (out_end - out_pos > sizeof (out) / 2) {
+			printf ("FAIL: NACK long before the end of the packet\n");
+			return (GP_ERROR_IO);
+		}
+		if (++nacks > NPACKETS) {
+			printf ("FAIL: every packet refused\n");
+			return (GP_ERROR_IO);
+		}
+		resent = 1;
+		send_packet ();
+		return (size);
+	}
+	if (out_pos != out_end) {
+		printf ("FAIL: ACK before the end of the packet\n");
+		return (GP_ERROR_IO);
+	}
+	waiting = 0;
+	resent = 0;
+	out_pos = out_end = 0;
+	out[out_end++] = EOT;
+	if (packet < NPACKETS - 1)
+		out[out_end++] = ENQ;
+	packet++;
+	return (size);
+}
+
+int
+gp_port_read (GPPort *port, char *data, int size)
+{
+	int i;
+
+	if (out_pos == out_end)
+		return (GP_ERROR_TIMEOUT);
+	if (size > (int)(out_end - out_pos))
+		overreads++;
+	if (size > chunk)
+		size = chunk;
+	if (size > (int)(out_end - out_pos))
+		size = out_end - out_pos;
+	for (i = 0; i < size; i++)
+		data[i] = out[out_pos++];
+	return (size);
+}
+
+static int
+receive (int piece)
+{
+	GPPort		port;
+	unsigned char	*rb = NULL;
+	unsigned int	rbs = 0;
+	int		i, j, result;
+
+	memset (&port, 0, sizeof (port));
+	chunk = piece;
+	packet = resent = waiting = nacks = overreads = 0;
+	out_pos = out_end = 0;
+	out[out_end++] = ENQ;
+
+	result = l_receive (&port, NULL, &rb, &rbs, 1000);
+	if ((result < 0) || (rbs != NPACKETS * PSZ)) {
+		printf ("FAIL: %d byte reads: result %d, %u bytes\n", piece, result, rbs);
+		return (1);
+	}
+	for (i = 0; i < NPACKETS; i++)
+		for (j = 0; j < PSZ; j++)
+			if (rb[i * PSZ + j] != val (i, j)) {
+				printf ("FAIL: %d byte reads: packet %d differs at %d\n",
+					piece, i, j);
+				return (1);
+			}
+	free (rb);
+	if (nacks != 9) {
+		printf ("FAIL: %d byte reads: %d packets refused, expected 9\n", piece, nacks);
+		return (1);
+	}
+	if (overreads) {
+		printf ("FAIL: %d byte reads: %d reads for more than the camera sent\n",
+			piece, overreads);
+		return (1);
+	}
+	printf ("%d byte reads: %u bytes\n", piece, rbs);
+	return (0);
+}
+
+int
+main (void)
+{
+	l_esc_class_init ();
+	if (receive (1) || receive (2) || receive (7) || receive (4096))
+		return (1);
+	return (0);
+}
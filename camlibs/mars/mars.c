@@ -212,7 +212,7 @@ static void precalc_table(code_table_t *table)
     			/* code 11101xxxxx */
     			is_abs = 1;
     			val = 0;	/* value is calculated later */
-    			len = 5;
+    			len = 10;	/* including the 5 value bits */
 		}
 		table[i].is_abs = is_abs;
 		table[i].val = val;
@@ -221,87 +221,98 @@ static void precalc_table(code_table_t *table)
 }
 
 #define CLAMP(x)	((x)<0?0:((x)>255)?255:(x))
-#define GET_CODE 	addr = inp + (bitpos >> 3); \
-	    code = (addr[0] << (bitpos & 7)) | (addr[1] >> (8 - (bitpos & 7)))
 
+/*
+ * Bit reservoir for the decoder. It gets refilled 32 bits at a time, so it
+ * may read up to 6 bytes beyond the last code; get_file_func() pads the
+ * raw data to the next 0x2000 byte boundary plus at least 0x1b0 bytes.
+ */
+struct mars_bits {
+	const unsigned char *src;
+	uint64_t buf;
+	int count;
+};
+
+/* Get the next 16 bits, this is enough for the longest code, an absolute
+ * value code of 5 + 5 bits, so each pixel needs only one fetch. */
+static inline unsigned int
+mars_peek_bits (struct mars_bits *bits)
+{
+	if (bits->count < 16) {
+		bits->buf = (bits->buf << 32) |
+			    ((uint32_t)bits->src[0] << 24) |
+			    (bits->src[1] << 16) | (bits->src[2] << 8) |
+			    bits->src[3];
+		bits->src += 4;
+		bits->count += 32;
+	}
+	return (bits->buf >> (bits->count - 16)) & 0xffff;
+}
+
+/*
+ * Decode one pixel given the predicted value. There are no branches here,
+ * an absolute value code simply selects the value bits instead of the
+ * predictor plus the table delta.
+ */
+static inline unsigned char
+mars_decode_pixel (struct mars_bits *bits, const code_table_t *table, int pred)
+{
+	unsigned int code = mars_peek_bits (bits);
+	const code_table_t *t = &table[code >> 8];
+	int val = pred + t->val;
+
+	bits->count -= t->len;
+	val = CLAMP(val);
+	return t->is_abs ? (int)(code >> 3) & 0xF8 : val;
+}
 
 int mars_decompress (unsigned char *inp, unsigned char *outp, int width,
    int height)
 {
 	int row, col;
-	unsigned char code;
-	int val;
 	code_table_t table[256];
-	unsigned char *addr;
-	int bitpos;
-	unsigned char lp=0,tp=0,tlp=0,trp=0;
+	const unsigned char *top;
+	struct mars_bits bits = { inp, 0, 0 };
 	/* First calculate the Huffman table */
 	precalc_table(table);
 
-	bitpos = 0;
-
-	/* main decoding loop */
-	for (row = 0; row < height; row++) {
-		col = 0;
-
-	/* first two pixels in first two rows are stored as raw 8-bit */
-	if (row < 2) {
-    		GET_CODE;
-    		bitpos += 8;
-    		*outp++ = code;
+	/* The predictor depends on the position of the pixel, pixels of the
+	 * same color are 2 apart. The first two rows are relative to the
+	 * left pixel, except for the first two pixels in them, which are
+	 * stored as raw 8-bit. The other rows get decoded as a left edge
+	 * prologue, a branch free interior and a right edge epilogue. */
+	for (row = 0; row < height && row < 2; row++) {
+		*outp++ = mars_peek_bits (&bits) >> 8;
+		bits.count -= 8;
+		*outp++ = mars_peek_bits (&bits) >> 8;
+		bits.count -= 8;
+
+		for (col = 2; col < width; col++, outp++)
+			*outp = mars_decode_pixel (&bits, table,
+						   outp[-2]);
+	}
 
-    		GET_CODE;
-    		bitpos += 8;
-    		*outp++ = code;
+	for (; row < height; row++) {
+		/* left column: relative to top pixel */
+		for (col = 0; col < 2; col++, outp++) {
+			top = outp - 2 * width;
+			*outp = mars_decode_pixel (&bits, table,
+						   (top[0] + top[2]) / 2);
+		}
 
-    		col += 2;
-	}
+		/* main area: average of left and top pixels */
+		for (; col < width - 2; col++, outp++) {
+			top = outp - 2 * width;
+			*outp = mars_decode_pixel (&bits, table,
+				(outp[-2] + top[0] + (top[-2] >> 1) +
+				 (top[2] >> 1) + 1) / 3);
+		}
 
-	while (col < width) {
-    		/* get bitcode */
-    		GET_CODE;
-    		/* update bit position */
-    		bitpos += table[code].len;
-
-    		/* calculate pixel value */
-    		if (table[code].is_abs) {
-    			/* get 5 more bits and use them as absolute value */
-    			GET_CODE;
-    			val = (code & 0xF8);
-    			bitpos += 5;
-
-    			}else {
-    				/* value is relative to top or left pixel */
-    				val = table[code].val;
-    				lp =  outp[-2];
-    				if (row > 1) {
-					if (col > 1)
-						tlp = outp[-2*width-2];
-        				tp  = outp[-2*width];
-        				if (col < width-2)
-        					trp = outp[-2*width+2];
-    				}
-    				if (row < 2) {
-        				/* top row: relative to left pixel */
-        				val += lp;
-    				}else if (col < 2) {
-        				/* left column: relative to top pixel */
-        				/* initial estimate */
-        				val += (tp + trp)/2;
-    				}else if (col > width - 3) {
-        				/* left column: relative to top pixel */
-        				val += (tp + lp + tlp +1)/3;
-					/* main area: average of left and top pixel */
-    				}else {
-        				/* initial estimate for predictor */
-					tlp>>=1;
-					trp>>=1;
-					val += (lp + tp + tlp + trp +1)/3;
-    				}
-    			}
-    			/* store pixel */
-    			*outp++ = CLAMP(val);
-    			col++;
+		/* right column: no top right pixel */
+		for (; col < width; col++, outp++) {
+			top = outp - 2 * width;
+			*outp = mars_decode_pixel (&bits, table,
+				(top[0] + outp[-2] + top[-2] + 1) / 3);
 		}
 	}
 	return GP_OK;
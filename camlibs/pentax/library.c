@@ -241,20 +241,28 @@ static CameraFilesystemFuncs fsfuncs = {
 	.del_file_func = delete_file_func
 };
 
+#define SAVE_BUFFER_CHUNK (512*1024)
+
 static int
 save_buffer(pslr_handle_t camhandle, int bufno, pslr_buffer_type buftype, uint32_t jpegres, CameraFile *file)
 {
-	uint8_t			buf[65536];
+	uint8_t			*buf;
 	uint32_t		current;
 
 	gp_log(GP_LOG_DEBUG, "pentax", "save_buffer: get buffer %d type %d res %d\n", bufno, buftype, jpegres);
 	if ( pslr_buffer_open(camhandle, bufno, buftype, jpegres) != PSLR_OK)
 		return GP_ERROR;
 
+	/* pslr_buffer_read() splits this into blocks the camera accepts */
+	buf = malloc(SAVE_BUFFER_CHUNK);
+	if (!buf) {
+		pslr_buffer_close(camhandle);
+		return GP_ERROR_NO_MEMORY;
+	}
 	current = 0;
 	while (1) {
 		uint32_t bytes;
-		bytes = pslr_buffer_read(camhandle, buf, sizeof(buf));
+		bytes = pslr_buffer_read(camhandle, buf, SAVE_BUFFER_CHUNK);
 		if (bytes == 0)
 			break;
 		if (((ipslr_handle_t*)camhandle)->model->id == 0x12b9c) {
@@ -276,14 +284,18 @@ save_buffer(pslr_handle_t camhandle, int bufno, pslr_buffer_type buftype, uint32
 					0x00, 0x14, 0x00, 0x00
 				};
 
-				if (bytes < sizeof(correct_header))
+				if (bytes < sizeof(correct_header)) {
+					free (buf);
+					pslr_buffer_close(camhandle);
 					return GP_ERROR;
+				}
 				memcpy(buf, correct_header, sizeof(correct_header));
 			}
 		}
 		gp_file_append (file, (char*)buf, bytes);
 		current += bytes;
 	}
+	free (buf);
 	pslr_buffer_close(camhandle);
 	return current;
 }
@@ -57,9 +57,12 @@
 #include "pslr_scsi.h"
 #include "pslr_lens.h"
 
-#define POLL_INTERVAL 50000 /* Number of us to wait when polling */
+#define POLL_INTERVAL 50000 /* Maximum number of us to wait when polling */
+#define POLL_MIN 1000 /* Shortest poll wait in us */
 #define BLKSZ 65536 /* Block size for downloads; if too big, we get
                      * memory allocation error from sg driver */
+#define BLKSZ_MAX (8*BLKSZ) /* Largest block size; downloads start with
+                             * BLKSZ and double after each good block */
 #define BLOCK_RETRY 3 /* Number of retries, since we can occasionally
                        * get SCSI errors when downloading data */
 
@@ -90,8 +93,8 @@ static int _ipslr_write_args(uint8_t cmd_2, ipslr_handle_t *p, int n, ...);
 #define ipslr_write_args_special(p,n,...) _ipslr_write_args(4,(p),(n),__VA_ARGS__)
 
 static int command(FDTYPE fd, int a, int b, int c);
-static int get_status(FDTYPE fd);
-static int get_result(FDTYPE fd);
+static int get_status(ipslr_handle_t *p);
+static int get_result(ipslr_handle_t *p);
 static int read_result(FDTYPE fd, uint8_t *buf, uint32_t n);
 
 void hexdump(uint8_t *buf, uint32_t bufLen);
@@ -194,7 +197,7 @@ int pslr_get_buffer_status(ipslr_handle_t *p, uint32_t *x, uint32_t *y) {
     int n;
 
     CHECK(command(p->fd, 0x02, 0x00, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     DPRINT("[C]\t\tipslr_get_buffer_status() bytes: %d\n",n);
     if (n!= 8) {
         return PSLR_READ_ERROR;
@@ -221,7 +224,7 @@ static int ipslr_cmd_23_XX(ipslr_handle_t *p, char XX, char YY, uint32_t mode) {
     DPRINT("[C]\t\tipslr_cmd_23_XX(%x, %x, mode=%x)\n", XX, YY, mode);
     CHECK(ipslr_write_args(p, 1, mode));
     CHECK(command(p->fd, 0x23, XX, YY));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -236,7 +239,7 @@ static int ipslr_cmd_23_06(ipslr_handle_t *p, char debug_on_off) {
         CHECK(ipslr_write_args_special(p, 4,1,1,0,0));
     }
     CHECK(command(p->fd, 0x23, 0x06, 0x14));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -247,7 +250,7 @@ static int ipslr_cmd_23_04(ipslr_handle_t *p) {
     CHECK(ipslr_write_args(p, 1, 3)); // posebni ARGS-i
     CHECK(ipslr_write_args_special(p, 1, 1)); // posebni ARGS-i
     CHECK(command(p->fd, 0x23, 0x04, 0x08));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -668,7 +671,7 @@ int pslr_get_buffer(pslr_handle_t h, int bufno, pslr_buffer_type type, int resol
 
     uint32_t bufpos = 0;
     while (true) {
-        uint32_t nextread = size - bufpos > 65536 ? 65536 : size - bufpos;
+        uint32_t nextread = size - bufpos;
         if (nextread == 0) {
             break;
         }
@@ -718,7 +721,7 @@ int ipslr_handle_command_x18( ipslr_handle_t *p, bool cmd9_wrap, int subcommand,
     va_end(ap);
     CHECK(ipslr_write_args(p, argnum, args[0], args[1], args[2], args[3]));
     CHECK(command(p->fd, 0x18, subcommand, 4 * argnum));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     if ( cmd9_wrap ) {
         CHECK(ipslr_cmd_00_09(p, 2));
     }
@@ -928,7 +931,7 @@ int pslr_delete_buffer(pslr_handle_t h, int bufno) {
     }
     CHECK(ipslr_write_args(p, 1, bufno));
     CHECK(command(p->fd, 0x02, 0x03, 0x04));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -936,7 +939,7 @@ int pslr_green_button(pslr_handle_t h) {
     DPRINT("[C]\tpslr_green_button()\n");
     ipslr_handle_t *p = (ipslr_handle_t *) h;
     CHECK(command(p->fd, 0x10, X10_GREEN, 0x00));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -944,7 +947,7 @@ int pslr_dust_removal(pslr_handle_t h) {
     DPRINT("[C]\tpslr_dust_removal()\n");
     ipslr_handle_t *p = (ipslr_handle_t *) h;
     CHECK(command(p->fd, 0x10, X10_DUST, 0x00));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -953,7 +956,7 @@ int pslr_bulb(pslr_handle_t h, bool on ) {
     ipslr_handle_t *p = (ipslr_handle_t *) h;
     CHECK(ipslr_write_args(p, 1, on ? 1 : 0));
     CHECK(command(p->fd, 0x10, X10_BULB, 0x04));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -963,7 +966,7 @@ int pslr_button_test(pslr_handle_t h, int bno, int arg) {
     ipslr_handle_t *p = (ipslr_handle_t *) h;
     CHECK(ipslr_write_args(p, 1, arg));
     CHECK(command(p->fd, 0x10, bno, 4));
-    r = get_status(p->fd);
+    r = get_status(p);
     DPRINT("\tbutton result code: 0x%x\n", r);
     return PSLR_OK;
 }
@@ -977,7 +980,7 @@ int pslr_ae_lock(pslr_handle_t h, bool lock) {
     } else {
         CHECK(command(p->fd, 0x10, X10_AE_UNLOCK, 0x00));
     }
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -1066,48 +1069,47 @@ int pslr_buffer_open(pslr_handle_t h, int bufno, pslr_buffer_type buftype, int b
     } while (i < 9 && info.b != 2);
     p->segment_count = j;
     p->offset = 0;
+    p->segment_index = 0;
+    p->segment_offset = 0;
     return PSLR_OK;
 }
 
 uint32_t pslr_buffer_read(pslr_handle_t h, uint8_t *buf, uint32_t size) {
     ipslr_handle_t *p = (ipslr_handle_t *) h;
-    uint32_t i;
-    uint32_t pos = 0;
-    uint32_t seg_offs;
+    ipslr_segment_t *seg;
     uint32_t addr;
     uint32_t blksz;
     int ret;
 
     DPRINT("[C]\tpslr_buffer_read(%d)\n", size);
 
-    /* Find current segment */
-    for (i = 0; i < p->segment_count; i++) {
-        if (p->offset < pos + p->segments[i].length) {
-            break;
-        }
-        pos += p->segments[i].length;
+    /* Advance the cursor past finished segments */
+    while (p->segment_index < p->segment_count &&
+           p->segment_offset >= p->segments[p->segment_index].length) {
+        p->segment_index++;
+        p->segment_offset = 0;
     }
+    if (p->segment_index >= p->segment_count) {
+        return 0;
+    }
+    seg = &p->segments[p->segment_index];
+    addr = seg->addr + p->segment_offset;
 
-    seg_offs = p->offset - pos;
-    addr = p->segments[i].addr + seg_offs;
-
-    /* Compute block size */
+    /* Compute block size, ipslr_download() splits it as needed */
     blksz = size;
-    if (blksz > p->segments[i].length - seg_offs) {
-        blksz = p->segments[i].length - seg_offs;
-    }
-    if (blksz > BLKSZ) {
-        blksz = BLKSZ;
+    if (blksz > seg->length - p->segment_offset) {
+        blksz = seg->length - p->segment_offset;
     }
 
 //    DPRINT("File offset %d segment: %d offset %d address 0x%x read size %d\n", p->offset,
-//           i, seg_offs, addr, blksz);
+//           p->segment_index, p->segment_offset, addr, blksz);
 
     ret = ipslr_download(p, addr, blksz, buf);
     if (ret != PSLR_OK) {
         return 0;
     }
     p->offset += blksz;
+    p->segment_offset += blksz;
     return blksz;
 }
 
@@ -1140,6 +1142,8 @@ void pslr_buffer_close(pslr_handle_t h) {
     memset(&p->segments[0], 0, sizeof (p->segments));
     p->offset = 0;
     p->segment_count = 0;
+    p->segment_index = 0;
+    p->segment_offset = 0;
 }
 
 int pslr_select_af_point(pslr_handle_t h, uint32_t point) {
@@ -1265,7 +1269,7 @@ static int ipslr_set_mode(ipslr_handle_t *p, uint32_t mode) {
     DPRINT("[C]\t\tipslr_set_mode(0x%x)\n", mode);
     CHECK(ipslr_write_args(p, 1, mode));
     CHECK(command(p->fd, 0, 0, 4));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -1273,7 +1277,7 @@ static int ipslr_cmd_00_09(ipslr_handle_t *p, uint32_t mode) {
     DPRINT("[C]\t\tipslr_cmd_00_09(0x%x)\n", mode);
     CHECK(ipslr_write_args(p, 1, mode));
     CHECK(command(p->fd, 0, 9, 4));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -1281,7 +1285,7 @@ static int ipslr_cmd_10_0a(ipslr_handle_t *p, uint32_t mode) {
     DPRINT("[C]\t\tipslr_cmd_10_0a(0x%x)\n", mode);
     CHECK(ipslr_write_args(p, 1, mode));
     CHECK(command(p->fd, 0x10, X10_CONNECT, 4));
-    CHECK(get_status(p->fd));
+    CHECK(get_status(p));
     return PSLR_OK;
 }
 
@@ -1290,7 +1294,7 @@ static int ipslr_cmd_00_05(ipslr_handle_t *p) {
     int n;
     uint8_t buf[0xb8];
     CHECK(command(p->fd, 0x00, 0x05, 0x00));
-    n = get_result(p->fd);
+    n = get_result(p);
     if (n != 0xb8) {
         DPRINT("\tonly got %d bytes\n", n);
         return PSLR_READ_ERROR;
@@ -1303,7 +1307,7 @@ static int ipslr_status(ipslr_handle_t *p, uint8_t *buf) {
     int n;
     DPRINT("[C]\t\tipslr_status()\n");
     CHECK(command(p->fd, 0, 1, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     if (n == 16 || n == 28) {
         return read_result(p->fd, buf, n);
     } else {
@@ -1315,7 +1319,7 @@ static int ipslr_status_full(ipslr_handle_t *p, pslr_status *status) {
     int n;
     DPRINT("[C]\t\tipslr_status_full()\n");
     CHECK(command(p->fd, 0, 8, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     DPRINT("\tread %d bytes\n", n);
     int expected_bufsize = p->model != NULL ? p->model->status_buffer_size : 0;
     if ( p->model == NULL ) {
@@ -1360,7 +1364,7 @@ static int ipslr_press_shutter(ipslr_handle_t *p, bool fullpress) {
     DPRINT("\t\tbefore: mask=0x%x\n", p->status.bufmask);
     CHECK(ipslr_write_args(p, 1, fullpress ? 2 : 1));
     CHECK(command(p->fd, 0x10, X10_SHUTTER, 0x04));
-    r = get_status(p->fd);
+    r = get_status(p);
     DPRINT("\t\tshutter result code: 0x%x\n", r);
     return PSLR_OK;
 }
@@ -1376,7 +1380,7 @@ static int ipslr_select_buffer(ipslr_handle_t *p, int bufno, pslr_buffer_type bu
         CHECK(ipslr_write_args(p, 4, bufno, buftype, bufres));
         CHECK(command(p->fd, 0x02, 0x01, 0x0c));
     }
-    r = get_status(p->fd);
+    r = get_status(p);
     if (r != 0) {
         return PSLR_COMMAND_ERROR;
     }
@@ -1389,7 +1393,7 @@ static int ipslr_next_segment(ipslr_handle_t *p) {
     CHECK(ipslr_write_args(p, 1, 0));
     CHECK(command(p->fd, 0x04, 0x01, 0x04));
     usleep(100000); // needed !! 100 too short, 1000 not short enough for PEF
-    r = get_status(p->fd);
+    r = get_status(p);
     if (r == 0) {
         return PSLR_OK;
     }
@@ -1405,7 +1409,7 @@ static int ipslr_buffer_segment_info(ipslr_handle_t *p, pslr_buffer_segment_info
     pInfo->b = 0;
     while ( pInfo->b == 0 && --num_try > 0 ) {
         CHECK(command(p->fd, 0x04, 0x00, 0x00));
-        n = get_result(p->fd);
+        n = get_result(p);
         if (n != 16) {
             return PSLR_READ_ERROR;
         }
@@ -1439,10 +1443,14 @@ static int ipslr_download(ipslr_handle_t *p, uint32_t addr, uint32_t length, uin
     int retry;
     uint32_t length_start = length;
 
+    if (!p->block_size) {
+        p->block_size = BLKSZ;
+        p->block_max = BLKSZ_MAX;
+    }
     retry = 0;
     while (length > 0) {
-        if (length > BLKSZ) {
-            block = BLKSZ;
+        if (length > p->block_size) {
+            block = p->block_size;
         } else {
             block = length;
         }
@@ -1450,18 +1458,32 @@ static int ipslr_download(ipslr_handle_t *p, uint32_t addr, uint32_t length, uin
         //DPRINT("Get 0x%x bytes from 0x%x\n", block, addr);
         CHECK(ipslr_write_args(p, 2, addr, block));
         CHECK(command(p->fd, 0x06, 0x00, 0x08));
-        get_status(p->fd);
+        get_status(p);
 
         n = scsi_read(p->fd, downloadCmd, sizeof (downloadCmd), buf, block);
-        get_status(p->fd);
+        get_status(p);
 
         if (n < 0) {
+            if (block > BLKSZ) {
+                /* Too big for the camera or the transport, stay
+                 * below this size from now on */
+                p->block_max = block / 2 > BLKSZ ? block / 2 : BLKSZ;
+                p->block_size = p->block_max;
+                DPRINT("\tRead of %d bytes failed, block size now %d\n", block, p->block_size);
+                continue;
+            }
             if (retry < BLOCK_RETRY) {
                 retry++;
                 continue;
             }
             return PSLR_READ_ERROR;
         }
+        if (block == p->block_size && p->block_size < p->block_max) {
+            p->block_size *= 2;
+            if (p->block_size > p->block_max) {
+                p->block_size = p->block_max;
+            }
+        }
         buf += n;
         length -= n;
         addr += n;
@@ -1479,7 +1501,7 @@ static int ipslr_identify(ipslr_handle_t *p) {
     int n;
 
     CHECK(command(p->fd, 0, 4, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     if (n != 8) {
         return PSLR_READ_ERROR;
     }
@@ -1502,7 +1524,7 @@ int pslr_read_datetime(pslr_handle_t *h, int *year, int *month, int *day, int *h
     int n;
 
     CHECK(command(p->fd, 0x20, 0x06, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     DPRINT("[C]\t\tipslr_read_datetime() bytes: %d\n",n);
     if (n!= 24) {
         return PSLR_READ_ERROR;
@@ -1531,7 +1553,7 @@ int pslr_read_dspinfo(pslr_handle_t *h, char* firmware) {
     int n;
 
     CHECK(command(p->fd, 0x01, 0x01, 0));
-    n = get_result(p->fd);
+    n = get_result(p);
     DPRINT("[C]\t\tipslr_read_dspinfo() bytes: %d\n",n);
     if (n!= 4) {
         return PSLR_READ_ERROR;
@@ -1553,7 +1575,7 @@ int pslr_read_setting(pslr_handle_t *h, int offset, uint32_t *value) {
 
     CHECK(ipslr_write_args(p, 1, offset));
     CHECK(command(p->fd, 0x20, 0x09, 4));
-    n = get_result(p->fd);
+    n = get_result(p);
     DPRINT("[C]\t\tipslr_read_setting() bytes: %d\n",n);
     if (n!= 4) {
         return PSLR_READ_ERROR;
@@ -1732,19 +1754,52 @@ static int read_status(FDTYPE fd, uint8_t *buf) {
     return PSLR_OK;
 }
 
-static int get_status(FDTYPE fd) {
-    DPRINT("[C]\t\t\tget_status(%" PRIFDTYPE ")\n", fd);
+/*
+ * Wait for the next status poll. The first wait is what the camera
+ * needed the previous times, then it doubles up to POLL_INTERVAL.
+ */
+static void poll_wait(ipslr_handle_t *p, uint32_t *delay, uint32_t *waited) {
+    if (!*delay) {
+        *delay = p->poll_estimate ? p->poll_estimate : POLL_MIN;
+    }
+    usleep(*delay);
+    *waited += *delay;
+    *delay *= 2;
+    if (*delay > POLL_INTERVAL) {
+        *delay = POLL_INTERVAL;
+    }
+}
+
+static void poll_learn(ipslr_handle_t *p, uint32_t waited) {
+    if (waited < POLL_MIN) {
+        waited = POLL_MIN;
+    }
+    if (!p->poll_estimate) {
+        p->poll_estimate = POLL_MIN;
+    }
+    p->poll_estimate = (3 * p->poll_estimate + waited) / 4;
+    if (p->poll_estimate > POLL_INTERVAL) {
+        p->poll_estimate = POLL_INTERVAL;
+    }
+}
+
+static int get_status(ipslr_handle_t *p) {
+    DPRINT("[C]\t\t\tget_status(%" PRIFDTYPE ")\n", p->fd);
 
     uint8_t statusbuf[8];
+    uint32_t delay = 0, waited = 0;
     memset(statusbuf,0,8);
 
     while (1) {
-        CHECK(read_status(fd, statusbuf));
+        CHECK(read_status(p->fd, statusbuf));
         DPRINT("[R]\t\t\t\t => ERROR: 0x%02X\n", statusbuf[7]);
         if (statusbuf[7] != 0x01) {
             break;
         }
-        usleep(POLL_INTERVAL);
+        poll_wait(p, &delay, &waited);
+    }
+    if (waited) {
+        poll_learn(p, waited);
     }
     if (statusbuf[7] != 0) {
         DPRINT("\tERROR: 0x%x\n", statusbuf[7]);
@@ -1752,19 +1807,23 @@ static int get_status(FDTYPE fd) {
     return statusbuf[7];
 }
 
-static int get_result(FDTYPE fd) {
-    DPRINT("[C]\t\t\tget_result(%" PRIFDTYPE ")\n", fd);
+static int get_result(ipslr_handle_t *p) {
+    DPRINT("[C]\t\t\tget_result(%" PRIFDTYPE ")\n", p->fd);
     uint8_t statusbuf[8];
+    uint32_t delay = 0, waited = 0;
     while (1) {
         //DPRINT("read out status\n");
-        CHECK(read_status(fd, statusbuf));
+        CHECK(read_status(p->fd, statusbuf));
         //hexdump_debug(statusbuf, 8);
         if (statusbuf[6] == 0x01) {
             break;
         }
         //DPRINT("Waiting for result\n");
         //hexdump_debug(statusbuf, 8);
-        usleep(POLL_INTERVAL);
+        poll_wait(p, &delay, &waited);
+    }
+    if (waited) {
+        poll_learn(p, waited);
     }
     if ((statusbuf[7] & 0xff) != 0) {
         DPRINT("\tERROR: 0x%x\n", statusbuf[7]);
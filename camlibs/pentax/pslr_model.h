@@ -189,6 +189,11 @@ struct ipslr_handle {
     ipslr_segment_t segments[MAX_SEGMENTS];
     uint32_t segment_count;
     uint32_t offset;
+    uint32_t segment_index;                          // segment containing offset
+    uint32_t segment_offset;                         // offset within that segment
+    uint32_t block_size;                             // download block size, 0 if not yet known
+    uint32_t block_max;                              // largest block size the camera accepted
+    uint32_t poll_estimate;                          // us until a busy camera answers, learned from the status polls
     uint8_t status_buffer[MAX_STATUS_BUF_SIZE];
     uint8_t settings_buffer[SETTINGS_BUFFER_SIZE];
 };
@@ -0,0 +1,194 @@
+/* test-download.c
+ *
+ * Downloads two images through pslr_buffer_read() from a scripted
+ * stand-in for the SCSI layer. The stand-in camera is busy for a few ms
+ * after each download command and refuses reads above a given size, so
+ * this checks that the data arrives intact, that the block size grows
+ * and backs off, and that status polling follows the camera.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+#include <gphoto2/gphoto2-port.h>
+
+#include "pslr.h"
+#include "pslr_scsi.h"
+#include "pslr_model.h"
+
+#define MEMORY_SIZE	(16 * 1024 * 1024)
+#define IMAGE_SIZE	(6 * 1024 * 1024)
+#define SEGMENT0	1234567
+#define CHUNK		(512 * 1024)	/* what library.c reads per call */
+#define BUSY_USEC	3000
+
+extern ipslr_handle_t pslr;
+bool debug = false;
+
+static uint8_t *memory;
+static uint32_t max_read, arg_addr;
+static double busy_until;
+static unsigned long nstatus, nreads, nfailed;
+
+static double
+now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int
+scsi_write (GPPort *port, uint8_t *cmd, uint32_t cmdLen,
+	    uint8_t *buf, uint32_t bufLen)
+{
+	/* without a model the arguments come one by one, big endian,
+	 * and the first one of a download is the address */
+	if (cmd[1] == 0x4f && cmd[2] == 0)
+		arg_addr = buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+	if (cmd[1] == 0x24 && cmd[2] == 0x06)
+		busy_until = now () + BUSY_USEC / 1e6;
+	return PSLR_OK;
+}
+
+int
+scsi_read (GPPort *port, uint8_t *cmd, uint32_t cmdLen,
+	   uint8_t *buf, uint32_t bufLen)
+{
+	if (cmd[1] == 0x26) {
+		/* status, busy until the download is set up */
+		nstatus++;
+		memset (buf, 0, bufLen);
+		buf[7] = (now () < busy_until) ? 0x01 : 0x00;
+		return 8;
+	}
+	if (cmd[1] == 0x24 && cmd[2] == 0x06) {
+		nreads++;
+		if (bufLen > max_read || arg_addr + bufLen > MEMORY_SIZE) {
+			nfailed++;
+			return -PSLR_SCSI_ERROR;
+		}
+		memcpy (buf, memory + arg_addr, bufLen);
+		return bufLen;
+	}
+	return -PSLR_SCSI_ERROR;
+}
+
+void
+close_drive (GPPort **port)
+{
+}
+
+char **
+get_drives (int *drive_num)
+{
+	*drive_num = 0;
+	return NULL;
+}
+
+pslr_result
+get_drive_info (char *drive_name, GPPort **device,
+		char *vendor_id, int vendor_id_size_max,
+		char *product_id, int product_id_size_max)
+{
+	return PSLR_DEVICE_ERROR;
+}
+
+static int
+download (uint32_t limit, uint8_t *data)
+{
+	ipslr_handle_t	*p = &pslr;
+	uint32_t	got, n;
+	double		start;
+	int		i;
+
+	memset (p, 0, sizeof (*p));
+	p->segments[0].addr = 0x1000;
+	p->segments[0].length = SEGMENT0;
+	p->segments[1].addr = 0x400000;
+	p->segments[1].length = IMAGE_SIZE - SEGMENT0;
+	max_read = limit;
+	nstatus = nreads = nfailed = 0;
+
+	start = now ();
+	for (i = 0; i < 2; i++) {
+		p->segment_count = 2;
+		p->offset = p->segment_index = p->segment_offset = 0;
+		got = 0;
+		memset (data, 0, IMAGE_SIZE);
+		while ((n = pslr_buffer_read (p, data + got, CHUNK)) > 0)
+			got += n;
+		if ((got != IMAGE_SIZE) ||
+		    memcmp (data, memory + 0x1000, SEGMENT0) ||
+		    memcmp (data + SEGMENT0, memory + 0x400000, IMAGE_SIZE - SEGMENT0)) {
+			printf ("FAIL: read limit %u: got %u bytes, data differs\n", limit, got);
+			return 1;
+		}
+	}
+	printf ("read limit %7u: %3lu reads, %lu failed, block size %u, "
+		"%.1f status polls and %.1f ms per read\n", limit, nreads, nfailed,
+		p->block_size, (double)nstatus / nreads, (now () - start) * 1e3 / nreads);
+
+	/* with the fixed 50ms poll every read took more than 50ms */
+	if ((now () - start) / nreads > 0.025) {
+		printf ("FAIL: status polling too slow\n");
+		return 1;
+	}
+	return 0;
+}
+
+int
+main (void)
+{
+	uint8_t		*data;
+	uint32_t	i;
+
+	memory = malloc (MEMORY_SIZE);
+	data = malloc (CHUNK + IMAGE_SIZE);
+	if (!memory || !data)
+		return 1;
+	for (i = 0; i < MEMORY_SIZE; i++)
+		memory[i] = i * 7 + (i >> 13);
+
+	/* the camera takes the largest blocks, grow up to them and stay */
+	if (download (4 * 1024 * 1024, data))
+		return 1;
+	if (nfailed || (pslr.block_size != 8 * 65536) ||
+	    (nreads > 2 * (IMAGE_SIZE / (8 * 65536) + 4))) {
+		printf ("FAIL: block size did not grow\n");
+		return 1;
+	}
+
+	/* the camera only takes the old 64K blocks, back off once */
+	if (download (65536, data))
+		return 1;
+	if ((nfailed != 1) || (pslr.block_size != 65536)) {
+		printf ("FAIL: block size did not back off\n");
+		return 1;
+	}
+
+	free (data);
+	free (memory);
+	return 0;
+}
@@ -1019,6 +1019,68 @@ chdk_put_onoff(CONFIG_PUT_ARGS) {
         return GP_OK;
 }
 
+/* Format of the frames returned by capture_preview. JPEG needs libjpeg and
+ * an extra compression pass per frame, PPM hands out the RGB conversion of
+ * the viewport as is. */
+enum {
+	CHDK_LVFORMAT_JPEG,
+	CHDK_LVFORMAT_PPM,
+};
+
+static struct {
+        char    *name;
+        char    *label;
+} chdklvformats[] = {
+        {"jpeg", N_("JPEG") },
+        {"ppm", N_("PPM (uncompressed RGB)") },
+};
+
+static int
+chdk_lvformat(void) {
+	char		buf[1024];
+
+	if (GP_OK != gp_setting_get("ptp2","chdk_lvformat", buf))
+		buf[0] = '\0';
+#ifdef HAVE_LIBJPEG
+	if (strcmp (buf, chdklvformats[CHDK_LVFORMAT_PPM].name))
+		return CHDK_LVFORMAT_JPEG;
+#endif
+	return CHDK_LVFORMAT_PPM;
+}
+
+static int
+chdk_get_lvformat(CONFIG_GET_ARGS) {
+        unsigned int	i;
+        int		cur = chdk_lvformat ();
+
+        gp_widget_new (GP_WIDGET_RADIO, _(menu->label), widget);
+        gp_widget_set_name (*widget, menu->name);
+        for (i=0;i<sizeof (chdklvformats)/sizeof (chdklvformats[i]);i++) {
+#ifndef HAVE_LIBJPEG
+                if (i == CHDK_LVFORMAT_JPEG)
+                        continue;
+#endif
+                gp_widget_add_choice (*widget, _(chdklvformats[i].label));
+                if ((int)i == cur)
+                        gp_widget_set_value (*widget, _(chdklvformats[i].label));
+        }
+        return GP_OK;
+}
+
+static int
+chdk_put_lvformat(CONFIG_PUT_ARGS) {
+        unsigned int	i;
+        char		*val;
+
+        CR (gp_widget_get_value(widget, &val));
+        for (i=0;i<sizeof(chdklvformats)/sizeof(chdklvformats[i]);i++) {
+                if (!strcmp( val, _(chdklvformats[i].label))) {
+                        gp_setting_set("ptp2","chdk_lvformat",chdklvformats[i].name);
+                        break;
+                }
+        }
+        return GP_OK;
+}
 
 struct submenu imgsettings[] = {
 	{ N_("Raw ISO"),	"rawiso",	chdk_get_iso,	 	chdk_put_iso},
@@ -1037,6 +1099,7 @@ struct submenu imgsettings[] = {
 	{ N_("Exposure Compensation"),	"exposurecompensation",	chdk_get_ev, chdk_put_ev},
 	{ N_("Orientation"),	"orientation",	chdk_get_orientation,	chdk_put_none},
 	{ N_("CHDK"),		"chdk",		chdk_get_onoff,		chdk_put_onoff},
+	{ N_("Live View Format"),	"chdklvformat",	chdk_get_lvformat,	chdk_put_lvformat},
 	{ NULL,			NULL,		NULL, 		NULL},
 };
 
@@ -1235,36 +1298,48 @@ static void yuv_live_to_jpeg(unsigned char *p_yuv,
 	free (tmprowbuf);
 }
 
-#else
+#endif
+
 static inline uint8_t clip_yuv (int v) {
 	if (v<0) return 0;
 	if (v>255) return 255;
 	return v;
 }
 
-static inline uint8_t yuv_to_r (uint8_t y, int8_t v) {
-	return clip_yuv (((y<<12) +          v*5743 + 2048)>>12);
-}
-
-static inline uint8_t yuv_to_g (uint8_t y, int8_t u, int8_t v) {
-	return clip_yuv (((y<<12) - u*1411 - v*2925 + 2048)>>12);
-}
-
-static inline uint8_t yuv_to_b (uint8_t y, int8_t u) {
-	return clip_yuv (((y<<12) + u*7258          + 2048)>>12);
+/* Convert the 2 or 4 Y values sharing one U/V pair to RGB24. The chroma
+ * contributions are computed once per pair, as in
+ *	R = Y + 1.402 V, G = Y - 0.344 U - 0.714 V, B = Y + 1.772 U
+ * in 4.12 fixed point. */
+static inline uint8_t *
+yuv_group_to_rgb (const uint8_t *y, int n, int8_t u, int8_t v, uint8_t *rgb)
+{
+	int	i, yy;
+	int	cr = v*5743 + 2048;
+	int	cg = - u*1411 - v*2925 + 2048;
+	int	cb = u*7258 + 2048;
+
+	for (i = 0; i < n; i++) {
+		yy = y[i] << 12;
+		*rgb++ = clip_yuv ((yy + cr) >> 12);
+		*rgb++ = clip_yuv ((yy + cg) >> 12);
+		*rgb++ = clip_yuv ((yy + cb) >> 12);
+	}
+	return rgb;
 }
 
-static void yuv_live_to_ppm (unsigned char *p_yuv,
-			     int buf_width, int width, int height,
-			     int fb_type, CameraFile *file
+static int
+yuv_live_to_ppm (unsigned char *p_yuv,
+		 int buf_width, int width, int height,
+		 int fb_type, CameraFile *file
 ) {
 	const unsigned char  *p_row = p_yuv;
 	const unsigned char  *p;
-	unsigned int	      row, x;
+	int		      row, x;
 	unsigned int	      row_inc;
-	int		      pshift, xshift, skip;
+	int		      pshift, xshift, skip, hdrlen;
 	char		      ppm_header[32];
-	uint8_t		      rgb[6];
+	uint8_t		      *ppm, *rgb;
+	uint8_t		      y[4];
 
 	/* Pre-Digic 6 cameras:
 	 * 8 bit per element UYVYYY, 6 bytes used to encode 4 rgb values */
@@ -1286,8 +1361,15 @@ static void yuv_live_to_ppm (unsigned char *p_yuv,
 	 * direction if all 4 Y values were used. */
 	skip  = (fb_type > LV_FB_YUV8) || (width/height > 2);
 
-	sprintf (ppm_header, "P6 %d %d 255\n", (width/height > 2) ? width/2 : width, height);
-	gp_file_append (file, ppm_header, strlen (ppm_header));
+	hdrlen = sprintf (ppm_header, "P6 %d %d 255\n", (width/height > 2) ? width/2 : width, height);
+
+	/* Convert straight into the final buffer, which is handed over to
+	 * the file as a whole */
+	ppm = malloc (hdrlen + ((width + xshift - 1) / xshift) * (skip ? 2 : 4) * 3 * height);
+	if (!ppm)
+		return GP_ERROR_NO_MEMORY;
+	memcpy (ppm, ppm_header, hdrlen);
+	rgb = ppm + hdrlen;
 
 	for (row=0; row<height; row++, p_row += row_inc) {
 		for (x=0, p=p_row; x<width; x+=xshift, p+=pshift) {
@@ -1300,31 +1382,20 @@ static void yuv_live_to_ppm (unsigned char *p_yuv,
 				u -= 0x80;
 				v -= 0x80;
 			}
-			rgb[0] = yuv_to_r (p[1], v);
-			rgb[1] = yuv_to_g (p[1], u, v);
-			rgb[2] = yuv_to_b (p[1], u);
-
-			rgb[3] = yuv_to_r (p[3], v);
-			rgb[4] = yuv_to_g (p[3], u, v);
-			rgb[5] = yuv_to_b (p[3], u);
-			gp_file_append (file, (char*)rgb, 6);
-
+			y[0] = p[1];
+			y[1] = p[3];
+			/* a UYVY group ends here, p[4] is the next group */
 			if (!skip) {
-				rgb[0] = yuv_to_r (p[4], v);
-				rgb[1] = yuv_to_g (p[4], u, v);
-				rgb[2] = yuv_to_b (p[4], u);
-
-				rgb[3] = yuv_to_r (p[5], v);
-				rgb[4] = yuv_to_g (p[5], u, v);
-				rgb[5] = yuv_to_b (p[5], u);
-				gp_file_append (file, (char*)rgb, 6);
+				y[2] = p[4];
+				y[3] = p[5];
 			}
+			rgb = yuv_group_to_rgb (y, skip ? 2 : 4, u, v, rgb);
 		}
 	}
-      	gp_file_set_mime_type (file, GP_MIME_PPM);
-      	gp_file_set_name (file, "chdk_preview.ppm");
+	gp_file_set_mime_type (file, GP_MIME_PPM);
+	gp_file_set_name (file, "chdk_preview.ppm");
+	return gp_file_set_data_and_size (file, (char*)ppm, rgb - ppm);
 }
-#endif
 
 static int
 chdk_camera_capture_preview (Camera *camera, CameraFile *file, GPContext *context)
@@ -1333,6 +1404,7 @@ chdk_camera_capture_preview (Camera *camera, CameraFile *file, GPContext *contex
 	uint32_t	size = 0;
 	PTPParams	*params = &camera->pl->params;
 	unsigned int	flags = LV_TFR_VIEWPORT;
+	int		ret = GP_OK;
 
 	lv_data_header header;
 	lv_framebuffer_desc vpd;
@@ -1350,14 +1422,17 @@ chdk_camera_capture_preview (Camera *camera, CameraFile *file, GPContext *contex
 		return GP_ERROR;
 	}
 #ifdef HAVE_LIBJPEG
-	yuv_live_to_jpeg(data+vpd.data_start, vpd.buffer_width, vpd.visible_width,
-			 vpd.visible_height, vpd.fb_type, file);
-#else
-	yuv_live_to_ppm (data+vpd.data_start, vpd.buffer_width, vpd.visible_width,
-			 vpd.visible_height, vpd.fb_type, file);
+	if (chdk_lvformat () == CHDK_LVFORMAT_JPEG)
+		yuv_live_to_jpeg(data+vpd.data_start, vpd.buffer_width, vpd.visible_width,
+				 vpd.visible_height, vpd.fb_type, file);
+	else
 #endif
+		ret = yuv_live_to_ppm (data+vpd.data_start, vpd.buffer_width, vpd.visible_width,
+				       vpd.visible_height, vpd.fb_type, file);
 
       	free (data);
+	if (ret != GP_OK)
+		return ret;
       	gp_file_set_mtime (file, time (NULL));
       	return GP_OK;
 }
@@ -51,6 +51,7 @@
 #include <time.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
 #endif
@@ -95,8 +96,18 @@
 
 #define PTP_EVENT_CHECK			0x0000	/* waits for */
 #define PTP_EVENT_CHECK_FAST		0x0001	/* checks */
-static uint16_t ptp_fujiptpip_check_event (PTPParams* params);
-static uint16_t ptp_fujiptpip_event (PTPParams* params, PTPContainer* event, int wait);
+
+/* The sockets serviced by the I/O loop, index into params->fujichannels */
+#define FUJIPTPIP_CMD		0
+#define FUJIPTPIP_EVT		1
+#define FUJIPTPIP_JPG		2
+#define FUJIPTPIP_NONE		-1
+
+/* Receive buffers up to this size are kept after a packet was consumed,
+ * larger ones (object downloads) are given back. */
+#define FUJIPTPIP_KEEP_BUFSIZE	(1024*1024)
+
+static uint16_t ptp_fujiptpip_loop (PTPParams* params, int wait, int timeout_ms);
 
 /* send / receive functions */
 uint16_t
@@ -118,7 +129,8 @@ ptp_fujiptpip_sendreq (PTPParams* params, PTPContainer* req, int dataphase)
 		break;
 	}
 
-	ptp_fujiptpip_check_event (params);
+	/* pick up whatever arrived on the event and liveview sockets */
+	ptp_fujiptpip_loop (params, FUJIPTPIP_NONE, 0);
 
 	/*htod32a(&request[ptpip_type],PTPIP_CMD_REQUEST);*/
 	htod32a(&request[fujiptpip_len],len);
@@ -216,34 +228,31 @@ ptp_fujiptpip_generic_read (PTPParams *params, int fd, PTPIPHeader *hdr, unsigne
 	return PTP_RC_OK;
 }
 
+/* Waits for the next packet on the command socket. *data points into the
+ * channel buffer and stays valid until ptp_fujiptpip_cmd_release(). */
 static uint16_t
 ptp_fujiptpip_cmd_read (PTPParams* params, PTPIPHeader *hdr, unsigned char** data) {
-	ptp_fujiptpip_check_event (params);
-	return ptp_fujiptpip_generic_read (params, params->cmdfd, hdr, data, 0);
-}
-
-static uint16_t
-ptp_fujiptpip_evt_read (PTPParams* params, PTPIPHeader *hdr, unsigned char** data) {
-	return ptp_fujiptpip_generic_read (params, params->evtfd, hdr, data, 0);
-}
+	PTPFujiPTPIPChannel	*chan = &params->fujichannels[FUJIPTPIP_CMD];
+	uint16_t		ret;
 
-static uint16_t
-ptp_fujiptpip_jpg_read (PTPParams* params, PTPIPHeader *hdr, unsigned char** data) {
-	return ptp_fujiptpip_generic_read (params, params->jpgfd, hdr, data, 0);
+	ret = ptp_fujiptpip_loop (params, FUJIPTPIP_CMD, PTPIP_DEFAULT_TIMEOUT_S*1000+PTPIP_DEFAULT_TIMEOUT_MS);
+	if (ret != PTP_RC_OK)
+		return ret;
+	hdr->length = htod32(chan->have);
+	*data = chan->buf + sizeof(uint32_t);
+	return PTP_RC_OK;
 }
 
-static uint16_t
-ptp_fujiptpip_check_event (PTPParams* params) {
-	PTPContainer	event;
-	uint16_t	ret;
+static void
+ptp_fujiptpip_cmd_release (PTPParams* params) {
+	PTPFujiPTPIPChannel	*chan = &params->fujichannels[FUJIPTPIP_CMD];
 
-	event.Code = 0;
-	ret = ptp_fujiptpip_event (params, &event, PTP_EVENT_CHECK_FAST);
-	if (ret != PTP_RC_OK)
-		return ret;
-	if (event.Code == 0)
-		return ret;
-	return ptp_add_event (params, &event);
+	chan->have = 0;
+	if (chan->size > FUJIPTPIP_KEEP_BUFSIZE) {
+		free (chan->buf);
+		chan->buf = NULL;
+		chan->size = 0;
+	}
 }
 
 #define fujiptpip_data_datatype		4
@@ -285,7 +294,7 @@ ptp_fujiptpip_senddata (PTPParams* params, PTPContainer* ptp,
 	while (curwrite < size) {
 		unsigned long written, towrite2, xtowrite;
 
-		ptp_fujiptpip_check_event (params);
+		ptp_fujiptpip_loop (params, FUJIPTPIP_NONE, 0);
 
 		towrite = size - curwrite;
 		if (towrite > WRITE_BLOCKSIZE) {
@@ -301,7 +310,7 @@ ptp_fujiptpip_senddata (PTPParams* params, PTPContainer* ptp,
 		GP_LOG_DATA ((char*)xdata, towrite2, "ptpip/senddata data:");
 		written = 0;
 		while (written < towrite2) {
-			ret = write (params->cmdfd, xdata+written, towrite2-written);
+			ret = ptpip_write_with_timeout (params->cmdfd, xdata+written, towrite2-written, PTPIP_DEFAULT_TIMEOUT_S, PTPIP_DEFAULT_TIMEOUT_MS);
 			if (ret == PTPSOCK_ERR) {
 				ptpip_perror ("write in senddata failed");
 				free (xdata);
@@ -512,7 +521,7 @@ ptp_fujiptpip_getdata (PTPParams* params, PTPContainer* ptp, PTPDataHandler *han
 			dtoh32(hdr.length)-fujiptpip_getdata_payload-4, xdata+fujiptpip_getdata_payload
 		);
 	}
-	free (xdata);
+	ptp_fujiptpip_cmd_release (params);
 	if (xret != PTP_RC_OK) {
 		GP_LOG_E ("failed to putfunc of returned data");
 		return GP_ERROR;
@@ -564,7 +573,7 @@ ptp_fujiptpip_getresp (PTPParams* params, PTPContainer* resp)
 		GP_LOG_E ("response type %d packet?", dtoh16a(data));
 		break;
 	}
-	free (data);
+	ptp_fujiptpip_cmd_release (params);
 	return PTP_RC_OK;
 }
 
@@ -744,6 +753,7 @@ ptp_fujiptpip_init_event (PTPParams* params, const char *address)
 		PTPSOCK_CLOSE (params->evtfd);
 		return GP_ERROR_IO;
 	} while (1);
+	params->fujichannels[FUJIPTPIP_EVT].active = 1;
 	GP_LOG_D ("fujiptpip event connected!");
 	tries = 2;
 	saddr.sin_family	= AF_INET;
@@ -765,6 +775,7 @@ ptp_fujiptpip_init_event (PTPParams* params, const char *address)
 		PTPSOCK_CLOSE (params->jpgfd);
 		return GP_ERROR_IO;
 	} while (1);
+	params->fujichannels[FUJIPTPIP_JPG].active = 1;
 	return GP_OK;
 }
 
@@ -781,55 +792,241 @@ ptp_fujiptpip_init_event (PTPParams* params, const char *address)
 #define ptpip_event_param3	16
 #define ptpip_event_param4	20
 
+/* The I/O loop.
+ *
+ * All sockets are non-blocking and serviced from one select() loop, so
+ * events and liveview frames are read whenever they arrive, also in the
+ * middle of a command transaction, instead of piling up in the kernel
+ * until someone asks for them. Each socket reassembles its packets into a
+ * buffer that is reused; complete event packets are decoded into
+ * params->fujievents, complete liveview frames replace the previous one
+ * in params->fujijpgframe and a complete command packet stays in its
+ * buffer until the command layer has consumed it.
+ */
+static int
+ptp_fujiptpip_fd (PTPParams* params, int channel) {
+	switch (channel) {
+	case FUJIPTPIP_CMD:	return params->cmdfd;
+	case FUJIPTPIP_EVT:	return params->evtfd;
+	default:		return params->jpgfd;
+	}
+}
+
+static int
+ptp_fujiptpip_complete (PTPParams* params, PTPFujiPTPIPChannel *chan) {
+	return (chan->have >= sizeof(uint32_t)) && (chan->have == dtoh32a(chan->buf));
+}
+
+static int
+ptp_fujiptpip_ready (PTPParams* params, int channel) {
+	switch (channel) {
+	case FUJIPTPIP_CMD:	return ptp_fujiptpip_complete (params, &params->fujichannels[FUJIPTPIP_CMD]);
+	case FUJIPTPIP_EVT:	return params->nroffujievents > 0;
+	case FUJIPTPIP_JPG:	return params->fujijpgframe.have > 0;
+	default:		return 0;
+	}
+}
+
 static uint16_t
-ptp_fujiptpip_event (PTPParams* params, PTPContainer* event, int wait)
+ptp_fujiptpip_queue_event (PTPParams* params, unsigned char *data, uint32_t length)
 {
-	fd_set		infds;
-	struct timeval	timeout;
-	int ret;
-	unsigned char*	data = NULL;
-	PTPIPHeader	hdr;
-	int n;
-
-	while (1) {
-		FD_ZERO(&infds);
-		FD_SET(params->evtfd, &infds);
-		timeout.tv_sec = 0;
-		if (wait == PTP_EVENT_CHECK_FAST)
-			timeout.tv_usec = 1;
-		else
-			timeout.tv_usec = 1000; /* 1/1000 second  .. perhaps wait longer? */
-
-		ret = select (params->evtfd+1, &infds, NULL, NULL, &timeout);
-		if (1 != ret) {
-			if (-1 == ret) {
-				GP_LOG_D ("select returned error, errno is %d", ptpip_get_socket_error());
-				return PTP_ERROR_IO;
-			}
-			return PTP_ERROR_TIMEOUT;
-		}
+	PTPContainer	*events, *event;
+	unsigned int	size, tail;
+	int		n;
 
-		ret = ptp_fujiptpip_evt_read (params, &hdr, &data);
-		if (ret != PTP_RC_OK)
-			return ret;
-		GP_LOG_D ("length %d", hdr.length);
-		break;
+	if (length < sizeof(uint32_t) + ptpip_event_param1) {
+		GP_LOG_E ("short event packet of %d bytes", length);
+		return PTP_RC_OK;
 	}
+	/* the queue is a ring, it only grows when it is full */
+	if (params->nroffujievents == params->fujievents_size) {
+		size = params->fujievents_size ? params->fujievents_size*2 : 8;
+		events = realloc (params->fujievents, sizeof(PTPContainer)*size);
+		if (!events)
+			return PTP_RC_GeneralError;
+		/* unwrap the events that were at the start of the old ring */
+		tail = params->fujievents_first + params->nroffujievents;
+		if (tail > params->fujievents_size)
+			memcpy (&events[params->fujievents_size], events,
+				sizeof(PTPContainer)*(tail - params->fujievents_size));
+		params->fujievents = events;
+		params->fujievents_size = size;
+	}
+	event = &params->fujievents[(params->fujievents_first + params->nroffujievents++) % params->fujievents_size];
+	memset (event, 0, sizeof(*event));
 
 	event->Code		= dtoh16a(&data[ptpip_event_code]);
 	event->Transaction_ID	= dtoh32a(&data[ptpip_event_transid]);
-	n = (dtoh32(hdr.length) - sizeof(uint32_t) - ptpip_event_param1)/sizeof(uint32_t);
+	n = (length - sizeof(uint32_t) - ptpip_event_param1)/sizeof(uint32_t);
 	switch (n) {
 	case 4: event->Param4 = dtoh32a(&data[ptpip_event_param4]);/* fallthrough */
 	case 3: event->Param3 = dtoh32a(&data[ptpip_event_param3]);/* fallthrough */
 	case 2: event->Param2 = dtoh32a(&data[ptpip_event_param2]);/* fallthrough */
 	case 1: event->Param1 = dtoh32a(&data[ptpip_event_param1]);/* fallthrough */
-	case 0: break;
+	case 0: event->Nparam = n; break;
 	default:
 		GP_LOG_E ("response got %d parameters?", n);
 		break;
 	}
-	free (data);
+	return PTP_RC_OK;
+}
+
+/* Reads what the socket has for the current packet of a channel. */
+static uint16_t
+ptp_fujiptpip_receive (PTPParams* params, int channel)
+{
+	PTPFujiPTPIPChannel	*chan = &params->fujichannels[channel];
+	PTPFujiPTPIPChannel	tmp;
+	uint32_t		len;
+	unsigned char		*buf;
+	int			ret;
+	uint16_t		rc = PTP_RC_OK;
+
+	/* the length word first, then the rest of the packet */
+	len = sizeof(uint32_t);
+	if (chan->have >= sizeof(uint32_t)) {
+		len = dtoh32a(chan->buf);
+		if (len < sizeof(uint32_t)) {
+			GP_LOG_E ("packet length %d < 4?", len);
+			return PTP_RC_GeneralError;
+		}
+	}
+	if (len > chan->size) {
+		buf = realloc (chan->buf, len);
+		if (!buf) {
+			GP_LOG_E ("realloc of %d bytes failed.", len);
+			return PTP_RC_GeneralError;
+		}
+		chan->buf = buf;
+		chan->size = len;
+	}
+	if (chan->have < len) {
+		ret = PTPSOCK_READ (ptp_fujiptpip_fd (params, channel), chan->buf + chan->have, len - chan->have);
+		if (ret == PTPSOCK_ERR) {
+			if ((ptpip_get_socket_error() == EAGAIN) || (ptpip_get_socket_error() == EWOULDBLOCK))
+				return PTP_RC_OK;
+			ptpip_perror ("read fujiptpip");
+			return PTP_ERROR_IO;
+		}
+		if (ret == 0) {
+			GP_LOG_E ("End of stream after reading %d bytes of packet", chan->have);
+			return PTP_RC_GeneralError;
+		}
+		chan->have += ret;
+	}
+	if (!ptp_fujiptpip_complete (params, chan))
+		return PTP_RC_OK;
+
+	switch (channel) {
+	case FUJIPTPIP_EVT:
+		GP_LOG_DATA ((char*)chan->buf, chan->have, "fujiptpip/event data:");
+		rc = ptp_fujiptpip_queue_event (params, chan->buf + sizeof(uint32_t), chan->have);
+		chan->have = 0;
+		break;
+	case FUJIPTPIP_JPG:
+		/* only the latest frame is of interest, swap buffers with it */
+		tmp = params->fujijpgframe;
+		params->fujijpgframe = *chan;
+		params->fujijpgframe.active = 0;
+		chan->buf = tmp.buf;
+		chan->size = tmp.size;
+		chan->have = 0;
+		break;
+	default:
+		/* left for ptp_fujiptpip_cmd_read */
+		break;
+	}
+	return rc;
+}
+
+/* Services all connected sockets until a complete packet is available for
+ * channel "wait", or no socket has data left if wait is FUJIPTPIP_NONE.
+ * Gives up once the awaited channel did not make progress for timeout_ms. */
+static uint16_t
+ptp_fujiptpip_loop (PTPParams* params, int wait, int timeout_ms)
+{
+	fd_set		infds;
+	struct timeval	timeout, last, now;
+	int		i, fd, maxfd, ret, elapsed;
+	uint32_t	had;
+	uint16_t	rc;
+
+	gettimeofday (&last, NULL);
+	while (!ptp_fujiptpip_ready (params, wait)) {
+		FD_ZERO(&infds);
+		maxfd = -1;
+		for (i = 0; i < 3; i++) {
+			if (!params->fujichannels[i].active)
+				continue;
+			/* a complete command packet first needs to be consumed */
+			if ((i == FUJIPTPIP_CMD) && ptp_fujiptpip_ready (params, i))
+				continue;
+			fd = ptp_fujiptpip_fd (params, i);
+			FD_SET(fd, &infds);
+			if (fd > maxfd)
+				maxfd = fd;
+		}
+		if (maxfd == -1)
+			return (wait == FUJIPTPIP_NONE) ? PTP_RC_OK : PTP_ERROR_IO;
+
+		gettimeofday (&now, NULL);
+		elapsed = (now.tv_sec - last.tv_sec)*1000 + (now.tv_usec - last.tv_usec)/1000;
+		if (elapsed < 0)
+			elapsed = 0;
+		if (elapsed > timeout_ms)
+			elapsed = timeout_ms;
+		timeout.tv_sec = (timeout_ms - elapsed) / 1000;
+		timeout.tv_usec = ((timeout_ms - elapsed) % 1000) * 1000;
+
+		ret = select (maxfd+1, &infds, NULL, NULL, &timeout);
+		if (ret == -1) {
+			if (ptpip_get_socket_error() == EINTR)
+				continue;
+			GP_LOG_D ("select returned error, errno is %d", ptpip_get_socket_error());
+			return PTP_ERROR_IO;
+		}
+		if (ret == 0)
+			return (wait == FUJIPTPIP_NONE) ? PTP_RC_OK : PTP_ERROR_TIMEOUT;
+
+		had = (wait == FUJIPTPIP_NONE) ? 0 : params->fujichannels[wait].have;
+		for (i = 0; i < 3; i++) {
+			if (!params->fujichannels[i].active || !FD_ISSET(ptp_fujiptpip_fd (params, i), &infds))
+				continue;
+			rc = ptp_fujiptpip_receive (params, i);
+			if (rc == PTP_RC_OK)
+				continue;
+			/* Losing the event or liveview socket must not take the
+			 * command channel with it, just stop servicing it. */
+			if ((i != FUJIPTPIP_CMD) && (i != wait)) {
+				GP_LOG_E ("fujiptpip channel %d failed (0x%04x), dropping it", i, rc);
+				params->fujichannels[i].active = 0;
+				continue;
+			}
+			return rc;
+		}
+		if ((wait != FUJIPTPIP_NONE) && (params->fujichannels[wait].have != had))
+			gettimeofday (&last, NULL);
+	}
+	return PTP_RC_OK;
+}
+
+static uint16_t
+ptp_fujiptpip_event (PTPParams* params, PTPContainer* event, int wait)
+{
+	uint16_t	ret;
+
+	if ((wait == PTP_EVENT_CHECK_FAST) || !params->fujichannels[FUJIPTPIP_EVT].active)
+		ret = ptp_fujiptpip_loop (params, FUJIPTPIP_NONE, 0);
+	else
+		ret = ptp_fujiptpip_loop (params, FUJIPTPIP_EVT, 1); /* 1/1000 second  .. perhaps wait longer? */
+	if ((ret != PTP_RC_OK) && (ret != PTP_ERROR_TIMEOUT))
+		return ret;
+	if (!params->nroffujievents)
+		return PTP_ERROR_TIMEOUT;
+
+	*event = params->fujievents[params->fujievents_first];
+	params->fujievents_first = (params->fujievents_first + 1) % params->fujievents_size;
+	params->nroffujievents--;
 	return PTP_RC_OK;
 }
 
@@ -852,35 +1049,25 @@ ptp_fujiptpip_event_wait (PTPParams* params, PTPContainer* event) {
 uint16_t
 ptp_fujiptpip_jpeg (PTPParams* params, unsigned char** xdata, unsigned int *xsize)
 {
-	fd_set		infds;
-	struct timeval	timeout;
-	int ret;
-	unsigned char*	data = NULL;
-	PTPIPHeader	hdr;
+	PTPFujiPTPIPChannel	*frame = &params->fujijpgframe;
+	uint16_t		ret;
 
-	while (1) {
-		FD_ZERO(&infds);
-		FD_SET(params->jpgfd, &infds);
-		timeout.tv_sec = 1;
-		timeout.tv_usec = 0;
-
-		ret = select (params->jpgfd+1, &infds, NULL, NULL, &timeout);
-		if (1 != ret) {
-			if (-1 == ret) {
-				GP_LOG_D ("select returned error, errno is %d", ptpip_get_socket_error());
-				return PTP_ERROR_IO;
-			}
-			return PTP_ERROR_TIMEOUT;
-		}
-
-		ret = ptp_fujiptpip_jpg_read (params, &hdr, &data);
-		if (ret != PTP_RC_OK)
-			return ret;
+	if (!params->fujichannels[FUJIPTPIP_JPG].active)
+		return PTP_ERROR_IO;
+	/* drain the socket first so we hand out the most recent frame */
+	ret = ptp_fujiptpip_loop (params, FUJIPTPIP_NONE, 0);
+	if (ret != PTP_RC_OK)
+		return ret;
+	ret = ptp_fujiptpip_loop (params, FUJIPTPIP_JPG, 1000);
+	if (ret != PTP_RC_OK)
+		return ret;
 
-		*xdata = data;
-		*xsize = hdr.length - sizeof(uint32_t);
-		break;
-	}
+	*xsize = frame->have - sizeof(uint32_t);
+	*xdata = malloc (*xsize);
+	if (!*xdata)
+		return PTP_RC_GeneralError;
+	memcpy (*xdata, frame->buf + sizeof(uint32_t), *xsize);
+	frame->have = 0;
 	return PTP_RC_OK;
 }
 
@@ -1009,6 +1196,7 @@ ptp_fujiptpip_connect (PTPParams* params, const char *address) {
 			return translate_ptp_result (ret);
 		}
 	} while(connect_tries < 2);
+	params->fujichannels[FUJIPTPIP_CMD].active = 1;
 	GP_LOG_D ("fujiptpip connected!");
 	return GP_OK;
 }
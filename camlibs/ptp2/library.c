@@ -198,7 +198,7 @@ time_since (const struct timeval start) {
 }
 
 static int
-waiting_for_timeout (int *current_wait, struct timeval start, int timeout) {
+waiting_for_timeout (PTPParams *params, int *current_wait, struct timeval start, int timeout) {
 #ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
         int time_to_timeout = timeout - time_since (start);
 
@@ -209,8 +209,12 @@ waiting_for_timeout (int *current_wait, struct timeval start, int timeout) {
                 *current_wait = 200; /* 200ms is the maximum sleep time */
         if (*current_wait > time_to_timeout)
                 *current_wait = time_to_timeout; /* never sleep 'into' the timeout */
-        if (*current_wait > 0)
-                usleep (*current_wait * 1000);
+        if (*current_wait > 0) {
+		/* Block on the event pipe rather than sleeping, so an event
+		 * arriving meanwhile ends the wait right away. */
+		if (ptp_wait_event_timeout (params, *current_wait) != PTP_RC_OK)
+			usleep (*current_wait * 1000);
+	}
         return *current_wait > 0;
 #else
 	/* Wait always timeout during fuzzing! */
@@ -3274,8 +3278,7 @@ add_object_to_fs_and_path (Camera *camera, uint32_t handle, CameraFilePath *path
 	path->folder[ strlen(path->folder)-1 ] = '\0';
 
 	if (ob->oi.ObjectFormat == PTP_OFC_Association)
-		/* FIXME: gp_filesystem_reset */
-		return GP_OK;
+		return gp_filesystem_add_folder_cached (camera->fs, path->folder, path->name, context);
 	/* The gp_filesystem_append function only appends files */
 	CR ( gp_filesystem_append (camera->fs, path->folder, path->name, context));
 
@@ -3303,6 +3306,41 @@ add_object_to_fs_and_path (Camera *camera, uint32_t handle, CameraFilePath *path
 	return gp_filesystem_set_info_noop(camera->fs, path->folder, path->name, info, context);
 }
 
+/* Drop a removed object from the driver and the filesystem cache. Only if
+ * we do not know anymore where it was, the whole filesystem is reset. */
+static void
+remove_object_from_fs (Camera *camera, uint32_t handle, GPContext *context)
+{
+	PTPObject	*ob;
+	PTPParams	*params = &camera->pl->params;
+	CameraFilePath	path;
+	uint32_t	storage, parent;
+	int		isfolder, ret = GP_ERROR;
+
+	if (	(ptp_object_find (params, handle, &ob) == PTP_RC_OK) &&
+		(ob->flags & PTPOBJECT_OBJECTINFO_LOADED) &&
+		ob->oi.Filename && (strlen (ob->oi.Filename) < sizeof (path.name))
+	) {
+		strcpy (path.name, ob->oi.Filename);
+		storage  = ob->oi.StorageID;
+		parent   = ob->oi.ParentObject;
+		isfolder = (ob->oi.ObjectFormat == PTP_OFC_Association);
+		sprintf (path.folder,"/"STORAGE_FOLDER_PREFIX"%08lx/",(unsigned long)storage);
+		/* might invalidate ob */
+		if (get_folder_from_handle (camera, storage, parent, path.folder) == GP_OK) {
+			/* delete last / or we get confused later. */
+			path.folder[ strlen(path.folder)-1 ] = '\0';
+			if (isfolder)
+				ret = gp_filesystem_remove_folder_cached (camera->fs, path.folder, path.name, context);
+			else
+				ret = gp_filesystem_remove_file_cached (camera->fs, path.folder, path.name, context);
+		}
+	}
+	ptp_remove_object_from_cache(params, handle);
+	if (ret != GP_OK)
+		gp_filesystem_reset (camera->fs);
+}
+
 /* find JPEGs in data blobs helper ... as most preview data is encapsulated */
 static int
 save_jpeg_in_data_to_preview(const unsigned char *data, unsigned long size, CameraFile *file)
@@ -3495,11 +3533,11 @@ camera_capture_preview (Camera *camera, CameraFile *file, GPContext *context)
 				ret = ptp_canon_eos_get_viewfinder_image (params , &data, &size);
 				if ((ret == 0xa102) || (ret == PTP_RC_DeviceBusy)) { /* means "not there yet" ... so wait */
 					/* wait 3 seconds at most ... use a bit of backoff logic for cameras where we should not drain compute. */
-					usleep((++try)*5*1000);
+					gp_camera_preview_wait (camera, (++try)*5*1000);
 					if (time_since (event_start) < 3*1000)
 						continue;
 /*
-					if (waiting_for_timeout (&back_off_wait, event_start, 3*1000))
+					if (waiting_for_timeout (params, &back_off_wait, event_start, 3*1000))
 						continue;
 */
 				}
@@ -3684,12 +3722,18 @@ ignoreerror:
 			}
 			if (ret == PTP_RC_DeviceBusy) {
 				GP_LOG_D ("busy, retrying after a bit of wait, try %d", tries);
-				usleep(10*1000);
+				/* a wait shortened for the frame rate does not use up a try */
+				if (gp_camera_preview_wait (camera, 10*1000) > 0)
+					tries++;
 				continue;
 			}
 			SET_CONTEXT_P(params, NULL);
 			return translate_ptp_result (ret);
 		}
+		if (tries < 0) {	/* still busy after all tries */
+			SET_CONTEXT_P(params, NULL);
+			return translate_ptp_result (ret);
+		}
 #if 0
 		C_PTP_REP_MSG (ptp_nikon_end_liveview (params),
 			       _("Nikon disable liveview failed"));
@@ -3716,7 +3760,8 @@ ignoreerror:
 			/* This state can persist for up to 1 second on the ZV-1 */
 			ret = ptp_getobjectinfo(params, preview_object, &oi);
 			if (ret == PTP_RC_InvalidObjectHandle) {
-				usleep(50*1000);
+				if (gp_camera_preview_wait (camera, 50*1000) > 0)
+					tries++;
 				continue;
 			}
 			if (ret == PTP_RC_OK)
@@ -3727,7 +3772,8 @@ ignoreerror:
 				break;
 			if (ret != PTP_RC_AccessDenied) /* we get those when we are too fast */
 				C_PTP (ret);
-			usleep(20*1000);
+			if (gp_camera_preview_wait (camera, 20*1000) > 0)
+				tries++;
 		} while (tries--);
 		CR (gp_port_set_timeout (camera->port, oldtimeout));
 
@@ -3780,7 +3826,8 @@ ignoreerror:
 			if (ret == PTP_RC_InvalidObjectHandle) {
 				/* 1000 x 10 tries was not enough for the S10 ... make the wait a bit longer
 				 * see https://github.com/gphoto/libgphoto2/issues/603 */
-				usleep(5*1000);
+				if (gp_camera_preview_wait (camera, 5*1000) > 0)
+					tries++;
 				continue;
 			}
 			C_PTP_REP (ret);
@@ -3806,7 +3853,8 @@ ignoreerror:
 			if (ret == PTP_RC_OK)
 				break;
 			if(ret == PTP_RC_DeviceBusy) {
-				usleep(1000);
+				if (gp_camera_preview_wait (camera, 1000) > 0)
+					tries++;
 				continue;
 			}
 
@@ -3843,7 +3891,8 @@ ignoreerror:
 				return translate_ptp_result (ret);
 			ret = ptp_panasonic_liveview_image (params, &ximage, &size);
 			if(ret == PTP_RC_DeviceBusy) {
-				usleep(40000);
+				if (gp_camera_preview_wait (camera, 40000) > 0)
+					tries++;
 				continue;
 			} else {
 				break;
@@ -3882,7 +3931,8 @@ ignoreerror:
 			}
 			ret = ptp_olympus_liveview_image (params, &ximage, &size);
 			if(ret == PTP_RC_DeviceBusy || size < 1024) {
-				usleep(40000);
+				if (gp_camera_preview_wait (camera, 40000) > 0)
+					tries++;
 				continue;
 			} else {
 				break;
@@ -4163,8 +4213,7 @@ capturetriggered:
 				if (!newobject) newobject = 0xffff0001;
 				break;
 			case PTP_EC_ObjectRemoved:
-				ptp_remove_object_from_cache(params, event.Param1);
-				gp_filesystem_reset (camera->fs);
+				remove_object_from_fs (camera, event.Param1, context);
 				break;
 			case PTP_EC_ObjectAdded: {
 				PTPObject	*ob;
@@ -4186,8 +4235,10 @@ capturetriggered:
 				/* if a new directory was added, not a file ... just continue.
 				 * happens when the camera starts with an empty card. */
 				if (ob->oi.ObjectFormat == PTP_OFC_Association) {
+					CameraFilePath	folderpath;
+
 					/* libgphoto2 vfs does not notice otherwise */
-					gp_filesystem_reset (camera->fs);
+					add_object_to_fs_and_path (camera, event.Param1, &folderpath, context);
 					break;
 				}
 				newobject = event.Param1;
@@ -4221,7 +4272,7 @@ capturetriggered:
 		}
 		gp_context_idle (context);
 		/* do not drain all of the DSLRs compute time */
-	} while ((done != 3) && waiting_for_timeout (&back_off_wait, capture_start, 70*1000)); /* 70 seconds */
+	} while ((done != 3) && waiting_for_timeout (params, &back_off_wait, capture_start, 70*1000)); /* 70 seconds */
 	/* Maximum image time is 30 seconds, but NR processing might take 25 seconds ... so wait longer.
 	 * see https://github.com/gphoto/libgphoto2/issues/94 */
 
@@ -4300,6 +4351,73 @@ capturetriggered:
 	return GP_OK;
 }
 
+/* Data handler that receives into one preallocated buffer */
+typedef struct {
+	unsigned char	*data;
+	unsigned long	size;
+	unsigned long	curoff;
+} PTPBufHandlerPrivate;
+
+static uint16_t
+buffer_putfunc (PTPParams *params, void *xpriv,
+	unsigned long sendlen, unsigned char *bytes
+) {
+	PTPBufHandlerPrivate	*priv = (PTPBufHandlerPrivate*)xpriv;
+
+	if (priv->curoff + sendlen > priv->size) {
+		/* more than announced in ObjectCompressedSize */
+		unsigned char	*data = realloc (priv->data, priv->curoff + sendlen);
+
+		if (!data)
+			return PTP_RC_GeneralError;
+		priv->data = data;
+		priv->size = priv->curoff + sendlen;
+	}
+	memcpy (priv->data + priv->curoff, bytes, sendlen);
+	priv->curoff += sendlen;
+	return PTP_RC_OK;
+}
+
+/* Downloads an object in blobsize pieces with GetPartialObject. The pieces
+ * are received directly at their place in one buffer of the object size,
+ * which is handed over to the file at the end, so there are neither
+ * per-piece allocations nor a growing file buffer. */
+static int
+getpartialobject_to_file (Camera *camera, uint32_t oid, uint32_t size,
+	uint32_t blobsize, CameraFile *file, GPContext *context
+) {
+	PTPParams		*params = &camera->pl->params;
+	PTPDataHandler		handler;
+	PTPBufHandlerPrivate	priv;
+	unsigned long		offset;
+	uint16_t		ret;
+
+	C_MEM (priv.data = malloc (size ? size : 1));
+	priv.size	= size;
+	priv.curoff	= 0;
+	handler.priv	= &priv;
+	handler.getfunc	= NULL;
+	handler.putfunc	= buffer_putfunc;
+
+	while (priv.curoff < size) {
+		uint32_t	xsize = size - priv.curoff;
+
+		if (xsize > blobsize)
+			xsize = blobsize;
+		offset = priv.curoff;
+		ret = ptp_getpartialobject_to_handler (params, oid, offset, xsize, &handler);
+		if (ret != PTP_RC_OK) {
+			free (priv.data);
+			C_PTP_REP (ret);
+		}
+		if (priv.curoff == offset) {
+			GP_LOG_E ("getpartialobject loop: offset=%ld, size is %d, xlen returned is 0?", offset, size);
+			break;
+		}
+	}
+	return gp_file_set_data_and_size (file, (char*)priv.data, priv.curoff);
+}
+
 /* 90 seconds timeout in ms ... (for long cycles)
  * while the max shutterspeed is 30seconds, there is also postprocessing of 30seconds happening
  * in e.g. https://github.com/gphoto/libgphoto2/issues/503
@@ -4358,8 +4476,7 @@ camera_canon_eos_capture (Camera *camera, CameraCaptureType type, CameraFilePath
 				break;
 			case PTP_CANON_EOS_CHANGES_TYPE_OBJECTREMOVED:
 				GP_LOG_D ("Found removed object. OID 0x%x", (unsigned int)entry.u.object.oid);
-				ptp_remove_object_from_cache(params, entry.u.object.oid);
-				gp_filesystem_reset (camera->fs);
+				remove_object_from_fs (camera, entry.u.object.oid, context);
 				break;
 			case PTP_CANON_EOS_CHANGES_TYPE_OBJECTINFO: {
 				int res;
@@ -4394,7 +4511,7 @@ camera_canon_eos_capture (Camera *camera, CameraCaptureType type, CameraFilePath
 		/* not really proven to help keep it on */
 		if (ptp_operation_issupported(params, PTP_OC_CANON_EOS_KeepDeviceOn)) C_PTP_REP (ptp_canon_eos_keepdeviceon (params));
 		gp_context_idle (context);
-	} while (waiting_for_timeout (&back_off_wait, capture_start, EOS_CAPTURE_TIMEOUT));
+	} while (waiting_for_timeout (params, &back_off_wait, capture_start, EOS_CAPTURE_TIMEOUT));
 
 	if (newobject == 0)
 		return GP_ERROR;
@@ -4426,20 +4543,10 @@ camera_canon_eos_capture (Camera *camera, CameraCaptureType type, CameraFilePath
 #define BLOBSIZE 1*1024*1024
 	/* the EOS R does not like 5MB, but likes 1MB */
 	/* Trying to read this in 1 block might be the cause of crashes of newer EOS */
-	{
-		uint32_t	offset = 0;
-
-		while (offset < oi.ObjectCompressedSize) {
-			uint32_t	xsize = oi.ObjectCompressedSize - offset;
-			unsigned char	*ximage = NULL;
-
-			if (xsize > BLOBSIZE)
-				xsize = BLOBSIZE;
-			C_PTP_REP (ptp_getpartialobject (params, newobject, offset, xsize, &ximage, &xsize));
-			gp_file_append (file, (char*)ximage, xsize);
-			free (ximage);
-			offset += xsize;
-		}
+	ret = getpartialobject_to_file (camera, newobject, oi.ObjectCompressedSize, BLOBSIZE, file, context);
+	if (ret != GP_OK) {
+		gp_file_free (file);
+		return ret;
 	}
 	/*old C_PTP_REP (ptp_canon_eos_getpartialobject (params, newobject, 0, oi.ObjectCompressedSize, &ximage));*/
 #undef BLOBSIZE
@@ -4662,8 +4769,7 @@ camera_canon_capture (Camera *camera, CameraCaptureType type, CameraFilePath *pa
 		GP_LOG_D ("Event: nparams=0x%X, code=0x%X, trans_id=0x%X, p1=0x%X, p2=0x%X, p3=0x%X", event.Nparam,event.Code,event.Transaction_ID, event.Param1, event.Param2, event.Param3);
 		switch (event.Code) {
 		case PTP_EC_ObjectRemoved:
-			ptp_remove_object_from_cache(params, event.Param1);
-			gp_filesystem_reset (camera->fs);
+			remove_object_from_fs (camera, event.Param1, context);
 			break;
 		case PTP_EC_ObjectAdded: {
 			/* add newly created object to internal structures. this hopefully just is a new folder */
@@ -4676,8 +4782,10 @@ camera_canon_capture (Camera *camera, CameraCaptureType type, CameraFilePath *pa
 				break;
 			/* this might be just the folder add, ignore that. */
 			if (ob->oi.ObjectFormat == PTP_OFC_Association) {
-				/* new directory ... mark fs as to be refreshed */
-				gp_filesystem_reset (camera->fs); /* FIXME: implement more lightweight folder add */
+				CameraFilePath	folderpath;
+
+				/* new directory ... add it to the fs */
+				add_object_to_fs_and_path (camera, event.Param1, &folderpath, context);
 				break;
 			} else {
 				/* new file */
@@ -4756,10 +4864,8 @@ camera_canon_capture (Camera *camera, CameraCaptureType type, CameraFilePath *pa
 		if (xmode != CANON_TRANSFER_CARD) {
 			fprintf (stderr,"parentobject is 0x%x, but not in card mode?\n", oi.ParentObject);
 		}
+		/* also adds a new folder to the fs */
 		ret = add_object_to_fs_and_path (camera, newobject, path, context);
-		/* FIXME: consistent handling of association add ... perhaps try another event loop turnaroundloop turnaround  */
-		if (oi.ObjectFormat == PTP_OFC_Association)
-			gp_filesystem_reset (camera->fs);
 		ptp_free_objectinfo(&oi);
 		return ret;
 	} else {
@@ -5314,7 +5420,7 @@ camera_fuji_capture (Camera *camera, CameraCaptureType type, CameraFilePath *pat
 			free (beforehandles.Handler);
 			return GP_OK;
 		}
-	}  while (waiting_for_timeout (&back_off_wait, event_start, waittime));
+	}  while (waiting_for_timeout (params, &back_off_wait, event_start, waittime));
 	free (beforehandles.Handler);
 	return GP_ERROR;
 }
@@ -5397,7 +5503,7 @@ camera_panasonic_capture (Camera *camera, CameraCaptureType type, CameraFilePath
 				break;
 			}
 		}
-	}  while (waiting_for_timeout (&back_off_wait, event_start, 65000)); /* wait for 66 seconds after busy is no longer signaled */
+	}  while (waiting_for_timeout (params, &back_off_wait, event_start, 65000)); /* wait for 66 seconds after busy is no longer signaled */
 
 downloadfile:
 
@@ -5446,7 +5552,7 @@ camera_olympus_omd_capture (Camera *camera, CameraCaptureType type, CameraFilePa
 				break;
 			}
 		}
-	}  while (waiting_for_timeout (&back_off_wait, event_start, 65000)); /* wait for 0.5 seconds after busy is no longer signaled */
+	}  while (waiting_for_timeout (params, &back_off_wait, event_start, 65000)); /* wait for 0.5 seconds after busy is no longer signaled */
 
 downloadfile:
 
@@ -5782,8 +5888,7 @@ fallback:
 
 		switch (event.Code) {
 		case PTP_EC_ObjectRemoved:
-			ptp_remove_object_from_cache(params, event.Param1);
-			gp_filesystem_reset (camera->fs);
+			remove_object_from_fs (camera, event.Param1, context);
 			break;
 		case PTP_EC_ObjectAdded: {
 			PTPObject	*ob;
@@ -5795,8 +5900,10 @@ fallback:
 
 			/* this might be just the folder add, ignore that. */
 			if (ob->oi.ObjectFormat == PTP_OFC_Association) {
-				/* new directory ... mark fs as to be refreshed */
-				gp_filesystem_reset (camera->fs);
+				CameraFilePath	folderpath;
+
+				/* new directory ... add it to the fs */
+				add_object_to_fs_and_path (camera, event.Param1, &folderpath, context);
 			} else {
 				newobject = event.Param1;
 				done |= 2;
@@ -5922,7 +6029,7 @@ camera_trigger_canon_eos_capture (Camera *camera, GPContext *context)
 				/* when doing manual focus, wait at most 0.1 seconds */
 				if (manualfocus && (time_since (focus_start) >= 100))
 					break;
-			} while (waiting_for_timeout (&back_off_wait, focus_start, 2*1000)); /* wait 2 seconds for focus */
+			} while (waiting_for_timeout (params, &back_off_wait, focus_start, 2*1000)); /* wait 2 seconds for focus */
 
 			if (!foundfocusinfo && !manualfocus) {
 				GP_LOG_E("no focus info?\n");
@@ -5977,7 +6084,7 @@ camera_trigger_canon_eos_capture (Camera *camera, GPContext *context)
 						break;
 					}
 				}
-			} while (!eos_m_focus_done && waiting_for_timeout (&back_off_wait, focus_start, 2*1000)); /* wait 2 seconds for focus */
+			} while (!eos_m_focus_done && waiting_for_timeout (params, &back_off_wait, focus_start, 2*1000)); /* wait 2 seconds for focus */
 			/* full release now (even if the press has failed) */
 			C_PTP_REP_MSG (ptp_canon_eos_remotereleaseoff (params, 3), _("Canon EOS M Full-Release failed"));
 			ptp_check_eos_events (params);
@@ -6455,20 +6562,11 @@ camera_wait_for_event (Camera *camera, int timeout,
 
 #define BLOBSIZE 1*1024*1024
 					/* Trying to read this in 1 block might be the cause of crashes of newer EOS */
-					{
-						uint32_t	offset = 0;
-
-						while (offset < entry.u.object.oi.ObjectCompressedSize) {
-							uint32_t	xsize = entry.u.object.oi.ObjectCompressedSize - offset;
-							unsigned char	*yimage = NULL;
-
-							if (xsize > BLOBSIZE)
-								xsize = BLOBSIZE;
-							C_PTP_REP (ptp_getpartialobject (params, newobject, offset, xsize, &yimage, &xsize));
-							gp_file_append (file, (char*)yimage, xsize);
-							free (yimage);
-							offset += xsize;
-						}
+					ret = getpartialobject_to_file (camera, newobject, entry.u.object.oi.ObjectCompressedSize, BLOBSIZE, file, context);
+					if (ret != GP_OK) {
+						gp_file_free (file);
+						free (path);
+						return ret;
 					}
 					/*old C_PTP_REP (ptp_canon_eos_getpartialobject (params, newobject, 0, oi.ObjectCompressedSize, &ximage));*/
 					/* C_PTP_REP (ptp_canon_eos_getpartialobject (params, newobject, 0, entry.u.object.oi.ObjectCompressedSize, (unsigned char**)&ximage));*/
@@ -6552,7 +6650,6 @@ camera_wait_for_event (Camera *camera, int timeout,
 					}
 					if (entry.u.object.oi.ObjectFormat == PTP_OFC_Association) {	/* not sure if we would get folder changed */
 						*eventtype = GP_EVENT_FOLDER_ADDED;
-						gp_filesystem_reset (camera->fs);
 					} else {
 						*eventtype = (entry.type == PTP_CANON_EOS_CHANGES_TYPE_OBJECTINFO) ? GP_EVENT_FILE_ADDED : GP_EVENT_FILE_CHANGED;
 						if (*eventtype == GP_EVENT_FILE_CHANGED) {
@@ -6625,8 +6722,7 @@ camera_wait_for_event (Camera *camera, int timeout,
 					/* continue otherwise */
 					break;
 				case PTP_CANON_EOS_CHANGES_TYPE_OBJECTREMOVED:
-					ptp_remove_object_from_cache(params, entry.u.object.oid);
-					gp_filesystem_reset (camera->fs);
+					remove_object_from_fs (camera, entry.u.object.oid, context);
 					*eventtype = GP_EVENT_UNKNOWN;
 					C_MEM (*eventdata = malloc(strlen("Object Removed")+1));
 					sprintf (*eventdata, "ObjectRemoved");
@@ -6637,7 +6733,7 @@ camera_wait_for_event (Camera *camera, int timeout,
 				}
 			}
 			gp_context_idle (context);
-		} while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		} while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 
 		*eventtype = GP_EVENT_TIMEOUT;
 		return GP_OK;
@@ -6760,7 +6856,6 @@ camera_wait_for_event (Camera *camera, int timeout,
 					if (ofc == PTP_OFC_Association) { /* new folder! */
 						*eventtype = GP_EVENT_FOLDER_ADDED;
 						*eventdata = path;
-						gp_filesystem_reset (camera->fs); /* FIXME: implement more lightweight folder add */
 						/* if this was the last current event ... stop and return the folder add */
 						return GP_OK;
 					} else {
@@ -6833,7 +6928,7 @@ downloadnow:
 				}
 			}
 			gp_context_idle (context);
-		} while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		} while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 
 		*eventtype = GP_EVENT_TIMEOUT;
 		return GP_OK;
@@ -6956,7 +7051,7 @@ sonyout:
 			if (ptp_get_one_event (params, &event))
 				goto handleregular;
 			gp_context_idle (context);
-		} while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		} while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 
 		*eventtype = GP_EVENT_TIMEOUT;
 		return GP_OK;
@@ -6993,7 +7088,7 @@ sonyout:
 			}
 			free (handles.Handler);
 			C_PTP_REP (ptp_check_event(params));
-		} while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		} while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 		*eventtype = GP_EVENT_TIMEOUT;
 		return GP_OK;
 	}
@@ -7067,7 +7162,7 @@ sonyout:
 			}
 
 			gp_context_idle (context);
-		} while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		} while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 
 		*eventtype = GP_EVENT_TIMEOUT;
 		return GP_OK;
@@ -7115,7 +7210,7 @@ sonyout:
 					return GP_OK;
 				}
 			}
-		}  while (waiting_for_timeout (&back_off_wait, event_start, timeout));
+		}  while (waiting_for_timeout (params, &back_off_wait, event_start, timeout));
 
 downloadomdfile:
 		C_MEM (path = malloc(sizeof(CameraFilePath)));
@@ -7208,7 +7303,6 @@ handleregular:
 		if (ob->oi.ObjectFormat == PTP_OFC_Association) { /* new folder! */
 			*eventtype = GP_EVENT_FOLDER_ADDED;
 			*eventdata = path;
-			gp_filesystem_reset (camera->fs); /* FIXME: implement more lightweight folder add */
 		} else {
 			*eventtype = GP_EVENT_FILE_ADDED;
 			*eventdata = path;
@@ -7285,8 +7379,7 @@ handleregular:
 		break;
 	}
 	case PTP_EC_ObjectRemoved:
-		ptp_remove_object_from_cache(params, event.Param1);
-		gp_filesystem_reset (camera->fs);
+		remove_object_from_fs (camera, event.Param1, context);
 		*eventtype = GP_EVENT_UNKNOWN;
 		C_MEM (*eventdata = malloc(strlen("PTP ObjectRemoved, Param1 01234567")+1));
 		sprintf (*eventdata, "PTP ObjectRemoved, Param1 %08x", event.Param1);
@@ -8560,6 +8653,70 @@ ptp_exit_camerafile_handler (PTPDataHandler *handler) {
 }
 
 
+/* How often a failed partial object read is retried before giving up.
+ * The delay between the attempts starts at 100ms and doubles every time. */
+#define PARTIAL_READ_RETRIES	4
+
+/* Session reopen hook for partial reads: a transfer that broke off midway
+ * can leave the device stuck in the data phase, so whack it back into its
+ * idle state and reopen the session we had. The object handles stay valid
+ * on the devices we know of. */
+static uint16_t
+reopen_session (Camera *camera)
+{
+	PTPParams	*params = &camera->pl->params;
+	uint32_t	sessionid = params->session_id;
+	uint16_t	ret;
+
+	if (camera->port->type != GP_PORT_USB)
+		return PTP_RC_OK;
+
+	GP_LOG_D ("Reopening session %u after transfer error.", sessionid);
+	ptp_usb_control_device_reset_request (params);
+	ret = LOG_ON_PTP_E (ptp_opensession (params, sessionid));
+	if (ret == PTP_RC_SessionAlreadyOpened)
+		ret = PTP_RC_OK;
+	return ret;
+}
+
+static uint16_t
+getpartialobject_retry (Camera *camera, uint32_t oid, uint64_t offset,
+			uint32_t size, unsigned char **xdata, uint32_t *xsize)
+{
+	PTPParams	*params = &camera->pl->params;
+	unsigned int	tries, delay = 100;
+	uint16_t	ret;
+
+	for (tries = 0; ; tries++) {
+		if ((params->deviceinfo.VendorExtensionID == PTP_VENDOR_MTP) &&
+			ptp_operation_issupported(params, PTP_OC_ANDROID_GetPartialObject64)
+		)
+			ret = ptp_android_getpartialobject64(params, oid, offset, size, xdata, xsize);
+		else
+			ret = ptp_getpartialobject(params, oid, offset, size, xdata, xsize);
+		if ((ret == PTP_RC_OK) || (tries == PARTIAL_READ_RETRIES))
+			return ret;
+
+		switch (ret) {
+		case PTP_RC_DeviceBusy:
+			break;
+		case PTP_ERROR_IO:
+		case PTP_ERROR_TIMEOUT:
+		case PTP_ERROR_RESP_EXPECTED:
+		case PTP_ERROR_DATA_EXPECTED:
+			if (reopen_session (camera) != PTP_RC_OK)
+				return ret;
+			break;
+		default:
+			return ret;
+		}
+		GP_LOG_D ("Reading %u bytes at offset %lu failed (0x%04x), retrying in %ums.",
+			  size, (unsigned long)offset, ret, delay);
+		usleep (delay * 1000);
+		delay *= 2;
+	}
+}
+
 static int
 read_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 	        CameraFileType type,
@@ -8580,7 +8737,7 @@ read_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 	uint32_t oid;
 	uint32_t storage;
 	uint64_t obj_size;
-	uint32_t offset32 = offset64, size32 = *size64;
+	uint32_t size32 = *size64;
 	PTPObject *ob;
 
 	SET_CONTEXT_P(params, context);
@@ -8648,13 +8805,7 @@ read_file_func (CameraFilesystem *fs, const char *folder, const char *filename,
 			size32 = obj_size - offset64;
 		}
 
-		if ((params->deviceinfo.VendorExtensionID == PTP_VENDOR_MTP) &&
-			ptp_operation_issupported(params, PTP_OC_ANDROID_GetPartialObject64)
-		) {
-			ret = ptp_android_getpartialobject64(params, oid, offset64, size32, &xdata, &size32);
-		} else {
-			ret = ptp_getpartialobject(params, oid, offset32, size32, &xdata, &size32);
-		}
+		ret = getpartialobject_retry (camera, oid, offset64, size32, &xdata, &size32);
 		if (ret == PTP_ERROR_CANCEL)
 			return GP_ERROR_CANCEL;
 		C_PTP_REP (ret);
@@ -9622,6 +9773,7 @@ camera_init (Camera *camera, GPContext *context)
 		params->event_wait	= ptp_usb_event_wait;
 		params->event_check	= ptp_usb_event_check;
 		params->event_check_queue	= ptp_usb_event_check_queue;
+		params->event_wait_timeout	= ptp_usb_event_wait_timeout;
 		params->cancelreq_func	= ptp_usb_control_cancel_request;
 		params->maxpacketsize 	= settings.usb.maxpacketsize;
 		GP_LOG_D ("maxpacketsize %d", settings.usb.maxpacketsize);
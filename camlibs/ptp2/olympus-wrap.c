@@ -437,11 +437,13 @@ olympus_xml_transfer (PTPParams *params,
 			evxml = malloc (oi.ObjectCompressedSize + 1);
 			memcpy (evxml, resxml, oi.ObjectCompressedSize);
 			evxml[oi.ObjectCompressedSize] = 0x00;
+			free (resxml);
 
 			GP_LOG_D ("file content: %s", evxml);
 
 			parse_event_xml (params, evxml, &ptp2);
 			/* parse it */
+			free (evxml);
 
 			evxml = generate_event_OK_xml(params, &ptp2);
 
@@ -466,6 +468,7 @@ olympus_xml_transfer (PTPParams *params,
 			ptp2.Code = PTP_OC_SendObject;
 			ptp2.Nparam = 0;
 			res = ptp_transaction(outerparams, &ptp2, PTP_DP_SENDDATA, strlen(evxml), (unsigned char**)&evxml, NULL);
+			free (evxml);
 			if (res != PTP_RC_OK)
 				return res;
 			continue;
@@ -528,6 +531,7 @@ redo:
 		*inxml = malloc (oi.ObjectCompressedSize + 1);
 		memcpy (*inxml, resxml, oi.ObjectCompressedSize);
 		(*inxml)[oi.ObjectCompressedSize] = 0x00;
+		free (resxml);
 
 		GP_LOG_D ("file content: %s", *inxml);
 		/* parse it */
@@ -536,42 +540,256 @@ redo:
 	return PTP_RC_OK;
 }
 
+/* The replies and events are small documents of a fixed shape, like
+ *	<?xml version="1.0"?>
+ *	<x3c xmlns="http://www1.olympus-imaging.com/ww/x3c">
+ *	<output><result>2001</result><c1016><pD135/></c1016></output></x3c>
+ * They are scanned in place into a flat table of elements, without
+ * building a libxml2 tree. Anything outside of that shape (entities,
+ * comments, CDATA, namespace prefixes, mixed content) is handed to
+ * libxml2 instead, which fills the same table.
+ */
+#define X3C_MAX_DEPTH	16
+
+typedef struct {
+	const char	*name;
+	const char	*content;	/* text of the element */
+	int		first;		/* first child element, -1 if none */
+	int		last;		/* last child element, -1 if none */
+	int		next;		/* next sibling element, -1 if none */
+	int		count;		/* number of child elements */
+	xmlChar		*dom_content;	/* content, if it came from libxml2 */
+} x3c_node;
+
+typedef struct {
+	x3c_node	*node;
+	int		nodes, size;
+	x3c_node	small_node[32];
+	char		small[2048];	/* scanned copy of small documents */
+	char		*buf;
+	xmlDocPtr	dom;		/* set if libxml2 parsed the document */
+} x3c_doc;
+
+static int
+x3c_blank (const char *s, const char *end) {
+	for (; s < end; s++)
+		if (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n')
+			return FALSE;
+	return TRUE;
+}
+
+static int
+x3c_add_node (x3c_doc *doc, int parent, const char *name) {
+	x3c_node	*n;
+
+	if (doc->nodes == doc->size) {
+		n = malloc (2 * doc->size * sizeof(x3c_node));
+		if (!n)
+			return -1;
+		memcpy (n, doc->node, doc->nodes * sizeof(x3c_node));
+		if (doc->node != doc->small_node)
+			free (doc->node);
+		doc->node = n;
+		doc->size *= 2;
+	}
+	n = &doc->node[doc->nodes];
+	n->name		= name;
+	n->content	= "";
+	n->first	= -1;
+	n->last		= -1;
+	n->next		= -1;
+	n->count	= 0;
+	n->dom_content	= NULL;
+	if (parent >= 0) {
+		n = &doc->node[parent];
+		if (n->last >= 0)
+			doc->node[n->last].next = doc->nodes;
+		else
+			n->first = doc->nodes;
+		n->last = doc->nodes;
+		n->count++;
+	}
+	return doc->nodes++;
+}
+
+/* Returns FALSE if the document is not of the simple kind described above. */
+static int
+x3c_scan (x3c_doc *doc, const char *txt) {
+	int	stack[X3C_MAX_DEPTH];
+	int	depth = 0, n;
+	size_t	len = strlen (txt);
+	char	*s, *t, *text, c;
+
+	doc->nodes = 0;
+	doc->buf = len < sizeof(doc->small) ? doc->small : malloc (len + 1);
+	if (!doc->buf)
+		return FALSE;
+	memcpy (doc->buf, txt, len + 1);
+
+	s = doc->buf;
+	s += strspn (s, " \t\r\n");
+	while (!strncmp (s, "<?", 2)) {
+		if (!(s = strstr (s, "?>")))
+			return FALSE;
+		s += 2;
+		s += strspn (s, " \t\r\n");
+	}
+	if (*s != '<')
+		return FALSE;
+
+	while (1) {
+		/* s points to the '<' of a start tag */
+		const char *name = ++s;
+
+		if (*s == '!' || *s == '?' || *s == '/')
+			return FALSE;
+		s += strcspn (s, " \t\r\n/>");
+		if (s == name || memchr (name, ':', s - name))
+			return FALSE;
+		c = *s;
+		*s = '\0';
+		if (c != '/' && c != '>') {	/* skip attributes */
+			for (s++; *s && *s != '>' && strncmp (s, "/>", 2); s++)
+				if ((*s == '"') || (*s == '\'')) {
+					if (!(s = strchr (s + 1, *s)))
+						return FALSE;
+				}
+			c = *s;
+		}
+		n = x3c_add_node (doc, depth ? stack[depth-1] : -1, name);
+		if (n < 0)
+			return FALSE;
+		if (c == '/') {			/* <name/> */
+			if (s[1] != '>')
+				return FALSE;
+			s += 2;
+		} else if (c == '>') {
+			if (depth == X3C_MAX_DEPTH)
+				return FALSE;
+			stack[depth++] = n;
+			s++;
+		} else
+			return FALSE;
+
+		/* text and end tags up to the next start tag */
+		while (depth) {
+			text = s;
+			if (!(t = strchr (s, '<')) || memchr (text, '&', t - text))
+				return FALSE;
+			if (t[1] != '/') {
+				if (t[1] == '!' || t[1] == '?' || !x3c_blank (text, t))
+					return FALSE;
+				break;
+			}
+			n = stack[depth-1];
+			s = t + 2;
+			len = strlen (doc->node[n].name);
+			if (strncmp (s, doc->node[n].name, len))
+				return FALSE;
+			s += len;
+			s += strspn (s, " \t\r\n");
+			if (*s != '>')
+				return FALSE;
+			s++;
+			if (doc->node[n].count) {
+				if (!x3c_blank (text, t))
+					return FALSE;
+			} else {
+				*t = '\0';
+				doc->node[n].content = text;
+			}
+			depth--;
+		}
+		if (!depth)
+			break;
+		s = t;
+	}
+	s += strspn (s, " \t\r\n");
+	return *s == '\0';
+}
+
 static int
-traverse_tree (PTPParams *params, int depth, xmlNodePtr node) {
-	xmlNodePtr	next;
-	xmlChar		*xchar;
-	int n;
-	char 		*xx;
+x3c_from_dom (x3c_doc *doc, xmlNodePtr node, int parent) {
+	for (; node; node = xmlNextElementSibling (node)) {
+		int n = x3c_add_node (doc, parent, (char*)node->name);
+
+		if (n < 0)
+			return FALSE;
+		doc->node[n].dom_content = xmlNodeGetContent (node);
+		if (doc->node[n].dom_content)
+			doc->node[n].content = (char*)doc->node[n].dom_content;
+		if (!x3c_from_dom (doc, xmlFirstElementChild (node), n))
+			return FALSE;
+	}
+	return TRUE;
+}
 
+/* Parses txt into doc, returns the root element or -1 */
+static int
+x3c_parse (x3c_doc *doc, const char *txt) {
+	doc->node = doc->small_node;
+	doc->size = sizeof(doc->small_node)/sizeof(doc->small_node[0]);
+	doc->buf = NULL;
+	doc->dom = NULL;
+	if (x3c_scan (doc, txt))
+		return 0;
+	GP_LOG_D ("x3c: document needs the full XML parser");
+
+	doc->nodes = 0;
+	doc->dom = xmlReadMemory (txt, strlen(txt), "http://gphoto.org/", "utf-8", 0);
+	if (!doc->dom)
+		return -1;
+	if (!x3c_from_dom (doc, xmlDocGetRootElement (doc->dom), -1) || !doc->nodes)
+		return -1;
+	return 0;
+}
+
+static void
+x3c_free (x3c_doc *doc) {
+	int i;
+
+	if (doc->buf != doc->small)
+		free (doc->buf);
+	if (doc->dom) {
+		for (i = 0; i < doc->nodes; i++)
+			xmlFree (doc->node[i].dom_content);
+		xmlFreeDoc (doc->dom);
+	}
+	if (doc->node != doc->small_node)
+		free (doc->node);
+}
 
-	if (!node) return FALSE;
+static int
+traverse_tree (PTPParams *params, int depth, x3c_doc *doc, int node) {
+	int	next;
+	char 	*xx;
+
+
+	if (node < 0) return FALSE;
 	xx = malloc(depth * 4 + 1);
 	memset (xx, ' ', depth*4);
 	xx[depth*4] = 0;
 
-	n = xmlChildElementCount (node);
-
 	next = node;
 	do {
-		ptp_debug(params,"%snode %s", xx, next->name);
-		ptp_debug(params,"%selements %d", xx, n);
-		xchar = xmlNodeGetContent (next);
-		ptp_debug(params,"%scontent %s", xx, xchar);
-		traverse_tree (params, depth+1,xmlFirstElementChild (next));
-	} while ((next = xmlNextElementSibling (next)));
+		ptp_debug(params,"%snode %s", xx, doc->node[next].name);
+		ptp_debug(params,"%selements %d", xx, doc->node[next].count);
+		ptp_debug(params,"%scontent %s", xx, doc->node[next].content);
+		traverse_tree (params, depth+1, doc, doc->node[next].first);
+	} while ((next = doc->node[next].next) >= 0);
 	free (xx);
 	return TRUE;
 }
 
 static int
-parse_9581_tree (xmlNodePtr node) {
-	xmlNodePtr next;
+parse_9581_tree (x3c_doc *doc, int node) {
+	int next;
 
-	next = xmlFirstElementChild (node);
-	while (next) {
-		if (!strcmp ((char*)next->name, "data")) {
+	next = doc->node[node].first;
+	while (next >= 0) {
+		if (!strcmp (doc->node[next].name, "data")) {
 			char *decoded, *x;
-			char *xchars = (char*)xmlNodeGetContent (next);
+			const char *xchars = doc->node[next].content;
 
 			x = decoded = malloc(strlen(xchars)+1);
 			while (xchars[0] && xchars[1]) {
@@ -584,56 +802,54 @@ parse_9581_tree (xmlNodePtr node) {
 			GP_LOG_D ("9581: %s", decoded);
 
 
-			next = xmlNextElementSibling (next);
+			next = doc->node[next].next;
 			free (decoded);
 			continue;
 		}
-		GP_LOG_E ("9581: unhandled node type %s", next->name);
-		next = xmlNextElementSibling (next);
+		GP_LOG_E ("9581: unhandled node type %s", doc->node[next].name);
+		next = doc->node[next].next;
 	}
 	/*traverse_tree (0, node);*/
 	return TRUE;
 }
 
 static int
-parse_910a_tree (xmlNodePtr node) {
-	xmlNodePtr next;
+parse_910a_tree (x3c_doc *doc, int node) {
+	int next;
 
-	next = xmlFirstElementChild (node);
-	do {
-		if (!strcmp ((char*)next->name, "param")) {
+	for (next = doc->node[node].first; next >= 0; next = doc->node[next].next) {
+		if (!strcmp (doc->node[next].name, "param")) {
 			unsigned int x;
-			xmlChar *xchar = xmlNodeGetContent (next);
-			if (!sscanf((char*)xchar,"%08x", &x)) {
-				fprintf(stderr,"could not parse param content %s\n", xchar);
+			if (!sscanf(doc->node[next].content,"%08x", &x)) {
+				fprintf(stderr,"could not parse param content %s\n", doc->node[next].content);
 			}
 			fprintf(stderr,"param content is 0x%08x\n", x);
 			continue;
 		}
-		fprintf (stderr,"910a: unhandled type %s\n", next->name);
-	} while ((next = xmlNextElementSibling (next)));
+		fprintf (stderr,"910a: unhandled type %s\n", doc->node[next].name);
+	}
 	/*traverse_tree (0, node);*/
 	return TRUE;
 }
 
 static int
-parse_9302_tree (xmlNodePtr node) {
-	xmlNodePtr	next;
-	xmlChar		*xchar;
+parse_9302_tree (x3c_doc *doc, int node) {
+	int		next;
+	const char	*xchar;
 
-	next = xmlFirstElementChild (node);
-	while (next) {
-		if (!strcmp((char*)next->name, "x3cVersion")) {
+	next = doc->node[node].first;
+	while (next >= 0) {
+		if (!strcmp(doc->node[next].name, "x3cVersion")) {
 			int x3cver;
-			xchar = xmlNodeGetContent (next);
-			sscanf((char*)xchar, "%04x", &x3cver);
+			xchar = doc->node[next].content;
+			sscanf(xchar, "%04x", &x3cver);
 			GP_LOG_D ("x3cVersion %d.%d", (x3cver>>8)&0xff, x3cver&0xff);
 			goto xnext;
 		}
-		if (!strcmp((char*)next->name, "productIDs")) {
-			char *x, *nextspace;
+		if (!strcmp(doc->node[next].name, "productIDs")) {
+			const char *x, *nextspace;
 			int len;
-			x = (char*)(xchar = xmlNodeGetContent (next));
+			x = xchar = doc->node[next].content;
 			GP_LOG_D ("productIDs:");
 
 			do {
@@ -662,9 +878,9 @@ parse_9302_tree (xmlNodePtr node) {
 
 			goto xnext;
 		}
-		GP_LOG_E ("unknown node in 9301: %s", next->name);
+		GP_LOG_E ("unknown node in 9301: %s", doc->node[next].name);
 xnext:
-		next = xmlNextElementSibling (next);
+		next = doc->node[next].next;
 	}
 	return TRUE;
 }
@@ -867,32 +1083,32 @@ parse_1015_tree (xmlNodePtr node, uint16_t type) {
 #endif
 
 static int
-traverse_output_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
-	xmlNodePtr next;
+traverse_output_tree (PTPParams *params, x3c_doc *doc, int node, PTPContainer *resp) {
+	int next;
 	int cmd;
 
-	if (strcmp((char*)node->name,"output")) {
-		GP_LOG_E ("node is not output, but %s.", node->name);
+	if (strcmp(doc->node[node].name,"output")) {
+		GP_LOG_E ("node is not output, but %s.", doc->node[node].name);
 		return FALSE;
 	}
-	if (xmlChildElementCount(node) != 2) {
-		GP_LOG_E ("output: expected 2 children, got %ld.", xmlChildElementCount(node));
+	if (doc->node[node].count != 2) {
+		GP_LOG_E ("output: expected 2 children, got %d.", doc->node[node].count);
 		return FALSE;
 	}
-	next = xmlFirstElementChild (node);
-	if (!strcmp((char*)next->name,"result")) {
+	next = doc->node[node].first;
+	if (!strcmp(doc->node[next].name,"result")) {
 		int result;
-		xmlChar *xchar;
-		xchar = xmlNodeGetContent (next);
-		if (!sscanf((char*)xchar,"%04x",&result))
+		const char *xchar;
+		xchar = doc->node[next].content;
+		if (!sscanf(xchar,"%04x",&result))
 			GP_LOG_E ("failed scanning result from %s", xchar);
 		resp->Code = result;
 		GP_LOG_D ("ptp result is 0x%04x", result);
 
 	}
-	next = xmlNextElementSibling (next);
-	if (!sscanf ((char*)next->name, "c%04x", &cmd)) {
-		GP_LOG_E ("expected c<HEX>, have %s", next->name);
+	next = doc->node[next].next;
+	if (!sscanf (doc->node[next].name, "c%04x", &cmd)) {
+		GP_LOG_E ("expected c<HEX>, have %s", doc->node[next].name);
 		return FALSE;
 	}
 	GP_LOG_D ("cmd is 0x%04x", cmd);
@@ -905,9 +1121,9 @@ traverse_output_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
 #if 0
 	case PTP_OC_OLYMPUS_GetDeviceInfo: return parse_9301_tree (next); /* 9301 */
 #endif
-	case PTP_OC_OLYMPUS_OpenSession: return parse_9302_tree (next);
-	case PTP_OC_OLYMPUS_GetCameraControlMode: return parse_910a_tree (next);
-	case PTP_OC_OLYMPUS_GetCameraID: return parse_9581_tree (next);
+	case PTP_OC_OLYMPUS_OpenSession: return parse_9302_tree (doc, next);
+	case PTP_OC_OLYMPUS_GetCameraControlMode: return parse_910a_tree (doc, next);
+	case PTP_OC_OLYMPUS_GetCameraID: return parse_9581_tree (doc, next);
 
 	case PTP_OC_SetDevicePropValue: /* <output>\n<result>2001</result>\n<c1016>\n<pD135/>\n</c1016>\n</output> */
 		/* we could cross check the parameter, but its not strictly necessary */
@@ -916,39 +1132,39 @@ traverse_output_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
 	case PTP_OC_GetDevicePropValue: return parse_1015_tree ( next , PTP_DTC_UINT32);
 #endif
 	default:
-		return traverse_tree (params, 0, next);
+		return traverse_tree (params, 0, doc, next);
 	}
 	return FALSE;
 }
 
 static int
-traverse_input_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
+traverse_input_tree (PTPParams *params, x3c_doc *doc, int node, PTPContainer *resp) {
 	unsigned int	curpar = 0;
 	int		evt;
-	xmlNodePtr	next = xmlFirstElementChild (node);
+	int		next = doc->node[node].first;
 	uint32_t	pars[5];
 
 
-	if (!next) {
+	if (next < 0) {
 		GP_LOG_E ("no nodes below input.");
 		return FALSE;
 	}
 
 	resp->Code = 0;
-	while (next) {
-		if (sscanf((char*)next->name,"e%x",&evt)) {
+	while (next >= 0) {
+		if (sscanf(doc->node[next].name,"e%x",&evt)) {
 			resp->Code = evt;
 
 			switch (evt) {
 			case PTP_EC_Olympus_PropertyChanged: {
-				xmlNodePtr propidnode = xmlFirstElementChild(next);
+				int propidnode = doc->node[next].first;
 
 				/* Gets a list of property that changed ... stuff into
 				 * event queue. */
-				while (propidnode) {
+				while (propidnode >= 0) {
 					int propid;
 
-					if (sscanf((char*)propidnode->name,"p%x", &propid)) {
+					if (sscanf(doc->node[propidnode].name,"p%x", &propid)) {
 						PTPContainer ptp;
 
 						memset(&ptp, 0, sizeof(ptp));
@@ -957,32 +1173,32 @@ traverse_input_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
 						ptp.Param1 = propid;
 						ptp_add_event (params, &ptp);
 					}
-					propidnode = xmlNextElementSibling (propidnode);
+					propidnode = doc->node[propidnode].next;
 				}
 				break;
 			}
 			default:
-				if (xmlChildElementCount(node) != 0) {
-					GP_LOG_E ("event %s hat tree below?", (char*)next->name);
-					traverse_tree (params, 0, xmlFirstElementChild(next));
+				if (doc->node[node].count != 0) {
+					GP_LOG_E ("event %s hat tree below?", doc->node[next].name);
+					traverse_tree (params, 0, doc, doc->node[next].first);
 				}
 			}
-			next = xmlNextElementSibling (next);
+			next = doc->node[next].next;
 			continue;
 		}
-		if (!strcmp((char*)next->name,"param")) {
+		if (!strcmp(doc->node[next].name,"param")) {
 			int x;
-			if (sscanf((char*)xmlNodeGetContent(next),"%x", &x)) {
+			if (sscanf(doc->node[next].content,"%x", &x)) {
 				if (curpar < sizeof(pars)/sizeof(pars[0]))
 					pars[curpar++] = x;
 				else
-					GP_LOG_E ("ignore superfluous argument %s/%x", (char*)xmlNodeGetContent(next), x);
+					GP_LOG_E ("ignore superfluous argument %s/%x", doc->node[next].content, x);
 			}
-			next = xmlNextElementSibling (next);
+			next = doc->node[next].next;
 			continue;
 		}
-		GP_LOG_E ("parsing event input node, unknown node %s", (char*)next->name);
-		next = xmlNextElementSibling (next);
+		GP_LOG_E ("parsing event input node, unknown node %s", doc->node[next].name);
+		next = doc->node[next].next;
 	}
 	resp->Nparam = curpar;
 	switch (curpar) {
@@ -998,187 +1214,163 @@ traverse_input_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
 }
 
 static int
-traverse_x3c_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
-	xmlNodePtr	next;
+traverse_x3c_tree (PTPParams *params, x3c_doc *doc, int node, PTPContainer *resp) {
+	int	next;
 
-	if (!node)
+	if (node < 0)
 		return FALSE;
-	if (strcmp((char*)node->name,"x3c")) {
-		GP_LOG_E ("node is not x3c, but %s.", node->name);
+	if (strcmp(doc->node[node].name,"x3c")) {
+		GP_LOG_E ("node is not x3c, but %s.", doc->node[node].name);
 		return FALSE;
 	}
-	if (xmlChildElementCount(node) != 1) {
-		GP_LOG_E ("x3c: expected 1 child, got %ld.", xmlChildElementCount(node));
+	if (doc->node[node].count != 1) {
+		GP_LOG_E ("x3c: expected 1 child, got %d.", doc->node[node].count);
 		return FALSE;
 	}
-	next = xmlFirstElementChild (node);
-	if (!strcmp((char*)next->name, "output"))
-		return traverse_output_tree (params, next, resp);
-	if (!strcmp((char*)next->name, "input"))
-		return traverse_input_tree (params, next, resp); /* event */
-	GP_LOG_E ("unknown name %s below x3c.", next->name);
+	next = doc->node[node].first;
+	if (!strcmp(doc->node[next].name, "output"))
+		return traverse_output_tree (params, doc, next, resp);
+	if (!strcmp(doc->node[next].name, "input"))
+		return traverse_input_tree (params, doc, next, resp); /* event */
+	GP_LOG_E ("unknown name %s below x3c.", doc->node[next].name);
 	return FALSE;
 }
 
 static int
-traverse_x3c_event_tree (PTPParams *params, xmlNodePtr node, PTPContainer *resp) {
-	xmlNodePtr	next;
+traverse_x3c_event_tree (PTPParams *params, x3c_doc *doc, int node, PTPContainer *resp) {
+	int	next;
 
-	if (!node)
+	if (node < 0)
 		return FALSE;
-	if (strcmp((char*)node->name,"x3c")) {
-		GP_LOG_E ("node is not x3c, but %s.", node->name);
+	if (strcmp(doc->node[node].name,"x3c")) {
+		GP_LOG_E ("node is not x3c, but %s.", doc->node[node].name);
 		return FALSE;
 	}
-	if (xmlChildElementCount(node) != 1) {
-		GP_LOG_E ("x3c: expected 1 child, got %ld.", xmlChildElementCount(node));
+	if (doc->node[node].count != 1) {
+		GP_LOG_E ("x3c: expected 1 child, got %d.", doc->node[node].count);
 		return FALSE;
 	}
-	next = xmlFirstElementChild (node);
-	if (!strcmp((char*)next->name, "input"))
-		return traverse_input_tree (params, next, resp); /* event */
-	GP_LOG_E ("unknown name %s below x3c.", next->name);
+	next = doc->node[node].first;
+	if (!strcmp(doc->node[next].name, "input"))
+		return traverse_input_tree (params, doc, next, resp); /* event */
+	GP_LOG_E ("unknown name %s below x3c.", doc->node[next].name);
 	return FALSE;
 }
 
 static int
 parse_xml(PTPParams *params, const char *txt, PTPContainer *resp) {
-	xmlDocPtr	docin;
-	xmlNodePtr	docroot;
-
-	docin = xmlReadMemory (txt, strlen(txt), "http://gphoto.org/", "utf-8", 0);
-	if (!docin) return FALSE;
-	docroot = xmlDocGetRootElement (docin);
-	if (!docroot) return FALSE;
-	return traverse_x3c_tree (params, docroot, resp);
+	x3c_doc	doc;
+	int	ret;
+
+	ret = traverse_x3c_tree (params, &doc, x3c_parse (&doc, txt), resp);
+	x3c_free (&doc);
+	return ret;
 }
 
 static int
 parse_event_xml(PTPParams *params, const char *txt, PTPContainer *resp) {
-	xmlDocPtr	docin;
-	xmlNodePtr	docroot;
-
-	docin = xmlReadMemory (txt, strlen(txt), "http://gphoto.org/", "utf-8", 0);
-	if (!docin) return FALSE;
-	docroot = xmlDocGetRootElement (docin);
-	if (!docroot) return FALSE;
-	return traverse_x3c_event_tree (params, docroot, resp);
+	x3c_doc	doc;
+	int	ret;
+
+	ret = traverse_x3c_event_tree (params, &doc, x3c_parse (&doc, txt), resp);
+	x3c_free (&doc);
+	return ret;
 }
 
-static void
-encode_command (xmlNodePtr inputnode, PTPContainer *ptp, unsigned char *data, int len)
+/* The documents sent to the camera are printed from a template; this is
+ * byte for byte what xmlDocDumpMemory() made of the equivalent tree. */
+#define X3C_HEAD	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\">"
+#define X3C_TAIL	"</x3c>\n"
+
+static char *
+encode_command (PTPContainer *ptp, unsigned char *data, int len)
 {
-	xmlNodePtr	cmdnode;
-	char 		code[20];
+	char	*xml, *x;
+	int	i;
 
-	sprintf(code,"c%04X", ptp->Code);
-	cmdnode 	= xmlNewChild (inputnode, NULL, (xmlChar*)code, NULL);
+	xml = malloc (sizeof(X3C_HEAD) + sizeof(X3C_TAIL) + 128 + 2*len);
+	if (!xml)
+		return NULL;
+	x = xml + sprintf (xml, X3C_HEAD "<input><c%04X", ptp->Code);
 
 	switch (ptp->Code) {
-	case 0x1014: { /* OK */
-		sprintf (code, "p%04X", ptp->Param1);
-		xmlNewChild (cmdnode, NULL, (xmlChar*)code, NULL);
+	case 0x1014: /* OK */
+		x += sprintf (x, "><p%04X/></c%04X>", ptp->Param1, ptp->Code);
 		break;
-	}
-	case 0x1016: {
-		char buf[20];
-		xmlNodePtr	pnode;
+	case 0x1016:
 		/* zb <c1016><pD10D><value>000A000D</value></pD10D></c1016> */
 		/* FIXME: might still be wrong. */
 		/* We can directly byte encode the data we get from the PTP stack */
 		/* ... BUT the byte order is bigendian (printed) vs encoded */
-		int i;
-		char *x = malloc (len*2+1);
-
-		if (len <= 4) { /* just dump the bytes in big endian byteorder */
-			for (i=0;i<len;i++)
-				sprintf(x+2*i,"%02X",data[len-i-1]);
+		x += sprintf (x, "><p%04X>", ptp->Param1);
+		if (!len) {
+			x += sprintf (x, "<value/>");
 		} else {
-			for (i=0;i<len;i++)
-				sprintf(x+2*i,"%02X",data[i]);
+			x += sprintf (x, "<value>");
+			if (len <= 4) { /* just dump the bytes in big endian byteorder */
+				for (i=0;i<len;i++)
+					x += sprintf(x,"%02X",data[len-i-1]);
+			} else {
+				for (i=0;i<len;i++)
+					x += sprintf(x,"%02X",data[i]);
+			}
+			x += sprintf (x, "</value>");
 		}
-		sprintf(buf,"p%04X", ptp->Param1);
-		pnode = xmlNewChild (cmdnode, NULL, (xmlChar*)buf, NULL);
-		xmlNewChild (pnode, NULL, (xmlChar*)"value", (xmlChar*)x);
-		free (x);
+		x += sprintf (x, "</p%04X></c%04X>", ptp->Param1, ptp->Code);
 		break;
-	}
 	default:
-		if (ptp->Nparam) {
-			switch (ptp->Nparam) {
-			case 1:
-				sprintf (code, "%08X", ptp->Param1);
-				xmlNewChild (cmdnode, NULL, (xmlChar*)"param", (xmlChar*)code);
-				break;
-			case 2:
-				sprintf (code, "%08X", ptp->Param1);
-				xmlNewChild (cmdnode, NULL, (xmlChar*)"param", (xmlChar*)code);
-				sprintf (code, "%08X", ptp->Param2);
-				xmlNewChild (cmdnode, NULL, (xmlChar*)"param", (xmlChar*)code);
-				break;
-			}
+		switch (ptp->Nparam) {
+		case 1:
+			x += sprintf (x, "><param>%08X</param></c%04X>",
+				      ptp->Param1, ptp->Code);
+			break;
+		case 2:
+			x += sprintf (x, "><param>%08X</param><param>%08X</param></c%04X>",
+				      ptp->Param1, ptp->Param2, ptp->Code);
+			break;
+		default:
+			x += sprintf (x, "/>");
+			break;
 		}
 		break;
 	}
+	sprintf (x, "</input>" X3C_TAIL);
+	return xml;
 }
 
 static char*
 generate_event_OK_xml(PTPParams *params, PTPContainer *ptp) {
-	xmlDocPtr	docout;
-	xmlChar		*output;
-	int		len;
-	xmlNodePtr	x3cnode, inputnode;
-	char		buf[10];
+	char	*output;
 
 	/*
 	"HRSPONSE.X3C" ... sent back to camera after receiving an event.
 	<output><result>2001</result><ec102/></output
 	 */
-
-	docout 		= xmlNewDoc ((xmlChar*)"1.0");
-	x3cnode		= xmlNewDocNode (docout, NULL, (xmlChar*)"x3c", NULL);
-	                  xmlNewNs (x3cnode,(xmlChar*)"http://www1.olympus-imaging.com/ww/x3c",NULL);
-	inputnode 	= xmlNewChild (x3cnode, NULL, (xmlChar*)"output", NULL);
-
-	sprintf (buf,"e%04X", ptp->Code);
-
-	xmlNewChild (inputnode,  NULL, (xmlChar*)"result", (xmlChar*)"2001");
-	xmlNewChild (inputnode,  NULL, (xmlChar*)buf, NULL);
-
-	xmlDocSetRootElement (docout, x3cnode);
-	xmlDocDumpMemory (docout, &output, &len);
+	output = malloc (sizeof(X3C_HEAD) + sizeof(X3C_TAIL) + 64);
+	if (!output)
+		return NULL;
+	sprintf (output, X3C_HEAD "<output><result>2001</result><e%04X/></output>" X3C_TAIL, ptp->Code);
 
 	GP_LOG_D ("generated xml is:");
 	GP_LOG_D ("%s", output);
 
 	/* NOTE: Windows driver generates XML with CRLF, Unix just creates XML with LF.
 	 * Olympus E-410 does not seem to care. */
-	return (char*)output;
+	return output;
 }
 static char*
 generate_xml(PTPParams *params, PTPContainer *ptp, unsigned char *data, int len) {
-	xmlDocPtr	docout;
-	xmlChar		*output;
-	xmlNodePtr	x3cnode;
-	xmlNodePtr	inputnode;
-
-	docout 		= xmlNewDoc ((xmlChar*)"1.0");
-	x3cnode		= xmlNewDocNode (docout, NULL, (xmlChar*)"x3c", NULL);
-	                  xmlNewNs (x3cnode,(xmlChar*)"http://www1.olympus-imaging.com/ww/x3c",NULL);
-	inputnode 	= xmlNewChild (x3cnode, NULL, (xmlChar*)"input", NULL);
+	char	*output;
 
 	/* The fun starts in here: */
-	encode_command (inputnode, ptp, data, len);
-
-	xmlDocSetRootElement (docout, x3cnode);
-	xmlDocDumpMemory (docout, &output, &len);
+	output = encode_command (ptp, data, len);
 
 	GP_LOG_D ("generated xml is:");
 	GP_LOG_D ("%s", output);
 
 	/* NOTE: Windows driver generates XML with CRLF, Unix just creates XML with LF.
 	 * Olympus E-410 does not seem to care. */
-	return (char*)output;
+	return output;
 }
 
 static int
@@ -1255,6 +1447,7 @@ ums_wrap2_event_check (PTPParams* params, PTPContainer* req)
 		evxml = malloc (oi.ObjectCompressedSize + 1);
 		memcpy (evxml, resxml, oi.ObjectCompressedSize);
 		evxml[oi.ObjectCompressedSize] = 0x00;
+		free (resxml);
 
 		GP_LOG_D ("file content: %s", evxml);
 
@@ -1262,6 +1455,7 @@ ums_wrap2_event_check (PTPParams* params, PTPContainer* req)
 
 		/* parse it  ... into req */
 		parse_event_xml (params, evxml, req);
+		free (evxml);
 
 		/* generate reply */
 		evxml = generate_event_OK_xml(params, req);
@@ -1287,6 +1481,7 @@ ums_wrap2_event_check (PTPParams* params, PTPContainer* req)
 		ptp2.Code = PTP_OC_SendObject;
 		ptp2.Nparam = 0;
 		res = ptp_transaction(outerparams, &ptp2, PTP_DP_SENDDATA, strlen(evxml), (unsigned char**)&evxml, NULL);
+		free (evxml);
 		if (res != PTP_RC_OK)
 			return res;
 		return PTP_RC_OK;
@@ -1300,6 +1495,8 @@ ums_wrap2_sendreq (PTPParams* params, PTPContainer* req, int dataphase)
 	if (is_outer_operation (params,req->Code))
 		return ums_wrap_sendreq (params,req,dataphase);
 	/* We do stuff in either senddata, getdata or getresp, not here. */
+	free (params->olympus_cmd);
+	free (params->olympus_reply);
 	params->olympus_cmd   = NULL;
 	params->olympus_reply = NULL;
 	return PTP_RC_OK;
@@ -1397,6 +1594,7 @@ olympus_setup (PTPParams *params) {
 
 	params->event_check	= ums_wrap2_event_check;
 	params->event_wait	= ums_wrap2_event_check;
+	params->event_wait_timeout	= NULL;
 
 	params->outer_params = outerparams = malloc (sizeof(PTPParams));
 	memcpy(outerparams, params, sizeof(PTPParams));
@@ -1991,50 +1991,53 @@ _lookup_or_allocate_canon_prop(PTPParams *params, uint16_t proptype)
 }
 
 
+/*
+ * Makes room for n more entries behind the used ones this decoder run has
+ * already appended to the EOS event backlog, and returns where the
+ * appended entries start. The backlog array is reused across calls, it is
+ * only compacted or grown when the new entries do not fit.
+ */
+static PTPCanon_changes_entry*
+ptp_reserve_eos_backlog (PTPParams *params, unsigned int used, unsigned int n)
+{
+	PTPCanon_changes_entry	*nentries;
+	unsigned int		pending = params->nrofbacklogentries + used;
+	unsigned int		alloc;
+
+	if (params->firstbacklogentry + pending + n > params->backlogentries_alloc) {
+		if (params->firstbacklogentry) {
+			memmove (params->backlogentries, params->backlogentries + params->firstbacklogentry,
+				 sizeof(params->backlogentries[0])*pending);
+			params->firstbacklogentry = 0;
+		}
+		if (pending + n > params->backlogentries_alloc) {
+			alloc = params->backlogentries_alloc ? params->backlogentries_alloc*2 : 32;
+			while (alloc < pending + n)
+				alloc *= 2;
+			nentries = realloc (params->backlogentries, sizeof(params->backlogentries[0])*alloc);
+			if (!nentries)
+				return NULL;
+			params->backlogentries = nentries;
+			params->backlogentries_alloc = alloc;
+		}
+	}
+	memset (&params->backlogentries[params->firstbacklogentry + pending], 0, sizeof(params->backlogentries[0])*n);
+	return &params->backlogentries[params->firstbacklogentry + params->nrofbacklogentries];
+}
+
+/*
+ * Decodes a GetEvent blob in one pass and appends the entries to the EOS
+ * event backlog in params. Returns the number of appended entries.
+ */
 static inline int
-ptp_unpack_CANON_changes (PTPParams *params, unsigned char* data, unsigned int datasize, PTPCanon_changes_entry **pce)
+ptp_unpack_CANON_changes (PTPParams *params, unsigned char* data, unsigned int datasize)
 {
-	int	i = 0, entries = 0;
+	int	i = 0;
 	unsigned char	*curdata = data;
 	PTPCanon_changes_entry *ce;
 
 	if (data==NULL)
 		return 0;
-	while (curdata - data + 8 < datasize) {
-		uint32_t	size = dtoh32a(&curdata[PTP_ece_Size]);
-		uint32_t	type = dtoh32a(&curdata[PTP_ece_Type]);
-
-		if (size > datasize) {
-			ptp_debug (params, "size %d is larger than datasize %d", size, datasize);
-			break;
-		}
-		if (size < 8) {
-			ptp_debug (params, "size %d is smaller than 8.", size);
-			break;
-		}
-		if ((size == 8) && (type == 0))
-			break;
-		if ((curdata - data) + size >= datasize) {
-			ptp_debug (params, "canon eos event decoder ran over supplied data, skipping entries");
-			break;
-		}
-		if (type == PTP_EC_CANON_EOS_OLCInfoChanged) {
-			unsigned int j;
-
-			entries++;
-			if (size >= 12+2) {
-				for (j=0;j<31;j++)
-					if (dtoh16a(curdata+12) & (1<<j))
-						entries++;
-			}
-		}
-		curdata += size;
-		entries++;
-	}
-	ce = calloc (sizeof(PTPCanon_changes_entry),(entries+1));
-	if (!ce) return 0;
-
-	curdata = data;
 	while (curdata - data  + 8 < datasize) {
 		uint32_t	size = dtoh32a(&curdata[PTP_ece_Size]);
 		uint32_t	type = dtoh32a(&curdata[PTP_ece_Type]);
@@ -2056,6 +2059,13 @@ ptp_unpack_CANON_changes (PTPParams *params, unsigned char* data, unsigned int d
 			break;
 		}
 
+		/* OLCInfoChanged expands to one entry per mask bit, plus the mask itself */
+		ce = ptp_reserve_eos_backlog (params, i, (type == PTP_EC_CANON_EOS_OLCInfoChanged) ? 1+16+1 : 1);
+		if (!ce) {
+			ptp_debug (params, "out of memory decoding eos events");
+			break;
+		}
+
 		ce[i].type = PTP_CANON_EOS_CHANGES_TYPE_UNKNOWN;
 		ce[i].u.info = NULL;
 		switch (type) {
@@ -2875,15 +2885,8 @@ ptp_unpack_CANON_changes (PTPParams *params, unsigned char* data, unsigned int d
 		}
 		curdata += size;
 		i++;
-		if (i >= entries) {
-			ptp_debug (params, "BAD: i %d, entries %d", i, entries);
-		}
-	}
-	if (!i) {
-		free (ce);
-		ce = NULL;
 	}
-	*pce = ce;
+	params->nrofbacklogentries += i;
 	return i;
 }
 
@@ -2086,6 +2086,10 @@ ptp_free_params (PTPParams *params)
 	unsigned int i;
 
 	free (params->cameraname);
+	for (i=0;i<sizeof(params->fujichannels)/sizeof(params->fujichannels[0]);i++)
+		free (params->fujichannels[i].buf);
+	free (params->fujijpgframe.buf);
+	free (params->fujievents);
 	free (params->wifi_profiles);
 	for (i=0;i<params->nrofobjects;i++)
 		ptp_free_object (&params->objects[i]);
@@ -3617,8 +3621,12 @@ ptp_check_event_queue (PTPParams *params)
 	return ret;
 }
 
-uint16_t
-ptp_check_event (PTPParams *params)
+/* With timeout < 0 this polls the event pipe once, otherwise it blocks
+ * on it for at most timeout ms. The vendor specific event methods
+ * cannot wait, so in that case PTP_RC_OperationNotSupported tells the
+ * caller to sleep itself (any vendor events found are queued already). */
+static uint16_t
+ptp_check_event_internal (PTPParams *params, int timeout)
 {
 	PTPContainer	event;
 	uint16_t	ret;
@@ -3642,7 +3650,7 @@ ptp_check_event (PTPParams *params)
 			}
 			free (xevent);
 			if (params->event90c7works)
-				return PTP_RC_OK;
+				return (timeout < 0) ? PTP_RC_OK : PTP_RC_OperationNotSupported;
 			/* fall through to generic event handling */
 		} else {
 			/* Method offered by Nikon DSLR, Nikon 1, and some older Nikon Coolpix P*
@@ -3666,7 +3674,7 @@ ptp_check_event (PTPParams *params)
 				}
 				free (xevent);
 				if (params->event90c7works)
-					return PTP_RC_OK;
+					return (timeout < 0) ? PTP_RC_OK : PTP_RC_OperationNotSupported;
 				/* fall through to generic event handling */
 			}
 		}
@@ -3675,7 +3683,7 @@ ptp_check_event (PTPParams *params)
 	if (	(params->deviceinfo.VendorExtensionID == PTP_VENDOR_CANON) &&
 		ptp_operation_issupported(params, PTP_OC_CANON_EOS_GetEvent)
 	) {
-		return PTP_RC_OK;
+		return (timeout < 0) ? PTP_RC_OK : PTP_RC_OperationNotSupported;
 	}
 
 	if (	(params->deviceinfo.VendorExtensionID == PTP_VENDOR_CANON) &&
@@ -3691,7 +3699,7 @@ ptp_check_event (PTPParams *params)
 		}
 		/* Event Emulate Mode 0 (unset) and 1-5 get interrupt events. 6-7 does not. */
 		if (params->canon_event_mode > 5)
-			return PTP_RC_OK;
+			return (timeout < 0) ? PTP_RC_OK : PTP_RC_OperationNotSupported;
 
 		/* FIXME: fallthrough or return? */
 #ifdef __APPLE__
@@ -3699,10 +3707,17 @@ ptp_check_event (PTPParams *params)
 		 * for interrupts, they have no timeout for it. 2010/08/23
 		 * Check back in 2011 or so. -Marcus
 		 */
-		return PTP_RC_OK;
+		return (timeout < 0) ? PTP_RC_OK : PTP_RC_OperationNotSupported;
 #endif
 	}
-	ret = params->event_check(params,&event);
+	if (timeout >= 0)
+		ret = params->event_wait_timeout(params,&event,timeout);
+	else if (params->nrofevents && params->event_wait_timeout)
+		/* an event came in while waiting, do not hold it up by
+		 * blocking on the pipe again before it is handled */
+		ret = params->event_check_queue(params,&event);
+	else
+		ret = params->event_check(params,&event);
 
 store_event:
 	if (ret == PTP_RC_OK) {
@@ -3718,6 +3733,32 @@ store_event:
 	return ret;
 }
 
+uint16_t
+ptp_check_event (PTPParams *params)
+{
+	return ptp_check_event_internal (params, -1);
+}
+
+/**
+ * ptp_wait_event_timeout:
+ * params:	PTPParams*
+ * timeout:	maximum time to block, in milliseconds
+ *
+ * Like ptp_check_event(), but blocks until the next event arrives or
+ * timeout has passed. Transports that cannot wait with a deadline, and
+ * cameras whose events are fetched with vendor commands, return
+ * PTP_RC_OperationNotSupported and the caller has to sleep instead.
+ *
+ * Return values: Some PTP_RC_* code.
+ **/
+uint16_t
+ptp_wait_event_timeout (PTPParams *params, int timeout)
+{
+	if (!params->event_wait_timeout)
+		return PTP_RC_OperationNotSupported;
+	return ptp_check_event_internal (params, timeout);
+}
+
 uint16_t
 ptp_wait_event (PTPParams *params)
 {
@@ -3814,15 +3855,17 @@ ptp_have_event(PTPParams *params, uint16_t code)
  *
  * This retrieves configuration status/updates/changes
  * on EOS cameras. It reads a datablock which has a list of variable
- * sized structures.
+ * sized structures. The decoded entries are appended to the
+ * event backlog in params.
  *
  * params:	PTPParams*
+ *		int *nrofentries	- number of entries added to the backlog
  *
  * Return values: Some PTP_RC_* code.
  *
  **/
 uint16_t
-ptp_canon_eos_getevent (PTPParams* params, PTPCanon_changes_entry **entries, int *nrofentries)
+ptp_canon_eos_getevent (PTPParams* params, int *nrofentries)
 {
 	PTPContainer	ptp;
 	unsigned char	*data = NULL;
@@ -3830,9 +3873,8 @@ ptp_canon_eos_getevent (PTPParams* params, PTPCanon_changes_entry **entries, int
 
 	PTP_CNT_INIT(ptp, PTP_OC_CANON_EOS_GetEvent);
 	*nrofentries = 0;
-	*entries = NULL;
 	CHECK_PTP_RC(ptp_transaction(params, &ptp, PTP_DP_GETDATA, 0, &data, &size));
-	*nrofentries = ptp_unpack_CANON_changes(params,data,size,entries);
+	*nrofentries = ptp_unpack_CANON_changes(params,data,size);
 	free (data);
 	return PTP_RC_OK;
 }
@@ -3840,26 +3882,12 @@ ptp_canon_eos_getevent (PTPParams* params, PTPCanon_changes_entry **entries, int
 uint16_t
 ptp_check_eos_events (PTPParams *params)
 {
-	PTPCanon_changes_entry	*entries = NULL, *nentries;
-	int			nrofentries = 0;
+	int	nrofentries = 0;
 
 	while (1) { /* call it repeatedly until the camera does not report any */
-		CHECK_PTP_RC(ptp_canon_eos_getevent (params, &entries, &nrofentries));
+		CHECK_PTP_RC(ptp_canon_eos_getevent (params, &nrofentries));
 		if (!nrofentries)
 			return PTP_RC_OK;
-
-		if (params->nrofbacklogentries) {
-			nentries = realloc(params->backlogentries,sizeof(entries[0])*(params->nrofbacklogentries+nrofentries));
-			if (!nentries)
-				return PTP_RC_GeneralError;
-			params->backlogentries = nentries;
-			memcpy (nentries+params->nrofbacklogentries, entries, nrofentries*sizeof(entries[0]));
-			params->nrofbacklogentries += nrofentries;
-			free (entries);
-		} else {
-			params->backlogentries = entries;
-			params->nrofbacklogentries = nrofentries;
-		}
 	}
 	return PTP_RC_OK;
 }
@@ -3869,19 +3897,14 @@ ptp_get_one_eos_event (PTPParams *params, PTPCanon_changes_entry *entry)
 {
 	if (!params->nrofbacklogentries)
 		return 0;
-	memcpy (entry, params->backlogentries, sizeof(*entry));
-	if (params->nrofbacklogentries > 1) {
-		memmove (params->backlogentries,params->backlogentries+1,sizeof(*entry)*(params->nrofbacklogentries-1));
-		params->nrofbacklogentries--;
-	} else {
-		free (params->backlogentries);
-		params->backlogentries = NULL;
-		params->nrofbacklogentries = 0;
-	}
+	memcpy (entry, &params->backlogentries[params->firstbacklogentry], sizeof(*entry));
+	params->firstbacklogentry++;
+	params->nrofbacklogentries--;
+	if (!params->nrofbacklogentries)
+		params->firstbacklogentry = 0;
 	return 1;
 }
 
-
 uint16_t
 ptp_canon_eos_getdevicepropdesc (PTPParams* params, uint16_t propcode,
 	PTPDevicePropDesc *dpd)
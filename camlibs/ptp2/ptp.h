@@ -3619,6 +3619,15 @@ ff ff 00 00 00 00 00 00 00 00
 
 typedef struct _PTPParams PTPParams;
 
+/* Receive state of one Fuji PTP/IP socket. Packets are reassembled
+ * incrementally into buf, which is kept from one packet to the next. */
+typedef struct _PTPFujiPTPIPChannel {
+	unsigned char	*buf;
+	uint32_t	size;	/* allocated size of buf */
+	uint32_t	have;	/* bytes of the current packet received */
+	int		active;	/* socket is connected and serviced by the I/O loop */
+} PTPFujiPTPIPChannel;
+
 
 typedef uint16_t (* PTPDataGetFunc)	(PTPParams* params, void*priv,
 					unsigned long wantlen,
@@ -3646,6 +3655,7 @@ typedef uint16_t (* PTPIOGetData)	(PTPParams* params, PTPContainer* ptp,
 	                                 PTPDataHandler *putter);
 typedef uint16_t (* PTPIOCancelReq)	(PTPParams* params, uint32_t transaction_id);
 typedef uint16_t (* PTPIODevStatReq) (PTPParams* params);
+typedef uint16_t (* PTPIOEventWait)	(PTPParams* params, PTPContainer* event, int timeout);
 
 /* debug functions */
 typedef void (* PTPErrorFunc) (void *data, const char *format, va_list args)
@@ -3727,6 +3737,7 @@ struct _PTPParams {
 	PTPIOGetResp	event_check;
 	PTPIOGetResp	event_check_queue;
 	PTPIOGetResp	event_wait;
+	PTPIOEventWait	event_wait_timeout;	/* optional, blocks at most timeout ms */
 	PTPIOCancelReq	cancelreq_func;
 	PTPIODevStatReq	devstatreq_func;
 
@@ -3786,9 +3797,13 @@ struct _PTPParams {
 	int			canon_event_mode;
 	int			uilocked;
 
-	/* PTP: Canon EOS event queue */
+	/* PTP: Canon EOS event queue, pending entries start at
+	 * backlogentries[firstbacklogentry]. The array is kept and
+	 * reused when the queue runs empty. */
 	PTPCanon_changes_entry	*backlogentries;
 	unsigned int		nrofbacklogentries;
+	unsigned int		firstbacklogentry;
+	unsigned int		backlogentries_alloc;
 	int			eos_captureenabled;
 	int			eos_camerastatus;
 
@@ -3811,6 +3826,14 @@ struct _PTPParams {
 	uint32_t	eventpipeid;
 	char		*cameraname;
 
+	/* IO: Fuji PTP/IP command, event and liveview channels */
+	PTPFujiPTPIPChannel	fujichannels[3];
+	PTPFujiPTPIPChannel	fujijpgframe;	/* last complete liveview frame */
+	PTPContainer		*fujievents;	/* ring of events not yet passed on */
+	unsigned int		fujievents_size;	/* allocated entries */
+	unsigned int		fujievents_first;	/* oldest event */
+	unsigned int		nroffujievents;
+
 	/* Olympus UMS wrapping related data */
 	PTPDeviceInfo	outer_deviceinfo;
 	char		*olympus_cmd;
@@ -3844,6 +3867,7 @@ uint16_t ptp_usb_event_async	(PTPParams *params, PTPEventCbFn cb, void *user_dat
 uint16_t ptp_usb_event_wait	(PTPParams* params, PTPContainer* event);
 uint16_t ptp_usb_event_check	(PTPParams* params, PTPContainer* event);
 uint16_t ptp_usb_event_check_queue	(PTPParams* params, PTPContainer* event);
+uint16_t ptp_usb_event_wait_timeout	(PTPParams* params, PTPContainer* event, int timeout);
 
 uint16_t ptp_usb_control_get_extended_event_data (PTPParams *params, char *buffer, int *size);
 uint16_t ptp_usb_control_device_reset_request (PTPParams *params);
@@ -4032,6 +4056,7 @@ uint16_t ptp_getstream (PTPParams* params, unsigned char **data, unsigned int *s
 uint16_t ptp_check_event (PTPParams *params);
 uint16_t ptp_check_event_queue (PTPParams *params);
 uint16_t ptp_wait_event (PTPParams *params);
+uint16_t ptp_wait_event_timeout (PTPParams *params, int timeout);
 uint16_t ptp_add_event (PTPParams *params, PTPContainer *evt);
 int ptp_have_event(PTPParams *params, uint16_t code);
 int ptp_get_one_event (PTPParams *params, PTPContainer *evt);
@@ -4256,7 +4281,7 @@ uint16_t ptp_canon_checkevent (PTPParams* params,
 #define ptp_canon_eos_setrequestrollingpitchinglevel(params,onoff)	ptp_generic_no_data(params,PTP_OC_CANON_EOS_SetRequestRollingPitchingLevel,1,onoff)
 uint16_t ptp_canon_eos_getremotemode (PTPParams*, uint32_t *);
 uint16_t ptp_canon_eos_capture (PTPParams* params, uint32_t *result);
-uint16_t ptp_canon_eos_getevent (PTPParams* params, PTPCanon_changes_entry **entries, int *nrofentries);
+uint16_t ptp_canon_eos_getevent (PTPParams* params, int *nrofentries);
 uint16_t ptp_canon_getpartialobject (PTPParams* params, uint32_t handle,
 				uint32_t offset, uint32_t size,
 				uint32_t pos, unsigned char** block,
@@ -0,0 +1,169 @@
+/* test-chdk-ppm.c
+ *
+ * Converts pseudo-random CHDK live view frames to PPM with
+ * yuv_live_to_ppm(), in the UYVYYY layout of the older cameras and the
+ * UYVY layouts of Digic 6, and compares a hash of each PPM with the one
+ * the conversion that appended pixel by pixel produced for the same frame.
+ * Each frame ends right before an inaccessible page where the system
+ * allows it, so a read past the end of the viewport crashes the test.
+ * Run with any argument to print the hashes instead.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "chdk.c"
+
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+/* The rest of the driver is not used by the conversion */
+uint16_t ptp_chdk_download (PTPParams *params, char *remote_fn, PTPDataHandler *handler) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_exec_lua (PTPParams *params, char *script, int flags, int *script_id, int *status) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_get_version (PTPParams *params, int *major, int *minor) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_get_script_status (PTPParams *params, unsigned *status) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_read_script_msg (PTPParams *params, ptp_chdk_script_msg **msg) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_get_live_data (PTPParams *params, unsigned flags, unsigned char **data, unsigned int *data_size) { return PTP_RC_GeneralError; }
+uint16_t ptp_chdk_parse_live_data (PTPParams *params, unsigned char *data, unsigned int data_size,
+				   lv_data_header *header, lv_framebuffer_desc *vpd, lv_framebuffer_desc *bmd) { return PTP_RC_GeneralError; }
+uint16_t ptp_init_camerafile_handler (PTPDataHandler *handler, CameraFile *file) { return PTP_RC_GeneralError; }
+uint16_t ptp_exit_camerafile_handler (PTPDataHandler *handler) { return PTP_RC_GeneralError; }
+const char *ptp_strerror (uint16_t ret, uint16_t vendor) { return "error"; }
+int translate_ptp_result (uint16_t result) { return GP_ERROR; }
+
+#define NFRAMES	8
+
+/* layout, buffer width, visible width and height */
+static const int frames[NFRAMES][4] = {
+	{ LV_FB_YUV8,  8,   8,   4 },
+	{ LV_FB_YUV8,  40,  36,  30 },
+	{ LV_FB_YUV8,  64,  60,  20 },	/* wide, 2 of the 4 Y values */
+	{ LV_FB_YUV8,  360, 360, 240 },
+	{ LV_FB_YUV8B, 10,  10,  6 },
+	{ LV_FB_YUV8B, 64,  64,  48 },
+	{ LV_FB_YUV8B, 720, 720, 480 },
+	{ LV_FB_YUV8C, 32,  30,  10 },
+};
+
+/* FNV-1a of the PPM files of the old conversion */
+static const uint32_t golden[NFRAMES] = {
+	0x38ab6942, 0x913428d2, 0x1126512d, 0xfae8b99e,
+	0x0a6ada87, 0xf1217f10, 0x8d1dee5e, 0x102701b9,
+};
+
+static unsigned int seed;
+
+static int
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* Returns memory for size bytes that ends right before a page that
+ * cannot be read. */
+static unsigned char *
+frame_alloc (size_t size, void **base, size_t *len)
+{
+#ifdef HAVE_SYS_MMAN_H
+	size_t		page = sysconf (_SC_PAGESIZE);
+	unsigned char	*p;
+
+	*len = (size + page - 1) / page * page + page;
+	p = mmap (NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	mprotect (p + *len - page, page, PROT_NONE);
+	*base = p;
+	return p + *len - page - size;
+#else
+	*base = malloc (size);
+	return *base;
+#endif
+}
+
+static void
+frame_free (void *base, size_t len)
+{
+#ifdef HAVE_SYS_MMAN_H
+	munmap (base, len);
+#else
+	free (base);
+#endif
+}
+
+int
+main (int argc, char **argv)
+{
+	CameraFile	*file;
+	const char	*data;
+	unsigned long	datasize;
+	unsigned char	*yuv;
+	void		*base;
+	size_t		len, size, row_inc, last_row;
+	uint32_t	hash;
+	int		f, type, bw, w, h, ret, failed = 0;
+	unsigned long	i;
+
+	for (f = 0; f < NFRAMES; f++) {
+		type = frames[f][0];
+		bw = frames[f][1];
+		w = frames[f][2];
+		h = frames[f][3];
+		/* the last row only as far as its last pixel group */
+		if (type == LV_FB_YUV8) {
+			row_inc = bw * 3 / 2;
+			last_row = (w + 3) / 4 * 6;
+		} else {
+			row_inc = bw * 2;
+			last_row = (w + 1) / 2 * 4;
+		}
+		size = row_inc * (h - 1) + last_row;
+		yuv = frame_alloc (size, &base, &len);
+		if (!yuv) {
+			printf ("ERROR: no memory for %lu bytes\n", (unsigned long)size);
+			return 1;
+		}
+		seed = f + 1;
+		for (i = 0; i < size; i++)
+			yuv[i] = rnd ();
+
+		gp_file_new (&file);
+		ret = yuv_live_to_ppm (yuv, bw, w, h, type, file);
+		frame_free (base, len);
+		if (ret < GP_OK) {
+			printf ("FAIL: %dx%d frame: %s\n", w, h, gp_result_as_string (ret));
+			gp_file_unref (file);
+			failed++;
+			continue;
+		}
+		gp_file_get_data_and_size (file, &data, &datasize);
+		hash = 2166136261u;
+		for (i = 0; i < datasize; i++)
+			hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+		gp_file_unref (file);
+		if (argc > 1) {
+			printf ("0x%08x,%s", hash, (f % 4 == 3) ? "\n" : " ");
+		} else if (hash != golden[f]) {
+			printf ("FAIL: %dx%d frame in layout %d: hash 0x%08x, expected 0x%08x\n",
+				w, h, type, hash, golden[f]);
+			failed++;
+		}
+	}
+	if (argc == 1 && !failed)
+		printf ("%d frames converted as before\n", NFRAMES);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/* test-eos-events.c
+ *
+ * Feeds fixed Canon EOS GetEvent replies through ptp_canon_eos_getevent()
+ * with a stand-in for the USB layer and compares the decoded backlog with
+ * the entries the decoder produced before it was made single pass. Also
+ * checks that entries keep their order while the backlog is reused,
+ * compacted and grown, and that truncated replies decode to a prefix of
+ * the full one.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "ptp.h"
+
+/* what the decoder made of reply() before it became single pass */
+static const char *golden[] = {
+	"property d101",
+	"camerastatus 1",
+	"objectinfo 90000001 20001 90000000 3801 123456 IMG_0001.JPG",
+	"info Button 256",
+	"property d102",
+	"property d101",
+	"info OLCInfo event mask=7",
+	"objectremoved 90000001",
+	"info StoreAdded 0x00020001",
+	"info unhandled EOS event RequestGetEvent (size 16)",
+	"info (null)",
+	"property d102",
+};
+#define NGOLDEN	(sizeof (golden) / sizeof (golden[0]))
+
+static unsigned char	data[512];
+static unsigned int	datalen;
+
+static unsigned char *
+put32 (unsigned char *p, uint32_t v)
+{
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+	return p + 4;
+}
+
+static unsigned char *
+record (unsigned char *p, uint32_t size, uint32_t type)
+{
+	memset (p, 0, size);
+	put32 (p, size);
+	put32 (p + 4, type);
+	return p + 8;
+}
+
+/* A GetEvent reply with one record of most kinds the decoder knows */
+static unsigned int
+reply (unsigned char *buf)
+{
+	unsigned char	*p = buf, *r;
+	int		k;
+
+	r = record (p, 0x14, PTP_EC_CANON_EOS_PropValueChanged);
+	put32 (r, PTP_DPC_CANON_EOS_Aperture);
+	put32 (r + 4, 0x30);
+	p += 0x14;
+
+	r = record (p, 12, PTP_EC_CANON_EOS_CameraStatusChanged);
+	put32 (r, 1);
+	p += 12;
+
+	r = record (p, 0x28 + 13, PTP_EC_CANON_EOS_ObjectAddedEx);
+	put32 (p + 0x08, 0x90000001);
+	put32 (p + 0x0c, 0x00020001);
+	put32 (p + 0x10, 0x3801);
+	put32 (p + 0x1c, 123456);
+	put32 (p + 0x20, 0x90000000);
+	strcpy ((char *)p + 0x28, "IMG_0001.JPG");
+	p += 0x28 + 13;
+
+	/* button, shutter speed and aperture */
+	r = record (p, 8 + 4 + 4 + 40, PTP_EC_CANON_EOS_OLCInfoChanged);
+	put32 (r, 4 + 4 + 40);
+	put32 (r + 4, 0x0007);
+	for (k = 0; k < 40; k++)
+		r[8 + k] = k;
+	p += 8 + 4 + 4 + 40;
+
+	r = record (p, 12, PTP_EC_CANON_EOS_ObjectRemoved);
+	put32 (r, 0x90000001);
+	p += 12;
+
+	r = record (p, 12, PTP_EC_CANON_EOS_StoreAdded);
+	put32 (r, 0x00020001);
+	p += 12;
+
+	record (p, 16, PTP_EC_CANON_EOS_RequestGetEvent);
+	p += 16;
+
+	record (p, 16, 0xc1ff);
+	p += 16;
+
+	r = record (p, 0x14, PTP_EC_CANON_EOS_PropValueChanged);
+	put32 (r, PTP_DPC_CANON_EOS_ShutterSpeed);
+	put32 (r + 4, 0x60);
+	p += 0x14;
+
+	record (p, 8, 0);
+	p += 8;
+	return p - buf;
+}
+
+static uint16_t
+sendreq (PTPParams *params, PTPContainer *req, int dataphase)
+{
+	return PTP_RC_OK;
+}
+
+static uint16_t
+getdata (PTPParams *params, PTPContainer *ptp, PTPDataHandler *handler)
+{
+	return handler->putfunc (params, handler->priv, datalen, data);
+}
+
+static uint16_t
+getresp (PTPParams *params, PTPContainer *resp)
+{
+	memset (resp, 0, sizeof (*resp));
+	resp->Code = PTP_RC_OK;
+	resp->Transaction_ID = params->transaction_id - 1;
+	return PTP_RC_OK;
+}
+
+static void
+nodebug (void *priv, const char *fmt, va_list args)
+{
+}
+
+void
+ptp_nikon_getptpipguid (unsigned char *guid)
+{
+}
+
+/* Formats an entry like golden[] and frees what it owns */
+static void
+format (PTPCanon_changes_entry *e, char *buf, size_t size)
+{
+	switch (e->type) {
+	case PTP_CANON_EOS_CHANGES_TYPE_PROPERTY:
+		snprintf (buf, size, "property %x", e->u.propid);
+		break;
+	case PTP_CANON_EOS_CHANGES_TYPE_CAMERASTATUS:
+		snprintf (buf, size, "camerastatus %d", e->u.status);
+		break;
+	case PTP_CANON_EOS_CHANGES_TYPE_OBJECTINFO:
+		snprintf (buf, size, "objectinfo %x %x %x %x %u %s", e->u.object.oid,
+			  e->u.object.oi.StorageID, e->u.object.oi.ParentObject,
+			  e->u.object.oi.ObjectFormat, (unsigned int)e->u.object.oi.ObjectCompressedSize,
+			  e->u.object.oi.Filename);
+		free (e->u.object.oi.Filename);
+		break;
+	case PTP_CANON_EOS_CHANGES_TYPE_OBJECTREMOVED:
+		snprintf (buf, size, "objectremoved %x", e->u.object.oid);
+		break;
+	case PTP_CANON_EOS_CHANGES_TYPE_UNKNOWN:
+		snprintf (buf, size, "info %s", e->u.info ? e->u.info : "(null)");
+		free (e->u.info);
+		break;
+	default:
+		snprintf (buf, size, "type %d", e->type);
+		break;
+	}
+}
+
+/* Pops an entry and checks that it is golden[*next % NGOLDEN] */
+static int
+pop (PTPParams *params, unsigned int *next)
+{
+	PTPCanon_changes_entry	e;
+	char			buf[256];
+
+	if (!ptp_get_one_eos_event (params, &e)) {
+		printf ("FAIL: backlog empty, expected '%s'\n", golden[*next % NGOLDEN]);
+		return 1;
+	}
+	format (&e, buf, sizeof (buf));
+	if (strcmp (buf, golden[*next % NGOLDEN])) {
+		printf ("FAIL: entry %u is '%s', expected '%s'\n", *next, buf, golden[*next % NGOLDEN]);
+		return 1;
+	}
+	(*next)++;
+	return 0;
+}
+
+static int
+getevent (PTPParams *params, int expected)
+{
+	int	n;
+
+	if (ptp_canon_eos_getevent (params, &n) != PTP_RC_OK) {
+		printf ("FAIL: GetEvent failed\n");
+		return 1;
+	}
+	if (n != expected) {
+		printf ("FAIL: %d entries decoded, expected %d\n", n, expected);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main (void)
+{
+	PTPParams		params;
+	PTPCanon_changes_entry	*entries, e;
+	unsigned int		full, len, next, k, alloc;
+	int			i;
+
+	memset (&params, 0, sizeof (params));
+	params.debug_func	= nodebug;
+	params.error_func	= nodebug;
+	params.byteorder	= PTP_DL_LE;
+	params.sendreq_func	= sendreq;
+	params.getdata_func	= getdata;
+	params.getresp_func	= getresp;
+	full = datalen = reply (data);
+
+	/* one reply, drained */
+	if (getevent (&params, NGOLDEN))
+		return 1;
+	for (next = 0; next < NGOLDEN; )
+		if (pop (&params, &next))
+			return 1;
+	if (ptp_get_one_eos_event (&params, &e)) {
+		printf ("FAIL: backlog not empty\n");
+		return 1;
+	}
+
+	/* the drained backlog is reused as it is */
+	entries = params.backlogentries;
+	alloc = params.backlogentries_alloc;
+	if (getevent (&params, NGOLDEN))
+		return 1;
+	if ((params.backlogentries != entries) || (params.backlogentries_alloc != alloc)) {
+		printf ("FAIL: backlog reallocated although it was empty\n");
+		return 1;
+	}
+	for (next = 0; next < NGOLDEN; )
+		if (pop (&params, &next))
+			return 1;
+
+	/* polled faster than drained, the backlog is compacted and grows,
+	 * the entries come out in order */
+	next = 0;
+	for (i = 0; i < 50; i++) {
+		if (getevent (&params, NGOLDEN))
+			return 1;
+		for (k = 0; k < NGOLDEN / 2; k++)
+			if (pop (&params, &next))
+				return 1;
+	}
+	while (params.nrofbacklogentries)
+		if (pop (&params, &next))
+			return 1;
+	if (next != 50 * NGOLDEN) {
+		printf ("FAIL: %u entries, expected %u\n", next, (unsigned int)(50 * NGOLDEN));
+		return 1;
+	}
+
+	/* truncated replies decode to whole records from the start */
+	for (len = 0; len < full; len++) {
+		datalen = len;
+		if (ptp_canon_eos_getevent (&params, &i) != PTP_RC_OK) {
+			printf ("FAIL: GetEvent failed\n");
+			return 1;
+		}
+		for (next = 0; params.nrofbacklogentries; )
+			if (pop (&params, &next))
+				return 1;
+	}
+
+	printf ("%u entries per reply decoded as before, backlog of %u entries\n",
+		(unsigned int)NGOLDEN, params.backlogentries_alloc);
+	free (params.backlogentries);
+	return 0;
+}
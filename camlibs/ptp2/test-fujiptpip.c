@@ -0,0 +1,214 @@
+/* test-fujiptpip.c
+ *
+ * Runs the Fuji PTP/IP I/O loop against socketpairs standing in for the
+ * command, event and liveview sockets of a camera. Checks that a response
+ * is still read when the event socket closes while it is pending, that the
+ * events queued before are handed out in order and that later checks then
+ * report no event instead of an error. Also checks that events queued and
+ * popped in bursts of changing size come out of the ring in order while it
+ * wraps and grows, and that a liveview request returns the newest of the
+ * frames that arrived.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "ptpip-private.h"
+#include "ptp.h"
+
+/* Only used when connecting, which the test does not */
+int translate_ptp_result (uint16_t result) { return result == PTP_RC_OK ? 0 : -1; }
+
+#define NBURSTS		50
+#define NFRAMES		3
+#define FRAME_SIZE	20000
+
+static void
+put16 (unsigned char *p, uint16_t v)
+{
+	p[0] = v; p[1] = v >> 8;
+}
+
+static void
+put32 (unsigned char *p, uint32_t v)
+{
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static int
+send_all (int fd, unsigned char *buf, unsigned int len)
+{
+	return write (fd, buf, len) == (ssize_t)len;
+}
+
+/* An event packet with one parameter */
+static int
+send_event (int fd, uint16_t code, uint32_t transid)
+{
+	unsigned char	buf[16];
+
+	put32 (buf, sizeof (buf));
+	put16 (buf + 4, 4);
+	put16 (buf + 6, code);
+	put32 (buf + 8, transid);
+	put32 (buf + 12, 0x1234);
+	return send_all (fd, buf, sizeof (buf));
+}
+
+/* A liveview packet, its payload filled with the frame number */
+static int
+send_frame (int fd, int n)
+{
+	unsigned char	buf[4 + FRAME_SIZE];
+
+	put32 (buf, sizeof (buf));
+	memset (buf + 4, n, FRAME_SIZE);
+	return send_all (fd, buf, sizeof (buf));
+}
+
+/* Connects a channel of the params to one end of a new socketpair, the
+ * other end is returned in *camera */
+static int
+connect_channel (PTPParams *params, int channel, int *fd, int *camera)
+{
+	int	sv[2];
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+		perror ("socketpair");
+		return 0;
+	}
+	ptpip_set_nonblock (sv[0]);
+	*fd = sv[0];
+	*camera = sv[1];
+	params->fujichannels[channel].active = 1;
+	params->fujichannels[channel].have = 0;
+	return 1;
+}
+
+int
+main (void)
+{
+	PTPParams	params;
+	PTPContainer	event, resp;
+	unsigned char	buf[12], *data;
+	unsigned int	size;
+	int		cmd, evt, jpg, i, k, sent, got, failed = 0;
+	uint16_t	ret;
+
+	memset (&params, 0, sizeof (params));
+	params.byteorder = PTP_DL_LE;
+	if (!connect_channel (&params, 0, &params.cmdfd, &cmd) ||
+	    !connect_channel (&params, 1, &params.evtfd, &evt) ||
+	    !connect_channel (&params, 2, &params.jpgfd, &jpg))
+		return 1;
+
+	/* the event socket closes with events unread, a response pending */
+	for (i = 0; i < 5; i++)
+		send_event (evt, 0x4000 + i, i);
+	close (evt);
+	put32 (buf, sizeof (buf));
+	put16 (buf + 4, 3);
+	put16 (buf + 6, PTP_RC_OK);
+	put32 (buf + 8, 7);
+	send_all (cmd, buf, sizeof (buf));
+	memset (&resp, 0, sizeof (resp));
+	resp.Code = PTP_OC_GetDeviceInfo;
+	ret = ptp_fujiptpip_getresp (&params, &resp);
+	if ((ret != PTP_RC_OK) || (resp.Code != PTP_RC_OK) || (resp.Transaction_ID != 7)) {
+		printf ("FAIL: response read as 0x%04x, code 0x%04x, transaction %d\n",
+			ret, resp.Code, resp.Transaction_ID);
+		failed++;
+	}
+	for (i = 0; i < 5; i++) {
+		ret = ptp_fujiptpip_event_check (&params, &event);
+		if ((ret != PTP_RC_OK) || (event.Code != 0x4000 + i) ||
+		    (event.Transaction_ID != i) || (event.Param1 != 0x1234)) {
+			printf ("FAIL: event %d read as 0x%04x, code 0x%04x\n", i, ret, event.Code);
+			failed++;
+		}
+	}
+	if (params.fujichannels[1].active) {
+		printf ("FAIL: closed event socket still serviced\n");
+		failed++;
+	}
+	ret = ptp_fujiptpip_event_check (&params, &event);
+	if (ret != PTP_ERROR_TIMEOUT) {
+		printf ("FAIL: check on the closed event socket returned 0x%04x\n", ret);
+		failed++;
+	}
+	ret = ptp_fujiptpip_event_wait (&params, &event);
+	if (ret != PTP_ERROR_TIMEOUT) {
+		printf ("FAIL: wait on the closed event socket returned 0x%04x\n", ret);
+		failed++;
+	}
+	close (params.evtfd);
+
+	/* bursts of events, popped in bursts of another size */
+	if (!connect_channel (&params, 1, &params.evtfd, &evt))
+		return 1;
+	sent = got = 0;
+	for (k = 0; k < NBURSTS; k++) {
+		for (i = 0; i < (k * 7) % 13; i++)
+			send_event (evt, 0x5000 + sent++ % 0x1000, 0);
+		for (i = 0; i < (k * 5) % 11; i++) {
+			if (ptp_fujiptpip_event_check (&params, &event) != PTP_RC_OK)
+				break;
+			if (event.Code != 0x5000 + got++ % 0x1000) {
+				printf ("FAIL: event %d has code 0x%04x\n", got - 1, event.Code);
+				failed++;
+			}
+		}
+	}
+	while (ptp_fujiptpip_event_check (&params, &event) == PTP_RC_OK)
+		if (event.Code != 0x5000 + got++ % 0x1000) {
+			printf ("FAIL: event %d has code 0x%04x\n", got - 1, event.Code);
+			failed++;
+		}
+	if (got != sent) {
+		printf ("FAIL: %d events sent, %d received\n", sent, got);
+		failed++;
+	}
+
+	/* only the newest liveview frame is handed out */
+	for (i = 1; i <= NFRAMES; i++)
+		send_frame (jpg, i);
+	data = NULL;
+	ret = ptp_fujiptpip_jpeg (&params, &data, &size);
+	if ((ret != PTP_RC_OK) || (size != FRAME_SIZE) ||
+	    (data[0] != NFRAMES) || (data[size - 1] != NFRAMES)) {
+		printf ("FAIL: liveview returned 0x%04x, %u bytes of frame %d\n",
+			ret, size, data ? data[0] : 0);
+		failed++;
+	}
+	free (data);
+
+	if (!failed)
+		printf ("%d events through a ring of %u entries\n", sent, params.fujievents_size);
+	close (cmd); close (evt); close (jpg);
+	close (params.cmdfd); close (params.evtfd); close (params.jpgfd);
+	for (i = 0; i < 3; i++)
+		free (params.fujichannels[i].buf);
+	free (params.fujijpgframe.buf);
+	free (params.fujievents);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+/* test-olympus-x3c.c
+ *
+ * Parses X3C replies and events of the Olympus XML wrapped cameras and
+ * prints requests, and compares the results with what the libxml2 tree
+ * based code produced for the same documents: return value, response
+ * code and parameters, the property change events queued, and the
+ * request text byte for byte. The documents cover the shapes the
+ * in-place scanner handles and the ones it hands to libxml2. Run with
+ * any argument to print the tables instead.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "olympus-wrap.c"
+
+#ifdef HAVE_LIBXML2
+
+/* The transport is not used by the parsers and printers */
+uint16_t ptp_getobject (PTPParams *params, uint32_t handle, unsigned char **object) { return PTP_RC_GeneralError; }
+uint16_t ptp_getobjectinfo (PTPParams *params, uint32_t handle, PTPObjectInfo *oi) { return PTP_RC_GeneralError; }
+uint16_t ptp_transaction (PTPParams *params, PTPContainer *ptp, uint16_t flags, uint64_t sendlen,
+			  unsigned char **data, unsigned int *recvlen) { return PTP_RC_GeneralError; }
+uint16_t ptp_usb_event_check (PTPParams *params, PTPContainer *event) { return PTP_RC_GeneralError; }
+uint16_t ptp_usb_event_wait (PTPParams *params, PTPContainer *event) { return PTP_RC_GeneralError; }
+void ptp_debug (PTPParams *params, const char *format, ...) { }
+
+/* the property ids of the queued events, in order */
+static uint32_t	events[400];
+static int	nevents;
+
+uint16_t
+ptp_add_event (PTPParams *params, PTPContainer *event)
+{
+	if (nevents < (int)(sizeof (events) / sizeof (events[0])))
+		events[nevents] = event->Param1;
+	nevents++;
+	return PTP_RC_OK;
+}
+
+#define H "<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\">"
+
+static const char *docs[] = {
+	/* replies */
+	H "<output><result>2001</result><c1016><pD135/></c1016></output></x3c>\n",
+	H "\r\n<output>\r\n<result>2001</result>\r\n<c1016>\r\n<pD135/>\r\n</c1016>\r\n</output>\r\n</x3c>\r\n",
+	H "<output><result>2019</result><c9302><x3cVersion>0101</x3cVersion><productIDs>0A4500200031 05410042</productIDs></c9302></output></x3c>",
+	H "<output><result>2001</result><c9581><data>414243</data><foo/></c9581></output></x3c>",
+	H "<output><result>2001</result><c1015><pD10D><value>000A000D</value></pD10D></c1015></output></x3c>",
+	H "<output><result>  2005 </result><c1001/></output></x3c>",
+	H "<output><result>2001</result></output></x3c>",
+	H "<output><result>2001</result><c1016/><x/></output></x3c>",
+	H "<output><result>2001</result><c1016/></output><output/></x3c>",
+	/* events */
+	H "<input><eC102><pD10D/><pD10E/><pD135/><x/></eC102></input></x3c>",
+	H "<input><e4008><param>12345678</param><param>2</param><param>3</param><param>4</param><param>5</param><param>6</param><param>7</param></e4008></input></x3c>",
+	H "<input><e4002/><param>1e000001</param><param>ff</param></input></x3c>",
+	H "<input><param>1</param><bogus/><e4006/></input></x3c>",
+	H "<input></input></x3c>",
+	H "<input/></x3c>",
+	H "<input><eC102 a=\"x>y\" b='q\"'><pD10D  /></eC102 ></input></x3c>",
+	"<x3c><input><e4004/></input></x3c>  \n",
+	"<y3c><input><e4004/></input></y3c>",
+	/* handed to libxml2 */
+	H "<output><result>20&#x30;1</result><c1016><pD135/></c1016></output></x3c>",
+	H "<output><!-- c --><result>2001</result><c1016><pD135/></c1016></output></x3c>",
+	H "<output><result><![CDATA[2001]]></result><c1016><pD135/></c1016></output></x3c>",
+	H "<output><result>2001</result><o:c1016 xmlns:o=\"u\"><pD135/></o:c1016></output></x3c>",
+	H "<output>t<result>2001</result><c1016><pD135/></c1016></output></x3c>",
+	"<?xml version=\"1.0\"?><!-- hi --><x3c><input><e4004/></input></x3c>",
+	H "<input><eC102><pD10D>&#x31;</pD10D><pD10E/></eC102><!-- x --></input></x3c>",
+	/* malformed */
+	H "<output><result>2001</result><c1016><pD135/></c1017></output></x3c>",
+	H "<output><result>2001</result><c1016><pD135/>",
+	H "<input><eC102><pD10D/></eC102></input></x3c>junk",
+	"",
+};
+#define NDOCS	(sizeof (docs) / sizeof (docs[0]))
+
+/* parse_xml() and parse_event_xml() of each document: return value,
+ * Code, Nparam, Param1-5 and the queued events */
+typedef struct {
+	int		ret;
+	uint16_t	code;
+	uint8_t		nparam;
+	uint32_t	param[5];
+	int		nevents;
+	uint32_t	events[3];
+} parse_result;
+
+static const parse_result golden_parse[NDOCS][2] = {
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2019, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2005, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 3, { 0xd10d, 0xd10e, 0xd135 } }, { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 3, { 0xd10d, 0xd10e, 0xd135 } } },
+	{ { 1, 0x4008, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 1, 0x4008, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x4002, 2, { 0x1e000001, 0xff, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 1, 0x4002, 2, { 0x1e000001, 0xff, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x4006, 1, { 0x1, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 1, 0x4006, 1, { 0x1, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 1, { 0xd10d, 0x0, 0x0 } }, { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 1, { 0xd10d, 0x0, 0x0 } } },
+	{ { 1, 0x4004, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 1, 0x4004, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x2001, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0x4004, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 1, 0x4004, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 2, { 0xd10d, 0xd10e, 0x0 } }, { 1, 0xc102, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 2, { 0xd10d, 0xd10e, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+	{ { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } }, { 0, 0x0000, 0, { 0x0, 0x0, 0x0, 0x0, 0x0 }, 0, { 0x0, 0x0, 0x0 } } },
+};
+
+/* requests: code, number of parameters, data length */
+static const struct {
+	uint16_t	code;
+	uint8_t		nparam;
+	int		len;
+} requests[] = {
+	{ 0x1001, 0, 0 }, { 0x1001, 1, 0 }, { 0x1001, 2, 0 }, { 0x1001, 3, 0 },
+	{ 0x1014, 1, 0 }, { 0x1015, 1, 0 },
+	{ 0x1016, 1, 1 }, { 0x1016, 1, 2 }, { 0x1016, 1, 4 }, { 0x1016, 1, 5 }, { 0x1016, 1, 12 },
+	{ 0x9301, 0, 0 }, { 0x910a, 2, 0 }, { 0xffff, 2, 7 },
+};
+#define NREQUESTS	(sizeof (requests) / sizeof (requests[0]))
+
+static const char *golden_request[NREQUESTS] = {
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1001/></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1001><param>0000D10D</param></c1001></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1001><param>0000D10D</param><param>1E000001</param></c1001></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1001/></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1014><pD10D/></c1014></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1015><param>0000D10D</param></c1015></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1016><pD10D><value>01</value></pD10D></c1016></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1016><pD10D><value>2601</value></pD10D></c1016></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1016><pD10D><value>704B2601</value></pD10D></c1016></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1016><pD10D><value>01264B7095</value></pD10D></c1016></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c1016><pD10D><value>01264B7095BADF04294E7398</value></pD10D></c1016></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c9301/></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><c910A><param>0000D10D</param><param>1E000001</param></c910A></input></x3c>\n",
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><input><cFFFF><param>0000D10D</param><param>1E000001</param></cFFFF></input></x3c>\n",
+};
+
+static const char *golden_event_ok =
+	"<?xml version=\"1.0\"?>\n<x3c xmlns=\"http://www1.olympus-imaging.com/ww/x3c\"><output><result>2001</result><eC102/></output></x3c>\n";
+
+static void
+parse (int doc, int event, parse_result *r)
+{
+	PTPContainer	resp;
+	int		i;
+
+	memset (&resp, 0, sizeof (resp));
+	memset (r, 0, sizeof (*r));
+	nevents = 0;
+	if (event)
+		r->ret = parse_event_xml (NULL, docs[doc], &resp);
+	else
+		r->ret = parse_xml (NULL, docs[doc], &resp);
+	r->code = resp.Code;
+	r->nparam = resp.Nparam;
+	r->param[0] = resp.Param1;
+	r->param[1] = resp.Param2;
+	r->param[2] = resp.Param3;
+	r->param[3] = resp.Param4;
+	r->param[4] = resp.Param5;
+	r->nevents = nevents;
+	for (i = 0; i < 3 && i < nevents; i++)
+		r->events[i] = events[i];
+}
+
+static char *
+request (int i)
+{
+	PTPContainer	ptp;
+	unsigned char	data[16];
+	int		k;
+
+	for (k = 0; k < (int)sizeof (data); k++)
+		data[k] = k * 37 + 1;
+	memset (&ptp, 0, sizeof (ptp));
+	ptp.Code = requests[i].code;
+	ptp.Nparam = requests[i].nparam;
+	ptp.Param1 = 0xd10d;
+	ptp.Param2 = 0x1e000001;
+	ptp.Param3 = 3;
+	return generate_xml (NULL, &ptp, data, requests[i].len);
+}
+
+static void
+print_string (const char *s)
+{
+	printf ("\t\"");
+	for (; *s; s++) {
+		if (*s == '\n')
+			printf ("\\n");
+		else if (*s == '"' || *s == '\\')
+			printf ("\\%c", *s);
+		else
+			putchar (*s);
+	}
+	printf ("\",\n");
+}
+
+static int
+print_tables (void)
+{
+	PTPContainer	ptp;
+	parse_result	r;
+	unsigned int	i;
+	int		e;
+	char		*x;
+
+	for (i = 0; i < NDOCS; i++) {
+		printf ("\t{");
+		for (e = 0; e < 2; e++) {
+			parse (i, e, &r);
+			printf (" { %d, 0x%04x, %d, { 0x%x, 0x%x, 0x%x, 0x%x, 0x%x }, %d, { 0x%x, 0x%x, 0x%x } }%s",
+				r.ret, r.code, r.nparam, r.param[0], r.param[1], r.param[2],
+				r.param[3], r.param[4], r.nevents, r.events[0], r.events[1],
+				r.events[2], e ? " },\n" : ",");
+		}
+	}
+	for (i = 0; i < NREQUESTS; i++) {
+		x = request (i);
+		print_string (x);
+		free (x);
+	}
+	memset (&ptp, 0, sizeof (ptp));
+	ptp.Code = 0xc102;
+	x = generate_event_OK_xml (NULL, &ptp);
+	print_string (x);
+	free (x);
+	return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+	PTPContainer	ptp;
+	parse_result	r;
+	unsigned int	i, k;
+	int		e, failed = 0;
+	char		*x, big[32768];
+
+	if (argc > 1)
+		return print_tables ();
+
+	for (i = 0; i < NDOCS; i++) {
+		for (e = 0; e < 2; e++) {
+			parse (i, e, &r);
+			if (memcmp (&r, &golden_parse[i][e], sizeof (r))) {
+				printf ("FAIL: %s of document %u differs:\n%s\n",
+					e ? "parse_event_xml" : "parse_xml", i, docs[i]);
+				failed++;
+			}
+		}
+	}
+
+	/* a large event, scanned and handed to libxml2 */
+	for (e = 0; e < 2; e++) {
+		x = big + sprintf (big, H "<input><eC102>");
+		for (k = 0; k < 300; k++)
+			x += sprintf (x, "<pD%03X/>\n", k);
+		sprintf (x, "</eC102>%s</input></x3c>", e ? "<!-- x -->" : "");
+		nevents = 0;
+		memset (&ptp, 0, sizeof (ptp));
+		if (!parse_event_xml (NULL, big, &ptp) || (ptp.Code != 0xc102) ||
+		    (nevents != 300) || (events[0] != 0xd000) || (events[299] != 0xd12b)) {
+			printf ("FAIL: event with 300 properties: %d events\n", nevents);
+			failed++;
+		}
+	}
+
+	for (i = 0; i < NREQUESTS; i++) {
+		x = request (i);
+		if (strcmp (x, golden_request[i])) {
+			printf ("FAIL: request %04x differs:\n%s\n", requests[i].code, x);
+			failed++;
+		}
+		free (x);
+	}
+	memset (&ptp, 0, sizeof (ptp));
+	ptp.Code = 0xc102;
+	x = generate_event_OK_xml (NULL, &ptp);
+	if (strcmp (x, golden_event_ok)) {
+		printf ("FAIL: event acknowledgement differs:\n%s\n", x);
+		failed++;
+	}
+	free (x);
+
+	if (!failed)
+		printf ("%u documents and %u requests as before\n",
+			(unsigned int)NDOCS, (unsigned int)NREQUESTS + 1);
+	return failed ? 1 : 0;
+}
+
+#else
+
+int
+main (void)
+{
+	printf ("built without libxml2, skipping\n");
+	return 77;
+}
+
+#endif
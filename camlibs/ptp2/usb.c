@@ -120,6 +120,10 @@ retry:
 	return PTP_RC_OK;
 }
 
+/* write blob size: the data is pulled from the handler in chunks of this
+ * size, so an upload never needs more memory than one chunk. */
+#define WRITELEN 512*1024
+
 uint16_t
 ptp_usb_senddata (PTPParams* params, PTPContainer* ptp,
 		  uint64_t size, PTPDataHandler *handler
@@ -170,7 +174,7 @@ ptp_usb_senddata (PTPParams* params, PTPContainer* ptp,
 	}
 	if (usecontext)
 		progressid = gp_context_progress_start (context, (size/CONTEXT_BLOCK_SIZE), _("Uploading..."));
-	bytes = malloc (4096);
+	bytes = malloc (WRITELEN);
 	if (!bytes)
 		return PTP_RC_GeneralError;
 	/* if everything OK send the rest */
@@ -180,7 +184,7 @@ ptp_usb_senddata (PTPParams* params, PTPContainer* ptp,
 	while(bytes_left_to_transfer > 0) {
 		unsigned long readlen, toread, oldwritten = written;
 
-		toread = 4096;
+		toread = WRITELEN;
 		if (toread > bytes_left_to_transfer)
 			toread = bytes_left_to_transfer;
 		ret = handler->getfunc (params, handler->priv, toread, bytes, &readlen);
@@ -544,9 +548,10 @@ ptp_usb_getresp (PTPParams* params, PTPContainer* resp)
 #define PTP_EVENT_CHECK			0x0000	/* waits for */
 #define PTP_EVENT_CHECK_FAST		0x0001	/* checks */
 #define PTP_EVENT_CHECK_QUEUE		0x0002	/* just looks in the queue */
+#define PTP_EVENT_CHECK_TIMEOUT		0x0003	/* waits for at most waittime ms */
 
 static inline uint16_t
-ptp_usb_event (PTPParams* params, PTPContainer* event, int wait)
+ptp_usb_event (PTPParams* params, PTPContainer* event, int wait, int waittime)
 {
 	int			result, timeout, fasttimeout;
 	unsigned long		rlen;
@@ -581,11 +586,19 @@ ptp_usb_event (PTPParams* params, PTPContainer* event, int wait)
 		result = gp_port_check_int (camera->port, (char*)&usbevent, sizeof(usbevent));
 		gp_port_set_timeout (camera->port, timeout);
 		break;
+	case PTP_EVENT_CHECK_TIMEOUT:
+		/* the port blocks until an interrupt transfer completes or the
+		 * time is up, so this returns as soon as the event is there */
+		gp_port_get_timeout (camera->port, &timeout);
+		gp_port_set_timeout (camera->port, waittime);
+		result = gp_port_check_int (camera->port, (char*)&usbevent, sizeof(usbevent));
+		gp_port_set_timeout (camera->port, timeout);
+		break;
 	default:
 		return PTP_ERROR_BADPARAM;
 	}
 	if (result < 0) {
-		if ((result != GP_ERROR_TIMEOUT) || (wait != PTP_EVENT_CHECK_FAST))
+		if ((result != GP_ERROR_TIMEOUT) || ((wait != PTP_EVENT_CHECK_FAST) && (wait != PTP_EVENT_CHECK_TIMEOUT)))
 			GP_LOG_E ("Reading PTP event failed: %s (%d)", gp_port_result_as_string(result), result);
 		return translate_gp_result_to_ptp(result);
 	}
@@ -631,19 +644,25 @@ ptp_usb_event (PTPParams* params, PTPContainer* event, int wait)
 uint16_t
 ptp_usb_event_check_queue (PTPParams* params, PTPContainer* event) {
 
-	return ptp_usb_event (params, event, PTP_EVENT_CHECK_QUEUE);
+	return ptp_usb_event (params, event, PTP_EVENT_CHECK_QUEUE, 0);
 }
 
 uint16_t
 ptp_usb_event_check (PTPParams* params, PTPContainer* event) {
 
-	return ptp_usb_event (params, event, PTP_EVENT_CHECK_FAST);
+	return ptp_usb_event (params, event, PTP_EVENT_CHECK_FAST, 0);
 }
 
 uint16_t
 ptp_usb_event_wait (PTPParams* params, PTPContainer* event) {
 
-	return ptp_usb_event (params, event, PTP_EVENT_CHECK);
+	return ptp_usb_event (params, event, PTP_EVENT_CHECK, 0);
+}
+
+uint16_t
+ptp_usb_event_wait_timeout (PTPParams* params, PTPContainer* event, int timeout) {
+
+	return ptp_usb_event (params, event, PTP_EVENT_CHECK_TIMEOUT, timeout);
 }
 
 uint16_t
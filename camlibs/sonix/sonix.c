@@ -337,53 +337,82 @@ sonix_exit      (GPPort *port)
  * it just peeks)
  */
 
+/*
+ * The pixel codes are at most 10 bits long, so they are decoded by a lookup
+ * of the next 10 bits in a table which holds the code length and either
+ * the delta to apply to the previous pixel value of the same color or a
+ * flag saying that the last 5 bits are an absolute value:
+ *
+ *	0		+0
+ *	101		+3
+ *	110		-3
+ *	1000		+8
+ *	1001		-8
+ *	1111		-20
+ *	11100		+20
+ *	11101xxxxx	8 * xxxxx
+ */
+
+struct sonix_code {
+	unsigned char len;
+	signed char delta;
+	unsigned char is_abs;
+};
+
+static void
+sonix_build_code_table (struct sonix_code *table)
+{
+	int bits;
+
+	for (bits = 0; bits < 1024; bits++) {
+		table[bits].is_abs = 0;
+		if ((bits&0x200)==0) {
+			table[bits].len = 1;
+			table[bits].delta = 0;
+		} else if ((bits&0x380)==0x280) {
+			table[bits].len = 3;
+			table[bits].delta = 3;
+		} else if ((bits&0x380)==0x300) {
+			table[bits].len = 3;
+			table[bits].delta = -3;
+		} else if ((bits&0x3c0)==0x200) {
+			table[bits].len = 4;
+			table[bits].delta = 8;
+		} else if ((bits&0x3c0)==0x240) {
+			table[bits].len = 4;
+			table[bits].delta = -8;
+		} else if ((bits&0x3c0)==0x3c0) {
+			table[bits].len = 4;
+			table[bits].delta = -20;
+		} else if ((bits&0x3e0)==0x380) {
+			table[bits].len = 5;
+			table[bits].delta = 20;
+		} else {
+			table[bits].len = 10;
+			table[bits].delta = 0;
+			table[bits].is_abs = 1;
+		}
+	}
+}
+
+/* Decode the next pixel of the color whose previous value is val, without
+ * branching on the code: an absolute code just selects its value bits. */
 #define PARSE_PIXEL(val) {\
+	const struct sonix_code *code;\
+	short newval;\
 	PEEK_BITS(10,bits);\
-	if ((bits&0x200)==0) { \
-		EAT_BITS(1); \
-	} \
-	else if ((bits&0x380)==0x280) { \
-		EAT_BITS(3); \
-		val+=3; \
-		if (val>255) val=255; \
-	}\
-	else if ((bits&0x380)==0x300) { \
-		EAT_BITS(3); \
-		val-=3; \
-		if (val<0) val=0; \
-	}\
-	else if ((bits&0x3c0)==0x200) { \
-		EAT_BITS(4); \
-		val+=8; \
-		if (val>255) val=255;\
-	}\
-	else if ((bits&0x3c0)==0x240) { \
-		EAT_BITS(4); \
-		val-=8; \
-		if (val<0) val=0;\
-	}\
-	else if ((bits&0x3c0)==0x3c0) { \
-		EAT_BITS(4); \
-		val-=20; \
-		if (val<0) val=0;\
-	}\
-	else if ((bits&0x3e0)==0x380) { \
-		EAT_BITS(5); \
-		val+=20; \
-		if (val>255) val=255;\
-	}\
-	else { \
-		EAT_BITS(10); \
-		val=8*(bits&0x1f)+0; \
-	}\
+	code = &table[bits&0x3ff];\
+	EAT_BITS(code->len);\
+	newval = val + code->delta;\
+	newval = newval < 0 ? 0 : newval;\
+	newval = newval > 255 ? 255 : newval;\
+	val = code->is_abs ? 8*(bits&0x1f) : newval;\
 }
 
 
 #define PUT_PIXEL_PAIR {\
-	long pp;\
-	pp=(c1val<<8)+c2val;\
-	*((unsigned short *) (dst+dst_index))=pp;\
-	dst_index+=2; }
+	dst[dst_index++] = c2val;\
+	dst[dst_index++] = c1val; }
 
 /* Now the decode function itself */
 
@@ -398,8 +427,13 @@ sonix_decode(unsigned char * dst, unsigned char * src, int width, int height)
 	int x, y;
 	unsigned long bitBuf = 0;
 	unsigned long bitBufCount = 0;
+	struct sonix_code table[1024];
+
+	sonix_build_code_table (table);
+
 	/* Columns were reversed during compression ! */
 	for (y = starting_row; y < height; y++) {
+		/* Each row starts with the first two pixels as raw 8 bit */
 		PEEK_BITS(8, bits);
 		EAT_BITS(8);
 		c2val = bits & 0xff;
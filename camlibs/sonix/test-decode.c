@@ -0,0 +1,108 @@
+/* test-decode.c
+ *
+ * Runs sonix_decode() on pseudo-random compressed streams of several
+ * frame sizes and compares a hash of each decoded frame with the one the
+ * if/else chain code parser produced for the same stream. Run with any
+ * argument to print the hashes instead.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gphoto2/gphoto2.h>
+
+#include "sonix.h"
+
+#define NSIZES	7
+#define NKINDS	4
+
+static const int sizes[NSIZES][2] = {
+	{ 4, 2 }, { 4, 4 }, { 6, 5 }, { 176, 144 }, { 352, 288 }, { 320, 240 }, { 640, 480 }
+};
+
+/* FNV-1a of the frames decoded by the old decoder */
+static const uint32_t golden[NSIZES][NKINDS] = {
+	{ 0xe4dc8998, 0x0c6c8d21, 0x43fef0d1, 0x9be17165 },
+	{ 0x41ad69ad, 0x1f6a345e, 0xb9fea710, 0x69691905 },
+	{ 0x9c9371a8, 0x528d1db3, 0x0395809f, 0x57b2477d },
+	{ 0xb13defea, 0x9901074f, 0x80fb2d18, 0xe28fb9c5 },
+	{ 0x2b2a32eb, 0xd52e9927, 0xd34f4762, 0x85c90dc5 },
+	{ 0x56510890, 0x91780143, 0x86e588d9, 0x6ad58dc5 },
+	{ 0x0ff3e96f, 0xc3c335fd, 0x6ccb828a, 0xb6005dc5 },
+};
+
+static unsigned int seed;
+
+static int
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* random bytes, short codes, mostly short codes with some absolute
+ * values, and a stream of zero codes */
+static unsigned char
+stream_byte (int kind)
+{
+	switch (kind) {
+	case 0:	return rnd ();
+	case 1:	return rnd () & 0x7f;
+	case 2:	return (rnd () % 4) ? (rnd () & 0x3f) : rnd ();
+	default: return 0;
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	unsigned char	*in, *out;
+	int		s, kind, w, h, n, i, failed = 0;
+	uint32_t	hash;
+
+	for (s = 0; s < NSIZES; s++) {
+		for (kind = 0; kind < NKINDS; kind++) {
+			w = sizes[s][0];
+			h = sizes[s][1];
+			n = w * h * 2 + 64;
+			in = malloc (n);
+			out = calloc (w, h);
+			seed = s * 131 + kind;
+			for (i = 0; i < n; i++)
+				in[i] = stream_byte (kind);
+			sonix_decode (out, in, w, h);
+			hash = 2166136261u;
+			for (i = 0; i < w * h; i++)
+				hash = (hash ^ out[i]) * 16777619u;
+			free (in);
+			free (out);
+			if (argc > 1) {
+				printf ("0x%08x%s", hash, (kind < NKINDS - 1) ? ", " : "\n");
+			} else if (hash != golden[s][kind]) {
+				printf ("FAIL: %dx%d kind %d: hash 0x%08x, expected 0x%08x\n",
+					w, h, kind, hash, golden[s][kind]);
+				failed++;
+			}
+		}
+	}
+	if (argc == 1 && !failed)
+		printf ("%d frames decoded as before\n", NSIZES * NKINDS);
+	return failed ? 1 : 0;
+}
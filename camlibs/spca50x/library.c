@@ -183,6 +183,7 @@ camera_capture (Camera *camera, CameraCaptureType type,
 	if (!(a.operations & GP_OPERATION_CAPTURE_IMAGE))
 		return GP_ERROR_NOT_SUPPORTED;
 
+	CHECK (spca50x_sdram_download_end (camera->pl));
 	if (cam_has_flash(camera->pl))
 	{
 		int fc;
@@ -224,6 +225,7 @@ static int
 camera_exit (Camera *camera, GPContext *context)
 {
 	if (camera->pl) {
+		spca50x_sdram_download_end (camera->pl);
 		if (cam_has_flash (camera->pl) || cam_has_card (camera->pl))
 			spca50x_flash_close (camera->pl, context);
 
@@ -257,6 +259,7 @@ camera_summary (Camera *camera, CameraText *summary, GPContext *context)
 	int flash_file_count;
 
 	if (cam_has_flash(camera->pl)  || cam_has_card (camera->pl)) {
+		CHECK (spca50x_sdram_download_end (camera->pl));
 		spca50x_flash_get_filecount(camera->pl, &flash_file_count);
 		snprintf (tmp, sizeof (tmp),
 			_("FLASH:\n Files: %d\n"), flash_file_count);
@@ -309,6 +312,7 @@ file_list_func (CameraFilesystem *fs, const char *folder,
 
 	if (cam_has_flash(camera->pl) || cam_has_card(camera->pl) )
 	{
+		CHECK (spca50x_sdram_download_end (camera->pl));
 		CHECK (spca50x_flash_get_TOC(camera->pl, &filecount));
 		for (i=0; i<filecount; i++)
 		{
@@ -350,6 +354,7 @@ get_file_func (CameraFilesystem *fs, const char *folder,
 	       gp_filesystem_number (camera->fs, folder, filename, context));
 
 	if (cam_has_flash(camera->pl) || cam_has_card(camera->pl) ) {
+		CHECK (spca50x_sdram_download_end (camera->pl));
 		CHECK (spca50x_flash_get_filecount
 					(camera->pl, &flash_file_count));
 	}
@@ -424,6 +429,7 @@ get_info_func (CameraFilesystem *fs, const char *folder,
 	       gp_filesystem_number (camera->fs, folder, filename, context));
 
 	if (cam_has_flash(camera->pl) || cam_has_card(camera->pl) ) {
+		CHECK (spca50x_sdram_download_end (camera->pl));
 		CHECK (spca50x_flash_get_TOC(camera->pl,
 					&flash_file_count));
 	}
@@ -480,6 +486,7 @@ delete_file_func (CameraFilesystem *fs, const char *folder,
 	       gp_filesystem_number (camera->fs, folder, filename, context));
 
 	if (cam_has_flash(camera->pl) || cam_has_card(camera->pl) ) {
+		CHECK (spca50x_sdram_download_end (camera->pl));
 		CHECK (spca50x_flash_get_filecount
 					(camera->pl, &flash_file_count));
 	} else {
@@ -44,9 +44,14 @@
 
 #define GP_MODULE "spca50x"
 
+/* Seconds without a download after which the camera mode is checked
+ * again before the next one */
+#define SPCA50X_SESSION_IDLE 2
+
 static int spca50x_mode_set_idle (CameraPrivateLibrary * lib);
 static int spca50x_is_idle (CameraPrivateLibrary * lib);
 static int spca50x_mode_set_download (CameraPrivateLibrary * lib);
+static int spca50x_download_begin (CameraPrivateLibrary * lib);
 static int spca50x_download_data (CameraPrivateLibrary * lib, uint32_t start,
 				 unsigned int size, uint8_t * buf);
 static int spca50x_get_FATs (CameraPrivateLibrary * lib, int dramtype);
@@ -69,24 +74,41 @@ static int
 spca50x_sdram_get_fat_page (CameraPrivateLibrary * lib, int index,
 		            int dramtype, uint8_t *p)
 {
+	uint32_t top;
+	int count;
+
 	switch (dramtype) {
 		case 4:	/* 128 Mbit */
-			CHECK (spca50x_download_data
-					(lib, 0x7fff80 -
-					 index * 0x80,
-					 SPCA50X_FAT_PAGE_SIZE, p));
+			top = 0x7fff80;
 			break;
 		case 3:	/* 64 Mbit */
-			CHECK (spca50x_download_data
-					(lib, 0x3fff80 -
-					 index * 0x80,
-					 SPCA50X_FAT_PAGE_SIZE, p));
+			top = 0x3fff80;
 			break;
 		default:
 			gp_log(GP_LOG_ERROR, "spca50x", "spca50x_sdram_get_fat_page: dramtype %d unhandled", dramtype);
 			return GP_ERROR;
 	}
 
+	/* The fat grows downwards from the top of the sdram, so the pages
+	 * following this one are stored right below it and a single
+	 * download fetches a whole window of them. */
+	if (index < lib->fat_window_first ||
+	    index >= lib->fat_window_first + lib->fat_window_count) {
+		count = SPCA50X_FAT_WINDOW;
+		if ((uint32_t)(index + count - 1) > top / 0x80)
+			count = top / 0x80 - index + 1;
+		lib->fat_window_count = 0;
+		CHECK (spca50x_download_data
+				(lib, top - (index + count - 1) * 0x80,
+				 count * SPCA50X_FAT_PAGE_SIZE,
+				 lib->fat_window));
+		lib->fat_window_first = index;
+		lib->fat_window_count = count;
+	}
+	memcpy (p, lib->fat_window + SPCA50X_FAT_PAGE_SIZE *
+		(lib->fat_window_first + lib->fat_window_count - 1 - index),
+		SPCA50X_FAT_PAGE_SIZE);
+
 	return GP_OK;
 }
 
@@ -154,6 +176,7 @@ spca50x_sdram_delete_file (CameraPrivateLibrary * lib, unsigned int index)
 	else			/* if (lib->bridge == BRIDGE_SPCA504) */
 		fat_index = 0xD8000 - g_file->fat_start - 1;
 
+	CHECK (spca50x_sdram_download_end (lib));
 	CHECK (gp_port_usb_msg_write
 	       (lib->gpdev, 0x06, fat_index, 0x0007, NULL, 0));
 #ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
@@ -169,6 +192,7 @@ spca50x_sdram_delete_file (CameraPrivateLibrary * lib, unsigned int index)
 int
 spca50x_sdram_delete_all (CameraPrivateLibrary * lib)
 {
+	CHECK (spca50x_sdram_download_end (lib));
 	if (lib->fw_rev == 2) {
 		CHECK (gp_port_usb_msg_write
 		       (lib->gpdev, 0x71, 0x0000, 0x0000, NULL, 0));
@@ -705,11 +729,9 @@ spca50x_sdram_get_info (CameraPrivateLibrary * lib)
 
 	GP_DEBUG ("* spca50x_sdram_get_info");
 
+	lib->fat_window_count = 0;
 	if (lib->bridge == BRIDGE_SPCA504) {
-		if (!spca50x_is_idle (lib))
-			spca50x_mode_set_idle (lib);
-
-		spca50x_mode_set_download (lib);
+		CHECK (spca50x_download_begin (lib));
 
 		CHECK (gp_port_usb_msg_write
 		       (lib->gpdev, 0x00, 0x0001, SPCA50X_REG_AutoPbSize, NULL,
@@ -760,12 +782,43 @@ spca50x_sdram_get_file_info (CameraPrivateLibrary * lib, unsigned int index,
 	*g_file = &(lib->sdram_files[index]);
 	return GP_OK;
 }
+static int
+spca50x_shadow_index (int reg)
+{
+	switch (reg) {
+	case SPCA50X_REG_CamMode:
+		return 0;
+	case SPCA50X_REG_PbSrc:
+		return 1;
+	default:
+		return -1;
+	}
+}
+
+/* Writes a register, unless it is known to hold the value already */
+static int
+spca50x_reg_write (CameraPrivateLibrary * lib, int reg, uint8_t value)
+{
+	int i = spca50x_shadow_index (reg);
+
+	if (i >= 0) {
+		if ((lib->shadow_valid & (1 << i)) && lib->shadow[i] == value)
+			return GP_OK;
+		lib->shadow_valid &= ~(1 << i);
+	}
+	CHECK (gp_port_usb_msg_write (lib->gpdev, 0, value, reg, NULL, 0));
+	if (i >= 0) {
+		lib->shadow[i] = value;
+		lib->shadow_valid |= 1 << i;
+	}
+	return GP_OK;
+}
+
 static int
 spca50x_mode_set_idle (CameraPrivateLibrary * lib)
 {
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, SPCA50X_CamMode_Idle, SPCA50X_REG_CamMode, NULL,
-		0));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_CamMode, SPCA50X_CamMode_Idle));
 	return GP_OK;
 }
 
@@ -783,73 +836,126 @@ spca50x_is_idle (CameraPrivateLibrary * lib)
 static int
 spca50x_mode_set_download (CameraPrivateLibrary * lib)
 {
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, SPCA50X_CamMode_Upload, SPCA50X_REG_CamMode, NULL,
-		0));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_CamMode, SPCA50X_CamMode_Upload));
 	return GP_OK;
 }
 
+/* Puts the camera into upload mode and remembers the vlc address, which
+ * the downloads overwrite. Nothing else may talk to the camera until
+ * spca50x_sdram_download_end () has been called. */
 static int
-spca50x_download_data (CameraPrivateLibrary * lib, uint32_t start,
-		      unsigned int size, uint8_t * buf)
+spca50x_download_begin (CameraPrivateLibrary * lib)
 {
+	uint8_t mode = 0;
 
-	uint8_t foo;
-	uint8_t vlcAddressL, vlcAddressM, vlcAddressH;
+	if (lib->in_download) {
+		if (time (NULL) - lib->last_download < SPCA50X_SESSION_IDLE)
+			return GP_OK;
+		/* The camera may have left upload mode by itself while
+		 * nobody was downloading, e.g. when it powered down */
+		CHECK (gp_port_usb_msg_read
+		       (lib->gpdev, 0, 0, SPCA50X_REG_CamMode,
+			(char *) & mode, 1));
+		lib->last_download = time (NULL);
+		if (mode == SPCA50X_CamMode_Upload)
+			return GP_OK;
+		GP_DEBUG ("camera left upload mode, restarting the session");
+		lib->shadow_valid = 0;
+		if (mode != SPCA50X_CamMode_Idle)
+			spca50x_mode_set_idle (lib);
+		CHECK (spca50x_mode_set_download (lib));
+		return GP_OK;
+	}
 
+	lib->shadow_valid = 0;
 	if (!spca50x_is_idle (lib))
 		spca50x_mode_set_idle (lib);
 
-	spca50x_mode_set_download (lib);
-
-	foo = size & 0xFF;
-	CHECK (gp_port_usb_msg_write (lib->gpdev, 0, foo,
-				      SPCA50X_REG_SdramSizeL, NULL, 0));
-	foo = (size >> 8) & 0xFF;
-	CHECK (gp_port_usb_msg_write (lib->gpdev, 0, foo,
-				      SPCA50X_REG_SdramSizeM, NULL, 0));
-	foo = (size >> 16) & 0xFF;
-	CHECK (gp_port_usb_msg_write (lib->gpdev, 0, foo,
-				      SPCA50X_REG_SdramSizeH, NULL, 0));
+	CHECK (spca50x_mode_set_download (lib));
 
 	CHECK (gp_port_usb_msg_read
 	       (lib->gpdev, 0, 0, SPCA50X_REG_VlcAddressL,
-		(char *) & vlcAddressL, 1));
+		(char *) & lib->vlc_address[0], 1));
 	CHECK (gp_port_usb_msg_read
 	       (lib->gpdev, 0, 0, SPCA50X_REG_VlcAddressM,
-		(char *) & vlcAddressM, 1));
+		(char *) & lib->vlc_address[1], 1));
 	CHECK (gp_port_usb_msg_read
 	       (lib->gpdev, 0, 0, SPCA50X_REG_VlcAddressH,
-		(char *) & vlcAddressH, 1));
+		(char *) & lib->vlc_address[2], 1));
 
-	foo = start & 0xFF;
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, foo, SPCA50X_REG_VlcAddressL, NULL, 0));
-	foo = (start >> 8) & 0xFF;
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, foo, SPCA50X_REG_VlcAddressM, NULL, 0));
-	foo = (start >> 16) & 0xFF;
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, foo, SPCA50X_REG_VlcAddressH, NULL, 0));
+	lib->in_download = 1;
+	lib->last_download = time (NULL);
+	return GP_OK;
+}
+
+/* Restores the vlc address and returns the camera to idle mode */
+int
+spca50x_sdram_download_end (CameraPrivateLibrary * lib)
+{
+	if (!lib->in_download)
+		return GP_OK;
+	lib->in_download = 0;
+
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressL, lib->vlc_address[0]));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressM, lib->vlc_address[1]));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressH, lib->vlc_address[2]));
+
+	CHECK (spca50x_mode_set_idle (lib));
+	return GP_OK;
+}
+
+static int
+spca50x_download_transfer (CameraPrivateLibrary * lib, uint32_t start,
+			   unsigned int size, uint8_t * buf)
+{
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_SdramSizeL, size & 0xFF));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_SdramSizeM, (size >> 8) & 0xFF));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_SdramSizeH, (size >> 16) & 0xFF));
+
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressL, start & 0xFF));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressM, (start >> 8) & 0xFF));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_VlcAddressH, (start >> 16) & 0xFF));
 
 	/* Set mode to ram -> usb */
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, SPCA50X_DramUsb, SPCA50X_REG_PbSrc, NULL, 0));
+	CHECK (spca50x_reg_write (lib, SPCA50X_REG_PbSrc, SPCA50X_DramUsb));
 	/* and pull the trigger */
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, SPCA50X_TrigDramFifo, SPCA50X_REG_Trigger, NULL,
-		0));
+	CHECK (spca50x_reg_write
+	       (lib, SPCA50X_REG_Trigger, SPCA50X_TrigDramFifo));
 
 	CHECK (gp_port_read (lib->gpdev, (char *)buf, size));
+	return GP_OK;
+}
 
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, vlcAddressL, SPCA50X_REG_VlcAddressL, NULL, 0));
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, vlcAddressM, SPCA50X_REG_VlcAddressM, NULL, 0));
-	CHECK (gp_port_usb_msg_write
-	       (lib->gpdev, 0, vlcAddressH, SPCA50X_REG_VlcAddressH, NULL, 0));
+/* Consecutive downloads share one upload mode session, so the camera
+ * mode and source are only set once. */
+static int
+spca50x_download_data (CameraPrivateLibrary * lib, uint32_t start,
+		      unsigned int size, uint8_t * buf)
+{
+	int ret;
+
+	CHECK (spca50x_download_begin (lib));
 
-	spca50x_mode_set_idle (lib);
+	ret = spca50x_download_transfer (lib, start, size, buf);
+	if (ret < GP_OK) {
+		/* Try to leave the camera idle, and start over with a
+		 * fresh session next time */
+		lib->shadow_valid = 0;
+		spca50x_sdram_download_end (lib);
+		lib->in_download = 0;
+		return ret;
+	}
+	lib->last_download = time (NULL);
 	return GP_OK;
 }
 
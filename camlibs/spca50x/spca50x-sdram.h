@@ -39,5 +39,6 @@ int spca50x_sdram_request_file (CameraPrivateLibrary * lib, uint8_t ** buf,
 int spca50x_sdram_request_thumbnail (CameraPrivateLibrary * lib,
 		uint8_t ** buf, unsigned int *len,
 		unsigned int number, int *type);
+int spca50x_sdram_download_end (CameraPrivateLibrary * lib);
 
 #endif /* !defined(CAMLIBS_SPCA50X_SPCA50X_SDRAM_H) */
@@ -28,9 +28,15 @@
 #define CAMLIBS_SPCA50X_SPCA50X_H
 
 #include <stdint.h>
+#include <time.h>
 #include <gphoto2/gphoto2-camera.h>
 
 #define SPCA50X_FAT_PAGE_SIZE 0x100
+/* Number of fat pages fetched per download, see spca50x-sdram.c */
+#define SPCA50X_FAT_WINDOW 16
+/* CamMode, PbSrc. The transfer engine itself changes SdramSize[LMH]
+ * and VlcAddress[LMH], so those are always written. */
+#define SPCA50X_SHADOW_REGS 2
 #define SPCA50X_FILE_TYPE_IMAGE 0x00
 #define SPCA50X_FILE_TYPE_AVI 0x01
 
@@ -75,6 +81,22 @@ struct _CameraPrivateLibrary
 	uint8_t *fats;
 	struct SPCA50xFile *flash_files;
 	struct SPCA50xFile *sdram_files;
+
+	/* SDRAM download session: the camera stays in upload mode between
+	 * consecutive downloads until spca50x_sdram_download_end () */
+	int in_download;
+	uint8_t vlc_address[3];
+	/* When the last download of the session finished */
+	time_t last_download;
+	/* Values last written to the download registers, only trusted
+	 * while in_download is set */
+	uint8_t shadow[SPCA50X_SHADOW_REGS];
+	unsigned int shadow_valid;
+	/* Read-ahead of fat pages fat_window_first ... + fat_window_count - 1,
+	 * in the order they are stored in SDRAM (last page first) */
+	uint8_t fat_window[SPCA50X_FAT_WINDOW * SPCA50X_FAT_PAGE_SIZE];
+	int fat_window_first;
+	int fat_window_count;
 };
 
 #define SPCA50X_SDRAM 0x01
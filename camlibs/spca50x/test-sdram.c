@@ -0,0 +1,298 @@
+/* test-sdram.c
+ *
+ * Downloads the images and thumbnails of an SDRAM camera through a
+ * stand-in for the port, which records the control transfers and models
+ * the registers, the SDRAM and the transfer engine: a bulk read is only
+ * served in upload mode with the source, size and trigger set, and it
+ * moves VlcAddress on and counts SdramSize down like the hardware does.
+ * Checks the number of transfers for the fat scan and per file, that the
+ * data is what the unbatched code downloaded, that a camera which left
+ * upload mode during a pause and a failed transfer are recovered from,
+ * and that the camera is left in the state the unbatched code left it in.
+ * Run with any argument to print the counts, hash and state instead.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gphoto2/gphoto2.h>
+
+#include "spca50x.h"
+#include "spca50x-sdram.h"
+#include "spca50x-registers.h"
+
+#define NFILES		40
+#define DRAM_SIZE	(16 << 20)
+#define VLC_ADDRESS	0x053412	/* what the camera had before */
+
+/* Transfers of the batched code. The unbatched code took 1384 control
+ * transfers and 81 bulk reads for the fat scan, and 36 control transfers
+ * per image and thumbnail. */
+#define SCAN_CONTROL	51
+#define SCAN_BULK	6
+#define FILES_CONTROL	560
+
+/* FNV-1a over the hashes of the images and thumbnails as the unbatched
+ * code downloaded them */
+#define DATA_HASH	0xd914b936
+
+static uint8_t	regs[0x10000];
+static uint8_t	*dram;
+static int	ncontrol, nbulk, triggered, fail_next;
+
+int
+gp_port_usb_msg_write (GPPort *port, int request, int value, int index,
+		       char *bytes, int size)
+{
+	ncontrol++;
+	if (request == 0) {
+		regs[index] = value;
+		if (index == SPCA50X_REG_Trigger)
+			triggered = 1;
+	}
+	return GP_OK;
+}
+
+int
+gp_port_usb_msg_read (GPPort *port, int request, int value, int index,
+		      char *bytes, int size)
+{
+	ncontrol++;
+	if (request == 0)
+		bytes[0] = regs[index];
+	return size;
+}
+
+int
+gp_port_read (GPPort *port, char *data, int size)
+{
+	uint32_t vlc = regs[SPCA50X_REG_VlcAddressL] |
+		       regs[SPCA50X_REG_VlcAddressM] << 8 |
+		       regs[SPCA50X_REG_VlcAddressH] << 16;
+	uint32_t len = regs[SPCA50X_REG_SdramSizeL] |
+		       regs[SPCA50X_REG_SdramSizeM] << 8 |
+		       regs[SPCA50X_REG_SdramSizeH] << 16;
+
+	if (!triggered || (len != (uint32_t)size) ||
+	    (regs[SPCA50X_REG_CamMode] != SPCA50X_CamMode_Upload) ||
+	    (regs[SPCA50X_REG_PbSrc] != SPCA50X_DramUsb) ||
+	    (vlc * 2 + size > DRAM_SIZE)) {
+		printf ("FAIL: read of %d bytes with trigger %d, size %u, mode %d, source 0x%02x\n",
+			size, triggered, len, regs[SPCA50X_REG_CamMode],
+			regs[SPCA50X_REG_PbSrc]);
+		exit (1);
+	}
+	triggered = 0;
+	if (fail_next) {
+		fail_next = 0;
+		return GP_ERROR_IO;
+	}
+	nbulk++;
+	memcpy (data, dram + vlc * 2, size);
+
+	/* the engine moves the address on and counts the size down */
+	vlc += size / 2;
+	regs[SPCA50X_REG_VlcAddressL] = vlc;
+	regs[SPCA50X_REG_VlcAddressM] = vlc >> 8;
+	regs[SPCA50X_REG_VlcAddressH] = vlc >> 16;
+	regs[SPCA50X_REG_SdramSizeL] = 0;
+	regs[SPCA50X_REG_SdramSizeM] = 0;
+	regs[SPCA50X_REG_SdramSizeH] = 0;
+	return size;
+}
+
+/* Random SDRAM contents with a fat page per image below the top, each
+ * image followed by its thumbnail */
+static void
+build_sdram (void)
+{
+	unsigned int	seed = 1, start = 0x2800, size, pages, i;
+	uint8_t		*p;
+
+	dram = malloc (DRAM_SIZE);
+	for (i = 0; i < DRAM_SIZE; i++) {
+		seed = seed * 1103515245 + 12345;
+		dram[i] = seed >> 16;
+	}
+	for (i = 0; i <= NFILES; i++) {
+		p = dram + (0x7fff80 - i * 0x80) * 2;
+		memset (p, 0, SPCA50X_FAT_PAGE_SIZE);
+		if (i == NFILES) {
+			p[0] = 0xff;
+			break;
+		}
+		size = 30000 + i * 997;
+		pages = (size + 255) / 256;
+		p[1] = start;
+		p[2] = start >> 8;
+		p[3] = start + pages;
+		p[4] = (start + pages) >> 8;
+		p[5] = size >> 8;
+		p[8] = 40;
+		p[9] = 30;
+		p[11] = size;
+		p[12] = size >> 8;
+		p[13] = size >> 16;
+		start += pages + 0xa0;
+	}
+	regs[SPCA50X_REG_DramType] = 4;
+	regs[SPCA50X_REG_VlcAddressL] = VLC_ADDRESS & 0xff;
+	regs[SPCA50X_REG_VlcAddressM] = (VLC_ADDRESS >> 8) & 0xff;
+	regs[SPCA50X_REG_VlcAddressH] = VLC_ADDRESS >> 16;
+	regs[SPCA50X_REG_CamMode] = SPCA50X_CamMode_DSC;
+}
+
+static uint32_t
+hash_data (uint32_t hash, const uint8_t *data, unsigned int len)
+{
+	while (len--)
+		hash = (hash ^ *data++) * 16777619u;
+	return hash;
+}
+
+/* Downloads image and thumbnail i and returns their hash, or 0 on
+ * failure */
+static uint32_t
+download (CameraPrivateLibrary *lib, int i)
+{
+	uint8_t		*buf;
+	unsigned int	len;
+	uint32_t	hash = 2166136261u;
+	int		type;
+
+	if (spca50x_sdram_request_file (lib, &buf, &len, i, &type) < GP_OK)
+		return 0;
+	hash = hash_data (hash, buf, len);
+	free (buf);
+	if (spca50x_sdram_request_thumbnail (lib, &buf, &len, i, &type) < GP_OK)
+		return 0;
+	hash = hash_data (hash, buf, len);
+	free (buf);
+	return hash;
+}
+
+int
+main (int argc, char **argv)
+{
+	CameraPrivateLibrary	*lib;
+	uint32_t		file_hash[NFILES], hash;
+	uint8_t			*buf;
+	unsigned int		len, vlc;
+	int			i, type, scan_control, scan_bulk, files_control;
+	int			files_bulk, failed = 0;
+
+	build_sdram ();
+	lib = calloc (1, sizeof (*lib));
+	lib->gpdev = (GPPort *) 1;
+	lib->bridge = BRIDGE_SPCA504;
+	lib->fw_rev = 1;
+	lib->storage_media_mask = SPCA50X_SDRAM;
+	lib->dirty_sdram = 1;
+
+	if (spca50x_sdram_get_info (lib) < GP_OK) {
+		printf ("FAIL: fat scan\n");
+		return 1;
+	}
+	if (lib->num_files_on_sdram != NFILES) {
+		printf ("FAIL: %d files found, expected %d\n", lib->num_files_on_sdram, NFILES);
+		return 1;
+	}
+	scan_control = ncontrol;
+	scan_bulk = nbulk;
+	for (i = 0; i < NFILES; i++) {
+		file_hash[i] = download (lib, i);
+		if (!file_hash[i]) {
+			printf ("FAIL: download of file %d\n", i);
+			return 1;
+		}
+	}
+	hash = 2166136261u;
+	for (i = 0; i < NFILES; i++)
+		hash = (hash ^ file_hash[i]) * 16777619u;
+	files_control = ncontrol - scan_control;
+	files_bulk = nbulk - scan_bulk;
+
+	if (argc > 1) {
+		printf ("fat scan: %d control transfers, %d bulk reads\n", scan_control, scan_bulk);
+		printf ("%d files: %d control transfers, %d bulk reads\n",
+			NFILES, files_control, files_bulk);
+		printf ("data hash 0x%08x\n", hash);
+	} else {
+		if ((scan_control != SCAN_CONTROL) || (scan_bulk != SCAN_BULK)) {
+			printf ("FAIL: fat scan took %d control transfers and %d bulk reads, expected %d and %d\n",
+				scan_control, scan_bulk, SCAN_CONTROL, SCAN_BULK);
+			failed++;
+		}
+		if ((files_control != FILES_CONTROL) || (files_bulk != 2 * NFILES)) {
+			printf ("FAIL: %d files took %d control transfers and %d bulk reads, expected %d and %d\n",
+				NFILES, files_control, files_bulk, FILES_CONTROL, 2 * NFILES);
+			failed++;
+		}
+		if (hash != DATA_HASH) {
+			printf ("FAIL: data hash 0x%08x, expected 0x%08x\n", hash, DATA_HASH);
+			failed++;
+		}
+	}
+
+	/* the camera drops out of upload mode during a pause */
+	regs[SPCA50X_REG_CamMode] = SPCA50X_CamMode_DSC;
+	lib->last_download -= 60;
+	if (download (lib, 0) != file_hash[0]) {
+		printf ("FAIL: download after a pause\n");
+		failed++;
+	}
+
+	/* a failed transfer leaves the camera idle, the next one works */
+	fail_next = 1;
+	if (spca50x_sdram_request_file (lib, &buf, &len, 1, &type) >= GP_OK) {
+		printf ("FAIL: failed transfer not reported\n");
+		free (buf);
+		failed++;
+	}
+	if (regs[SPCA50X_REG_CamMode] != SPCA50X_CamMode_Idle) {
+		printf ("FAIL: camera in mode %d after a failed transfer\n",
+			regs[SPCA50X_REG_CamMode]);
+		failed++;
+	}
+	if (download (lib, 1) != file_hash[1]) {
+		printf ("FAIL: download after a failed transfer\n");
+		failed++;
+	}
+	spca50x_sdram_download_end (lib);
+
+	/* as the unbatched code left it: idle, source and vlc address */
+	vlc = regs[SPCA50X_REG_VlcAddressL] | regs[SPCA50X_REG_VlcAddressM] << 8 |
+	      regs[SPCA50X_REG_VlcAddressH] << 16;
+	if ((regs[SPCA50X_REG_CamMode] != SPCA50X_CamMode_Idle) ||
+	    (regs[SPCA50X_REG_PbSrc] != SPCA50X_DramUsb) || (vlc != VLC_ADDRESS)) {
+		printf ("FAIL: camera left in mode %d, source 0x%02x, vlc address 0x%06x\n",
+			regs[SPCA50X_REG_CamMode], regs[SPCA50X_REG_PbSrc], vlc);
+		failed++;
+	}
+
+	if (argc == 1 && !failed)
+		printf ("%d files downloaded in %d control transfers\n",
+			NFILES, scan_control + files_control);
+	free (lib->fats);
+	free (lib->sdram_files);
+	free (lib);
+	free (dram);
+	return failed ? 1 : 0;
+}
@@ -100,10 +100,13 @@ st2205_send_command(Camera *camera, int cmd, int arg1, int arg2)
 	return GP_OK;
 }
 
+/* Read count consecutive blocks starting at block. Memory dumps get read
+   with a single fread, the picframe itself only transfers one block per
+   read command. */
 static int
-st2205_read_block(Camera *camera, int block, char *buf)
+st2205_read_blocks(Camera *camera, int block, int count, char *buf)
 {
-	int ret;
+	int ret, size = count * ST2205_BLOCK_SIZE;
 	if (camera->pl->mem_dump) {
 		ret = fseek(camera->pl->mem_dump, block * ST2205_BLOCK_SIZE,
 			    SEEK_SET);
@@ -112,8 +115,8 @@ st2205_read_block(Camera *camera, int block, char *buf)
 				"seeking in memdump: %s", strerror(errno));
 			return GP_ERROR_IO_READ;
 		}
-		ret = fread(buf, 1, ST2205_BLOCK_SIZE, camera->pl->mem_dump);
-		if (ret != ST2205_BLOCK_SIZE) {
+		ret = fread(buf, 1, size, camera->pl->mem_dump);
+		if (ret != size) {
 			if (ret < 0)
 				gp_log (GP_LOG_ERROR, "st2205",
 					"reading memdump: %s",
@@ -124,23 +127,26 @@ st2205_read_block(Camera *camera, int block, char *buf)
 			return GP_ERROR_IO_READ;
 		}
 	} else {
-		CHECK (st2205_send_command (camera, 4, block,
-					    ST2205_BLOCK_SIZE))
-		if (gp_port_seek (camera->port, ST2205_READ_OFFSET, SEEK_SET)
-				!= ST2205_READ_OFFSET)
-			return GP_ERROR_IO;
-
-		if (gp_port_read (camera->port, buf, ST2205_BLOCK_SIZE)
-				!= ST2205_BLOCK_SIZE)
-			return GP_ERROR_IO_READ;
+		for (; count; count--, block++, buf += ST2205_BLOCK_SIZE) {
+			CHECK (st2205_send_command (camera, 4, block,
+						    ST2205_BLOCK_SIZE))
+			if (gp_port_seek (camera->port, ST2205_READ_OFFSET,
+					  SEEK_SET) != ST2205_READ_OFFSET)
+				return GP_ERROR_IO;
+
+			if (gp_port_read (camera->port, buf, ST2205_BLOCK_SIZE)
+					!= ST2205_BLOCK_SIZE)
+				return GP_ERROR_IO_READ;
+		}
 	}
 	return GP_OK;
 }
 
+/* Write count consecutive blocks starting at block */
 static int
-st2205_write_block(Camera *camera, int block, char *buf)
+st2205_write_blocks(Camera *camera, int block, int count, char *buf)
 {
-	int ret;
+	int ret, size = count * ST2205_BLOCK_SIZE;
 	if (camera->pl->mem_dump) {
 		ret = fseek(camera->pl->mem_dump, block * ST2205_BLOCK_SIZE,
 			    SEEK_SET);
@@ -149,58 +155,79 @@ st2205_write_block(Camera *camera, int block, char *buf)
 				"seeking in memdump: %s", strerror(errno));
 			return GP_ERROR_IO_WRITE;
 		}
-		ret = fwrite(buf, 1, ST2205_BLOCK_SIZE, camera->pl->mem_dump);
-		if (ret != ST2205_BLOCK_SIZE) {
+		ret = fwrite(buf, 1, size, camera->pl->mem_dump);
+		if (ret != size) {
 			gp_log (GP_LOG_ERROR, "st2205",
 				"writing memdump: %s", strerror(errno));
 			return GP_ERROR_IO_WRITE;
 		}
 	} else {
-		/* Prepare for write */
-		CHECK (st2205_send_command (camera, 3, block,
-					    ST2205_BLOCK_SIZE))
-		/* Write */
-		if (gp_port_seek (camera->port, ST2205_WRITE_OFFSET, SEEK_SET)
-				!= ST2205_WRITE_OFFSET)
-			return GP_ERROR_IO;
-
-		if (gp_port_write (camera->port, buf, ST2205_BLOCK_SIZE)
-				!= ST2205_BLOCK_SIZE)
-			return GP_ERROR_IO_WRITE;
-		/* Commit */
-		CHECK (st2205_send_command (camera, 2, block,
-					    ST2205_BLOCK_SIZE))
-		/* Read commit response (ignored) */
-		if (gp_port_seek (camera->port, ST2205_READ_OFFSET, SEEK_SET)
-				!= ST2205_READ_OFFSET)
-			return GP_ERROR_IO;
-
-		if (gp_port_read (camera->port, camera->pl->buf, 512)
-				!= 512)
-			return GP_ERROR_IO_READ;
+		for (; count; count--, block++, buf += ST2205_BLOCK_SIZE) {
+			/* Prepare for write */
+			CHECK (st2205_send_command (camera, 3, block,
+						    ST2205_BLOCK_SIZE))
+			/* Write */
+			if (gp_port_seek (camera->port, ST2205_WRITE_OFFSET,
+					  SEEK_SET) != ST2205_WRITE_OFFSET)
+				return GP_ERROR_IO;
+
+			if (gp_port_write (camera->port, buf,
+					   ST2205_BLOCK_SIZE)
+					!= ST2205_BLOCK_SIZE)
+				return GP_ERROR_IO_WRITE;
+			/* Commit */
+			CHECK (st2205_send_command (camera, 2, block,
+						    ST2205_BLOCK_SIZE))
+			/* Read commit response (ignored) */
+			if (gp_port_seek (camera->port, ST2205_READ_OFFSET,
+					  SEEK_SET) != ST2205_READ_OFFSET)
+				return GP_ERROR_IO;
+
+			if (gp_port_read (camera->port, camera->pl->buf, 512)
+					!= 512)
+				return GP_ERROR_IO_READ;
+		}
 	}
 	return GP_OK;
 }
 
+/* Make sure blocks block - block + count - 1 are in our memory cache,
+   reading each run of missing blocks with a single st2205_read_blocks */
 static int
-st2205_check_block_present(Camera *camera, int block)
+st2205_check_blocks_present(Camera *camera, int block, int count)
 {
-	int ret;
+	int ret, run, end = block + count;
 
-	if ((block + 1) * ST2205_BLOCK_SIZE > camera->pl->mem_size) {
+	if (end * ST2205_BLOCK_SIZE > camera->pl->mem_size) {
 		gp_log (GP_LOG_ERROR, "st2205", "read beyond end of memory");
 		return GP_ERROR_CORRUPTED_DATA;
 	}
 
-	if (camera->pl->block_is_present[block])
-		return GP_OK;
+	while (block < end) {
+		if (camera->pl->block_is_present[block]) {
+			block++;
+			continue;
+		}
 
-	ret = st2205_read_block(camera, block, camera->pl->mem +
-				block * ST2205_BLOCK_SIZE);
-	if (ret == 0)
-		camera->pl->block_is_present[block] = 1;
+		for (run = 1; (block + run) < end &&
+			      !camera->pl->block_is_present[block + run];
+		     run++);
 
-	return ret;
+		ret = st2205_read_blocks(camera, block, run, camera->pl->mem +
+					 block * ST2205_BLOCK_SIZE);
+		if (ret < 0)
+			return ret;
+
+		for (; run; run--, block++)
+			camera->pl->block_is_present[block] = 1;
+	}
+	return GP_OK;
+}
+
+static int
+st2205_check_block_present(Camera *camera, int block)
+{
+	return st2205_check_blocks_present (camera, block, 1);
 }
 
 static int
@@ -217,7 +244,7 @@ st2205_detect_mem_size(Camera *camera)
 		return GP_ERROR_NO_MEMORY;
 	}
 
-	ret = st2205_read_block(camera, 0, buf0);
+	ret = st2205_read_blocks(camera, 0, 1, buf0);
 	if (ret) {
 		st2205_free_page_aligned(buf0, ST2205_BLOCK_SIZE);
 		st2205_free_page_aligned(buf1, ST2205_BLOCK_SIZE);
@@ -225,9 +252,9 @@ st2205_detect_mem_size(Camera *camera)
 	}
 
 	for (i = 0; i < 3; i++) {
-		ret = st2205_read_block(camera,
-					(524288 / ST2205_BLOCK_SIZE) << i,
-					buf1);
+		ret = st2205_read_blocks(camera,
+					 (524288 / ST2205_BLOCK_SIZE) << i,
+					 1, buf1);
 		if (ret) {
 			st2205_free_page_aligned(buf0, ST2205_BLOCK_SIZE);
 			st2205_free_page_aligned(buf1, ST2205_BLOCK_SIZE);
@@ -249,21 +276,13 @@ static int
 st2205_read_mem(Camera *camera, int offset,
 	void *buf, int len)
 {
-	int to_copy, block = offset / ST2205_BLOCK_SIZE;
-
-	while (len) {
-		CHECK (st2205_check_block_present (camera, block))
+	int block = offset / ST2205_BLOCK_SIZE;
+	int count = (offset + len + ST2205_BLOCK_SIZE - 1) /
+		    ST2205_BLOCK_SIZE - block;
 
-		to_copy = ST2205_BLOCK_SIZE - (offset % ST2205_BLOCK_SIZE);
-		if (to_copy > len)
-			to_copy = len;
+	CHECK (st2205_check_blocks_present (camera, block, count))
 
-		memcpy(buf, camera->pl->mem + offset, to_copy);
-		buf += to_copy;
-		len -= to_copy;
-		offset += to_copy;
-		block++;
-	}
+	memcpy(buf, camera->pl->mem + offset, len);
 	return GP_OK;
 }
 
@@ -271,7 +290,9 @@ static int
 st2205_write_mem(Camera *camera, int offset,
 	void *buf, int len)
 {
-	int to_copy, block = offset / ST2205_BLOCK_SIZE;
+	int i, block = offset / ST2205_BLOCK_SIZE;
+	int count = (offset + len + ST2205_BLOCK_SIZE - 1) /
+		    ST2205_BLOCK_SIZE - block;
 
 	/* Don't allow writing to the firmware space */
 	if ((offset + len) >
@@ -280,21 +301,12 @@ st2205_write_mem(Camera *camera, int offset,
 		return GP_ERROR_CORRUPTED_DATA;
 	}
 
-	while (len) {
-		CHECK (st2205_check_block_present (camera, block))
-
-		to_copy = ST2205_BLOCK_SIZE - (offset % ST2205_BLOCK_SIZE);
-		if (to_copy > len)
-			to_copy = len;
+	CHECK (st2205_check_blocks_present (camera, block, count))
 
-		memcpy(camera->pl->mem + offset, buf, to_copy);
-		camera->pl->block_dirty[block] = 1;
+	memcpy(camera->pl->mem + offset, buf, len);
+	for (i = 0; i < count; i++)
+		camera->pl->block_dirty[block + i] = 1;
 
-		buf += to_copy;
-		len -= to_copy;
-		offset += to_copy;
-		block++;
-	}
 	return GP_OK;
 }
 
@@ -793,17 +805,15 @@ st2205_commit(Camera *camera)
 
 		/* Make sure all data blocks in this erase block have been
 		   read before erasing the block! */
-		for (j = 0; j < erase_block_size; j++)
-			CHECK (st2205_check_block_present (camera, i + j))
+		CHECK (st2205_check_blocks_present (camera, i,
+						    erase_block_size))
 
 		/* Re-write all the data blocks in this erase block! */
-		for (j = 0; j < erase_block_size; j++) {
-			CHECK (st2205_write_block (camera, i + j,
-						   camera->pl->mem +
-						   (i + j) *
-						   ST2205_BLOCK_SIZE))
+		CHECK (st2205_write_blocks (camera, i, erase_block_size,
+					    camera->pl->mem +
+					    i * ST2205_BLOCK_SIZE))
+		for (j = 0; j < erase_block_size; j++)
 			camera->pl->block_dirty[i + j] = 0;
-		}
 	}
 	return GP_OK;
 }
@@ -975,10 +985,9 @@ st2205_init(Camera *camera)
 	/* Some 96x64 models don't use compression, unfortunately I've found
 	   no way to detect if this is the case, so we keep a list of firmware
 	   checksums to identify these. */
-	for (i = camera->pl->mem_size - camera->pl->firmware_size;
-	     i < camera->pl->mem_size; i += ST2205_BLOCK_SIZE)
-		CHECK (st2205_check_block_present (camera,
-						   i / ST2205_BLOCK_SIZE))
+	CHECK (st2205_check_blocks_present (camera,
+		(camera->pl->mem_size - camera->pl->firmware_size) /
+		ST2205_BLOCK_SIZE, camera->pl->firmware_size / ST2205_BLOCK_SIZE))
 	checksum = 0;
 	for (i = camera->pl->mem_size - camera->pl->firmware_size;
 	     i < camera->pl->mem_size; i++)
@@ -128,6 +128,12 @@ struct _CameraPrivateLibrary {
 extern const st2205_lookup_row st2205_lookup[3][256];
 extern const uint8_t st2205_shuffle_data[10360];
 
+/* functions in st2205_search.c */
+/* Returns the row of lookup table table_no closest to row, the lowest
+   index of the closest ones, and its squared distance in smallest_diff */
+uint8_t
+st2205_find_closest_match(int table_no, int16_t *row, int *smallest_diff);
+
 /* functions in st2205.c */
 int
 st2205_open_device(Camera *camera);
@@ -165,29 +165,6 @@ st2205_decode_image(CameraPrivateLibrary *pl, unsigned char *src, int **dest)
 	return 0;
 }
 
-static uint8_t st2205_find_closest_match(const st2205_lookup_row *table,
-	  int16_t *row, int *smallest_diff_ret)
-{
-	int i, j;
-	uint8_t closest_match = 0;
-	unsigned int diff, smallest_diff = -1;
-
-	for (i = 0; i < 256; i++) {
-		diff = 0;
-		for (j = 0; j < 8; j++)
-			diff += (row[j] - table[i][j]) * (row[j] - table[i][j]);
-		if (diff < smallest_diff) {
-			smallest_diff = diff;
-			closest_match = i;
-		}
-	}
-
-	if (smallest_diff_ret)
-		*smallest_diff_ret = smallest_diff;
-
-	return closest_match;
-}
-
 static uint8_t st2205_closest_correction(int16_t corr)
 {
 	int i, diff, smallest_diff;
@@ -212,7 +189,7 @@ st2205_code_block(CameraPrivateLibrary *pl, int **src,
 	const st2205_lookup_row *luma_table;
 	int y_base, uv_base[2];
 	int16_t Y[64], UV[2][16];
-	uint8_t corr1, corr2, *pattern;
+	uint8_t corr1, corr2, *pattern, luma_pattern[2][8];
 	int x, y, r, g, b, uv, diff1, diff2, used = 0;
 
 	/* Step 1 convert to "YUV" */
@@ -274,10 +251,10 @@ st2205_code_block(CameraPrivateLibrary *pl, int **src,
 	/* Step 3 encode chroma values */
 	for (uv = 0; uv < 2; uv++) {
 		pattern = dest + used;
-		dest[used++] = st2205_find_closest_match (st2205_lookup[2],
-							  &UV[uv][0], &diff1);
-		dest[used++] = st2205_find_closest_match (st2205_lookup[2],
-							  &UV[uv][8], &diff2);
+		dest[used++] = st2205_find_closest_match (2, &UV[uv][0],
+							  &diff1);
+		dest[used++] = st2205_find_closest_match (2, &UV[uv][8],
+							  &diff2);
 		if ((diff1 > 64 || diff2 > 64) && allow_uv_corr) {
 			dest[2 + uv] |= 0x80;
 			for (x = 0; x < 16; x+= 2) {
@@ -294,9 +271,9 @@ st2205_code_block(CameraPrivateLibrary *pl, int **src,
 	diff1 = 0;
 	diff2 = 0;
 	for (y = 0; y < 8; y++) {
-		st2205_find_closest_match(st2205_lookup[0], &Y[y * 8], &x);
+		luma_pattern[0][y] = st2205_find_closest_match(0, &Y[y * 8], &x);
 		diff1 += x;
-		st2205_find_closest_match(st2205_lookup[1], &Y[y * 8], &x);
+		luma_pattern[1][y] = st2205_find_closest_match(1, &Y[y * 8], &x);
 		diff2 += x;
 	}
 
@@ -308,11 +285,10 @@ st2205_code_block(CameraPrivateLibrary *pl, int **src,
 		dest[1] |= 0x80;
 	}
 
-	/* Step 4b encode luma values, choose luma patterns */
+	/* Step 4b encode luma values, the patterns of the chosen table */
 	pattern = dest + used;
 	for (y = 0; y < 8; y++)
-		dest[used++] = st2205_find_closest_match (luma_table,
-							  &Y[y * 8], NULL);
+		dest[used++] = luma_pattern[diff1 <= diff2 ? 0 : 1][y];
 
 	/* Step 4c encode luma values, add luma correction values */
 	for (y = 0; y < 8; y++) {
@@ -0,0 +1,144 @@
+/* Sitronix st2205 picframe compression, closest pattern search
+ *
+ *   Copyright (c) 2010 Hans de Goede <hdegoede@redhat.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include "st2205.h"
+
+/* Per lookup table: the row indices sorted by the sum of the row, used to
+   prune the closest match search. */
+struct st2205_sorted_table {
+	int	sum[256];
+	uint8_t	index[256];
+};
+static struct st2205_sorted_table st2205_sorted[3];
+static int st2205_sorted_initialized;
+
+static int st2205_row_sum(const int16_t *row)
+{
+	int j, sum = 0;
+
+	for (j = 0; j < 8; j++)
+		sum += row[j];
+
+	return sum;
+}
+
+static void st2205_init_sorted_tables(void)
+{
+	struct st2205_sorted_table *sorted;
+	int t, i, j, sum;
+
+	for (t = 0; t < 3; t++) {
+		sorted = &st2205_sorted[t];
+		/* insertion sort, stable so equal sums stay in index order */
+		for (i = 0; i < 256; i++) {
+			sum = st2205_row_sum(st2205_lookup[t][i]);
+			for (j = i; j > 0 && sorted->sum[j - 1] > sum; j--) {
+				sorted->sum[j] = sorted->sum[j - 1];
+				sorted->index[j] = sorted->index[j - 1];
+			}
+			sorted->sum[j] = sum;
+			sorted->index[j] = i;
+		}
+	}
+	st2205_sorted_initialized = 1;
+}
+
+/* Check table row i against the best match so far. Ties go to the lowest
+   row index, like a plain scan over all rows would pick. */
+static void st2205_check_match(const st2205_lookup_row *table, int i,
+	int16_t *row, unsigned int *smallest_diff, int *closest_match)
+{
+	unsigned int diff = 0;
+	int j;
+
+	for (j = 0; j < 8; j++)
+		diff += (row[j] - table[i][j]) * (row[j] - table[i][j]);
+	if (diff < *smallest_diff ||
+	    (diff == *smallest_diff && i < *closest_match)) {
+		*smallest_diff = diff;
+		*closest_match = i;
+	}
+}
+
+uint8_t st2205_find_closest_match(int table_no,
+	  int16_t *row, int *smallest_diff_ret)
+{
+	const st2205_lookup_row *table = st2205_lookup[table_no];
+	const struct st2205_sorted_table *sorted;
+	int lo, hi, mid, sum, d, closest_match = 0;
+	int lo_done = 0, hi_done = 0;
+	unsigned int smallest_diff = -1;
+
+	if (!st2205_sorted_initialized)
+		st2205_init_sorted_tables();
+	sorted = &st2205_sorted[table_no];
+
+	/*
+	 * The squared distance between two rows is at least
+	 * (sum1 - sum2)^2 / 8, so starting at the rows with the closest
+	 * sum we can stop walking in a direction once that bound is
+	 * larger than the best match found.
+	 */
+	sum = st2205_row_sum(row);
+	lo = 0;
+	hi = 256;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (sorted->sum[mid] < sum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	hi = lo;
+	lo = lo - 1;
+
+	while (!lo_done || !hi_done) {
+		if (!hi_done) {
+			if (hi > 255) {
+				hi_done = 1;
+			} else {
+				d = sorted->sum[hi] - sum;
+				if ((unsigned int)(d * d) / 8 > smallest_diff)
+					hi_done = 1;
+				else
+					st2205_check_match(table, sorted->index[hi++],
+						row, &smallest_diff, &closest_match);
+			}
+		}
+		if (!lo_done) {
+			if (lo < 0) {
+				lo_done = 1;
+			} else {
+				d = sum - sorted->sum[lo];
+				if ((unsigned int)(d * d) / 8 > smallest_diff)
+					lo_done = 1;
+				else
+					st2205_check_match(table, sorted->index[lo--],
+						row, &smallest_diff, &closest_match);
+			}
+		}
+	}
+
+	if (smallest_diff_ret)
+		*smallest_diff_ret = smallest_diff;
+
+	return closest_match;
+}
@@ -0,0 +1,115 @@
+/* test-search.c
+ *
+ * Compares st2205_find_closest_match() with the plain scan over all 256
+ * rows of a lookup table that the encoder used before the search was
+ * pruned. Both must pick the same row, the lowest index of equally close
+ * ones, and report the same distance, for every table row, for rows close
+ * to table rows and for random rows.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "st2205.h"
+
+#define RANDOM_ROWS	100000
+
+static unsigned int seed = 1;
+
+static int
+rnd (int range)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 16) & 0x7fff) % range;
+}
+
+/* The search as it was before it was pruned */
+static uint8_t
+full_scan (const st2205_lookup_row *table, int16_t *row, int *smallest_diff_ret)
+{
+	int i, j;
+	uint8_t closest_match = 0;
+	unsigned int diff, smallest_diff = -1;
+
+	for (i = 0; i < 256; i++) {
+		diff = 0;
+		for (j = 0; j < 8; j++)
+			diff += (row[j] - table[i][j]) * (row[j] - table[i][j]);
+		if (diff < smallest_diff) {
+			smallest_diff = diff;
+			closest_match = i;
+		}
+	}
+
+	*smallest_diff_ret = smallest_diff;
+	return closest_match;
+}
+
+static int
+check (int table_no, int16_t *row)
+{
+	int want_diff, diff, j;
+	uint8_t want, got;
+
+	want = full_scan (st2205_lookup[table_no], row, &want_diff);
+	got = st2205_find_closest_match (table_no, row, &diff);
+	if (got != want || diff != want_diff) {
+		printf ("FAIL: table %d row", table_no);
+		for (j = 0; j < 8; j++)
+			printf (" %d", row[j]);
+		printf (": got %d (diff %d), expected %d (diff %d)\n",
+			got, diff, want, want_diff);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main (void)
+{
+	int16_t row[8];
+	int t, i, j, n = 0;
+
+	for (t = 0; t < 3; t++) {
+		/* the table rows themselves, and rows close to them */
+		for (i = 0; i < 256; i++) {
+			for (j = 0; j < 8; j++)
+				row[j] = st2205_lookup[t][i][j];
+			if (check (t, row))
+				return 1;
+			for (j = 0; j < 8; j++)
+				row[j] = st2205_lookup[t][i][j] + rnd (9) - 4;
+			if (check (t, row))
+				return 1;
+			n += 2;
+		}
+		/* anything the encoder can pass in, luma and chroma
+		   differences from the block base stay within -128..127 */
+		for (i = 0; i < RANDOM_ROWS; i++) {
+			for (j = 0; j < 8; j++)
+				row[j] = rnd (256) - 128;
+			if (check (t, row))
+				return 1;
+			n++;
+		}
+	}
+
+	printf ("%d rows searched, same matches as the full scan\n", n);
+	return 0;
+}
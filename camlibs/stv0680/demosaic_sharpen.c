@@ -231,121 +231,209 @@ static const bayer_desc bayers[4][4] = {
 
 /* Use integer arithmetic. Accuracy is 10^-6, which is good enough */
 #define SHIFT 20
-static inline int weight (const unsigned char dx, const int alpha)
+
+void demosaic_sharpen_init (DemosaicSharpen * const ds,
+			    const int width, const int height,
+			    const unsigned char * const src_region,
+			    const int alpha, const BayerTile bt)
 {
-	return (1<<SHIFT)/(alpha + dx);
+	int dx;
+
+	ds->width = width;
+	ds->height = height;
+	ds->src_region = src_region;
+	ds->tile = bt & 3; /* Don't care about interlace */
+	/* less strong weighting for TLRB2 pattern */
+	for (dx = 0; dx < 256; dx++) {
+		ds->weight[0][dx] = (1<<SHIFT)/(alpha + dx);
+		ds->weight[1][dx] = (1<<SHIFT)/((alpha << 1) + dx);
+	}
 }
 
-/* alpha controls the strength of the weighting; 1 = strongest, 64 = weak */
-void demosaic_sharpen (const int width, const int height,
-		       const unsigned char * const src_region,
-		       unsigned char * const dest_region,
-		       const int alpha, const BayerTile bt)
+/* Points at least two pixels away from the border have all their
+ * neighbours, so the pattern tables can be written out: a green point
+ * (NB_DIAG) predicts from its left/right and top/bottom neighbours,
+ * a red or blue one (NB_TLRB2) from its direct and diagonal neighbours.
+ * The common factor 2 of DIAG_TO_LR, DIAG_TO_TB and TLRB2_TO_TLRB is
+ * left out, which does not change the quotients. */
+static inline void
+demosaic_pixel_inner (const DemosaicSharpen * const ds,
+		      const bayer_desc * const bd,
+		      const unsigned char * const p,
+		      unsigned char * const d)
 {
-	const unsigned char* src_ptr = src_region;
-	unsigned char* dst_ptr = dest_region;
-	const bayer_desc *bay_des = bayers [bt & 3]; /* Don't care about interlace */
-	int x, y;
+	const int c = bd->colour;
+	const long s = 3L * ds->width;
+	const int v = p[c];
+
+	d[c] = v;
+	if (bd->idx_pts[0] == NB_DIAG) {
+		const int * const wt = ds->weight[0];
+		const int tl = wt[abs (v - p[-s-3+c])];
+		const int tr = wt[abs (v - p[-s+3+c])];
+		const int bl = wt[abs (v - p[ s-3+c])];
+		const int br = wt[abs (v - p[ s+3+c])];
+		const int l = tl + bl, r = tr + br, t = tl + tr, b = bl + br;
+		const int clr = bd->idx_pts[1] == NB_LR ? (c+1)%3 : (c+2)%3;
+		const int ctb = 3 - c - clr;
 
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++, src_ptr += 3, dst_ptr += 3) {
-			/* 3 2 */
-			/* 1 0 */
-			const unsigned char bayer = (1^(x&1)) + ((1^(y&1))<<1);
-			const col colour = bay_des[bayer].colour;
-			/* nb_pat[0] is our own pattern */
-			const nb_pat * const nbpts = bay_des[bayer].idx_pts;
-			/* less strong weighting for TLRB2 pattern */
-			const int myalpha = (*nbpts == NB_TLRB2? (alpha << 1): alpha);
-			const unsigned char colval = src_ptr[colour];
-			int weights[4]; int sum_weights = 0.0;
-			patconv pconv;
-			/* Calc coeffs for prediction */
-			int nbs; col ncol; int othcol; int i;
-			int skno; int nsumw;
-			int predcol = 0; /*  Only for DEBUG */
-			/* DPRINTF("(%i,%i)(%p): bay %i, col %i, pat %i, val %i\n", x, y, src_ptr, bayer, colour, nbpts[0], colval);*/
-			/* Copy own colour */
-			dst_ptr[colour] = colval;
-			/* Now calc weights */
-			for (nbs = 0; nbs < 4; nbs++) {
-				const off offset = n_pos[nbpts[0]].nb_pts[nbs];
-				const int nx = x + offset.dx;
-				const int ny = y + offset.dy;
-				const signed long addr_off = 3 * (offset.dx + width * offset.dy);
-				unsigned char thisval = colval; int coeff = 0;
-				if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-					thisval = src_ptr[addr_off+colour];
-					coeff = weight (abs ((int)colval - thisval), myalpha);
-				} else if (nbpts[0] == NB_TLRB2 && x > 0 && x < width-1 && y > 0 && y < height-1) {
-					coeff = weight (128, myalpha); /* assign some small weight */
-				}
-				/*DPRINTF(" (%i,%i)(%p): val %i, diff %i, weight %i\n", nx, ny, src_ptr+addr_off, thisval, abs ((int)colval - thisval), coeff);*/
-				predcol += thisval * coeff;
-				weights[nbs] = coeff;
-				sum_weights += coeff;
-			};
+		d[clr] = (p[-3+clr] * l + p[3+clr] * r) / (l + r);
+		d[ctb] = (p[-s+ctb] * t + p[s+ctb] * b) / (t + b);
+	} else {
+		const int * const wt = ds->weight[1];
+		const int t = wt[abs (v - p[-2*s+c])];
+		const int l = wt[abs (v - p[-6+c])];
+		const int r = wt[abs (v - p[ 6+c])];
+		const int b = wt[abs (v - p[ 2*s+c])];
+		const int tl = t + l, tr = t + r, bl = l + b, br = r + b;
+		const int cx = bd->idx_pts[1] == NB_TLRB ? (c+1)%3 : (c+2)%3;
+		const int cd = 3 - c - cx;
+
+		d[cx] = (p[-s+cx] * t + p[-3+cx] * l + p[3+cx] * r
+			 + p[s+cx] * b) / (t + l + r + b);
+		d[cd] = (p[-s-3+cd] * tl + p[-s+3+cd] * tr + p[s-3+cd] * bl
+			 + p[s+3+cd] * br) / (tl + tr + bl + br);
+	}
+}
+
+static void
+demosaic_pixel (const DemosaicSharpen * const ds, const int x, const int y,
+		const unsigned char * const src_ptr,
+		unsigned char * const dst_ptr)
+{
+	const int width = ds->width, height = ds->height;
+	const bayer_desc *bay_des = bayers [ds->tile];
+	/* 3 2 */
+	/* 1 0 */
+	const unsigned char bayer = (1^(x&1)) + ((1^(y&1))<<1);
+	const col colour = bay_des[bayer].colour;
+	/* nb_pat[0] is our own pattern */
+	const nb_pat * const nbpts = bay_des[bayer].idx_pts;
+	/* less strong weighting for TLRB2 pattern */
+	const int * const wt = ds->weight[*nbpts == NB_TLRB2];
+	const unsigned char colval = src_ptr[colour];
+	int weights[4]; int sum_weights = 0.0;
+	patconv pconv;
+	/* Calc coeffs for prediction */
+	int nbs; col ncol; int othcol; int i;
+	int skno; int nsumw;
+	int predcol = 0; /*  Only for DEBUG */
+	/* DPRINTF("(%i,%i)(%p): bay %i, col %i, pat %i, val %i\n", x, y, src_ptr, bayer, colour, nbpts[0], colval);*/
+	/* Copy own colour */
+	dst_ptr[colour] = colval;
+	/* Now calc weights */
+	for (nbs = 0; nbs < 4; nbs++) {
+		const off offset = n_pos[nbpts[0]].nb_pts[nbs];
+		const int nx = x + offset.dx;
+		const int ny = y + offset.dy;
+		const signed long addr_off = 3 * (offset.dx + width * offset.dy);
+		unsigned char thisval = colval; int coeff = 0;
+		if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
+			thisval = src_ptr[addr_off+colour];
+			coeff = wt[abs ((int)colval - thisval)];
+		} else if (nbpts[0] == NB_TLRB2 && x > 0 && x < width-1 && y > 0 && y < height-1) {
+			coeff = wt[128]; /* assign some small weight */
+		}
+		/*DPRINTF(" (%i,%i)(%p): val %i, diff %i, weight %i\n", nx, ny, src_ptr+addr_off, thisval, abs ((int)colval - thisval), coeff);*/
+		predcol += thisval * coeff;
+		weights[nbs] = coeff;
+		sum_weights += coeff;
+	};
 #ifdef DEBUG
-			printf(" Coeffs:");
-			for (nbs = 0; nbs < 4; nbs++)
-				printf (" %6.4f", (double)weights[nbs]/sum_weights);
-			printf (" -> pred %i\n", predcol/sum_weights);
+	printf(" Coeffs:");
+	for (nbs = 0; nbs < 4; nbs++)
+		printf (" %6.4f", (double)weights[nbs]/sum_weights);
+	printf (" -> pred %i\n", predcol/sum_weights);
 #endif
-			/* Now calculate other colours */
-			ncol = (colour+1)%3;
-			pconv = pconvmap[nbpts[0]][nbpts[1]];
-			if (pconv == PATCONV_NONE)
-				abort ();
-			othcol = 0; predcol = 0; nsumw = 0; skno = 0;
-			/*DPRINTF(" Col %i: pat %i pconv %i\n", ncol, nbpts[1], pconv);*/
-			for (nbs = 0; nbs < n_pos[nbpts[1]].num; nbs++) {
-				off offset = n_pos[nbpts[1]].nb_pts[nbs];
-				const int nx = x + offset.dx;
-				const int ny = y + offset.dy;
-				const signed long addr_off = 3 * (offset.dx + width * offset.dy);
-				int eff_weight = 0; unsigned char thisval;
-				for (i = 0; i < 4; i++)
-					eff_weight += pat_to_pat[pconv].cf[nbs][i] * weights[i];
-				if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-					thisval = src_ptr[addr_off+ncol];
-					nsumw += eff_weight;
-					/*DPRINTF("  (%i,%i): val %i, eff_w %6.4f\n", nx, ny, thisval, (double)(eff_weight>>1)/sum_weights);*/
-					othcol  += thisval * eff_weight;
-					predcol += thisval;
-				} else {
-					skno++;
-				}
-			};
-			dst_ptr[ncol] = othcol/nsumw;
-			/*DPRINTF( " -> val %i (bilin: %i)\n", dst_ptr[ncol], predcol/(n_pos[nbpts[1]].num-skno));*/
-			/* Third colour */
-			ncol = (colour+2)%3;
-			pconv = pconvmap[nbpts[0]][nbpts[2]];
-			if (pconv == PATCONV_NONE)
-				abort ();
-			othcol = 0; predcol = 0; nsumw = 0; skno = 0;
-			/*DPRINTF(" Col %i: pat %i pconv %i\n", ncol, nbpts[2], pconv);*/
-			for (nbs = 0; nbs < n_pos[nbpts[2]].num; nbs++) {
-				off offset = n_pos[nbpts[2]].nb_pts[nbs];
-				const int nx = x + offset.dx;
-				const int ny = y + offset.dy;
-				const signed long addr_off = 3 * (offset.dx + width * offset.dy);
-				int eff_weight = 0; unsigned char thisval;
-				for (i = 0; i < 4; i++)
-					eff_weight += pat_to_pat[pconv].cf[nbs][i] * weights[i];
-				if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-					thisval = src_ptr[addr_off+ncol];
-					nsumw += eff_weight;
-					/*DPRINTF("  (%i,%i): val %i, eff_w %6.4f\n", nx, ny, thisval, (double)(eff_weight>>1)/sum_weights);*/
-					othcol  += thisval * eff_weight;
-					predcol += thisval;
-				} else {
-					skno++;
-				}
-			};
-			dst_ptr[ncol] = othcol/nsumw;
-			/*DPRINTF( " -> val %i (bilin: %i)\n", dst_ptr[ncol], predcol/(n_pos[nbpts[1]].num-skno));*/
+	/* Now calculate other colours */
+	ncol = (colour+1)%3;
+	pconv = pconvmap[nbpts[0]][nbpts[1]];
+	if (pconv == PATCONV_NONE)
+		abort ();
+	othcol = 0; predcol = 0; nsumw = 0; skno = 0;
+	/*DPRINTF(" Col %i: pat %i pconv %i\n", ncol, nbpts[1], pconv);*/
+	for (nbs = 0; nbs < n_pos[nbpts[1]].num; nbs++) {
+		off offset = n_pos[nbpts[1]].nb_pts[nbs];
+		const int nx = x + offset.dx;
+		const int ny = y + offset.dy;
+		const signed long addr_off = 3 * (offset.dx + width * offset.dy);
+		int eff_weight = 0; unsigned char thisval;
+		for (i = 0; i < 4; i++)
+			eff_weight += pat_to_pat[pconv].cf[nbs][i] * weights[i];
+		if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
+			thisval = src_ptr[addr_off+ncol];
+			nsumw += eff_weight;
+			/*DPRINTF("  (%i,%i): val %i, eff_w %6.4f\n", nx, ny, thisval, (double)(eff_weight>>1)/sum_weights);*/
+			othcol  += thisval * eff_weight;
+			predcol += thisval;
+		} else {
+			skno++;
+		}
+	};
+	dst_ptr[ncol] = othcol/nsumw;
+	/*DPRINTF( " -> val %i (bilin: %i)\n", dst_ptr[ncol], predcol/(n_pos[nbpts[1]].num-skno));*/
+	/* Third colour */
+	ncol = (colour+2)%3;
+	pconv = pconvmap[nbpts[0]][nbpts[2]];
+	if (pconv == PATCONV_NONE)
+		abort ();
+	othcol = 0; predcol = 0; nsumw = 0; skno = 0;
+	/*DPRINTF(" Col %i: pat %i pconv %i\n", ncol, nbpts[2], pconv);*/
+	for (nbs = 0; nbs < n_pos[nbpts[2]].num; nbs++) {
+		off offset = n_pos[nbpts[2]].nb_pts[nbs];
+		const int nx = x + offset.dx;
+		const int ny = y + offset.dy;
+		const signed long addr_off = 3 * (offset.dx + width * offset.dy);
+		int eff_weight = 0; unsigned char thisval;
+		for (i = 0; i < 4; i++)
+			eff_weight += pat_to_pat[pconv].cf[nbs][i] * weights[i];
+		if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
+			thisval = src_ptr[addr_off+ncol];
+			nsumw += eff_weight;
+			/*DPRINTF("  (%i,%i): val %i, eff_w %6.4f\n", nx, ny, thisval, (double)(eff_weight>>1)/sum_weights);*/
+			othcol  += thisval * eff_weight;
+			predcol += thisval;
+		} else {
+			skno++;
 		}
+	};
+	dst_ptr[ncol] = othcol/nsumw;
+	/*DPRINTF( " -> val %i (bilin: %i)\n", dst_ptr[ncol], predcol/(n_pos[nbpts[1]].num-skno));*/
+}
+
+void demosaic_sharpen_row (const DemosaicSharpen * const ds, const int y,
+			   unsigned char * const dst_row)
+{
+	const int width = ds->width;
+	const unsigned char *src_ptr = ds->src_region + 3L * width * y;
+	unsigned char *dst_ptr = dst_row;
+	const bayer_desc * const bay_des = bayers [ds->tile];
+	int x;
+
+	if (y < 2 || y >= ds->height - 2 || width < 5) {
+		for (x = 0; x < width; x++, src_ptr += 3, dst_ptr += 3)
+			demosaic_pixel (ds, x, y, src_ptr, dst_ptr);
+		return;
 	}
+	for (x = 0; x < 2; x++, src_ptr += 3, dst_ptr += 3)
+		demosaic_pixel (ds, x, y, src_ptr, dst_ptr);
+	for (; x < width - 2; x++, src_ptr += 3, dst_ptr += 3)
+		demosaic_pixel_inner (ds, &bay_des[(1^(x&1)) + ((1^(y&1))<<1)],
+				      src_ptr, dst_ptr);
+	for (; x < width; x++, src_ptr += 3, dst_ptr += 3)
+		demosaic_pixel (ds, x, y, src_ptr, dst_ptr);
 }
 
+/* alpha controls the strength of the weighting; 1 = strongest, 64 = weak */
+void demosaic_sharpen (const int width, const int height,
+		       const unsigned char * const src_region,
+		       unsigned char * const dest_region,
+		       const int alpha, const BayerTile bt)
+{
+	DemosaicSharpen ds;
+	int y;
+
+	demosaic_sharpen_init (&ds, width, height, src_region, alpha, bt);
+	for (y = 0; y < height; y++)
+		demosaic_sharpen_row (&ds, y, dest_region + 3L * width * y);
+}
@@ -6,6 +6,21 @@
 
 #include "libgphoto2/bayer-types.h"
 
+typedef struct _DemosaicSharpen {
+	int width, height;
+	const unsigned char *src_region;
+	int tile;
+	/* weight[0] for alpha, weight[1] for 2 * alpha, by colour difference */
+	int weight[2][256];
+} DemosaicSharpen;
+
+/* Row at a time interface, for feeding the sharpen filter directly */
+void demosaic_sharpen_init (DemosaicSharpen *ds,
+			    const int width, const int height,
+			    const unsigned char * const src_region,
+			    const int alpha, const BayerTile bt);
+void demosaic_sharpen_row (const DemosaicSharpen *ds, const int y,
+			   unsigned char * const dst_row);
 
 void demosaic_sharpen (const int width, const int height,
 		       const unsigned char * const src_region,
@@ -224,13 +224,19 @@ int stv0680_get_image_raw(GPPort *port, int image_no, CameraFile *file)
 	return GP_OK;
 }
 
+static void demosaic_row(void *data, int y, unsigned char *row)
+{
+	demosaic_sharpen_row(data, y, row);
+}
+
 int stv0680_get_image(GPPort *port, int image_no, CameraFile *file)
 {
 	struct stv680_image_header imghdr;
 	char header[200];
 	unsigned char buf[16];
-	unsigned char *raw, *tmpdata1, *tmpdata2, *data;
+	unsigned char *raw, *bayer, *data;
 	int h,w,ret,coarse,fine,size;
+	DemosaicSharpen ds;
 
 	/* Despite the documentation saying so, CMDID_UPLOAD_IMAGE does not
 	 * return an image_header. The first 8 byte are correct, but the
@@ -266,27 +272,20 @@ int stv0680_get_image(GPPort *port, int image_no, CameraFile *file)
 		free (raw);
 		return GP_ERROR_NO_MEMORY;
 	}
-	tmpdata1 = malloc(size * 3);
-	if (!tmpdata1) {
-		free (raw);
-		free (data);
-		return GP_ERROR_NO_MEMORY;
-	}
-	tmpdata2 = malloc(size * 3);
-	if (!tmpdata2) {
+	bayer = malloc(size * 3);
+	if (!bayer) {
 		free (raw);
 		free (data);
-		free (tmpdata1);
 		return GP_ERROR_NO_MEMORY;
 	}
-	gp_bayer_expand (raw, w, h, tmpdata1, BAYER_TILE_GBRG_INTERLACED);
-	light_enhance(w,h,coarse,imghdr.avg_pixel_value,fine,tmpdata1);
-	/* gp_bayer_interpolate (tmpdata1, w, h, BAYER_TILE_GBRG_INTERLACED); */
-	stv680_hue_saturation (w, h, tmpdata1, tmpdata2 );
-	demosaic_sharpen (w, h, tmpdata2, tmpdata1, 2, BAYER_TILE_GBRG_INTERLACED);
-	sharpen (w, h, tmpdata1, data, 16);
-	free(tmpdata2);
-	free(tmpdata1);
+	gp_bayer_expand (raw, w, h, bayer, BAYER_TILE_GBRG_INTERLACED);
+	light_enhance(w,h,coarse,imghdr.avg_pixel_value,fine,bayer);
+	/* gp_bayer_interpolate (bayer, w, h, BAYER_TILE_GBRG_INTERLACED); */
+	stv680_hue_saturation (w, h, bayer, bayer);
+	/* The sharpen filter pulls its rows straight out of the demosaicing */
+	demosaic_sharpen_init (&ds, w, h, bayer, 2, BAYER_TILE_GBRG_INTERLACED);
+	sharpen_rows (w, h, demosaic_row, &ds, data, 16);
+	free(bayer);
 	free(raw);
 	gp_file_append(file, (char *)data, 3*size);
 	free(data);
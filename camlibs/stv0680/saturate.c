@@ -230,18 +230,59 @@ static void hue_saturation_update (HueSaturationDialog *hsd)
     }
 }
 
+static void hue_saturation_pixel (HueSaturationDialog *hsd,
+				  const unsigned char *s, unsigned char *d)
+{
+  int r, g, b;
+  int hue;
+
+  r = s[RED_PIX];
+  g = s[GREEN_PIX];
+  b = s[BLUE_PIX];
+
+  gimp_rgb_to_hls (&r, &g, &b);
+
+  if (r < 43)
+    hue = 0;
+  else if (r < 85)
+    hue = 1;
+  else if (r < 128)
+    hue = 2;
+  else if (r < 171)
+    hue = 3;
+  else if (r < 213)
+    hue = 4;
+  else
+    hue = 5;
+
+  r = hsd->hue_transfer[hue][r];
+  g = hsd->lightness_transfer[hue][g];
+  b = hsd->saturation_transfer[hue][b];
+
+  gimp_hls_to_rgb (&r, &g, &b);
+
+  d[RED_PIX] = r;
+  d[GREEN_PIX] = g;
+  d[BLUE_PIX] = b;
+}
+
 /********************************  */
+/* srcPR and destPR may be the same buffer */
 void stv680_hue_saturation(
     int width, int height, unsigned char *srcPR, unsigned char *destPR
 ) {
-    unsigned char *src, *s;
-    unsigned char *dest, *d;
-    int w, h;
-    int r, g, b;
-    int hue;
+    unsigned char *s, *d;
+    unsigned char in[3];
+    long n;
+    int c, v;
 
     /*  the hue-saturation tool dialog  */
     HueSaturationDialog hsd;
+    /*  Results for pixels with at most one colour set, indexed by the
+     *  colour and its value. This is all the bayer expanded images the
+     *  driver passes in contain, so the floating point conversion is
+     *  only needed for the others. */
+    unsigned char single[3][256][3];
 
     memset(&hsd, 0, sizeof(hsd));
 
@@ -253,50 +294,33 @@ void stv680_hue_saturation(
     hue_saturation_update(&hsd);
 
     /*  Set the transfer arrays  (for speed)  */
-    h = height;
-    src = srcPR;
-    dest = destPR;
-
-  while (h--)
-    {
-      w = width;
-      s = src;
-      d = dest;
-      while (w--)
+    for (c = 0; c < 3; c++)
+      for (v = 0; v < 256; v++)
 	{
-	  r = s[RED_PIX];
-	  g = s[GREEN_PIX];
-	  b = s[BLUE_PIX];
-
-	  gimp_rgb_to_hls (&r, &g, &b);
-
-	  if (r < 43)
-	    hue = 0;
-	  else if (r < 85)
-	    hue = 1;
-	  else if (r < 128)
-	    hue = 2;
-	  else if (r < 171)
-	    hue = 3;
-	  else if (r < 213)
-	    hue = 4;
-	  else
-	    hue = 5;
-
-	  r = hsd.hue_transfer[hue][r];
-	  g = hsd.lightness_transfer[hue][g];
-	  b = hsd.saturation_transfer[hue][b];
-
-	  gimp_hls_to_rgb (&r, &g, &b);
-
-	  d[RED_PIX] = r;
-	  d[GREEN_PIX] = g;
-	  d[BLUE_PIX] = b;
-
-	  s += 3;   /* bytes/pixel = 3  */
-	  d += 3;
+	  in[0] = in[1] = in[2] = 0;
+	  in[c] = v;
+	  hue_saturation_pixel (&hsd, in, single[c][v]);
 	}
-      src += 3*width;
-      dest += 3*width;
-    }
+
+    s = srcPR;
+    d = destPR;
+    for (n = (long) width * height; n > 0; n--, s += 3, d += 3)
+      {
+	const unsigned char *t;
+
+	if (!s[GREEN_PIX] && !s[BLUE_PIX])
+	  t = single[RED_PIX][s[RED_PIX]];
+	else if (!s[RED_PIX] && !s[BLUE_PIX])
+	  t = single[GREEN_PIX][s[GREEN_PIX]];
+	else if (!s[RED_PIX] && !s[GREEN_PIX])
+	  t = single[BLUE_PIX][s[BLUE_PIX]];
+	else
+	  {
+	    hue_saturation_pixel (&hsd, s, d);
+	    continue;
+	  }
+	d[RED_PIX] = t[RED_PIX];
+	d[GREEN_PIX] = t[GREEN_PIX];
+	d[BLUE_PIX] = t[BLUE_PIX];
+      }
 }
@@ -23,6 +23,7 @@
  * Contents:
  *
  *   sharpen()                 - Sharpen an image using a median filter.
+ *   sharpen_rows()            - Sharpen rows produced by a callback.
  *   rgb_filter()              - Sharpen RGB pixels.
  *
  * Revision History:
@@ -61,11 +62,11 @@ static void rgb_filter (int    width,	/* I - Width of line in pixels */
 		 int    *neg_lut,
  	         unsigned char *src,	/* I - Source line */
 	         unsigned char *dst,	/* O - Destination line */
-		long int *neg0,	/* I - Top negative coefficient line */
-		long int *neg1,	/* I - Middle negative coefficient line */
-		long int *neg2)	/* I - Bottom negative coefficient line */
+		int *neg0,	/* I - Top negative coefficient line */
+		int *neg1,	/* I - Middle negative coefficient line */
+		int *neg2)	/* I - Bottom negative coefficient line */
 {
-  long int pixel;		/* New pixel value */
+  int pixel;		/* New pixel value */
 
   *dst++ = *src++;
   *dst++ = *src++;
@@ -118,15 +119,16 @@ static void rgb_filter (int    width,	/* I - Width of line in pixels */
   *dst++ = *src++;
 }
 
-/** 'sharpen()' - Sharpen an image using a convolution filter. **/
-void  sharpen(int width, int height,
-	unsigned char *src_region, unsigned char *dest_region,
+/** 'sharpen_rows()' - Sharpen an image using a convolution filter,
+ ** fetching each source row from 'get_row' just before it is needed. **/
+void  sharpen_rows(int width, int height,
+	sharpen_get_row get_row, void *data, unsigned char *dest_region,
 	int sharpen_percent
 ) {
     unsigned char   *src_rows[4],	/* Source pixel rows */
 		    *src_ptr,		/* Current source pixel */
 		    *dst_row;		/* Destination pixel row */
-    long int	*neg_rows[4],	/* Negative coefficient rows */
+    int		*neg_rows[4],	/* Negative coefficient rows */
 		*neg_ptr;	/* Current negative coefficient */
     int		i,		/* Looping vars */
 		y,		/* Current location in image */
@@ -143,13 +145,13 @@ void  sharpen(int width, int height,
     for (row = 0; row < 4; row ++)
     {
     	    src_rows[row] = new (unsigned char, pitch);
-	    neg_rows[row] = new (long int, pitch);
+	    neg_rows[row] = new (int, pitch);
     }
 
     dst_row = new (unsigned char, pitch);
 
     /** Pre-load the first row for the filter...  **/
-    memcpy(src_rows[0], src_region, pitch);
+    get_row(data, 0, src_rows[0]);
 
     for (i = pitch, src_ptr = src_rows[0], neg_ptr = neg_rows[0];
 	 i > 0;   i --, src_ptr ++, neg_ptr ++)
@@ -170,7 +172,7 @@ void  sharpen(int width, int height,
 		count --;
 
 	    /** Grab the next row... **/
-	    memcpy(src_rows[row], (src_region + pitch*(y+1)), pitch);
+	    get_row(data, y + 1, src_rows[row]);
 
 	    for (i = pitch, src_ptr = src_rows[row], neg_ptr = neg_rows[row];
 		 i > 0;  i --, src_ptr ++, neg_ptr ++)
@@ -214,3 +216,28 @@ void  sharpen(int width, int height,
     }
     free (dst_row);
 }
+
+struct region {
+    unsigned char *src;
+    int pitch;
+};
+
+static void get_region_row (void *data, int y, unsigned char *row)
+{
+    struct region *r = data;
+
+    memcpy(row, r->src + r->pitch*y, r->pitch);
+}
+
+/** 'sharpen()' - Sharpen an image using a convolution filter. **/
+void  sharpen(int width, int height,
+	unsigned char *src_region, unsigned char *dest_region,
+	int sharpen_percent
+) {
+    struct region r;
+
+    r.src = src_region;
+    r.pitch = width * 3;
+    sharpen_rows(width, height, get_region_row, &r, dest_region,
+		 sharpen_percent);
+}
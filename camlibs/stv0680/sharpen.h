@@ -6,4 +6,12 @@ void  sharpen(int width, int height,
 	int sharpen_percent
 );
 
+/* Fills 'row' with the 3 * width bytes of source row 'y' */
+typedef void (*sharpen_get_row)(void *data, int y, unsigned char *row);
+
+void  sharpen_rows(int width, int height,
+	sharpen_get_row get_row, void *data, unsigned char *dest_region,
+	int sharpen_percent
+);
+
 #endif /* !defined(CAMLIBS_STV0680_SHARPEN_H) */
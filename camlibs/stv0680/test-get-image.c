@@ -0,0 +1,168 @@
+/* test-get-image.c
+ *
+ * Runs stv0680_get_image() on synthetic sensor dumps served by a stand-in
+ * for the USB port functions, and compares a hash of each developed image
+ * with the one the unfused pipeline (separate expand, light_enhance,
+ * hue/saturation, demosaic_sharpen and sharpen passes) produced for the
+ * same dump. Run with any argument to print the hashes instead.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <gphoto2/gphoto2.h>
+
+#include "stv0680.h"
+#include "library.h"
+
+#define NSIZES	6
+#define NKINDS	6
+
+static const int sizes[NSIZES][2] = {
+	{ 352, 288 }, { 176, 144 }, { 33, 17 }, { 7, 5 }, { 5, 7 }, { 4, 4 }
+};
+
+/* FNV-1a of the developed images of the unfused pipeline */
+static const uint32_t golden[NSIZES][NKINDS] = {
+	{ 0x664937b6, 0x6638a1dc, 0xf0bb55e7, 0xafdbcc93, 0x8b27891d, 0xf6c9aee6 },
+	{ 0x048ec221, 0x5e2edfcc, 0x12a66b68, 0x293af2a5, 0xc7bc893d, 0x8d95edb2 },
+	{ 0x26d1199b, 0x5ac1b30b, 0xf8473e67, 0xe795062b, 0x14be5d6e, 0x2ca3db2d },
+	{ 0x7e6c8f1b, 0x4319c4aa, 0xc404d5d2, 0xff9f847f, 0x2f726f52, 0x6f2632e0 },
+	{ 0x45957ac1, 0x73cd9efd, 0xbbc5922e, 0xff9f847f, 0xcce28aa7, 0x98e44e66 },
+	{ 0xfe58c5c6, 0x00816131, 0xde6cb502, 0xc655ff85, 0x7385b1c4, 0x763754d5 },
+};
+
+static int		width, height, kind;
+static unsigned int	seed;
+
+static int
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* smooth with noise, noise, gradient, checkerboard, one colour, flat */
+static unsigned char
+sensor (int x, int y)
+{
+	int v;
+
+	switch (kind) {
+	case 0:	v = 128 + 100 * sin (x / 17.0) * cos (y / 23.0) + (rnd () % 21 - 10) +
+		    (((x / 40 + y / 40) & 1) ? 30 : -30);
+		break;
+	case 1:	v = rnd () & 255; break;
+	case 2:	v = x * 255 / (width > 1 ? width - 1 : 1); break;
+	case 3:	v = ((x / 8 + y / 8) & 1) ? 255 : 0; break;
+	case 4:	v = ((x % 2 == 0) && (y % 2 == 1)) ? 250 : 10; break;
+	default: v = 200 + rnd () % 7; break;
+	}
+	return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/* The camera side: the image header, the upload command and the sensor
+ * dump of the current image */
+int
+gp_port_usb_msg_read (GPPort *port, int request, int value, int index,
+		      char *bytes, int size)
+{
+	struct stv680_image_header *hdr = (struct stv680_image_header *)bytes;
+	int n = width * height;
+
+	memset (bytes, 0, size);
+	if (request == CMDID_GET_IMAGE_HEADER) {
+		hdr->size[0] = n >> 24;
+		hdr->size[1] = n >> 16;
+		hdr->size[2] = n >> 8;
+		hdr->size[3] = n;
+		hdr->width[0] = width >> 8;
+		hdr->width[1] = width;
+		hdr->height[0] = height >> 8;
+		hdr->height[1] = height;
+		hdr->fine_exposure[1] = kind * 40 + 3;
+		hdr->coarse_exposure[0] = (kind * 90) >> 8;
+		hdr->coarse_exposure[1] = kind * 90;
+		hdr->avg_pixel_value = 40 + kind * 20;
+		hdr->flags = IMAGE_IS_VALID;
+	}
+	return size;
+}
+
+int
+gp_port_usb_msg_write (GPPort *port, int request, int value, int index,
+		       char *bytes, int size)
+{
+	return size;
+}
+
+int
+gp_port_read (GPPort *port, char *data, int size)
+{
+	int i;
+
+	seed = kind * 31 + width;
+	for (i = 0; i < size && i < width * height; i++)
+		data[i] = sensor (i % width, i / width);
+	return i;
+}
+
+int
+main (int argc, char **argv)
+{
+	GPPort		port;
+	CameraFile	*file;
+	const char	*data;
+	unsigned long	size, i;
+	uint32_t	hash;
+	int		s, failed = 0;
+
+	memset (&port, 0, sizeof (port));
+	port.type = GP_PORT_USB;
+	for (s = 0; s < NSIZES; s++) {
+		for (kind = 0; kind < NKINDS; kind++) {
+			width = sizes[s][0];
+			height = sizes[s][1];
+			gp_file_new (&file);
+			if (stv0680_get_image (&port, 0, file) != GP_OK) {
+				printf ("FAIL: %dx%d kind %d: no image\n", width, height, kind);
+				return 1;
+			}
+			gp_file_get_data_and_size (file, &data, &size);
+			/* the RGB data follows the PPM header */
+			data += size - width * height * 3;
+			hash = 2166136261u;
+			for (i = 0; i < (unsigned long)width * height * 3; i++)
+				hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+			gp_file_unref (file);
+			if (argc > 1) {
+				printf ("0x%08x%s", hash, (kind < NKINDS - 1) ? ", " : "\n");
+			} else if (hash != golden[s][kind]) {
+				printf ("FAIL: %dx%d kind %d: hash 0x%08x, expected 0x%08x\n",
+					width, height, kind, hash, golden[s][kind]);
+				failed++;
+			}
+		}
+	}
+	if (argc == 1 && !failed)
+		printf ("%d images developed as before\n", NSIZES * NKINDS);
+	return failed ? 1 : 0;
+}
@@ -411,6 +411,24 @@ int gp_camera_wait_for_event     (Camera *camera, int timeout,
 int gp_camera_get_storageinfo    (Camera *camera, CameraStorageInformation**,
 				   int *, GPContext *context);
 
+/**
+ * \brief Timing of a frame returned by gp_camera_capture_preview_ex().
+ *
+ * All times are in microseconds.
+ */
+typedef struct _CameraPreviewInfo {
+	unsigned long	size;		/**< \brief Size of the frame in bytes. */
+	unsigned int	total_usec;	/**< \brief Time spent fetching the frame, without governor_usec. */
+	unsigned int	transfer_usec;	/**< \brief Time spent in the driver apart from busy waits, mostly the transfer. */
+	unsigned int	wait_usec;	/**< \brief Time the driver waited for the camera to have a frame ready. */
+	unsigned int	busy;		/**< \brief How often the camera answered that no frame was ready yet. */
+	unsigned int	governor_usec;	/**< \brief Time slept before fetching, to keep the requested frame rate. */
+} CameraPreviewInfo;
+
+int gp_camera_capture_preview_ex (Camera *camera, CameraFile *file,
+				  unsigned int fps, CameraPreviewInfo *info,
+				  GPContext *context);
+
 /**@}*/
 
 
@@ -450,8 +468,39 @@ int gp_camera_file_read		(Camera *camera, const char *folder, const char *file,
 		    		 CameraFileType type,
 		    		 uint64_t offset, char *buf, uint64_t *size,
 		    		 GPContext *context);
+int gp_camera_file_get_resume	(Camera *camera, const char *folder,
+				 const char *file, CameraFileType type,
+				 CameraFile *camera_file, uint64_t offset,
+				 GPContext *context);
 int gp_camera_file_delete     	(Camera *camera, const char *folder,
 				 const char *file, GPContext *context);
+
+/**
+ * \brief Flags for gp_camera_download_batch().
+ */
+typedef enum {
+	GP_DOWNLOAD_BATCH_SKIP_EXISTING	= 1 << 0, /**< \brief Do not overwrite files already in the destination directory. */
+	GP_DOWNLOAD_BATCH_STOP_ON_ERROR	= 1 << 1  /**< \brief Stop at the first file that fails. */
+} CameraDownloadBatchFlags;
+
+/**
+ * \brief Called by gp_camera_download_batch() for every finished file.
+ *
+ * \param camera the #Camera
+ * \param index the index of the file in the array passed to gp_camera_download_batch()
+ * \param path the camera path of the file
+ * \param result #GP_OK or the error the download of this file failed with
+ * \param data the data passed to gp_camera_download_batch()
+ */
+typedef void (* CameraDownloadBatchFunc) (Camera *camera, unsigned int index,
+					  const CameraFilePath *path,
+					  int result, void *data);
+int gp_camera_download_batch	(Camera *camera, const CameraFilePath *paths,
+				 unsigned int count, const char *dest_dir,
+				 int flags, CameraDownloadBatchFunc func,
+				 void *data, GPContext *context);
+int gp_camera_folder_prefetch_previews (Camera *camera, const char *folder,
+				 uint64_t max_bytes, GPContext *context);
 /**@}*/
 
 
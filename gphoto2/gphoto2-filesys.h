@@ -251,6 +251,12 @@ int gp_filesystem_set_file_noop    (CameraFilesystem *fs,
 				    CameraFile *file, GPContext *context);
 int gp_filesystem_delete_file_noop (CameraFilesystem *fs, const char *folder,
 				    const char *filename, GPContext *context);
+int gp_filesystem_remove_file_cached   (CameraFilesystem *fs, const char *folder,
+					const char *filename, GPContext *context);
+int gp_filesystem_add_folder_cached    (CameraFilesystem *fs, const char *folder,
+					const char *name, GPContext *context);
+int gp_filesystem_remove_folder_cached (CameraFilesystem *fs, const char *folder,
+					const char *name, GPContext *context);
 int gp_filesystem_reset            (CameraFilesystem *fs);
 
 /* Information retrieval */
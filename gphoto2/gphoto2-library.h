@@ -73,6 +73,12 @@ int camera_id		(CameraText *id);
 int camera_abilities 	(CameraAbilitiesList *list);
 int camera_init 	(Camera *camera, GPContext *context);
 
+/*
+ * For camera libraries: waits in capture_preview while the camera has no
+ * frame ready yet, see gp_camera_capture_preview_ex().
+ */
+int gp_camera_preview_wait (Camera *camera, unsigned int usec);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
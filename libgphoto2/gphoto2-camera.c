@@ -31,12 +31,19 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <utime.h>
 
 #include <ltdl.h>
 
 #include <gphoto2/gphoto2-result.h>
 #include <gphoto2/gphoto2-library.h>
+#include <gphoto2/gphoto2-setting.h>
 #include <gphoto2/gphoto2-port-log.h>
+#include <gphoto2/gphoto2-port-portability.h>
 
 #include "libgphoto2/i18n.h"
 
@@ -225,6 +232,11 @@ struct _CameraPrivateCore {
 	void                  *timeout_data;
 	unsigned int          *timeout_ids;
 	unsigned int           timeout_ids_len;
+
+	/* Frame pacing, see gp_camera_capture_preview_ex() */
+	CameraPreviewInfo     *preview_info;
+	unsigned int           preview_interval;
+	struct timeval         preview_due;
 };
 
 
@@ -287,6 +299,9 @@ gp_camera_exit (Camera *camera, GPContext *context)
 
 	gp_filesystem_reset (camera->fs);
 
+	/* Write back what the driver stored in the settings */
+	gp_setting_flush ();
+
 	return exit_result;
 }
 
@@ -1397,6 +1412,144 @@ gp_camera_capture_preview (Camera *camera, CameraFile *file, GPContext *context)
 }
 
 
+/* how long the frame rate governor sleeps between looks at the context */
+#define PREVIEW_CANCEL_SLICE	10000
+
+static long
+usec_between (const struct timeval *from, const struct timeval *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_usec - from->tv_usec);
+}
+
+/**
+ * Captures a preview and reports how long it took.
+ *
+ * @param camera a #Camera
+ * @param file a #CameraFile
+ * @param fps the frame rate to keep, or 0
+ * @param info a #CameraPreviewInfo, or NULL
+ * @param context a #GPContext
+ * @return a gphoto2 error code
+ *
+ * Works like gp_camera_capture_preview(), and fills in info with the size of
+ * the frame and where the time went: transfer, waiting for a busy camera,
+ * and pacing.
+ *
+ * If fps is not 0, the calls are paced to that frame rate. A call made
+ * before the next frame is due sleeps until then, so a live view loop can
+ * just call this function again after processing a frame. While the camera
+ * has no frame ready yet, it is polled at a quarter of the frame interval
+ * instead of the driver's back-off, see gp_camera_preview_wait(). A caller
+ * falling behind by more than one frame restarts the schedule instead of
+ * catching up with a burst. The sleep ends early with #GP_ERROR_CANCEL
+ * if the context is cancelled, without fetching a frame.
+ *
+ **/
+int
+gp_camera_capture_preview_ex (Camera *camera, CameraFile *file,
+			      unsigned int fps, CameraPreviewInfo *info,
+			      GPContext *context)
+{
+	CameraPreviewInfo	 dummy;
+	struct timeval		 start, end;
+	unsigned long		 size;
+	long			 ahead;
+	int			 ret;
+
+	C_PARAMS (camera && file);
+
+	if (!info)
+		info = &dummy;
+	memset (info, 0, sizeof (*info));
+
+	gettimeofday (&start, NULL);
+	if (fps) {
+		unsigned int interval = 1000000 / fps;
+
+		if (camera->pc->preview_interval != interval) {
+			camera->pc->preview_interval = interval;
+			camera->pc->preview_due = start;
+		}
+		ahead = usec_between (&start, &camera->pc->preview_due);
+		if ((ahead < -(long)interval) || (ahead > (long)interval)) {
+			/* behind by more than a frame, or the clock jumped */
+			camera->pc->preview_due = start;
+			ahead = 0;
+		}
+		while (ahead > 0) {
+			/* sleep in slices, to notice a cancel in time */
+			if (gp_context_cancel (context) == GP_CONTEXT_FEEDBACK_CANCEL)
+				return (GP_ERROR_CANCEL);
+			usleep ((ahead < PREVIEW_CANCEL_SLICE) ? ahead : PREVIEW_CANCEL_SLICE);
+			gettimeofday (&end, NULL);
+			info->governor_usec += usec_between (&start, &end);
+			start = end;
+			ahead = usec_between (&start, &camera->pc->preview_due);
+		}
+		camera->pc->preview_due.tv_usec += interval;
+		camera->pc->preview_due.tv_sec  += camera->pc->preview_due.tv_usec / 1000000;
+		camera->pc->preview_due.tv_usec %= 1000000;
+	} else
+		camera->pc->preview_interval = 0;
+
+	camera->pc->preview_info = info;
+	ret = gp_camera_capture_preview (camera, file, context);
+	camera->pc->preview_info = NULL;
+
+	gettimeofday (&end, NULL);
+	info->total_usec = usec_between (&start, &end);
+	info->transfer_usec = info->total_usec > info->wait_usec ?
+			      info->total_usec - info->wait_usec : 0;
+	if ((ret == GP_OK) && (gp_file_get_data_and_size (file, NULL, &size) == GP_OK))
+		info->size = size;
+	return ret;
+}
+
+/**
+ * Waits before asking the camera for a preview frame again.
+ *
+ * @param camera a #Camera
+ * @param usec how long the driver would wait, in microseconds
+ * @return a gphoto2 error code
+ *
+ * For use by drivers in their capture_preview function, in place of
+ * sleeping, when the camera answered that no frame is ready yet. The wait
+ * is accounted in the #CameraPreviewInfo of gp_camera_capture_preview_ex().
+ * If a frame rate was requested there, the camera is polled every quarter
+ * of the frame interval for the first frame interval. A camera that stays
+ * busy longer gets the driver's own back-off.
+ *
+ * Returns 1 if the wait was cut short that way. A driver that counts its
+ * tries should not count this one, so that its retry budget still covers
+ * as much time as before.
+ *
+ **/
+int
+gp_camera_preview_wait (Camera *camera, unsigned int usec)
+{
+	CameraPreviewInfo	*info;
+	struct timeval		 start, end;
+	unsigned int		 interval;
+	int			 short_wait;
+
+	C_PARAMS (camera && camera->pc);
+
+	info = camera->pc->preview_info;
+	interval = camera->pc->preview_interval;
+	short_wait = info && interval && (info->wait_usec < interval) && (usec > interval / 4);
+	if (short_wait)
+		usec = interval / 4;
+	gettimeofday (&start, NULL);
+	usleep (usec);
+	gettimeofday (&end, NULL);
+	if (info) {
+		info->busy++;
+		info->wait_usec += usec_between (&start, &end);
+	}
+	return (short_wait ? 1 : GP_OK);
+}
+
+
 /**
  * Wait and retrieve an event from the camera.
  *
@@ -1723,6 +1876,526 @@ gp_camera_file_read (Camera *camera, const char *folder, const char *file,
 	return (GP_OK);
 }
 
+/* Size of the chunks gp_camera_file_get_resume() requests from the driver */
+#define RESUME_CHUNK_SIZE	(1024*1024)
+
+/**
+ * Continues the download of a file from the #Camera at a given offset.
+ *
+ * @param camera a #Camera
+ * @param folder a folder
+ * @param file the name of a file
+ * @param type the #CameraFileType
+ * @param camera_file a #CameraFile already holding the first \c offset bytes
+ * @param offset the offset into the camera file to continue from
+ * @param context a #GPContext
+ * @return a gphoto2 error code
+ *
+ * The file is read in chunks using the partial read support of the driver
+ * (see gp_camera_file_read()) and every chunk is appended to \c camera_file,
+ * which is not cleaned beforehand. This is meant for #CameraFile objects
+ * created with gp_file_new_from_fd() whose descriptor is positioned at the
+ * end of the data received so far: if the download fails again, the data
+ * already received stays in the file and the caller can retry with the new
+ * offset instead of starting over from byte 0.
+ *
+ * If the size of the file is known, chunks are read until it is complete,
+ * and a file that ends early is an error. Otherwise the first chunk that
+ * comes back short ends the download.
+ *
+ * Drivers without partial read support return #GP_ERROR_NOT_SUPPORTED.
+ *
+ **/
+int
+gp_camera_file_get_resume (Camera *camera, const char *folder, const char *file,
+			   CameraFileType type, CameraFile *camera_file,
+			   uint64_t offset, GPContext *context)
+{
+	CameraFileInfo	info;
+	uint64_t	start = offset, total = 0, size;
+	unsigned int	id = 0;
+	char		*buf;
+	int		result;
+
+	GP_LOG_D ("Resuming file '%s' in folder '%s' at offset %lu...",
+		  file, folder, (unsigned long)offset);
+
+	C_PARAMS (camera && folder && file && camera_file);
+	CHECK_INIT (camera, context);
+
+	/* Did we get reasonable foldername/filename? */
+	if (strlen (folder) == 0) {
+		CAMERA_UNUSED (camera, context);
+		return (GP_ERROR_DIRECTORY_NOT_FOUND);
+	}
+	if (strlen (file) == 0) {
+		CAMERA_UNUSED (camera, context);
+		return (GP_ERROR_FILE_NOT_FOUND);
+	}
+
+	CHECK_OPEN (camera, context);
+
+	buf = malloc (RESUME_CHUNK_SIZE);
+	if (!buf) {
+		CHECK_CLOSE (camera, context);
+		CAMERA_UNUSED (camera, context);
+		return (GP_ERROR_NO_MEMORY);
+	}
+
+	/* With the size known, a short chunk does not mean the end of the
+	 * file, the driver may return less than asked for at any point */
+	if ((type == GP_FILE_TYPE_NORMAL) &&
+	    (gp_filesystem_get_info (camera->fs, folder, file, &info,
+				     context) == GP_OK) &&
+	    (info.file.fields & GP_FILE_INFO_SIZE) &&
+	    (info.file.size > offset)) {
+		total = info.file.size;
+		id = gp_context_progress_start (context, total - offset,
+						_("Downloading..."));
+	}
+
+	do {
+		size = RESUME_CHUNK_SIZE;
+		result = gp_filesystem_read_file (camera->fs, folder, file,
+						  type, offset, buf, &size,
+						  context);
+		if (result < GP_OK)
+			break;
+		if (!size && total) {
+			/* nothing more before the end of the file */
+			result = GP_ERROR_IO_READ;
+			break;
+		}
+		if (size) {
+			result = gp_file_append (camera_file, buf, size);
+			if (result < GP_OK)
+				break;
+			offset += size;
+		}
+		if (total)
+			gp_context_progress_update (context, id,
+						    offset - start);
+		if (gp_context_cancel (context) == GP_CONTEXT_FEEDBACK_CANCEL) {
+			result = GP_ERROR_CANCEL;
+			break;
+		}
+	} while (total ? (offset < total) : (size == RESUME_CHUNK_SIZE));
+
+	if (total)
+		gp_context_progress_stop (context, id);
+	free (buf);
+	CHECK_CLOSE (camera, context);
+
+	if (result < GP_OK) {
+		GP_LOG_E ("Download of '%s' stopped at offset %lu (%s).",
+			  file, (unsigned long)offset, gp_result_as_string (result));
+		CAMERA_UNUSED (camera, context);
+		return (result);
+	}
+
+	CAMERA_UNUSED (camera, context);
+	return (GP_OK);
+}
+
+typedef struct {
+	const CameraFilePath	*path;
+	unsigned int		index;
+	int			result;	/* set if it is known to fail up front */
+} CameraBatchEntry;
+
+static int
+batch_entry_compare (const void *a, const void *b)
+{
+	const CameraBatchEntry *ea = a, *eb = b;
+	int r;
+
+	r = strcmp (ea->path->folder, eb->path->folder);
+	if (!r)
+		r = strcmp (ea->path->name, eb->path->name);
+	if (!r)
+		r = (ea->index > eb->index) - (ea->index < eb->index);
+	return r;
+}
+
+/*
+ * Looks up all files of the batch before anything is transferred. Each
+ * folder is listed once, which also loads the camlib's information about
+ * its files, and the sorted listing is matched against the sorted run of
+ * requests from that folder. Files that are not there are marked as such
+ * and not asked for again.
+ */
+static int
+batch_resolve (Camera *camera, CameraBatchEntry *entries, unsigned int count,
+	       GPContext *context)
+{
+	CameraList	*list;
+	const char	*name;
+	unsigned int	i, k, start;
+	int		j, n, r, result;
+
+	result = gp_list_new (&list);
+	if (result < GP_OK)
+		return (result);
+	for (start = 0; start < count; start = i) {
+		for (i = start; i < count; i++)
+			if (strcmp (entries[i].path->folder, entries[start].path->folder))
+				break;
+
+		gp_list_reset (list);
+		result = gp_filesystem_list_files (camera->fs,
+				entries[start].path->folder, list, context);
+		if (result == GP_ERROR_CANCEL) {
+			gp_list_free (list);
+			return (result);
+		}
+		if (result < GP_OK) {
+			for (k = start; k < i; k++)
+				if (entries[k].result == GP_OK)
+					entries[k].result = result;
+			continue;
+		}
+		gp_list_sort (list);
+		n = gp_list_count (list);
+		for (k = start, j = 0; k < i; k++) {
+			r = 1;
+			while (j < n) {
+				gp_list_get_name (list, j, &name);
+				r = strcmp (name, entries[k].path->name);
+				if (r >= 0)
+					break;
+				j++;
+			}
+			if (r && (entries[k].result == GP_OK))
+				entries[k].result = GP_ERROR_FILE_NOT_FOUND;
+		}
+	}
+	gp_list_free (list);
+	return (GP_OK);
+}
+
+static int
+batch_download_one (Camera *camera, const CameraFilePath *path,
+		    const char *dest_dir, int flags, int *skipped,
+		    GPContext *context)
+{
+	CameraFile	*file;
+	struct utimbuf	u;
+	struct stat	st;
+	time_t		mtime = 0;
+	char		*dest, *tmp;
+	int		fd, result;
+
+	*skipped = 0;
+	C_MEM (dest = malloc (strlen (dest_dir) + 1 + strlen (path->name) + 1));
+	sprintf (dest, "%s/%s", dest_dir, path->name);
+
+	if ((flags & GP_DOWNLOAD_BATCH_SKIP_EXISTING) && !stat (dest, &st)) {
+		GP_LOG_D ("'%s' exists, skipping it.", dest);
+		*skipped = 1;
+		free (dest);
+		return (GP_OK);
+	}
+
+	/* The data goes into a hidden file next to the destination, which
+	 * only replaces it once complete. A failed download thus never
+	 * destroys a file that was there before. */
+	tmp = malloc (strlen (dest_dir) + 2 + strlen (path->name) + 5 + 1);
+	if (!tmp) {
+		free (dest);
+		return (GP_ERROR_NO_MEMORY);
+	}
+	sprintf (tmp, "%s/.%s.part", dest_dir, path->name);
+	fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		GP_LOG_E ("Could not create '%s'.", tmp);
+		free (tmp);
+		free (dest);
+		return (GP_ERROR_IO_WRITE);
+	}
+	result = gp_file_new_from_fd (&file, fd);
+	if (result < GP_OK) {
+		close (fd);
+		unlink (tmp);
+		free (tmp);
+		free (dest);
+		return (result);
+	}
+
+	result = gp_filesystem_get_file (camera->fs, path->folder, path->name,
+					 GP_FILE_TYPE_NORMAL, file, context);
+	gp_file_get_mtime (file, &mtime);
+	gp_file_unref (file);
+
+	if ((result >= GP_OK) && mtime) {
+		u.actime = mtime;
+		u.modtime = mtime;
+		utime (tmp, &u);
+	}
+	if (result >= GP_OK) {
+#ifdef WIN32
+		if (!MoveFileEx (tmp, dest, MOVEFILE_REPLACE_EXISTING))
+#else
+		if (rename (tmp, dest) < 0)
+#endif
+		{
+			GP_LOG_E ("Could not rename '%s' to '%s'.", tmp, dest);
+			result = GP_ERROR_IO_WRITE;
+		}
+	}
+	if (result < GP_OK)
+		unlink (tmp);
+	free (tmp);
+	free (dest);
+	return (result);
+}
+
+/**
+ * Downloads a number of files from the #Camera into a directory.
+ *
+ * @param camera a #Camera
+ * @param paths the camera paths of the files
+ * @param count the number of entries in \c paths
+ * @param dest_dir the directory to store the files in
+ * @param flags a combination of #CameraDownloadBatchFlags
+ * @param func called after every file, may be NULL
+ * @param data passed to \c func
+ * @param context a #GPContext
+ * @return a gphoto2 error code
+ *
+ * Every file is stored under its camera file name in \c dest_dir.
+ * All files are looked up before the first one is transferred, one
+ * folder listing per folder, and then fetched in folder order. The
+ * camera is opened only once for the whole batch. Each file is written
+ * to disk as the data arrives. It is not held in memory first, and it
+ * replaces an existing file of the same name only once it is complete.
+ *
+ * Failed files are reported to \c func and skipped, unless
+ * #GP_DOWNLOAD_BATCH_STOP_ON_ERROR is given. Files left alone because of
+ * #GP_DOWNLOAD_BATCH_SKIP_EXISTING are no failure, they are reported
+ * with #GP_OK. The result is #GP_OK if no file failed, the error of the
+ * first failed file otherwise.
+ *
+ **/
+int
+gp_camera_download_batch (Camera *camera, const CameraFilePath *paths,
+			  unsigned int count, const char *dest_dir,
+			  int flags, CameraDownloadBatchFunc func,
+			  void *data, GPContext *context)
+{
+	CameraBatchEntry	*entries;
+	unsigned int		i, id, done = 0, skipped = 0;
+	int			result, skip, first_error = GP_OK;
+
+	C_PARAMS (camera && (paths || !count) && dest_dir);
+	CHECK_INIT (camera, context);
+
+	GP_LOG_D ("Downloading %u files to '%s'...", count, dest_dir);
+
+	if (!count) {
+		CAMERA_UNUSED (camera, context);
+		return (GP_OK);
+	}
+
+	CHECK_OPEN (camera, context);
+
+	entries = malloc (sizeof (CameraBatchEntry) * count);
+	if (!entries) {
+		CHECK_CLOSE (camera, context);
+		CAMERA_UNUSED (camera, context);
+		return (GP_ERROR_NO_MEMORY);
+	}
+	for (i = 0; i < count; i++) {
+		entries[i].path = &paths[i];
+		entries[i].index = i;
+		entries[i].result = GP_OK;
+		if (!strlen (paths[i].folder))
+			entries[i].result = GP_ERROR_DIRECTORY_NOT_FOUND;
+		else if (!strlen (paths[i].name) || strchr (paths[i].name, '/'))
+			entries[i].result = GP_ERROR_FILE_NOT_FOUND;
+	}
+	qsort (entries, count, sizeof (CameraBatchEntry), batch_entry_compare);
+
+	result = batch_resolve (camera, entries, count, context);
+	if (result < GP_OK) {
+		free (entries);
+		CHECK_CLOSE (camera, context);
+		CAMERA_UNUSED (camera, context);
+		return (result);
+	}
+
+	id = gp_context_progress_start (context, count, _("Downloading files..."));
+	for (i = 0; i < count; i++) {
+		if (gp_context_cancel (context) == GP_CONTEXT_FEEDBACK_CANCEL) {
+			if (first_error == GP_OK)
+				first_error = GP_ERROR_CANCEL;
+			break;
+		}
+		skip = 0;
+		result = entries[i].result;
+		if (result == GP_OK)
+			result = batch_download_one (camera, entries[i].path,
+						     dest_dir, flags, &skip, context);
+		if (func)
+			func (camera, entries[i].index, entries[i].path, result, data);
+		gp_context_progress_update (context, id, i + 1);
+		if (skip)
+			skipped++;
+		else if (result >= GP_OK)
+			done++;
+		if (result < GP_OK) {
+			GP_LOG_E ("Downloading '%s/%s' failed: %s",
+				  entries[i].path->folder, entries[i].path->name,
+				  gp_result_as_string (result));
+			if (first_error == GP_OK)
+				first_error = result;
+			if ((flags & GP_DOWNLOAD_BATCH_STOP_ON_ERROR) ||
+			    (result == GP_ERROR_CANCEL))
+				break;
+		}
+	}
+	gp_context_progress_stop (context, id);
+	free (entries);
+	GP_LOG_D ("Downloaded %u files, skipped %u existing ones.", done, skipped);
+
+	CHECK_CLOSE (camera, context);
+	CAMERA_UNUSED (camera, context);
+	return (first_error);
+}
+
+/*
+ * Errors after which fetching the previews of the remaining files makes
+ * no sense. Anything else only means that this file has no preview.
+ */
+static int
+prefetch_error_is_fatal (int result)
+{
+	switch (result) {
+	case GP_ERROR_CANCEL:
+	case GP_ERROR_NO_MEMORY:
+	case GP_ERROR_IO:
+	case GP_ERROR_IO_READ:
+	case GP_ERROR_IO_WRITE:
+	case GP_ERROR_TIMEOUT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Fills the preview cache with the thumbnails of a whole folder.
+ *
+ * @param camera a #Camera
+ * @param folder a folder
+ * @param max_bytes the maximum amount of preview data to cache, 0 for no limit
+ * @param context a #GPContext
+ * @return the number of cached previews or a gphoto2 error code
+ *
+ * The previews of all files in \c folder are fetched back to back, with
+ * the camera opened only once, and kept in the #CameraFilesystem. Later
+ * calls of gp_camera_file_get() with #GP_FILE_TYPE_PREVIEW for these
+ * files are answered from the cache without talking to the camera.
+ *
+ * Fetching stops before the previews would exceed \c max_bytes. The
+ * preview size is taken from the file info where the driver reports it,
+ * otherwise a preview is fetched and then dropped if it does not fit.
+ * Files without a preview are skipped. If fetching stops because of an error,
+ * the previews fetched so far stay cached and the error is returned.
+ *
+ **/
+int
+gp_camera_folder_prefetch_previews (Camera *camera, const char *folder,
+				    uint64_t max_bytes, GPContext *context)
+{
+	CameraList	*list = NULL;
+	CameraFile	*file;
+	CameraFileInfo	info;
+	const char	*name;
+	unsigned long	size;
+	uint64_t	total = 0;
+	unsigned int	id;
+	int		i, count, result, cached = 0;
+
+	GP_LOG_D ("Prefetching previews in '%s'...", folder);
+
+	C_PARAMS (camera && folder);
+	CHECK_INIT (camera, context);
+	CHECK_OPEN (camera, context);
+
+	result = gp_list_new (&list);
+	if (result < GP_OK)
+		goto out;
+	result = gp_filesystem_list_files (camera->fs, folder, list, context);
+	if (result < GP_OK)
+		goto out;
+	/* Same order as gp_camera_folder_list_files() hands them out. */
+	gp_list_sort (list);
+	count = gp_list_count (list);
+
+	id = gp_context_progress_start (context, count, _("Fetching previews..."));
+	for (i = 0; i < count; i++) {
+		if (gp_context_cancel (context) == GP_CONTEXT_FEEDBACK_CANCEL) {
+			result = GP_ERROR_CANCEL;
+			break;
+		}
+		gp_list_get_name (list, i, &name);
+
+		/* Most drivers know the preview size from the file info,
+		 * which spares fetching a preview that does not fit. */
+		if (max_bytes &&
+		    (gp_filesystem_get_info (camera->fs, folder, name,
+					     &info, context) >= GP_OK) &&
+		    (info.preview.fields & GP_FILE_INFO_SIZE) &&
+		    (total + info.preview.size > max_bytes)) {
+			GP_LOG_D ("Preview cache budget of %llu bytes reached.",
+				  (unsigned long long) max_bytes);
+			break;
+		}
+
+		result = gp_file_new (&file);
+		if (result < GP_OK)
+			break;
+		result = gp_filesystem_get_file (camera->fs, folder, name,
+						 GP_FILE_TYPE_PREVIEW, file, context);
+		if (result < GP_OK) {
+			gp_file_unref (file);
+			if (prefetch_error_is_fatal (result))
+				break;
+			GP_LOG_D ("No preview for '%s': %s", name,
+				  gp_result_as_string (result));
+			gp_context_progress_update (context, id, i + 1);
+			result = GP_OK;
+			continue;
+		}
+		gp_file_get_data_and_size (file, NULL, &size);
+		if (max_bytes && (total + size > max_bytes)) {
+			GP_LOG_D ("Preview cache budget of %llu bytes reached.",
+				  (unsigned long long) max_bytes);
+			gp_file_unref (file);
+			break;
+		}
+		result = gp_filesystem_set_file_noop (camera->fs, folder, name,
+					GP_FILE_TYPE_PREVIEW, file, context);
+		gp_file_unref (file);
+		if (result < GP_OK)
+			break;
+		total += size;
+		cached++;
+		gp_context_progress_update (context, id, i + 1);
+	}
+	gp_context_progress_stop (context, id);
+
+	if (result >= GP_OK)
+		result = cached;
+
+out:
+	if (list)
+		gp_list_free (list);
+	CHECK_CLOSE (camera, context);
+	CAMERA_UNUSED (camera, context);
+	return (result);
+}
+
 /**
  * Deletes the file from \c folder.
  *
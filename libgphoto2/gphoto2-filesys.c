@@ -412,6 +412,37 @@ lookup_folder (
 	return NULL;
 }
 
+/* Like lookup_folder(), but only walks the folders that are already cached
+ * and never calls into the camera driver. Returns NULL if the folder is not
+ * in the cache (yet). */
+static CameraFilesystemFolder*
+lookup_cached_folder (CameraFilesystemFolder *folder, const char *foldername)
+{
+	CameraFilesystemFolder	*f;
+	const char	*curpt = foldername;
+	const char	*s;
+	size_t		len;
+
+	while (folder) {
+		/* handle multiple slashes, and slashes at the end */
+		while (curpt[0]=='/')
+			curpt++;
+		if (!curpt[0])
+			return folder;
+		if (folder->folders_dirty)
+			return NULL;
+
+		s = strchr(curpt,'/');
+		len = s ? (size_t)(s-curpt) : strlen(curpt);
+		for (f = folder->folders; f; f = f->next)
+			if (!strncmp(f->name, curpt, len) && (strlen(f->name) == len))
+				break;
+		folder = f;
+		curpt += len;
+	}
+	return NULL;
+}
+
 static int
 lookup_folder_file (
 	CameraFilesystem *fs,
@@ -694,6 +725,7 @@ gp_filesystem_free (CameraFilesystem *fs)
  * Tells the fs that there is a file called filename in folder
  * called folder. Usually camera drivers will call this function after
  * capturing an image in order to tell the fs about the new file.
+ * If filename is NULL, only the folder is added.
  * A front-end should not use this function.
  *
  * \return a gphoto2 error code.
@@ -738,11 +770,13 @@ gp_filesystem_append (CameraFilesystem *fs, const char *folder,
 	CC (context);
 	CA (folder, context);
 
-	GP_LOG_D ("Append %s/%s to filesystem", folder, filename);
+	GP_LOG_D ("Append %s/%s to filesystem", folder, filename ? filename : "");
 	/* Check folder for existence, if not, create it. */
 	f = lookup_folder (fs, fs->rootfolder, folder, context);
 	if (!f)
 		CR (append_folder (fs, folder, &f, context));
+	if (!filename)
+		return (GP_OK);
 	if (f->files_dirty) { /* Need to load folder from driver first ... capture case */
 		CameraList	*xlist;
 		int ret;
@@ -1153,6 +1187,113 @@ gp_filesystem_delete_file_noop (CameraFilesystem *fs, const char *folder,
 	return delete_file (fs, f, file);
 }
 
+/**
+ * \brief Remove a file from the cached filesystem view
+ * \param fs a #CameraFilesystem
+ * \param folder the folder the file was in
+ * \param filename the name of the file
+ * \param context a #GPContext
+ *
+ * Tells the filesystem that a file has disappeared from the device, e.g.
+ * after an ObjectRemoved event. Unlike gp_filesystem_delete_file_noop()
+ * this never asks the camera driver for listings: if the folder's file
+ * list is not cached, there is nothing to update. All other cached
+ * folders and file infos are kept.
+ *
+ * \return a gphoto2 error code.
+ **/
+int
+gp_filesystem_remove_file_cached (CameraFilesystem *fs, const char *folder,
+				  const char *filename, GPContext *context)
+{
+	CameraFilesystemFolder	*f;
+	CameraFilesystemFile	*file;
+
+	C_PARAMS (fs && folder && filename);
+	CC (context);
+	CA (folder, context);
+
+	GP_LOG_D ("Removing cached file '%s' from folder '%s'...", filename, folder);
+	f = lookup_cached_folder (fs->rootfolder, folder);
+	if (!f || f->files_dirty)
+		return (GP_OK);
+	for (file = f->files; file; file = file->next)
+		if (!strcmp (file->name, filename))
+			return delete_file (fs, f, file);
+	return (GP_OK);
+}
+
+/**
+ * \brief Add a folder to the cached filesystem view
+ * \param fs a #CameraFilesystem
+ * \param folder the folder the new folder was created in
+ * \param name the name of the new folder
+ * \param context a #GPContext
+ *
+ * Tells the filesystem that a folder has appeared on the device, e.g.
+ * after an ObjectAdded event. If the parent's folder list is cached, the
+ * new folder is added to it, with its own contents still to be listed.
+ * Nothing else is invalidated and the camera driver is not called.
+ *
+ * \return a gphoto2 error code.
+ **/
+int
+gp_filesystem_add_folder_cached (CameraFilesystem *fs, const char *folder,
+				 const char *name, GPContext *context)
+{
+	CameraFilesystemFolder	*f, *sub;
+
+	C_PARAMS (fs && folder && name);
+	CC (context);
+	CA (folder, context);
+
+	GP_LOG_D ("Adding cached folder '%s' to folder '%s'...", name, folder);
+	f = lookup_cached_folder (fs->rootfolder, folder);
+	if (!f || f->folders_dirty)
+		return (GP_OK);
+	for (sub = f->folders; sub; sub = sub->next)
+		if (!strcmp (sub->name, name))
+			return (GP_OK);
+	return append_folder_one (f, name, NULL);
+}
+
+/**
+ * \brief Remove a folder from the cached filesystem view
+ * \param fs a #CameraFilesystem
+ * \param folder the folder the removed folder was in
+ * \param name the name of the removed folder
+ * \param context a #GPContext
+ *
+ * Tells the filesystem that a folder and everything below it has
+ * disappeared from the device. Only this subtree is dropped from the
+ * cache, the camera driver is not called.
+ *
+ * \return a gphoto2 error code.
+ **/
+int
+gp_filesystem_remove_folder_cached (CameraFilesystem *fs, const char *folder,
+				    const char *name, GPContext *context)
+{
+	CameraFilesystemFolder	*f;
+	CameraFilesystemFolder	**prev;
+
+	C_PARAMS (fs && folder && name);
+	CC (context);
+	CA (folder, context);
+
+	GP_LOG_D ("Removing cached folder '%s' from folder '%s'...", name, folder);
+	f = lookup_cached_folder (fs->rootfolder, folder);
+	if (!f || f->folders_dirty)
+		return (GP_OK);
+	for (prev = &f->folders; *prev; prev = &((*prev)->next))
+		if (!strcmp ((*prev)->name, name))
+			break;
+	if (!*prev)
+		return (GP_OK);
+	CR (recurse_delete_folder (fs, *prev));
+	return delete_folder (fs, prev);
+}
+
 /**
  * \brief Create a subfolder within a folder
  * \param fs a #CameraFilesystem
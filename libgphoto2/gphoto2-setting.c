@@ -29,6 +29,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include <gphoto2/gphoto2-result.h>
 #include <gphoto2/gphoto2-port-log.h>
@@ -52,8 +56,26 @@ typedef struct {
 } Setting;
 
 /* Currently loaded settings */
+static int             glob_setting_loaded = 0;
 static int             glob_setting_count = 0;
-static Setting         glob_setting[512];
+static int             glob_setting_alloc = 0;
+static Setting        *glob_setting = NULL;
+
+/* Open addressing hash over (id, key), holding indices + 1 into
+ * glob_setting. Its size is a power of 2 and it is kept at most half full. */
+static unsigned int   *glob_setting_hash = NULL;
+static unsigned int    glob_setting_hashsize = 0;
+
+/* Changes not yet written to the settings file, and when it was last
+ * written. */
+static int             glob_setting_dirty = 0;
+static time_t          glob_setting_saved = 0;
+
+/* Changes are written back at most every SETTING_FLUSH_INTERVAL seconds;
+ * anything left over is written by gp_setting_flush(), which gp_camera_exit()
+ * calls, and, where the compiler supports it, when the library is
+ * unloaded. */
+#define SETTING_FLUSH_INTERVAL	2
 
 static int save_settings (void);
 
@@ -61,6 +83,94 @@ static int save_settings (void);
 
 static int load_settings (void);
 
+static unsigned int
+setting_hash (const char *id, const char *key)
+{
+	unsigned int h = 5381;
+
+	while (*id)
+		h = h * 33 + (unsigned char)*id++;
+	h = h * 33 + '=';
+	while (*key)
+		h = h * 33 + (unsigned char)*key++;
+	return h;
+}
+
+static unsigned int *
+setting_slot (const char *id, const char *key)
+{
+	unsigned int mask = glob_setting_hashsize - 1;
+	unsigned int h = setting_hash (id, key) & mask;
+
+	while (glob_setting_hash[h]) {
+		Setting *setting = &glob_setting[glob_setting_hash[h] - 1];
+
+		if (!strcmp (setting->id, id) && !strcmp (setting->key, key))
+			break;
+		h = (h + 1) & mask;
+	}
+	return &glob_setting_hash[h];
+}
+
+static Setting *
+setting_find (const char *id, const char *key)
+{
+	unsigned int *slot;
+
+	if (!glob_setting_hashsize)
+		return NULL;
+	slot = setting_slot (id, key);
+	return *slot ? &glob_setting[*slot - 1] : NULL;
+}
+
+static Setting *
+setting_add (const char *id, const char *key)
+{
+	Setting *setting;
+	int x;
+
+	if (glob_setting_count == glob_setting_alloc) {
+		int alloc = glob_setting_alloc ? glob_setting_alloc * 2 : 64;
+
+		setting = realloc (glob_setting, sizeof (Setting) * alloc);
+		if (!setting)
+			return NULL;
+		glob_setting = setting;
+		glob_setting_alloc = alloc;
+	}
+	if (2 * (glob_setting_count + 1) > (int)glob_setting_hashsize) {
+		unsigned int size = glob_setting_hashsize ? glob_setting_hashsize * 2 : 128;
+		unsigned int *hash = calloc (size, sizeof (unsigned int));
+
+		if (!hash)
+			return NULL;
+		free (glob_setting_hash);
+		glob_setting_hash = hash;
+		glob_setting_hashsize = size;
+		for (x = 0; x < glob_setting_count; x++)
+			*setting_slot (glob_setting[x].id, glob_setting[x].key) = x + 1;
+	}
+	setting = &glob_setting[glob_setting_count];
+	snprintf (setting->id, sizeof (setting->id), "%s", id);
+	snprintf (setting->key, sizeof (setting->key), "%s", key);
+	setting->value[0] = '\0';
+	/* Look up the slot with the possibly truncated id and key */
+	*setting_slot (setting->id, setting->key) = ++glob_setting_count;
+	return setting;
+}
+
+#ifdef __GNUC__
+/* Unlike an atexit() handler, a destructor does not outlive the library
+ * when the program unloads it with dlclose(). */
+static void setting_unload (void) __attribute__ ((destructor));
+
+static void
+setting_unload (void)
+{
+	gp_setting_flush ();
+}
+#endif
+
 /**
  * \brief Retrieve a specific gphoto setting.
  * \param id the frontend id of the caller
@@ -74,20 +184,18 @@ static int load_settings (void);
 int
 gp_setting_get (char *id, char *key, char *value)
 {
-        int x;
+	Setting *setting;
 
 	C_PARAMS (id && key);
 
-	if (!glob_setting_count)
+	if (!glob_setting_loaded)
 		load_settings ();
 
-        for (x=0; x<glob_setting_count; x++) {
-                if ((strcmp(glob_setting[x].id, id)==0) &&
-		    (strcmp(glob_setting[x].key, key)==0)) {
-                        strcpy(value, glob_setting[x].value);
-                        return (GP_OK);
-                }
-        }
+	setting = setting_find (id, key);
+	if (setting) {
+		strcpy(value, setting->value);
+		return (GP_OK);
+	}
         strcpy(value, "");
         return(GP_ERROR);
 }
@@ -102,35 +210,60 @@ gp_setting_get (char *id, char *key, char *value)
  *
  * This function sets the setting key for a specific frontend
  * id to the value.
+ *
+ * The settings file is not rewritten for every change: changes made in
+ * quick succession are collected and written together, at the latest by
+ * gp_setting_flush(). gp_camera_exit() flushes, and with gcc and
+ * compatible compilers so does unloading the library. A program that
+ * changes settings without a camera, or is built otherwise, has to call
+ * gp_setting_flush() before it exits.
  */
 int
 gp_setting_set (char *id, char *key, char *value)
 {
-        int x;
+	Setting *setting;
 
 	C_PARAMS (id && key);
 
-	if (!glob_setting_count)
+	if (!glob_setting_loaded)
 		load_settings ();
 
 	GP_LOG_D ("Setting key '%s' to value '%s' (%s)", key, value, id);
 
-        for (x=0; x<glob_setting_count; x++) {
-                if ((strcmp(glob_setting[x].id, id)==0) &&
-		    (strcmp(glob_setting[x].key, key)==0)) {
-                        strcpy(glob_setting[x].value, value);
-                        save_settings ();
-                        return (GP_OK);
-                }
-	}
-        strcpy(glob_setting[glob_setting_count].id, id);
-        strcpy(glob_setting[glob_setting_count].key, key);
-        strcpy(glob_setting[glob_setting_count++].value, value);
-        save_settings ();
+	setting = setting_find (id, key);
+	if (!setting) {
+		C_MEM (setting = setting_add (id, key));
+	} else if (!strcmp (setting->value, value))
+		return (GP_OK);
+	snprintf (setting->value, sizeof (setting->value), "%s", value);
+
+	glob_setting_dirty = 1;
+	if (time (NULL) - glob_setting_saved >= SETTING_FLUSH_INTERVAL)
+		return gp_setting_flush ();
 
         return (GP_OK);
 }
 
+/**
+ * \brief Write pending setting changes to the settings file.
+ *
+ * \return GPhoto error code
+ *
+ * gp_setting_set() collects changes made in quick succession. This
+ * function writes them out right away. The new file is written next to
+ * the old one and then renamed over it, so the settings file is complete
+ * at any time, even if the program is killed while writing.
+ */
+int
+gp_setting_flush (void)
+{
+	if (!glob_setting_dirty)
+		return (GP_OK);
+	CHECK_RESULT (save_settings ());
+	glob_setting_dirty = 0;
+	return (GP_OK);
+}
+
 static int
 verify_settings (char *settings_file)
 {
@@ -184,7 +317,10 @@ load_settings (void)
 	GP_LOG_D ("Creating gphoto config directory ('%s')", buf);
 	(void)gp_system_mkdir (buf);
 
+	glob_setting_loaded = 1;
 	glob_setting_count = 0;
+	if (glob_setting_hash)
+		memset (glob_setting_hash, 0, sizeof (unsigned int) * glob_setting_hashsize);
 #ifdef WIN32
 	SHGetFolderPath(NULL, CSIDL_PROFILE, NULL, 0, buf);
 	strcat(buf, "\\.gphoto\\settings");
@@ -208,16 +344,20 @@ load_settings (void)
 		if (!fgets(buf, 1023, f))
 			break;
 		if (strlen(buf)>2) {
+		     Setting *setting;
+
 		     buf[strlen(buf)-1] = '\0';
 		     id = strtok(buf, "=");
-		     strcpy(glob_setting[glob_setting_count].id,id);
 		     key = strtok(NULL, "=");
-		     strcpy(glob_setting[glob_setting_count].key,key);
 		     value = strtok(NULL, "\0");
-		     if (value)
-			strcpy(glob_setting[glob_setting_count++].value, value);
-		       else
-			strcpy(glob_setting[glob_setting_count++].value, "");
+		     if (!id || !key)
+			continue;
+		     setting = setting_find (id, key);
+		     if (!setting)
+			setting = setting_add (id, key);
+		     if (!setting)
+			break;
+		     snprintf (setting->value, sizeof (setting->value), "%s", value ? value : "");
 		}
 	}
 	fclose (f);
@@ -229,8 +369,8 @@ static int
 save_settings (void)
 {
 	FILE *f;
-	char buf[1024];
-	int x=0;
+	char buf[1024], tmp[1024 + 4];
+	int x=0, result;
 
 #ifdef WIN32
 	SHGetFolderPath(NULL, CSIDL_PROFILE, NULL, 0, buf);
@@ -238,25 +378,42 @@ save_settings (void)
 #else
 	snprintf (buf, sizeof(buf), "%s/.gphoto/settings", getenv ("HOME"));
 #endif
+	snprintf (tmp, sizeof(tmp), "%s.tmp", buf);
 
 
 	GP_LOG_D ("Saving %i setting(s) to file \"%s\"", glob_setting_count, buf);
 
-	if ((f=fopen(buf, "w+"))==NULL) {
+	if ((f=fopen(tmp, "w"))==NULL) {
 		GP_LOG_E ("Can't open settings file for writing.");
 		return(0);
 	}
-	rewind(f);
 	while (x < glob_setting_count) {
-		fwrite(glob_setting[x].id, strlen(glob_setting[x].id),1,f);
-		fputc('=', f);
-		fwrite(glob_setting[x].key, strlen(glob_setting[x].key),1,f);
-		fputc('=', f);
-		fwrite(glob_setting[x].value, strlen(glob_setting[x].value),1,f);
-		fputc('\n', f);
+		fprintf (f, "%s=%s=%s\n", glob_setting[x].id,
+			 glob_setting[x].key, glob_setting[x].value);
 		x++;
 	}
-	fclose(f);
+	/* Make sure the data is on disk before the new file replaces the
+	 * old one. */
+	result = (fflush (f) == 0);
+#ifndef WIN32
+	if (result)
+		result = (fsync (fileno (f)) == 0);
+#endif
+	if (fclose (f))
+		result = 0;
+#ifdef WIN32
+	if (result)
+		result = MoveFileEx (tmp, buf, MOVEFILE_REPLACE_EXISTING);
+#else
+	if (result)
+		result = (rename (tmp, buf) == 0);
+#endif
+	if (!result) {
+		GP_LOG_E ("Can't write settings file \"%s\".", buf);
+		unlink (tmp);
+		return (GP_ERROR_IO_WRITE);
+	}
+	glob_setting_saved = time (NULL);
 
 	return (GP_OK);
 }
@@ -30,6 +30,38 @@
 #include <gphoto2/gphoto2-result.h>
 #include <gphoto2/gphoto2-port-log.h>
 
+typedef struct _CameraWidgetChunk CameraWidgetChunk;
+typedef struct _CameraWidgetArena CameraWidgetArena;
+
+/*
+ * Label, name, info and choice strings of all widgets in a tree are kept
+ * in chunks owned by the root widget. Chunks never move, so the pointers
+ * handed out by gp_widget_get_label() and friends stay valid until the
+ * tree is freed. Identical strings are stored only once.
+ */
+struct _CameraWidgetChunk {
+	CameraWidgetChunk *next;
+	size_t size, used;
+	char data[1];
+};
+
+struct _CameraWidgetArena {
+	CameraWidgetChunk *chunks;	/* the one we allocate from first */
+
+	/* Interned strings (open addressing) */
+	const char **strings;
+	unsigned int strings_count, strings_size;
+
+	/*
+	 * Hash index for the gp_widget_get_child_by_* functions. Buckets
+	 * are chained through the widgets in depth-first order. It is only
+	 * built once a tree is searched twice without being changed.
+	 */
+	CameraWidget **by_name, **by_label, **by_id;
+	unsigned int index_size;
+	int lookups;
+};
+
 /**
  * CameraWidget:
  *
@@ -38,20 +70,24 @@
  **/
 struct _CameraWidget {
 	CameraWidgetType type;
-	char    label [256];
-	char    info [1024];
-	char    name [256];
+	const char *label;
+	const char *info;
+	const char *name;
 
 	CameraWidget *parent;
 
+	/* Strings of the tree (root widget only) */
+	CameraWidgetArena *arena;
+
 	/* Current value of the widget */
 	char   *value_string;
 	int     value_int;
 	float   value_float;
 
 	/* For Radio and Menu */
-	char    **choice;
+	const char **choice;
 	int     choice_count;
+	int     choice_size;
 
 	/* For Range */
 	float   min;
@@ -76,8 +112,261 @@ struct _CameraWidget {
 
 	/* Callback */
 	CameraWidgetCallback callback;
+
+	/* Next widget in the same bucket of the root's lookup index */
+	CameraWidget *next_name, *next_label, *next_id;
 };
 
+static CameraWidget *
+gp_widget_root (CameraWidget *widget)
+{
+	while (widget->parent)
+		widget = widget->parent;
+	return widget;
+}
+
+static unsigned int
+gp_widget_hash (const char *s)
+{
+	unsigned int h = 2166136261u;
+
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619u;
+	return h;
+}
+
+static void
+gp_widget_index_drop (CameraWidgetArena *arena)
+{
+	free (arena->by_name);
+	free (arena->by_label);
+	free (arena->by_id);
+	arena->by_name = arena->by_label = arena->by_id = NULL;
+	arena->index_size = 0;
+	arena->lookups = 0;
+}
+
+/* Called whenever names or the shape of the tree change */
+static void
+gp_widget_tree_changed (CameraWidget *widget)
+{
+	CameraWidget *root = gp_widget_root (widget);
+
+	if (root->arena)
+		gp_widget_index_drop (root->arena);
+}
+
+static void
+gp_widget_arena_free (CameraWidgetArena *arena)
+{
+	CameraWidgetChunk *chunk;
+
+	if (!arena)
+		return;
+	while (arena->chunks) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free (chunk);
+	}
+	gp_widget_index_drop (arena);
+	free (arena->strings);
+	free (arena);
+}
+
+static int
+gp_widget_arena_add (CameraWidgetArena *arena, const char *s)
+{
+	unsigned int i, mask;
+
+	if (2 * (arena->strings_count + 1) > arena->strings_size) {
+		const char **old = arena->strings;
+		unsigned int old_size = arena->strings_size;
+
+		arena->strings_size = old_size ? 2 * old_size : 32;
+		arena->strings = calloc (arena->strings_size, sizeof (char *));
+		if (!arena->strings) {
+			arena->strings = old;
+			arena->strings_size = old_size;
+			return GP_ERROR_NO_MEMORY;
+		}
+		arena->strings_count = 0;
+		for (i = 0; i < old_size; i++)
+			if (old[i])
+				gp_widget_arena_add (arena, old[i]);
+		free (old);
+	}
+	mask = arena->strings_size - 1;
+	for (i = gp_widget_hash (s) & mask; arena->strings[i]; i = (i + 1) & mask)
+		if (!strcmp (arena->strings[i], s))
+			return GP_OK;
+	arena->strings[i] = s;
+	arena->strings_count++;
+	return GP_OK;
+}
+
+/* Returns the copy of @s stored in the tree of @widget, or NULL. */
+static const char *
+gp_widget_intern (CameraWidget *widget, const char *s)
+{
+	CameraWidget *root = gp_widget_root (widget);
+	CameraWidgetArena *arena = root->arena;
+	CameraWidgetChunk *chunk;
+	size_t len, size;
+	unsigned int i, mask;
+	char *copy;
+
+	if (!*s)
+		return "";
+
+	if (!arena) {
+		arena = root->arena = calloc (1, sizeof (CameraWidgetArena));
+		if (!arena)
+			return NULL;
+	}
+	if (arena->strings_size) {
+		mask = arena->strings_size - 1;
+		for (i = gp_widget_hash (s) & mask; arena->strings[i];
+		     i = (i + 1) & mask)
+			if (!strcmp (arena->strings[i], s))
+				return arena->strings[i];
+	}
+
+	len = strlen (s) + 1;
+	chunk = arena->chunks;
+	if (!chunk || (chunk->size - chunk->used < len)) {
+		/* Small trees get small chunks, larger ones up to 4k */
+		size = chunk ? 2 * chunk->size : 64;
+		if (size > 4096)
+			size = 4096;
+		if (size < len)
+			size = len;
+		chunk = malloc (sizeof (CameraWidgetChunk) + size);
+		if (!chunk)
+			return NULL;
+		chunk->size = size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+	copy = chunk->data + chunk->used;
+	memcpy (copy, s, len);
+	if (gp_widget_arena_add (arena, copy) < 0)
+		return NULL;
+	chunk->used += len;
+	return copy;
+}
+
+/*
+ * Hands the strings of a tree that becomes part of another one over to
+ * the new root. The intern table only avoids duplicates, so failing to
+ * grow it is harmless.
+ */
+static void
+gp_widget_arena_merge (CameraWidget *root, CameraWidget *child)
+{
+	CameraWidgetArena *from = child->arena, *to = root->arena;
+	CameraWidgetChunk *last;
+	unsigned int i;
+
+	if (!from)
+		return;
+	child->arena = NULL;
+	if (!to) {
+		root->arena = from;
+		gp_widget_index_drop (from);
+		return;
+	}
+
+	/* Keep allocating from the current chunk of the new root */
+	for (last = from->chunks; last && last->next; last = last->next)
+		;
+	if (last) {
+		if (to->chunks) {
+			last->next = to->chunks->next;
+			to->chunks->next = from->chunks;
+		} else
+			to->chunks = from->chunks;
+		from->chunks = NULL;
+	}
+	for (i = 0; i < from->strings_size; i++)
+		if (from->strings[i])
+			gp_widget_arena_add (to, from->strings[i]);
+	gp_widget_arena_free (from);
+}
+
+static void
+gp_widget_index_add (CameraWidgetArena *arena, CameraWidget *widget)
+{
+	unsigned int mask = arena->index_size - 1, h;
+	int x;
+
+	/* Visit in reverse depth-first order, so that pushing to the front
+	 * leaves each bucket in depth-first order. */
+	for (x = widget->children_count - 1; x >= 0; x--)
+		gp_widget_index_add (arena, widget->children[x]);
+
+	h = gp_widget_hash (widget->name) & mask;
+	widget->next_name = arena->by_name[h];
+	arena->by_name[h] = widget;
+	h = gp_widget_hash (widget->label) & mask;
+	widget->next_label = arena->by_label[h];
+	arena->by_label[h] = widget;
+	h = ((unsigned int) widget->id * 2654435761u) & mask;
+	widget->next_id = arena->by_id[h];
+	arena->by_id[h] = widget;
+}
+
+static int
+gp_widget_count_tree (CameraWidget *widget)
+{
+	int x, n = 1;
+
+	for (x = 0; x < widget->children_count; x++)
+		n += gp_widget_count_tree (widget->children[x]);
+	return n;
+}
+
+/* Returns the lookup index of the tree @widget is part of, or NULL if the
+ * tree should simply be walked. */
+static CameraWidgetArena *
+gp_widget_index (CameraWidget *widget)
+{
+	CameraWidget *root = gp_widget_root (widget);
+	CameraWidgetArena *arena = root->arena;
+	unsigned int size;
+
+	if (!arena)
+		return NULL;
+	if (arena->index_size)
+		return arena;
+
+	/* Trees that are searched while being built are cheaper to walk */
+	if (arena->lookups++ < 1)
+		return NULL;
+
+	for (size = 16; size < 2 * (unsigned int) gp_widget_count_tree (root); )
+		size *= 2;
+	arena->by_name  = calloc (size, sizeof (CameraWidget *));
+	arena->by_label = calloc (size, sizeof (CameraWidget *));
+	arena->by_id    = calloc (size, sizeof (CameraWidget *));
+	if (!arena->by_name || !arena->by_label || !arena->by_id) {
+		gp_widget_index_drop (arena);
+		return NULL;
+	}
+	arena->index_size = size;
+	gp_widget_index_add (arena, root);
+	return arena;
+}
+
+static int
+gp_widget_is_within (CameraWidget *widget, CameraWidget *top)
+{
+	for (; widget; widget = widget->parent)
+		if (widget == top)
+			return 1;
+	return 0;
+}
+
 /**
  * \brief Create a new widget.
  *
@@ -101,7 +390,13 @@ gp_widget_new (CameraWidgetType type, const char *label,
 	C_MEM (*widget = calloc (1, sizeof (CameraWidget)));
 
 	(*widget)->type = type;
-	strcpy ((*widget)->label, label);
+	(*widget)->name = (*widget)->info = "";
+	(*widget)->label = gp_widget_intern (*widget, label);
+	if (!(*widget)->label) {
+		free (*widget);
+		*widget = NULL;
+		return (GP_ERROR_NO_MEMORY);
+	}
 
 	/* set the value to nothing */
 	(*widget)->value_int    	= 0;
@@ -142,8 +437,9 @@ gp_widget_free (CameraWidget *widget)
 			gp_widget_free (widget->children[x]);
 		free (widget->children);
 	}
-	for (x = 0; x < widget->choice_count; x++)
-		free (widget->choice[x]);
+	if (widget->parent)
+		gp_widget_tree_changed (widget);
+	gp_widget_arena_free (widget->arena);
 	free (widget->choice);
 	free (widget->value_string);
 	free (widget);
@@ -218,7 +514,8 @@ gp_widget_set_info (CameraWidget *widget, const char *info)
 {
 	C_PARAMS (widget && info);
 
-	strcpy (widget->info, info);
+	C_MEM (info = gp_widget_intern (widget, info));
+	widget->info = info;
 	return (GP_OK);
 }
 
@@ -252,7 +549,9 @@ gp_widget_set_name (CameraWidget *widget, const char *name)
 {
 	C_PARAMS (widget && name);
 
-	strcpy (widget->name, name);
+	C_MEM (name = gp_widget_intern (widget, name));
+	widget->name = name;
+	gp_widget_tree_changed (widget);
 	return (GP_OK);
 }
 
@@ -481,6 +780,8 @@ gp_widget_append (CameraWidget *widget, CameraWidget *child)
 	widget->children_count += 1;
 	child->parent = widget;
 	child->changed = 0;
+	gp_widget_arena_merge (gp_widget_root (widget), child);
+	gp_widget_tree_changed (widget);
 
 	return (GP_OK);
 }
@@ -515,6 +816,8 @@ gp_widget_prepend (CameraWidget *widget, CameraWidget *child)
 	widget->children_count += 1;
 	child->parent = widget;
 	child->changed = 0;
+	gp_widget_arena_merge (gp_widget_root (widget), child);
+	gp_widget_tree_changed (widget);
 
 	return (GP_OK);
 }
@@ -554,6 +857,48 @@ gp_widget_get_child (CameraWidget *widget, int child_number,
 	return (GP_OK);
 }
 
+static CameraWidget *
+gp_widget_walk_by_label (CameraWidget *widget, const char *label)
+{
+	CameraWidget *found;
+	int x;
+
+	if (!strcmp (widget->label, label))
+		return widget;
+	for (x = 0; x < widget->children_count; x++)
+		if ((found = gp_widget_walk_by_label (widget->children[x], label)))
+			return found;
+	return NULL;
+}
+
+static CameraWidget *
+gp_widget_walk_by_id (CameraWidget *widget, int id)
+{
+	CameraWidget *found;
+	int x;
+
+	if (widget->id == id)
+		return widget;
+	for (x = 0; x < widget->children_count; x++)
+		if ((found = gp_widget_walk_by_id (widget->children[x], id)))
+			return found;
+	return NULL;
+}
+
+static CameraWidget *
+gp_widget_walk_by_name (CameraWidget *widget, const char *name)
+{
+	CameraWidget *found;
+	int x;
+
+	if (!strcmp (widget->name, name))
+		return widget;
+	for (x = 0; x < widget->children_count; x++)
+		if ((found = gp_widget_walk_by_name (widget->children[x], name)))
+			return found;
+	return NULL;
+}
+
 /**
  * \brief Retrieves the child with label \c label of the #CameraWidget
  *
@@ -567,28 +912,24 @@ int
 gp_widget_get_child_by_label (CameraWidget *widget, const char *label,
 			      CameraWidget **child)
 {
-	int x;
+	CameraWidgetArena *index;
+	CameraWidget *found = NULL;
 
 	C_PARAMS (widget && label && child);
 
-	if (strcmp (widget->label, label) == 0) {
-		*child = widget;
-		return (GP_OK);
-	}
-
-	for (x = 0; x < widget->children_count; x++) {
-		int result;
-		CameraWidget *child_rec;
-
-		result = gp_widget_get_child_by_label (widget->children[x],
-						       label, &child_rec);
-		if (result == GP_OK) {
-			*child = child_rec;
-			return (GP_OK);
-		}
-	}
-
-	return (GP_ERROR_BAD_PARAMETERS);
+	index = gp_widget_index (widget);
+	if (!index)
+		found = gp_widget_walk_by_label (widget, label);
+	else
+		for (found = index->by_label[gp_widget_hash (label) & (index->index_size - 1)];
+		     found; found = found->next_label)
+			if (!strcmp (found->label, label) &&
+			    gp_widget_is_within (found, widget))
+				break;
+	if (!found)
+		return (GP_ERROR_BAD_PARAMETERS);
+	*child = found;
+	return (GP_OK);
 }
 
 /**
@@ -603,28 +944,23 @@ gp_widget_get_child_by_label (CameraWidget *widget, const char *label,
 int
 gp_widget_get_child_by_id (CameraWidget *widget, int id, CameraWidget **child)
 {
-	int x;
+	CameraWidgetArena *index;
+	CameraWidget *found = NULL;
 
 	C_PARAMS (widget && child);
 
-	if (widget->id == id) {
-		*child = widget;
-		return (GP_OK);
-	}
-
-	for (x = 0; x < widget->children_count; x++) {
-		int result;
-		CameraWidget *child_rec;
-
-		result = gp_widget_get_child_by_id (widget->children[x], id,
-						    &child_rec);
-		if (result == GP_OK) {
-			*child = child_rec;
-			return (GP_OK);
-		}
-	}
-
-	return (GP_ERROR_BAD_PARAMETERS);
+	index = gp_widget_index (widget);
+	if (!index)
+		found = gp_widget_walk_by_id (widget, id);
+	else
+		for (found = index->by_id[((unsigned int) id * 2654435761u) & (index->index_size - 1)];
+		     found; found = found->next_id)
+			if ((found->id == id) && gp_widget_is_within (found, widget))
+				break;
+	if (!found)
+		return (GP_ERROR_BAD_PARAMETERS);
+	*child = found;
+	return (GP_OK);
 }
 
 /**
@@ -639,28 +975,24 @@ int
 gp_widget_get_child_by_name (CameraWidget *widget, const char *name,
 			     CameraWidget **child)
 {
-	int x;
+	CameraWidgetArena *index;
+	CameraWidget *found = NULL;
 
 	C_PARAMS (widget && child);
 
-	if (!strcmp (widget->name, name)) {
-		*child = widget;
-		return (GP_OK);
-	}
-
-	for (x = 0; x < widget->children_count; x++) {
-		int result;
-		CameraWidget *child_rec;
-
-		result = gp_widget_get_child_by_name (widget->children[x], name,
-						      &child_rec);
-		if (result == GP_OK) {
-			*child = child_rec;
-			return (GP_OK);
-		}
-	}
-
-	return (GP_ERROR_BAD_PARAMETERS);
+	index = gp_widget_index (widget);
+	if (!index)
+		found = gp_widget_walk_by_name (widget, name);
+	else
+		for (found = index->by_name[gp_widget_hash (name) & (index->index_size - 1)];
+		     found; found = found->next_name)
+			if (!strcmp (found->name, name) &&
+			    gp_widget_is_within (found, widget))
+				break;
+	if (!found)
+		return (GP_ERROR_BAD_PARAMETERS);
+	*child = found;
+	return (GP_OK);
 }
 
 /**
@@ -764,8 +1096,14 @@ gp_widget_add_choice (CameraWidget *widget, const char *choice)
 	C_PARAMS ((widget->type == GP_WIDGET_RADIO) ||
 		  (widget->type == GP_WIDGET_MENU));
 
-	C_MEM (widget->choice = realloc (widget->choice, sizeof(char*)*(widget->choice_count+1)));
-	widget->choice[widget->choice_count] = strdup(choice);
+	if (widget->choice_count == widget->choice_size) {
+		int size = widget->choice_size ? 2 * widget->choice_size : 8;
+
+		C_MEM (widget->choice = realloc (widget->choice, sizeof(char*)*size));
+		widget->choice_size = size;
+	}
+	C_MEM (choice = gp_widget_intern (widget, choice));
+	widget->choice[widget->choice_count] = choice;
 	widget->choice_count += 1;
 	return (GP_OK);
 }
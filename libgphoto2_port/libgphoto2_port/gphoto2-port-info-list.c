@@ -54,12 +54,35 @@
  *
  * The internals of this list are private.
  **/
+typedef struct _GPPortInfoPattern {
+#ifdef HAVE_REGEX
+	regex_t *re;		/* NULL if the path did not compile */
+#endif
+	unsigned int entry;
+} GPPortInfoPattern;
+
 struct _GPPortInfoList {
 	GPPortInfo *info;
 	unsigned int count;
 	unsigned int iolib_count;
+
+	/* Lookup index for gp_port_info_list_lookup_path, built on first use
+	 * and kept up to date by gp_port_info_list_append. */
+	int indexed;
+	unsigned int generation;	/* gp_port_info_generation at build time */
+	unsigned int *hash;		/* open addressing, entry index + 1 */
+	unsigned int hashsize;		/* power of 2 */
+	unsigned int *regular;		/* entry index -> index without generic entries */
+	unsigned int generic;		/* number of generic entries */
+	GPPortInfoPattern *patterns;	/* the generic entries, in list order */
+	unsigned int nrpatterns;
 };
 
+/* Bumped whenever a GPPortInfo is modified. Entries can still be modified
+ * after they were appended to a list, so this tells the lists that their
+ * lookup index might be stale. */
+static unsigned int gp_port_info_generation;
+
 #define CR(x)         {int r=(x);if (r<0) return (r);}
 
 
@@ -132,6 +155,145 @@ gp_port_message_codeset (const char *codeset) {
 					codeset);
 }
 
+static unsigned int
+path_hash (const char *path)
+{
+	unsigned int h = 5381;
+
+	while (*path)
+		h = h * 33 + (unsigned char)*path++;
+	return h;
+}
+
+static void
+index_free (GPPortInfoList *list)
+{
+	unsigned int i;
+
+	for (i = 0; i < list->nrpatterns; i++) {
+#ifdef HAVE_REGEX
+		if (list->patterns[i].re) {
+			regfree (list->patterns[i].re);
+			free (list->patterns[i].re);
+		}
+#endif
+	}
+	free (list->patterns);
+	list->patterns = NULL;
+	list->nrpatterns = 0;
+	free (list->hash);
+	list->hash = NULL;
+	list->hashsize = 0;
+	free (list->regular);
+	list->regular = NULL;
+	list->generic = 0;
+	list->indexed = 0;
+}
+
+static void
+index_insert (GPPortInfoList *list, unsigned int n)
+{
+	unsigned int mask = list->hashsize - 1;
+	unsigned int h = path_hash (list->info[n]->path) & mask;
+
+	while (list->hash[h]) {
+		/* The first entry with this path wins, like in a linear search. */
+		if (!strcmp (list->info[list->hash[h] - 1]->path, list->info[n]->path))
+			return;
+		h = (h + 1) & mask;
+	}
+	list->hash[h] = n + 1;
+}
+
+static int
+index_add_pattern (GPPortInfoList *list, unsigned int n)
+{
+	GPPortInfoPattern *pattern;
+#ifdef HAVE_REGEX
+	int result;
+#ifdef HAVE_GNU_REGEX
+	const char *rv;
+#endif
+#endif
+
+	C_MEM (list->patterns = realloc (list->patterns, sizeof (GPPortInfoPattern) * (list->nrpatterns + 1)));
+	pattern = &list->patterns[list->nrpatterns++];
+	pattern->entry = n;
+
+#ifdef HAVE_REGEX
+	C_MEM (pattern->re = calloc (1, sizeof (regex_t)));
+#ifdef HAVE_GNU_REGEX
+	rv = re_compile_pattern (list->info[n]->path,
+				 strlen (list->info[n]->path), pattern->re);
+	result = (rv != NULL);
+	if (rv)
+		GP_LOG_D ("%s", rv);
+#else
+	result = regcomp (pattern->re, list->info[n]->path, REG_ICASE);
+	if (result) {
+		char buf[1024];
+		if (regerror (result, pattern->re, buf, sizeof (buf)))
+			GP_LOG_E ("%s", buf);
+		else
+			GP_LOG_E ("regcomp failed");
+	}
+#endif
+	if (result) {
+		free (pattern->re);
+		pattern->re = NULL;
+	}
+#endif /* HAVE_REGEX */
+	return GP_OK;
+}
+
+/* Adds entry n, the last one of the list, to the lookup index. */
+static int
+index_add (GPPortInfoList *list, unsigned int n)
+{
+	unsigned int i;
+
+	C_MEM (list->regular = realloc (list->regular, sizeof (unsigned int) * (n + 1)));
+	list->regular[n] = n - list->generic;
+
+	if (!strlen (list->info[n]->name)) {
+		list->generic++;
+		return index_add_pattern (list, n);
+	}
+
+	/* Keep the table at most half full, rehash when growing. */
+	if (2 * (n + 1 - list->generic) > list->hashsize) {
+		unsigned int size = list->hashsize ? list->hashsize * 2 : 64;
+
+		free (list->hash);
+		C_MEM (list->hash = calloc (size, sizeof (unsigned int)));
+		list->hashsize = size;
+		for (i = 0; i < n; i++)
+			if (strlen (list->info[i]->name))
+				index_insert (list, i);
+	}
+	index_insert (list, n);
+	return GP_OK;
+}
+
+static int
+index_build (GPPortInfoList *list)
+{
+	unsigned int i;
+	int result;
+
+	index_free (list);
+	for (i = 0; i < list->count; i++) {
+		result = index_add (list, i);
+		if (result < 0) {
+			index_free (list);
+			return result;
+		}
+	}
+	list->generation = gp_port_info_generation;
+	list->indexed = 1;
+	return GP_OK;
+}
+
 /**
  * \brief Create a new GPPortInfoList
  *
@@ -187,6 +349,7 @@ gp_port_info_list_free (GPPortInfoList *list)
 		list->info = NULL;
 	}
 	list->count = 0;
+	index_free (list);
 
 	free (list);
 
@@ -219,6 +382,14 @@ gp_port_info_list_append (GPPortInfoList *list, GPPortInfo info)
 	list->count++;
 	list->info[list->count - 1] = info;
 
+	/* Keep an up-to-date lookup index current, otherwise drop it. */
+	if (list->indexed && (list->generation == gp_port_info_generation)) {
+		if (index_add (list, list->count - 1) == GP_OK)
+			return (list->count - 1 - list->generic);
+	}
+	if (list->indexed)
+		index_free (list);
+
 	/* Ignore generic entries */
 	for (generic = i = 0; i < list->count; i++)
 		if (!strlen (list->info[i]->name))
@@ -365,18 +536,19 @@ gp_port_info_list_count (GPPortInfoList *list)
  * can be found, a regex search will be performed in the hope some driver
  * claimed ports like "serial:*".
  *
+ * The exact paths are looked up in a hash table and the patterns of the
+ * generic entries are compiled only once. Both are built on the first
+ * lookup and kept up to date when entries are appended.
+ *
  * \return The index of the entry or a gphoto2 error code
  **/
 int
 gp_port_info_list_lookup_path (GPPortInfoList *list, const char *path)
 {
-	unsigned int i;
-	int result, generic;
+	unsigned int i, h;
+	int result;
 #ifdef HAVE_REGEX
-	regex_t pattern;
-#ifdef HAVE_GNU_REGEX
-	const char *rv;
-#else
+#ifndef HAVE_GNU_REGEX
 	regmatch_t match;
 #endif
 #endif
@@ -385,66 +557,66 @@ gp_port_info_list_lookup_path (GPPortInfoList *list, const char *path)
 
 	GP_LOG_D ("Looking for path '%s' (%i entries available)...", path, list->count);
 
+	if (!list->indexed || (list->generation != gp_port_info_generation))
+		CR (index_build (list));
+
 	/* Exact match? */
-	for (generic = i = 0; i < list->count; i++)
-		if (!strlen (list->info[i]->name))
-			generic++;
-		else if (!strcmp (list->info[i]->path, path))
-			return (i - generic);
+	if (list->hashsize) {
+		h = path_hash (path) & (list->hashsize - 1);
+		while (list->hash[h]) {
+			i = list->hash[h] - 1;
+			if (!strcmp (list->info[i]->path, path))
+				return (list->regular[i]);
+			h = (h + 1) & (list->hashsize - 1);
+		}
+	}
 
 #ifdef HAVE_REGEX
 	/* Regex match? */
 	GP_LOG_D ("Starting regex search for '%s'...", path);
-	for (i = 0; i < list->count; i++) {
-		GPPortInfo newinfo;
-
-		if (strlen (list->info[i]->name))
-			continue;
+	for (h = 0; h < list->nrpatterns; h++) {
+		GPPortInfo newinfo, generic;
 
-		GP_LOG_D ("Trying '%s'...", list->info[i]->path);
+		generic = list->info[list->patterns[h].entry];
+		GP_LOG_D ("Trying '%s'...", generic->path);
 
-		/* Compile the pattern */
+		if (!list->patterns[h].re) {
 #ifdef HAVE_GNU_REGEX
-		memset (&pattern, 0, sizeof (pattern));
-		rv = re_compile_pattern (list->info[i]->path,
-					 strlen (list->info[i]->path), &pattern);
-		if (rv) {
-			GP_LOG_D ("%s", rv);
 			continue;
-		}
 #else
-		result = regcomp (&pattern, list->info[i]->path, REG_ICASE);
-		if (result) {
-			char buf[1024];
-			if (regerror (result, &pattern, buf, sizeof (buf)))
-				GP_LOG_E ("%s", buf);
-			else
-				GP_LOG_E ("regcomp failed");
 			return (GP_ERROR_UNKNOWN_PORT);
-		}
 #endif
+		}
 
 		/* Try to match */
 #ifdef HAVE_GNU_REGEX
-		result = re_match (&pattern, path, strlen (path), 0, NULL);
-		regfree (&pattern);
+		result = re_match (list->patterns[h].re, path, strlen (path), 0, NULL);
 		if (result < 0) {
 			GP_LOG_D ("re_match failed (%i)", result);
 			continue;
 		}
 #else
-		result = regexec (&pattern, path, 1, &match, 0);
-		regfree (&pattern);
+		result = regexec (list->patterns[h].re, path, 1, &match, 0);
 		if (result) {
 			GP_LOG_D ("regexec failed");
 			continue;
 		}
 #endif
-		gp_port_info_new (&newinfo);
-		gp_port_info_set_type (newinfo, list->info[i]->type);
-		newinfo->library_filename = strdup(list->info[i]->library_filename);
-		gp_port_info_set_name (newinfo, _("Generic Port"));
-		gp_port_info_set_path (newinfo, path);
+		/* Fill in the new entry directly, the gp_port_info_set_*
+		 * functions would needlessly invalidate our index. */
+		CR (gp_port_info_new (&newinfo));
+		newinfo->type = generic->type;
+		if (generic->library_filename)
+			newinfo->library_filename = strdup (generic->library_filename);
+		newinfo->name = strdup (_("Generic Port"));
+		newinfo->path = strdup (path);
+		if (!newinfo->name || !newinfo->path) {
+			free (newinfo->library_filename);
+			free (newinfo->name);
+			free (newinfo->path);
+			free (newinfo);
+			return (GP_ERROR_NO_MEMORY);
+		}
 		CR (result = gp_port_info_list_append (list, newinfo));
 		return result;
 	}
@@ -541,6 +713,7 @@ gp_port_info_get_name (GPPortInfo info, char **name) {
  **/
 int
 gp_port_info_set_name (GPPortInfo info, const char *name) {
+	gp_port_info_generation++;
 	C_MEM (info->name = strdup (name));
 	return GP_OK;
 }
@@ -572,6 +745,7 @@ gp_port_info_get_path (GPPortInfo info, char **path) {
  **/
 int
 gp_port_info_set_path (GPPortInfo info, const char *path) {
+	gp_port_info_generation++;
 	C_MEM (info->path = strdup (path));
 	return GP_OK;
 }
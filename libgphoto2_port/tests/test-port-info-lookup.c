@@ -0,0 +1,122 @@
+/* test-port-info-lookup.c
+ *
+ * Checks gp_port_info_list_lookup_path on a large synthetic port list
+ * and reports how long the lookups take.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gphoto2/gphoto2-port.h>
+#include <gphoto2/gphoto2-port-result.h>
+#include <gphoto2/gphoto2-port-info-list.h>
+
+#define NR_ENTRIES	10000
+#define NR_ROUNDS	10
+
+#define CHECK(cond) do {						\
+	if (!(cond)) {							\
+		printf ("%s:%d: check failed: %s\n",			\
+			__FILE__, __LINE__, #cond);			\
+		return 1;						\
+	}								\
+} while (0)
+
+static int
+append (GPPortInfoList *list, GPPortType type, const char *name, const char *path)
+{
+	GPPortInfo info;
+
+	gp_port_info_new (&info);
+	gp_port_info_set_type (info, type);
+	gp_port_info_set_name (info, name);
+	gp_port_info_set_path (info, path);
+	return gp_port_info_list_append (list, info);
+}
+
+int
+main (void)
+{
+	GPPortInfoList	*list;
+	GPPortInfo	info;
+	char		path[64];
+	char		*xpath;
+	clock_t		start;
+	double		secs;
+	int		i, j, ret;
+
+	CHECK (gp_port_info_list_new (&list) == GP_OK);
+
+	/* Generic entries first, like the iolibs do it. */
+	append (list, GP_PORT_SERIAL, "", "^serial:");
+	for (i = 0; i < NR_ENTRIES; i++) {
+		snprintf (path, sizeof (path), "usb:%03d,%03d", i / 1000, i % 1000);
+		CHECK (append (list, GP_PORT_USB, "Universal Serial Bus", path) == i);
+	}
+	append (list, GP_PORT_USB, "", "^usb:");
+	/* A duplicate path, the first entry has to win. */
+	CHECK (append (list, GP_PORT_USB, "Duplicate", "usb:000,005") == NR_ENTRIES);
+
+	/* Exact matches */
+	for (i = 0; i < NR_ENTRIES; i++) {
+		snprintf (path, sizeof (path), "usb:%03d,%03d", i / 1000, i % 1000);
+		CHECK (gp_port_info_list_lookup_path (list, path) == i);
+	}
+
+	/* Generic matches add an entry, which is then found directly. */
+	ret = gp_port_info_list_lookup_path (list, "serial:/dev/ttyS0");
+	CHECK (ret == NR_ENTRIES + 1);
+	CHECK (gp_port_info_list_lookup_path (list, "serial:/dev/ttyS0") == ret);
+	CHECK (gp_port_info_list_get_info (list, ret, &info) == GP_OK);
+	gp_port_info_get_path (info, &xpath);
+	CHECK (!strcmp (xpath, "serial:/dev/ttyS0"));
+	CHECK (gp_port_info_list_lookup_path (list, "usb:999,999") == NR_ENTRIES + 2);
+	CHECK (gp_port_info_list_lookup_path (list, "ptpip:") == GP_ERROR_UNKNOWN_PORT);
+
+	/* Changing an entry after the lookup index was built. */
+	CHECK (gp_port_info_list_get_info (list, 42, &info) == GP_OK);
+	gp_port_info_set_path (info, "usb:renamed");
+	CHECK (gp_port_info_list_lookup_path (list, "usb:renamed") == 42);
+	CHECK (gp_port_info_list_lookup_path (list, "usb:000,042") == NR_ENTRIES + 3);
+
+	CHECK (gp_port_info_list_count (list) == NR_ENTRIES + 4);
+
+	start = clock ();
+	for (j = 0; j < NR_ROUNDS; j++)
+		for (i = 0; i < NR_ENTRIES; i++) {
+			snprintf (path, sizeof (path), "usb:%03d,%03d", i / 1000, i % 1000);
+			gp_port_info_list_lookup_path (list, path);
+		}
+	secs = (double)(clock () - start) / CLOCKS_PER_SEC;
+	printf ("%d exact lookups in a list of %d entries: %.3f s (%.0f ns each)\n",
+		NR_ROUNDS * NR_ENTRIES, gp_port_info_list_count (list), secs,
+		secs * 1e9 / (NR_ROUNDS * NR_ENTRIES));
+
+	start = clock ();
+	for (i = 0; i < NR_ENTRIES; i++)
+		gp_port_info_list_lookup_path (list, "disk:/nonexistent");
+	secs = (double)(clock () - start) / CLOCKS_PER_SEC;
+	printf ("%d failing lookups: %.3f s (%.0f ns each)\n",
+		NR_ENTRIES, secs, secs * 1e9 / NR_ENTRIES);
+
+	gp_port_info_list_free (list);
+	return 0;
+}
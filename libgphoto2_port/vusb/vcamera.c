@@ -167,6 +167,16 @@ ptp_senddata(vcamera *cam, uint16_t code, unsigned char *data, int bytes) {
 	put_16bit_le(offset+6,code);
 	put_32bit_le(offset+8,cam->seqnr);
 	memcpy(offset+12,data,bytes);
+
+	if (cam->fault_count && (cam->fault_left < 0) && ((unsigned int)size > cam->fault_offset)) {
+		if (cam->fault_skip) {
+			cam->fault_skip--;
+			return;
+		}
+		cam->fault_count--;
+		cam->fault_left = (offset - cam->inbulk) + cam->fault_offset;
+		gp_log (GP_LOG_DEBUG, __FUNCTION__, "breaking off data phase of 0x%04x after %u of %d bytes", code, cam->fault_offset, size);
+	}
 }
 
 static void
@@ -209,10 +219,13 @@ ptp_response(vcamera *cam, uint16_t code, int nparams, ...) {
 #define PTP_RC_NoThumbnailPresent			0x2010
 #define PTP_RC_StoreNotAvailable			0x2013
 #define PTP_RC_SpecificationByFormatUnsupported         0x2014
+#define PTP_RC_NoValidObjectInfo			0x2015
 #define PTP_RC_InvalidParentObject			0x201A
 #define PTP_RC_InvalidDevicePropFormat			0x201B
 #define PTP_RC_InvalidParameter				0x201D
 #define PTP_RC_SessionAlreadyOpened     		0x201E
+#define PTP_RC_DeviceBusy				0x2019
+#define PTP_RC_NIKON_NotLiveView			0xA00B
 
 #define CHECK_PARAM_COUNT(x)											\
 	if (ptp->nparams != x) {										\
@@ -245,8 +258,12 @@ static int ptp_getstorageids_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getstorageinfo_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getobjectinfo_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getobject_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_getpartialobject_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getthumb_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_deleteobject_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_sendobjectinfo_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_sendobjectinfo_write_data(vcamera *cam, ptpcontainer *ptp, unsigned char *data, unsigned int len);
+static int ptp_sendobject_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getdevicepropdesc_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_getdevicepropvalue_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_setdevicepropvalue_write(vcamera *cam, ptpcontainer *ptp);
@@ -254,6 +271,11 @@ static int ptp_setdevicepropvalue_write_data(vcamera *cam, ptpcontainer *ptp, un
 static int ptp_initiatecapture_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_vusb_write(vcamera *cam, ptpcontainer *ptp);
 static int ptp_nikon_setcontrolmode_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_nikon_deviceready_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_nikon_getevent_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_nikon_startliveview_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_nikon_endliveview_write(vcamera *cam, ptpcontainer *ptp);
+static int ptp_nikon_getliveviewimg_write(vcamera *cam, ptpcontainer *ptp);
 
 static struct ptp_function {
 	int	code;
@@ -271,15 +293,23 @@ static struct ptp_function {
 	{0x1009,	ptp_getobject_write, 		NULL			},
 	{0x100A,	ptp_getthumb_write, 		NULL			},
 	{0x100B,	ptp_deleteobject_write, 	NULL			},
+	{0x100C,	ptp_sendobjectinfo_write, 	ptp_sendobjectinfo_write_data	},
+	{0x100D,	ptp_sendobject_write, 		NULL			},
 	{0x100E,	ptp_initiatecapture_write, 	NULL			},
 	{0x1014,	ptp_getdevicepropdesc_write, 	NULL			},
 	{0x1015,	ptp_getdevicepropvalue_write, 	NULL			},
 	{0x1016,	ptp_setdevicepropvalue_write, 	ptp_setdevicepropvalue_write_data	},
+	{0x101B,	ptp_getpartialobject_write, 	NULL			},
 	{0x9999,	ptp_vusb_write, 		NULL			},
 };
 
 static struct ptp_function ptp_functions_nikon_dslr[] = {
 	{0x90c2,	ptp_nikon_setcontrolmode_write, NULL			},
+	{0x90c7,	ptp_nikon_getevent_write,	NULL			},
+	{0x90c8,	ptp_nikon_deviceready_write,	NULL			},
+	{0x9201,	ptp_nikon_startliveview_write,	NULL			},
+	{0x9202,	ptp_nikon_endliveview_write,	NULL			},
+	{0x9203,	ptp_nikon_getliveviewimg_write,	NULL			},
 };
 
 static struct ptp_map_functions {
@@ -355,6 +385,10 @@ static int ptp_fnumber_setvalue(vcamera*,PTPPropertyValue*);
 static int ptp_exposurebias_getdesc(vcamera*,PTPDevicePropDesc*);
 static int ptp_exposurebias_getvalue(vcamera*,PTPPropertyValue*);
 static int ptp_exposurebias_setvalue(vcamera*,PTPPropertyValue*);
+static int ptp_liveviewstatus_getdesc(vcamera*,PTPDevicePropDesc*);
+static int ptp_liveviewstatus_getvalue(vcamera*,PTPPropertyValue*);
+static int ptp_liveviewprohibit_getdesc(vcamera*,PTPDevicePropDesc*);
+static int ptp_liveviewprohibit_getvalue(vcamera*,PTPPropertyValue*);
 
 static struct ptp_property {
 	int	code;
@@ -368,6 +402,8 @@ static struct ptp_property {
 	{0x5010,	ptp_exposurebias_getdesc, ptp_exposurebias_getvalue, ptp_exposurebias_setvalue },
 	{0x500d,	ptp_shutterspeed_getdesc, ptp_shutterspeed_getvalue, ptp_shutterspeed_setvalue },
 	{0x5011,	ptp_datetime_getdesc, ptp_datetime_getvalue, ptp_datetime_setvalue },
+	{0xd1a2,	ptp_liveviewstatus_getdesc, ptp_liveviewstatus_getvalue, NULL },
+	{0xd1a4,	ptp_liveviewprohibit_getdesc, ptp_liveviewprohibit_getvalue, NULL },
 };
 
 struct ptp_dirent {
@@ -468,6 +504,113 @@ ptp_nikon_setcontrolmode_write(vcamera *cam, ptpcontainer *ptp) {
 	return 1;
 }
 
+static int
+ptp_nikon_deviceready_write(vcamera *cam, ptpcontainer *ptp) {
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+
+	ptp_response (cam, PTP_RC_OK, 0);
+	return 1;
+}
+
+/* Events are sent on the interrupt pipe only, like the Coolpix P2 does. */
+static int
+ptp_nikon_getevent_write(vcamera *cam, ptpcontainer *ptp) {
+	unsigned char	data[2];
+
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+
+	put_16bit_le (data, 0);	/* no events */
+	ptp_senddata (cam, 0x90c7, data, sizeof(data));
+	ptp_response (cam, PTP_RC_OK, 0);
+	return 1;
+}
+
+/* The live view sensor delivers a new frame every 40ms plus up to 20ms of
+ * jitter. Until the next frame is there, GetLiveViewImg answers DeviceBusy. */
+#define LIVEVIEW_PERIOD		40000
+#define LIVEVIEW_JITTER		20000
+#define LIVEVIEW_HEADER		384
+#define LIVEVIEW_SIZE		(LIVEVIEW_HEADER + 64*1024)
+
+static void
+liveview_next_frame (vcamera *cam) {
+	cam->liveview_seed = cam->liveview_seed * 1103515245 + 12345;
+	cam->liveview_next.tv_usec += LIVEVIEW_PERIOD + (cam->liveview_seed >> 16) % LIVEVIEW_JITTER;
+	cam->liveview_next.tv_sec  += cam->liveview_next.tv_usec / 1000000;
+	cam->liveview_next.tv_usec %= 1000000;
+}
+
+static int
+liveview_frame_ready (vcamera *cam, const struct timeval *now) {
+	return (now->tv_sec > cam->liveview_next.tv_sec) ||
+	       ((now->tv_sec == cam->liveview_next.tv_sec) && (now->tv_usec >= cam->liveview_next.tv_usec));
+}
+
+static int
+ptp_nikon_startliveview_write(vcamera *cam, ptpcontainer *ptp) {
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+
+	if (!cam->liveview) {
+		cam->liveview = 1;
+		cam->liveview_seed = 1;
+		gettimeofday (&cam->liveview_next, NULL);
+		liveview_next_frame (cam);
+	}
+	ptp_response (cam, PTP_RC_OK, 0);
+	return 1;
+}
+
+static int
+ptp_nikon_endliveview_write(vcamera *cam, ptpcontainer *ptp) {
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+
+	cam->liveview = 0;
+	ptp_response (cam, PTP_RC_OK, 0);
+	return 1;
+}
+
+static int
+ptp_nikon_getliveviewimg_write(vcamera *cam, ptpcontainer *ptp) {
+	unsigned char	*data;
+	struct timeval	now;
+
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+
+	if (!cam->liveview) {
+		ptp_response (cam, PTP_RC_NIKON_NotLiveView, 0);
+		return 1;
+	}
+	gettimeofday (&now, NULL);
+	if (!liveview_frame_ready (cam, &now)) {
+		ptp_response (cam, PTP_RC_DeviceBusy, 0);
+		return 1;
+	}
+	/* each frame is handed out once, later ones follow the sensor clock */
+	while (liveview_frame_ready (cam, &now))
+		liveview_next_frame (cam);
+
+	/* Nikon header, followed by a JPEG SOI ... EOI */
+	data = calloc (1, LIVEVIEW_SIZE);
+	if (!data) {
+		ptp_response (cam, PTP_RC_GeneralError, 0);
+		return 1;
+	}
+	data[LIVEVIEW_HEADER]    = 0xff;
+	data[LIVEVIEW_HEADER+1]  = 0xd8;
+	data[LIVEVIEW_SIZE-2]    = 0xff;
+	data[LIVEVIEW_SIZE-1]    = 0xd9;
+	ptp_senddata (cam, 0x9203, data, LIVEVIEW_SIZE);
+	free (data);
+
+	ptp_response (cam, PTP_RC_OK, 0);
+	return 1;
+}
+
 static int
 ptp_opensession_write(vcamera *cam, ptpcontainer *ptp) {
 	CHECK_PARAM_COUNT(1);
@@ -810,6 +953,75 @@ ptp_getstorageinfo_write(vcamera *cam, ptpcontainer *ptp) {
 	return 1;
 }
 
+#ifndef HAVE_LIBEXIF
+/*
+ * Without libexif, look for the thumbnail in the EXIF APP1 segment of a
+ * JPEG file directly: it is the JPEG that starts with the first SOI after
+ * the TIFF header and ends with the last EOI inside the segment. Returns
+ * the thumbnail in *thumb (malloc'ed) and its size, or 0 if there is none.
+ */
+static int
+vcam_exif_thumbnail(struct ptp_dirent *cur, unsigned char **thumb) {
+	unsigned char	*data;
+	unsigned int	size, pos = 2, seglen, start, end, i, len = 0;
+	int		fd;
+
+	*thumb = NULL;
+	size = cur->stbuf.st_size;
+	if (size > 65536 + 4)	/* SOI and an APP1 segment of at most 64k */
+		size = 65536 + 4;
+	data = malloc(size);
+	if (!data)
+		return 0;
+	fd = open(cur->fsname,O_RDONLY);
+	if (fd == -1) {
+		free (data);
+		return 0;
+	}
+	if ((int)size != read(fd, data, size)) {
+		free (data);
+		close (fd);
+		return 0;
+	}
+	close (fd);
+
+	if ((size < 4) || (data[0] != 0xff) || (data[1] != 0xd8)) {
+		free (data);
+		return 0;
+	}
+	while (pos + 4 <= size && data[pos] == 0xff && data[pos + 1] != 0xda) {
+		seglen = (data[pos + 2] << 8) | data[pos + 3];
+		if (pos + 2 + seglen > size)
+			break;
+		if ((data[pos + 1] == 0xe1) && (seglen >= 8) &&
+		    !memcmp (data + pos + 4, "Exif\0\0", 6)) {
+			start = pos + 10;
+			end = pos + 2 + seglen;
+			for (i = start; i + 1 < end; i++)
+				if ((data[i] == 0xff) && (data[i + 1] == 0xd8))
+					break;
+			start = i;
+			for (i = end - 2; i > start && i + 1 < end; i--)
+				if ((data[i] == 0xff) && (data[i + 1] == 0xd9)) {
+					len = i + 2 - start;
+					break;
+				}
+			if (len) {
+				*thumb = malloc(len);
+				if (*thumb)
+					memcpy (*thumb, data + start, len);
+				else
+					len = 0;
+			}
+			break;
+		}
+		pos += 2 + seglen;
+	}
+	free (data);
+	return len;
+}
+#endif
+
 static int
 ptp_getobjectinfo_write(vcamera *cam, ptpcontainer *ptp) {
 	struct ptp_dirent	*cur;
@@ -917,6 +1129,15 @@ ptp_getobjectinfo_write(vcamera *cam, ptpcontainer *ptp) {
 		exif_data_unref (ed);
 		free (filedata);
 	}
+#else
+	if (ofc == 0x3801) {
+		unsigned char	*thumb;
+
+		thumbsize = vcam_exif_thumbnail (cur, &thumb);
+		if (thumbsize)
+			thumbofc = 0x3808;
+		free (thumb);
+	}
 #endif
 	x += put_16bit_le (data+x, ofc);
 	x += put_16bit_le (data+x, 0); 			/* ProtectionStatus, no protection */
@@ -1000,6 +1221,69 @@ ptp_getobject_write(vcamera *cam, ptpcontainer *ptp) {
 	return 1;
 }
 
+static int
+ptp_getpartialobject_write(vcamera *cam, ptpcontainer *ptp) {
+	unsigned char 		*data;
+	struct ptp_dirent	*cur;
+	unsigned int		offset, size;
+	int			fd;
+
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+	CHECK_PARAM_COUNT(3);
+
+	cur = first_dirent;
+	while (cur) {
+		if (cur->id == ptp->params[0]) break;
+		cur = cur->next;
+	}
+	if (!cur) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "invalid object id 0x%08x", ptp->params[0]);
+		ptp_response(cam,PTP_RC_InvalidObjectHandle,0);
+		return 1;
+	}
+	offset = ptp->params[1];
+	if (offset > cur->stbuf.st_size) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "offset %u beyond the end of %s", offset, cur->fsname);
+		ptp_response(cam,PTP_RC_InvalidParameter,0);
+		return 1;
+	}
+	size = cur->stbuf.st_size - offset;
+	if (size > ptp->params[2])
+		size = ptp->params[2];
+	if (cam->short_count && (size > cam->short_size)) {
+		if (cam->short_skip)
+			cam->short_skip--;
+		else {
+			cam->short_count--;
+			size = cam->short_size;
+			gp_log (GP_LOG_DEBUG, __FUNCTION__, "returning only %u bytes at offset %u", size, offset);
+		}
+	}
+
+	data = malloc(size ? size : 1);
+	fd =  open(cur->fsname,O_RDONLY);
+	if (fd == -1) {
+		free (data);
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "could not open %s", cur->fsname);
+		ptp_response(cam,PTP_RC_GeneralError,0);
+		return 1;
+	}
+	if ((lseek(fd, offset, SEEK_SET) != offset) || (size != read(fd, data, size))) {
+		free (data);
+		close (fd);
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "could not read data of %s", cur->fsname);
+		ptp_response(cam,PTP_RC_GeneralError,0);
+		return 1;
+	}
+	close (fd);
+
+	ptp_senddata (cam, 0x101B, data, size);
+	free (data);
+	ptp_response (cam, PTP_RC_OK, 1, size);
+	return 1;
+}
+
 static int
 ptp_getthumb_write(vcamera *cam, ptpcontainer *ptp) {
 	unsigned char 		*data;
@@ -1064,8 +1348,21 @@ ptp_getthumb_write(vcamera *cam, ptpcontainer *ptp) {
 
 	ptp_response (cam, PTP_RC_OK, 0);
 #else
-	gp_log (GP_LOG_ERROR, __FUNCTION__, "Cannot get thumbnail without libexif, lying about missing thumbnail");
-	ptp_response(cam,PTP_RC_NoThumbnailPresent,0);
+	{
+		unsigned char	*thumb;
+		int		thumbsize;
+
+		thumbsize = vcam_exif_thumbnail (cur, &thumb);
+		if (!thumbsize) {
+			gp_log (GP_LOG_ERROR, __FUNCTION__, "EXIF data does not contain a thumbnail");
+			free (data);
+			ptp_response(cam,PTP_RC_NoThumbnailPresent,0);
+			return 1;
+		}
+		ptp_senddata (cam, 0x100A, thumb, thumbsize);
+		free (thumb);
+		ptp_response (cam, PTP_RC_OK, 0);
+	}
 #endif
 	free (data);
 	return 1;
@@ -1242,6 +1539,140 @@ ptp_deleteobject_write(vcamera *cam, ptpcontainer *ptp) {
 }
 
 
+/* The object announced by the last SendObjectInfo, waiting for its data */
+static struct ptp_dirent	*sendobject_dirent = NULL;
+static int			sendobject_fd = -1;
+static int			sendobject_failed = 0;
+/* Bytes of the SendObject data phase still to be received */
+static unsigned int		sendobject_left = 0;
+
+static int
+ptp_sendobjectinfo_write(vcamera *cam, ptpcontainer *ptp) {
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+	CHECK_PARAM_COUNT(2);
+
+	if ((ptp->params[0] != 0) && (ptp->params[0] != 0x00010001)) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "invalid storage id 0x%08x", ptp->params[0]);
+		ptp_response (cam, PTP_RC_InvalidStorageId, 0);
+		return 1;
+	}
+	/* so ... we wait for the data phase */
+	return 1;
+}
+
+static int
+ptp_sendobjectinfo_write_data(vcamera *cam, ptpcontainer *ptp, unsigned char *data, unsigned int len) {
+	struct ptp_dirent	*cur, *parent;
+	uint32_t		parentid = ptp->params[1];
+	uint16_t		ofc;
+	char			*name;
+
+	if ((len < 53) || (len < 53 + 2*data[52])) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "objectinfo of %d bytes is too short", len);
+		ptp_response (cam, PTP_RC_GeneralError, 0);
+		return 1;
+	}
+	if (parentid == 0xffffffff)
+		parentid = 0;
+	parent = first_dirent;
+	while (parent) {
+		if (parent->id == parentid) break;
+		parent = parent->next;
+	}
+	if (!parent || !S_ISDIR(parent->stbuf.st_mode)) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "invalid parent object 0x%08x", ptp->params[1]);
+		ptp_response (cam, PTP_RC_InvalidParentObject, 0);
+		return 1;
+	}
+	ofc = get_16bit_le (data+4);
+	name = get_string (data+52);
+	if (!strlen(name) || strchr(name,'/') || !strcmp(name,".") || !strcmp(name,"..")) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "invalid filename '%s'", name);
+		free (name);
+		ptp_response (cam, PTP_RC_InvalidParameter, 0);
+		return 1;
+	}
+
+	cur = malloc(sizeof(struct ptp_dirent));
+	cur->name = name;
+	cur->fsname = malloc(strlen(parent->fsname)+1+strlen(name)+1);
+	strcpy(cur->fsname,parent->fsname);
+	strcat(cur->fsname,"/");
+	strcat(cur->fsname,name);
+	cur->parent = parent;
+
+	if (ofc == 0x3001) { /* association, create the directory right away */
+		if ((-1 == mkdir(cur->fsname, 0755)) && (errno != EEXIST)) {
+			gp_log (GP_LOG_ERROR,__FUNCTION__, "could not create %s", cur->fsname);
+			free_dirent (cur);
+			ptp_response (cam, PTP_RC_AccessDenied, 0);
+			return 1;
+		}
+	} else {
+		if (sendobject_fd != -1)
+			close (sendobject_fd);
+		sendobject_fd = open(cur->fsname, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+		if (sendobject_fd == -1) {
+			gp_log (GP_LOG_ERROR,__FUNCTION__, "could not create %s", cur->fsname);
+			free_dirent (cur);
+			ptp_response (cam, PTP_RC_AccessDenied, 0);
+			return 1;
+		}
+		sendobject_dirent = cur;
+		sendobject_failed = 0;
+	}
+	stat(cur->fsname, &cur->stbuf);
+	cur->id = ptp_objectid++;
+	cur->next = first_dirent;
+	first_dirent = cur;
+
+	ptp_response (cam, PTP_RC_OK, 3, 0x00010001, parent->id, cur->id);
+	return 1;
+}
+
+static int
+ptp_sendobject_write(vcamera *cam, ptpcontainer *ptp) {
+	CHECK_SEQUENCE_NUMBER();
+	CHECK_SESSION();
+	CHECK_PARAM_COUNT(0);
+
+	if (!sendobject_dirent) {
+		gp_log (GP_LOG_ERROR,__FUNCTION__, "no SendObjectInfo before SendObject");
+		ptp_response (cam, PTP_RC_NoValidObjectInfo, 0);
+		return 1;
+	}
+	/* so ... we wait for the data phase, see ptp_sendobject_data */
+	return 1;
+}
+
+/* The SendObject data phase is written to the file as it arrives instead of
+ * being collected in outbulk first, so large uploads do not need to fit
+ * into memory. */
+static void
+ptp_sendobject_data(vcamera *cam, const unsigned char *data, unsigned int len) {
+	while (len && !sendobject_failed) {
+		ssize_t	ret = write (sendobject_fd, data, len);
+
+		if (ret <= 0) {
+			gp_log (GP_LOG_ERROR,__FUNCTION__, "writing to %s failed", sendobject_dirent->fsname);
+			sendobject_failed = 1;
+			break;
+		}
+		data += ret;
+		len -= ret;
+	}
+	if (sendobject_left)
+		return;
+
+	close (sendobject_fd);
+	sendobject_fd = -1;
+	stat(sendobject_dirent->fsname, &sendobject_dirent->stbuf);
+	sendobject_dirent = NULL;
+	ptp_response (cam, sendobject_failed ? PTP_RC_StoreFull : PTP_RC_OK, 0);
+}
+
+
 static int
 put_propval (unsigned char *data, uint16_t type, PTPPropertyValue *val) {
 	switch (type) {
@@ -1405,6 +1836,24 @@ ptp_vusb_write(vcamera *cam, ptpcontainer *ptp) {
 		ptp_response (cam, PTP_RC_InvalidParameter, 0);
 		return 1;
 	}
+	if (ptp->params[0] == 3) {
+		/* break off the next data phases, see README.txt */
+		cam->fault_offset = (ptp->nparams >= 2) ? ptp->params[1] : 0;
+		cam->fault_count = (ptp->nparams >= 3) ? ptp->params[2] : 1;
+		cam->fault_skip = (ptp->nparams >= 4) ? ptp->params[3] : 0;
+		gp_log (GP_LOG_DEBUG, __FUNCTION__, "breaking off %u data phases after %u bytes, %u intact ones first", cam->fault_count, cam->fault_offset, cam->fault_skip);
+		ptp_response (cam, PTP_RC_OK, 0);
+		return 1;
+	}
+	if (ptp->params[0] == 4) {
+		/* cut the next GetPartialObject replies short, see README.txt */
+		cam->short_size = (ptp->nparams >= 2) ? ptp->params[1] : 0;
+		cam->short_count = (ptp->nparams >= 3) ? ptp->params[2] : 1;
+		cam->short_skip = (ptp->nparams >= 4) ? ptp->params[3] : 0;
+		gp_log (GP_LOG_DEBUG, __FUNCTION__, "cutting %u partial object replies to %u bytes, %u full ones first", cam->short_count, cam->short_size, cam->short_skip);
+		ptp_response (cam, PTP_RC_OK, 0);
+		return 1;
+	}
 	if (ptp->nparams >= 2) {
 		timeout = ptp->params[1];
 		gp_log (GP_LOG_DEBUG, __FUNCTION__, "new timeout %d", timeout);
@@ -1779,6 +2228,40 @@ ptp_datetime_setvalue (vcamera* cam, PTPPropertyValue *val) {
 	return 1;
 }
 
+static int
+ptp_liveviewstatus_getdesc (vcamera* cam, PTPDevicePropDesc *desc) {
+	desc->DevicePropertyCode	= 0xd1a2;
+	desc->DataType			= 2;	/* uint8 */
+	desc->GetSet			= 0;	/* Get only */
+	desc->FactoryDefaultValue.u8	= 0;
+	desc->CurrentValue.u8		= cam->liveview;
+	desc->FormFlag			= 0;	/* none */
+	return 1;
+}
+
+static int
+ptp_liveviewstatus_getvalue (vcamera* cam, PTPPropertyValue *val) {
+	val->u8 = cam->liveview;
+	return 1;
+}
+
+static int
+ptp_liveviewprohibit_getdesc (vcamera* cam, PTPDevicePropDesc *desc) {
+	desc->DevicePropertyCode	= 0xd1a4;
+	desc->DataType			= 6;	/* uint32 */
+	desc->GetSet			= 0;	/* Get only */
+	desc->FactoryDefaultValue.u32	= 0;
+	desc->CurrentValue.u32		= 0;	/* nothing prohibits live view */
+	desc->FormFlag			= 0;	/* none */
+	return 1;
+}
+
+static int
+ptp_liveviewprohibit_getvalue (vcamera* cam, PTPPropertyValue *val) {
+	val->u32 = 0;
+	return 1;
+}
+
 
 /********************************************************************************************/
 
@@ -1830,6 +2313,19 @@ vcam_process_output(vcamera *cam) {
 		return; /* wait for more data */
 
 	ptp.size = get_32bit_le (cam->outbulk);
+
+	if (	sendobject_dirent && (ptp.size >= 12) && (cam->nroutbulk >= 12) &&
+		(get_16bit_le (cam->outbulk+4) == 2) && (get_16bit_le (cam->outbulk+6) == 0x100D)
+	) {
+		unsigned int	len = MIN(ptp.size, cam->nroutbulk);
+
+		/* the data phase of SendObject, stream it out to the file */
+		sendobject_left = ptp.size - len;
+		ptp_sendobject_data (cam, cam->outbulk+12, len-12);
+		memmove (cam->outbulk, cam->outbulk+len, cam->nroutbulk-len);
+		cam->nroutbulk -= len;
+		return;
+	}
 	if (ptp.size > cam->nroutbulk)
 		return; /* wait for more data */
 
@@ -1976,8 +2472,19 @@ vcam_read(vcamera*cam, int ep, unsigned char *data, int bytes) {
 
 	/* Emulated PTP camera stuff */
 
+	if (cam->fault_left == 0) {
+		/* the transfer breaks off, the rest never arrives */
+		gp_log (GP_LOG_DEBUG, __FUNCTION__, "injected read error");
+		cam->fault_left = -1;
+		cam->nrinbulk = 0;
+		return GP_ERROR_IO_READ;
+	}
 	if (toread > cam->nrinbulk)
 		toread = cam->nrinbulk;
+	if ((cam->fault_left > 0) && (toread > cam->fault_left))
+		toread = cam->fault_left;
+	if (cam->fault_left > 0)
+		cam->fault_left -= toread;
 
 	memcpy (data, cam->inbulk, toread);
 	memmove (cam->inbulk, cam->inbulk + toread, (cam->nrinbulk - toread));
@@ -1985,8 +2492,33 @@ vcam_read(vcamera*cam, int ep, unsigned char *data, int bytes) {
 	return toread;
 }
 
+/* PTP device reset class request: forget the pending transfers and close
+ * the session, the host opens a new one */
+static int
+vcam_reset(vcamera*cam) {
+	gp_log (GP_LOG_DEBUG, __FUNCTION__, "device reset");
+	cam->nrinbulk = 0;
+	cam->nroutbulk = 0;
+	cam->fault_left = -1;
+	cam->session = 0;
+	cam->seqnr = 0;
+	return GP_OK;
+}
+
 static int vcam_write(vcamera*cam, int ep, const unsigned char *data, int bytes) {
+	int	len = bytes;
+
 	/*gp_log_data("vusb", data, bytes, "data, vcam_write");*/
+	if (sendobject_left) {
+		unsigned int	towrite = MIN((unsigned int)bytes, sendobject_left);
+
+		sendobject_left -= towrite;
+		ptp_sendobject_data (cam, data, towrite);
+		data += towrite;
+		bytes -= towrite;
+		if (!bytes)
+			return len;
+	}
 	if (!cam->outbulk) {
 		cam->outbulk = malloc(bytes);
 	} else {
@@ -1997,7 +2529,7 @@ static int vcam_write(vcamera*cam, int ep, const unsigned char *data, int bytes)
 
 	vcam_process_output(cam);
 
-	return bytes;
+	return len;
 }
 
 struct ptp_interrupt {
@@ -2099,6 +2631,11 @@ vcam_readint(vcamera*cam, unsigned char *data, int bytes, int timeout) {
 	newtimeout = (first_interrupt->triggertime.tv_sec - now.tv_sec)*1000 + (first_interrupt->triggertime.tv_usec - now.tv_usec)/1000;
 	if (newtimeout > timeout)
 		gp_log (GP_LOG_ERROR, __FUNCTION__, "miscalculated? %d vs %d", timeout, newtimeout);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+	/* like a real device, deliver the interrupt at its trigger time */
+	if (newtimeout > 0)
+		usleep (1000*newtimeout);
+#endif
 	tocopy = first_interrupt->size;
 	if (tocopy > bytes)
 		tocopy = bytes;
@@ -2117,7 +2654,10 @@ vcamera_new(vcameratype type) {
 	cam = calloc(1,sizeof(vcamera));
 	if (!cam) return NULL;
 
-	read_tree(VCAMERADIR);
+	if (getenv("VCAMERADIR"))	/* lets the test suite bring its own files */
+		read_tree(getenv("VCAMERADIR"));
+	else
+		read_tree(VCAMERADIR);
 
 	cam->init = vcam_init;
 	cam->exit = vcam_exit;
@@ -2127,9 +2667,11 @@ vcamera_new(vcameratype type) {
 	cam->read = vcam_read;
 	cam->readint = vcam_readint;
 	cam->write = vcam_write;
+	cam->reset = vcam_reset;
 
 	cam->type = type;
 	cam->seqnr = 0;
+	cam->fault_left = -1;
 
 	return cam;
 }
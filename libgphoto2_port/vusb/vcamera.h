@@ -25,6 +25,7 @@
 #undef FUZZ_PTP
 
 #include <stdio.h>
+#include <sys/time.h>
 
 typedef struct ptpcontainer {
 	unsigned int size;
@@ -49,6 +50,7 @@ typedef struct vcamera {
 	int (*read)(struct vcamera*,  int ep, unsigned char *data, int bytes);
 	int (*readint)(struct vcamera*,  unsigned char *data, int bytes, int timeout);
 	int (*write)(struct vcamera*, int ep, const unsigned char *data, int bytes);
+	int (*reset)(struct vcamera*);
 
 	unsigned short	vendor, product;	/* for generic fuzzing */
 
@@ -67,6 +69,23 @@ typedef struct vcamera {
 	unsigned int	shutterspeed;
 	unsigned int	fnumber;
 
+	int		liveview;
+	unsigned int	liveview_seed;
+	struct timeval	liveview_next;
+
+	/* data phases still to break off, after how many bytes, and how
+	 * many intact ones go first */
+	unsigned int	fault_count;
+	unsigned int	fault_offset;
+	unsigned int	fault_skip;
+	/* bytes left until the data phase in the bulk queue breaks, -1 if none does */
+	int		fault_left;
+	/* GetPartialObject replies still to cut short, to how many bytes,
+	 * and how many full ones go first */
+	unsigned int	short_count;
+	unsigned int	short_size;
+	unsigned int	short_skip;
+
 	int		fuzzmode;
 #define FUZZMODE_PROTOCOL	0
 #define FUZZMODE_NORMAL		1
@@ -252,7 +252,9 @@ static int
 gp_port_vusb_msg_class_write_lib(GPPort *port, int request,
         int value, int index, char *bytes, int size)
 {
-	gp_log(GP_LOG_DEBUG,__FUNCTION__,"()");
+	gp_log(GP_LOG_DEBUG,__FUNCTION__,"(req=%x)", request);
+	if (request == 0x66)	/* PTP device reset */
+		return port->pl->vcamera->reset(port->pl->vcamera);
 	return GP_OK;
 }
 
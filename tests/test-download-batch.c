@@ -0,0 +1,229 @@
+/* test-download-batch.c
+ *
+ * Downloads the files of the vusb virtual camera once with a
+ * gp_camera_file_get loop and once with gp_camera_download_batch, prints
+ * how long each of them took and checks what the batch wrote: complete
+ * copies of all files, existing files left alone with
+ * GP_DOWNLOAD_BATCH_SKIP_EXISTING, and missing camera files reported
+ * without touching a local file of the same name.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+#define FILES	300
+#define SIZE	8192
+
+static int results[FILES + 1];
+
+static void
+batch_func (Camera *camera, unsigned int index, const CameraFilePath *path,
+	    int result, void *data)
+{
+	results[index] = result;
+}
+
+static double
+now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* compares a downloaded file with file index of the camera */
+static int
+same_file (const char *tree, const char *dest, unsigned int index)
+{
+	unsigned char	*want, *have;
+	unsigned long	size;
+	char		path[1024];
+	struct stat	st;
+	FILE		*f;
+	int		same = 0;
+
+	if (vusb_tree_read (tree, index, &want, &size) < GP_OK)
+		return 0;
+	snprintf (path, sizeof (path), "%s/IMG_%04u.JPG", dest, index);
+	if (!stat (path, &st) && (st.st_size == size) && (f = fopen (path, "rb"))) {
+		have = malloc (size);
+		same = have && (fread (have, 1, size, f) == size) && !memcmp (have, want, size);
+		free (have);
+		fclose (f);
+	}
+	free (want);
+	return same;
+}
+
+static int
+write_text (const char *dest, const char *name, const char *text)
+{
+	char	path[1024];
+	FILE	*f;
+
+	snprintf (path, sizeof (path), "%s/%s", dest, name);
+	if (!(f = fopen (path, "w")))
+		return 0;
+	fputs (text, f);
+	fclose (f);
+	return 1;
+}
+
+static int
+has_text (const char *dest, const char *name, const char *text)
+{
+	char	path[1024], buf[64] = "";
+	FILE	*f;
+
+	snprintf (path, sizeof (path), "%s/%s", dest, name);
+	if (!(f = fopen (path, "r")))
+		return 0;
+	if (!fgets (buf, sizeof (buf), f))
+		buf[0] = '\0';
+	fclose (f);
+	return !strcmp (buf, text);
+}
+
+static void
+remove_dir (const char *dir)
+{
+	char		path[1024];
+	unsigned int	i;
+
+	for (i = 0; i < FILES; i++) {
+		snprintf (path, sizeof (path), "%s/IMG_%04u.JPG", dir, i);
+		unlink (path);
+	}
+	snprintf (path, sizeof (path), "%s/NOPE.JPG", dir);
+	unlink (path);
+	rmdir (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	CameraFilePath	paths[FILES + 1];
+	CameraFile	*file;
+	char		tree[1024], loopdir[1024], dest[1024], path[1024];
+	const char	*tmp = getenv ("TMPDIR");
+	double		start;
+	int		i, fd, ret, failed = 0;
+
+	context = gp_context_new ();
+	CHECK (vusb_tree_new (tree, sizeof (tree), FILES, SIZE));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (tree, FILES);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+
+	snprintf (loopdir, sizeof (loopdir), "%s/gphoto2-loop-XXXXXX", tmp ? tmp : "/tmp");
+	snprintf (dest, sizeof (dest), "%s/gphoto2-batch-XXXXXX", tmp ? tmp : "/tmp");
+	if (!mkdtemp (loopdir) || !mkdtemp (dest)) {
+		perror ("mkdtemp");
+		return (1);
+	}
+	for (i = 0; i < FILES; i++) {
+		strcpy (paths[i].folder, VUSB_FOLDER);
+		sprintf (paths[i].name, "IMG_%04d.JPG", i);
+	}
+
+	start = now ();
+	for (i = 0; i < FILES; i++) {
+		snprintf (path, sizeof (path), "%s/%s", loopdir, paths[i].name);
+		fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1) {
+			perror (path);
+			return (1);
+		}
+		CHECK (gp_file_new_from_fd (&file, fd));
+		CHECK (gp_camera_file_get (camera, paths[i].folder, paths[i].name,
+					   GP_FILE_TYPE_NORMAL, file, context));
+		gp_file_unref (file);
+	}
+	printf ("gp_camera_file_get loop: %.3f s for %d files\n", now () - start, FILES);
+
+	/* a complete batch */
+	start = now ();
+	CHECK (gp_camera_download_batch (camera, paths, FILES, dest, 0,
+					 batch_func, NULL, context));
+	printf ("gp_camera_download_batch: %.3f s for %d files\n", now () - start, FILES);
+	for (i = 0; i < FILES; i++)
+		if ((results[i] != GP_OK) || !same_file (tree, dest, i)) {
+			printf ("FAIL: %s was not downloaded right\n", paths[i].name);
+			failed++;
+		}
+
+	/* existing files are skipped and this is no error */
+	if (!write_text (dest, paths[7].name, "keep"))
+		return (1);
+	ret = gp_camera_download_batch (camera, paths, FILES, dest,
+					GP_DOWNLOAD_BATCH_SKIP_EXISTING |
+					GP_DOWNLOAD_BATCH_STOP_ON_ERROR,
+					batch_func, NULL, context);
+	if ((ret != GP_OK) || (results[FILES - 1] != GP_OK)) {
+		printf ("FAIL: skipping existing files returned %d\n", ret);
+		failed++;
+	}
+	if (!has_text (dest, paths[7].name, "keep")) {
+		printf ("FAIL: existing file was overwritten\n");
+		failed++;
+	}
+
+	/* a file the camera does not have leaves a local one alone */
+	strcpy (paths[FILES].folder, VUSB_FOLDER);
+	strcpy (paths[FILES].name, "NOPE.JPG");
+	if (!write_text (dest, "NOPE.JPG", "keep"))
+		return (1);
+	ret = gp_camera_download_batch (camera, paths + FILES - 1, 2, dest, 0,
+					batch_func, NULL, context);
+	if ((ret != GP_ERROR_FILE_NOT_FOUND) || (results[0] != GP_OK) ||
+	    (results[1] != GP_ERROR_FILE_NOT_FOUND)) {
+		printf ("FAIL: missing file gave %d (%d, %d)\n", ret, results[0], results[1]);
+		failed++;
+	}
+	if (!has_text (dest, "NOPE.JPG", "keep")) {
+		printf ("FAIL: local file of a missing camera file was touched\n");
+		failed++;
+	}
+
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	remove_dir (loopdir);
+	remove_dir (dest);
+	vusb_tree_free (tree, FILES);
+	return (failed != 0);
+}
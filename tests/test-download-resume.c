@@ -0,0 +1,223 @@
+/* test-download-resume.c
+ *
+ * Breaks off transfers of the vusb virtual camera in the middle of an
+ * object and checks that the download still delivers the exact bytes:
+ * once when the ptp2 driver retries the partial read by itself, and once
+ * when the retries run out and the caller continues with
+ * gp_camera_file_get_resume() at the offset it got to. Also checks that
+ * replies shorter than asked for in the middle of the file do not end
+ * the download early, and that a file ending early is an error.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+/* more than the 1 MiB chunks of gp_camera_file_get_resume() */
+#define SIZE	(3 * 1024 * 1024 + 1234)
+#define NAME	"IMG_0000.JPG"
+
+/* Makes the vcamera break off count transfers after 32 KiB, after
+ * letting the first skip transfers through */
+static int
+break_transfers (Camera *camera, unsigned int count, unsigned int skip,
+		 GPContext *context)
+{
+	CameraWidget	*widget;
+	char		opcode[64];
+
+	CHECK (gp_camera_get_single_config (camera, "opcode", &widget, context));
+	snprintf (opcode, sizeof (opcode), "0x9999,0x3,0x8000,0x%x,0x%x", count, skip);
+	CHECK (gp_widget_set_value (widget, opcode));
+	CHECK (gp_camera_set_single_config (camera, "opcode", widget, context));
+	gp_widget_free (widget);
+	return (0);
+}
+
+/* Makes the vcamera return only size bytes for count GetPartialObject
+ * requests, after answering the first skip ones in full */
+static int
+short_reads (Camera *camera, unsigned int size, unsigned int count,
+	     unsigned int skip, GPContext *context)
+{
+	CameraWidget	*widget;
+	char		opcode[64];
+
+	CHECK (gp_camera_get_single_config (camera, "opcode", &widget, context));
+	snprintf (opcode, sizeof (opcode), "0x9999,0x4,0x%x,0x%x,0x%x", size, count, skip);
+	CHECK (gp_widget_set_value (widget, opcode));
+	CHECK (gp_camera_set_single_config (camera, "opcode", widget, context));
+	gp_widget_free (widget);
+	return (0);
+}
+
+static int
+same_data (const char *path, const unsigned char *want, unsigned long size)
+{
+	unsigned char	*have;
+	struct stat	st;
+	FILE		*f;
+	int		same = 0;
+
+	if (!stat (path, &st) && (st.st_size == size) && (f = fopen (path, "rb"))) {
+		have = malloc (size);
+		same = have && (fread (have, 1, size, f) == size) && !memcmp (have, want, size);
+		free (have);
+		fclose (f);
+	}
+	return same;
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	CameraFile	*file;
+	unsigned char	*want;
+	unsigned long	size;
+	char		tree[1024], path[1024];
+	const char	*tmp = getenv ("TMPDIR");
+	struct stat	st;
+	int		fd, ret, failed = 0;
+
+	context = gp_context_new ();
+	CHECK (vusb_tree_new (tree, sizeof (tree), 1, SIZE));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (tree, 1);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+	CHECK (vusb_tree_read (tree, 0, &want, &size));
+	snprintf (path, sizeof (path), "%s/gphoto2-resume-XXXXXX", tmp ? tmp : "/tmp");
+	fd = mkstemp (path);
+	if (fd == -1) {
+		perror ("mkstemp");
+		return (1);
+	}
+
+	/* the second chunk breaks off once, the driver retries it */
+	CHECK (break_transfers (camera, 1, 1, context));
+	CHECK (gp_file_new_from_fd (&file, fd));
+	ret = gp_camera_file_get_resume (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, 0, context);
+	gp_file_unref (file);
+	close (fd);
+	if ((ret != GP_OK) || !same_data (path, want, size)) {
+		printf ("FAIL: retried download returned %d or differs\n", ret);
+		failed++;
+	}
+
+	/* the second chunk breaks off more often than the driver retries,
+	 * the caller resumes where the file ends */
+	fd = open (path, O_WRONLY | O_TRUNC);
+	if (fd == -1) {
+		perror (path);
+		return (1);
+	}
+	CHECK (break_transfers (camera, 10, 1, context));
+	CHECK (gp_file_new_from_fd (&file, fd));
+	ret = gp_camera_file_get_resume (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, 0, context);
+	gp_file_unref (file);
+	close (fd);
+	if (ret == GP_OK) {
+		printf ("FAIL: download did not break off\n");
+		failed++;
+	}
+	if (stat (path, &st) || (st.st_size != 1024 * 1024)) {
+		printf ("FAIL: expected the first 1 MiB before the break\n");
+		failed++;
+	}
+	printf ("download broke off after %lu bytes (%s)\n",
+		(unsigned long)st.st_size, gp_result_as_string (ret));
+
+	/* no more breaks, continue at the end of the file */
+	CHECK (break_transfers (camera, 0, 0, context));
+	fd = open (path, O_WRONLY | O_APPEND);
+	if (fd == -1) {
+		perror (path);
+		return (1);
+	}
+	CHECK (gp_file_new_from_fd (&file, fd));
+	ret = gp_camera_file_get_resume (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, st.st_size,
+					 context);
+	gp_file_unref (file);
+	close (fd);
+	if ((ret != GP_OK) || !same_data (path, want, size)) {
+		printf ("FAIL: resumed download returned %d or differs\n", ret);
+		failed++;
+	}
+
+	/* the camera returns less than asked for in the middle of the file,
+	 * the download goes on to the end */
+	CHECK (short_reads (camera, 0x1000, 2, 1, context));
+	fd = open (path, O_WRONLY | O_TRUNC);
+	if (fd == -1) {
+		perror (path);
+		return (1);
+	}
+	CHECK (gp_file_new_from_fd (&file, fd));
+	ret = gp_camera_file_get_resume (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, 0, context);
+	gp_file_unref (file);
+	close (fd);
+	if ((ret != GP_OK) || !same_data (path, want, size)) {
+		printf ("FAIL: download with short reads returned %d or differs\n", ret);
+		failed++;
+	}
+
+	/* nothing at all before the end of the file is an error */
+	CHECK (short_reads (camera, 0, 1, 1, context));
+	fd = open (path, O_WRONLY | O_TRUNC);
+	if (fd == -1) {
+		perror (path);
+		return (1);
+	}
+	CHECK (gp_file_new_from_fd (&file, fd));
+	ret = gp_camera_file_get_resume (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, 0, context);
+	gp_file_unref (file);
+	close (fd);
+	if (ret == GP_OK) {
+		printf ("FAIL: download of a file that ended early succeeded\n");
+		failed++;
+	}
+	CHECK (short_reads (camera, 0, 0, 0, context));
+
+	unlink (path);
+	free (want);
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	vusb_tree_free (tree, 1);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,112 @@
+/* test-event-latency.c
+ *
+ * Lets the vusb virtual camera send a CaptureComplete event some time
+ * after it was asked to, and measures how late gp_camera_wait_for_event
+ * reports it. The vcamera gets its Nikon events from the interrupt pipe
+ * only, so this goes through the back-off loop of the Nikon branch. With
+ * that loop blocking on the pipe the event is seen right away instead of
+ * after the current back-off sleep.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+#define TRIALS	5
+#define DELAY	700	/* ms, long enough for the back-off to reach its maximum */
+
+static double
+now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	CameraWidget	*widget;
+	CameraEventType	type;
+	void		*data;
+	char		dir[1024], opcode[32];
+	double		start, late, sum = 0, max = 0;
+	int		i, ret;
+
+	context = gp_context_new ();
+	CHECK (vusb_tree_new (dir, sizeof (dir), 1, 1024));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (dir, 1);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+
+	/* drain what the camera sends on its own after connecting */
+	do {
+		CHECK (gp_camera_wait_for_event (camera, 10, &type, &data, context));
+		free (data);
+	} while (type != GP_EVENT_TIMEOUT);
+
+	CHECK (gp_camera_get_single_config (camera, "opcode", &widget, context));
+	snprintf (opcode, sizeof (opcode), "0x9999,0x2,0x%x", DELAY);
+	CHECK (gp_widget_set_value (widget, opcode));
+
+	for (i = 0; i < TRIALS; i++) {
+		start = now ();
+		CHECK (gp_camera_set_single_config (camera, "opcode", widget, context));
+		do {
+			CHECK (gp_camera_wait_for_event (camera, 2*DELAY, &type, &data, context));
+			free (data);
+			if (type == GP_EVENT_TIMEOUT) {
+				printf ("FAIL: no CaptureComplete event\n");
+				return (1);
+			}
+		} while (type != GP_EVENT_CAPTURE_COMPLETE);
+		late = (now () - start) * 1e3 - DELAY;
+		printf ("event %d reported %.1f ms after it was sent\n", i, late);
+		sum += late;
+		if (late > max)
+			max = late;
+	}
+	printf ("latency: mean %.1f ms, max %.1f ms\n", sum / TRIALS, max);
+
+	gp_widget_free (widget);
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	vusb_tree_free (dir, 1);
+
+	/* sleeping between the polls makes this 50ms and more */
+	if (sum / TRIALS > 25) {
+		printf ("FAIL: events are seen late\n");
+		return (1);
+	}
+	return (0);
+}
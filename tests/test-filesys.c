@@ -54,6 +54,20 @@ error_func (GPContext __unused__ *context, const char *str, void __unused__ *dat
 	printf ("### %s\n", str);
 }
 
+/* The filesystem passes parent folders with a trailing slash while it
+ * walks down to a dirty folder, compare without it */
+static int
+is_folder (const char *folder, const char *name)
+{
+	size_t len = strlen (name);
+
+	if (strncmp (folder, name, len))
+		return (0);
+	while (folder[len] == '/')
+		len++;
+	return (!folder[len]);
+}
+
 static int
 set_info_func (CameraFilesystem __unused__ *fs, const char __unused__ *folder,
 	       const char __unused__ *file,
@@ -84,7 +98,7 @@ file_list_func (CameraFilesystem __unused__ *fs, const char *folder,
 {
 	printf ("### -> The camera will list the files in '%s' here.\n", folder);
 
-	if (!strcmp (folder, "/whatever")) {
+	if (is_folder (folder, "/whatever")) {
 		gp_list_append (list, "file1", NULL);
 		gp_list_append (list, "file2", NULL);
 		gp_list_append (list, "file3", NULL);
@@ -104,17 +118,17 @@ folder_list_func (CameraFilesystem __unused__ *fs, const char *folder,
 	printf ("### -> The camera will list the folders in '%s' here.\n",
 		folder);
 
-	if (!strcmp (folder, "/")) {
+	if (is_folder (folder, "/")) {
 		gp_list_append (list, "whatever", NULL);
 		gp_list_append (list, "another", NULL);
 	}
 
-	if (!strcmp (folder, "/whatever")) {
+	if (is_folder (folder, "/whatever")) {
 		gp_list_append (list, "directory", NULL);
 		gp_list_append (list, "dir", NULL);
 	}
 
-	if (!strcmp (folder, "/whatever/directory")) {
+	if (is_folder (folder, "/whatever/directory")) {
 		gp_list_append (list, "my_special_folder", NULL);
 	}
 
@@ -282,6 +296,31 @@ main ()
 
 	gp_filesystem_dump (fs);
 
+	printf ("*** Removing a file from the cache only...\n");
+	CHECK (gp_filesystem_remove_file_cached (fs, "/whatever", "file2", context));
+	CHECK (count = gp_filesystem_count (fs, "/whatever", context));
+	if (count != 2) {
+		printf ("Expected 2 cached files in '/whatever', got %i\n", count);
+		return (1);
+	}
+
+	printf ("*** Adding and removing cached folders...\n");
+	CHECK (gp_filesystem_add_folder_cached (fs, "/whatever", "newdir", context));
+	CHECK (gp_filesystem_add_folder_cached (fs, "/whatever", "newdir", context));
+	CHECK (gp_filesystem_remove_folder_cached (fs, "/whatever", "directory", context));
+	CHECK (gp_filesystem_list_folders (fs, "/whatever", list, context));
+	CHECK (count = gp_list_count (list));
+	if (count != 2) {
+		printf ("Expected 2 cached folders in '/whatever', got %i\n", count);
+		return (1);
+	}
+
+	printf ("*** Updating folders that are not cached is a no-op...\n");
+	CHECK (gp_filesystem_remove_file_cached (fs, "/another", "file1", context));
+	CHECK (gp_filesystem_add_folder_cached (fs, "/nonexistent", "dir", context));
+
+	gp_filesystem_dump (fs);
+
 	printf ("*** Freeing file system...\n");
 	CHECK (gp_filesystem_free (fs));
 
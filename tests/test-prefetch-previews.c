@@ -0,0 +1,157 @@
+/* test-prefetch-previews.c
+ *
+ * Fills the preview cache of a vusb folder with
+ * gp_camera_folder_prefetch_previews() and checks that the byte budget
+ * holds without fetching a preview that does not fit, that the cached
+ * previews are returned by gp_camera_file_get() without asking the camera
+ * again, and that the data is the thumbnail stored in the files.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+#define FILES	12
+#define SIZE	16384
+#define PREVIEW	3000
+#define BUDGET	(3 * PREVIEW + PREVIEW / 2)
+
+static int thumb_requests;
+
+/* counts the GetThumb requests the ptp2 driver sends */
+static void
+log_func (GPLogLevel level, const char *domain, const char *str, void *data)
+{
+	if (strstr (str, "Sending PTP_OC 0x100a "))
+		thumb_requests++;
+}
+
+/* Gets the preview of file index and compares it with the tree. Returns
+ * the number of GetThumb requests it took, or -1 on failure. */
+static int
+get_preview (Camera *camera, const char *tree, unsigned int index, GPContext *context)
+{
+	CameraFile	*file;
+	const char	*data;
+	unsigned char	*want;
+	unsigned long	size, want_size;
+	char		name[32];
+	int		ret, before = thumb_requests;
+
+	snprintf (name, sizeof (name), "IMG_%04u.JPG", index);
+	gp_file_new (&file);
+	ret = gp_camera_file_get (camera, VUSB_FOLDER, name, GP_FILE_TYPE_PREVIEW,
+				  file, context);
+	if ((ret < GP_OK) || (vusb_tree_read_preview (tree, index, &want, &want_size) < GP_OK)) {
+		printf ("FAIL: preview of %s: %s\n", name, gp_result_as_string (ret));
+		gp_file_unref (file);
+		return (-1);
+	}
+	gp_file_get_data_and_size (file, &data, &size);
+	ret = (size == want_size) && !memcmp (data, want, size);
+	free (want);
+	gp_file_unref (file);
+	if (!ret) {
+		printf ("FAIL: preview of %s differs\n", name);
+		return (-1);
+	}
+	return (thumb_requests - before);
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	char		tree[1024];
+	int		i, ret, counted, failed = 0;
+
+	context = gp_context_new ();
+	CHECK (vusb_tree_new_with_previews (tree, sizeof (tree), FILES, SIZE, PREVIEW));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (tree, FILES);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+	/* without debug logging, only the data and the budget are checked */
+	counted = gp_log_add_func (GP_LOG_DEBUG, log_func, NULL) > 0;
+
+	/* three previews fit, the fourth is not even fetched */
+	thumb_requests = 0;
+	ret = gp_camera_folder_prefetch_previews (camera, VUSB_FOLDER, BUDGET, context);
+	if (ret != 3) {
+		printf ("FAIL: %d previews cached within %d bytes, expected 3\n", ret, BUDGET);
+		failed++;
+	}
+	if (counted && (thumb_requests != 3)) {
+		printf ("FAIL: %d previews fetched within %d bytes, expected 3\n",
+			thumb_requests, BUDGET);
+		failed++;
+	}
+
+	/* the cached ones come without asking the camera */
+	for (i = 0; i < 3; i++) {
+		ret = get_preview (camera, tree, i, context);
+		if (ret < 0)
+			failed++;
+		else if (counted && ret) {
+			printf ("FAIL: cached preview %d fetched again\n", i);
+			failed++;
+		}
+	}
+	ret = get_preview (camera, tree, 3, context);
+	if (ret < 0)
+		failed++;
+	else if (counted && (ret != 1)) {
+		printf ("FAIL: preview 3 took %d requests, expected 1\n", ret);
+		failed++;
+	}
+
+	/* no budget, the whole folder */
+	ret = gp_camera_folder_prefetch_previews (camera, VUSB_FOLDER, 0, context);
+	if (ret != FILES) {
+		printf ("FAIL: %d previews cached without a budget, expected %d\n", ret, FILES);
+		failed++;
+	}
+	for (i = 0; i < FILES; i++) {
+		ret = get_preview (camera, tree, i, context);
+		if (ret < 0)
+			failed++;
+		else if (counted && ret) {
+			printf ("FAIL: cached preview %d fetched again\n", i);
+			failed++;
+		}
+	}
+
+	if (!failed)
+		printf ("%d previews cached and returned\n", FILES);
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	vusb_tree_free (tree, FILES);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,168 @@
+/* test-preview-rate.c
+ *
+ * Fetches preview frames from the live view of the vusb vcamera with
+ * gp_camera_capture_preview_ex(), which has a new frame every 40-60ms,
+ * and checks that they came at the requested frame rate. Also checks that
+ * cancelling the context ends the sleep before a frame. Run with a number
+ * of frames and a frame rate (0 for as fast as possible) to print where
+ * the time went for other rates.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+#define FRAMES	20
+#define FPS	10
+
+static int cancel;
+
+static GPContextFeedback
+cancel_func (GPContext *context, void *data)
+{
+	return (cancel ? GP_CONTEXT_FEEDBACK_CANCEL : GP_CONTEXT_FEEDBACK_OK);
+}
+
+static double
+now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Fetches frames at fps and prints where the time went. Returns the mean
+ * interval in seconds, or a negative value on failure. */
+static double
+run (Camera *camera, CameraFile *file, int frames, unsigned int fps, GPContext *context)
+{
+	CameraPreviewInfo	info;
+	unsigned int		busy = 0;
+	double			start, last = 0, interval, sum = 0, min = 1e9, max = 0;
+	double			transfer = 0, wait = 0, governor = 0;
+	int			i, ret;
+
+	/* the first frame starts live view and the schedule, do not count it */
+	ret = gp_camera_capture_preview_ex (camera, file, fps, &info, context);
+	for (i = 0; (ret >= GP_OK) && (i < frames); i++) {
+		ret = gp_camera_capture_preview_ex (camera, file, fps, &info, context);
+		start = now ();
+		if (i) {
+			interval = start - last;
+			sum += interval;
+			if (interval < min) min = interval;
+			if (interval > max) max = interval;
+		}
+		last = start;
+		busy     += info.busy;
+		transfer += info.transfer_usec / 1e3;
+		wait     += info.wait_usec / 1e3;
+		governor += info.governor_usec / 1e3;
+	}
+	if (ret < GP_OK) {
+		printf ("ERROR: %s\n", gp_result_as_string (ret));
+		return (-1);
+	}
+	interval = sum / (frames - 1);
+	printf ("%d frames of %lu bytes at %u fps requested\n", frames, info.size, fps);
+	printf ("interval: mean %.1f ms, min %.1f ms, max %.1f ms (%.1f fps)\n",
+		interval * 1e3, min * 1e3, max * 1e3, 1 / interval);
+	printf ("per frame: transfer %.2f ms, busy wait %.2f ms in %.2f polls, governor %.2f ms\n",
+		transfer / frames, wait / frames, (double)busy / frames, governor / frames);
+	return (interval);
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	CameraFile	*file;
+	CameraPreviewInfo info;
+	char		tree[1024];
+	unsigned int	fps = FPS;
+	double		interval, start;
+	int		ret, frames = FRAMES, failed = 0;
+
+	if (argc == 3) {
+		frames = atoi (argv[1]);
+		fps = atoi (argv[2]);
+	} else if (argc != 1) {
+		printf ("Usage: %s [<frames> <fps>]\n", argv[0]);
+		return (1);
+	}
+	if (frames < 2) {
+		printf ("Need at least 2 frames.\n");
+		return (1);
+	}
+
+	context = gp_context_new ();
+	gp_context_set_cancel_func (context, cancel_func, NULL);
+	CHECK (vusb_tree_new (tree, sizeof (tree), 1, 1024));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (tree, 1);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+	CHECK (gp_file_new (&file));
+
+	interval = run (camera, file, frames, fps, context);
+	/* within 10% of the requested interval */
+	if (interval < 0)
+		failed++;
+	else if (fps && ((interval * fps < 0.9) || (interval * fps > 1.1))) {
+		printf ("FAIL: requested %.1f ms\n", 1e3 / fps);
+		failed++;
+	}
+
+	/* the next frame is due in a frame interval, a cancel ends the wait */
+	if (fps && (argc == 1)) {
+		CHECK (gp_camera_capture_preview_ex (camera, file, fps, &info, context));
+		cancel = 1;
+		start = now ();
+		ret = gp_camera_capture_preview_ex (camera, file, fps, &info, context);
+		start = now () - start;
+		cancel = 0;
+		if (ret != GP_ERROR_CANCEL) {
+			printf ("FAIL: cancelled wait returned %s\n", gp_result_as_string (ret));
+			failed++;
+		} else if (start * fps > 0.5) {
+			printf ("FAIL: cancelled wait took %.1f ms\n", start * 1e3);
+			failed++;
+		} else
+			printf ("cancelled wait ended after %.1f ms\n", start * 1e3);
+	}
+
+	gp_file_unref (file);
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	vusb_tree_free (tree, 1);
+	return (failed ? 1 : 0);
+}
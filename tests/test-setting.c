@@ -0,0 +1,146 @@
+/* test-setting.c
+ *
+ * Exercises gp_setting_set/gp_setting_get/gp_setting_flush with a large
+ * number of keys, and checks that the settings file stays complete when
+ * the process writing it gets killed.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#include <gphoto2/gphoto2-setting.h>
+#include <gphoto2/gphoto2-result.h>
+
+#define NR_KEYS		10000
+#define NR_KILLS	20
+
+#define CHECK(r) if (!(r)) { fprintf(stderr,"%s:%d: result unexpected.\n",__FILE__,__LINE__); exit(1); }
+
+static char settings_file[1024];
+
+/* Checks that every line of the settings file is complete and that all
+ * the NR_KEYS settings written by the first pass are in it. */
+static void
+check_settings_file (void)
+{
+	FILE	*f;
+	char	buf[1024], value[64];
+	int	found = 0, n;
+
+	CHECK ((f = fopen (settings_file, "r")) != NULL);
+	while (fgets (buf, sizeof (buf), f)) {
+		CHECK (buf[strlen (buf) - 1] == '\n');
+		CHECK (strchr (buf, '=') && strchr (strchr (buf, '=') + 1, '='));
+		if (sscanf (buf, "test=key%d=%63s", &n, value) == 2) {
+			CHECK (n == atoi (value));
+			found++;
+		}
+	}
+	fclose (f);
+	CHECK (found == NR_KEYS);
+}
+
+int
+main ()
+{
+#ifdef WIN32
+	return 77;
+#else
+	char	dir[] = "test-setting.XXXXXX";
+	char	home[1024], key[32], value[32], buf[1100];
+	clock_t	start;
+	int	i, round;
+
+	CHECK (mkdtemp (dir) != NULL);
+	CHECK (getcwd (home, sizeof (home) - sizeof (dir) - 1) != NULL);
+	strcat (home, "/");
+	strcat (home, dir);
+	setenv ("HOME", home, 1);
+	snprintf (settings_file, sizeof (settings_file), "%s/.gphoto/settings", home);
+
+	start = clock ();
+	for (i = 0; i < NR_KEYS; i++) {
+		snprintf (key, sizeof (key), "key%d", i);
+		snprintf (value, sizeof (value), "%d", i);
+		CHECK (gp_setting_set ("test", key, value) == GP_OK);
+	}
+	CHECK (gp_setting_flush () == GP_OK);
+	printf ("%d new settings: %.3f s\n", NR_KEYS,
+		(double)(clock () - start) / CLOCKS_PER_SEC);
+
+	start = clock ();
+	for (i = 0; i < NR_KEYS; i++) {
+		snprintf (value, sizeof (value), "%d", i);
+		CHECK (gp_setting_set ("test", "counter", value) == GP_OK);
+	}
+	CHECK (gp_setting_flush () == GP_OK);
+	printf ("%d updates of one setting: %.3f s\n", NR_KEYS,
+		(double)(clock () - start) / CLOCKS_PER_SEC);
+
+	for (i = 0; i < NR_KEYS; i++) {
+		snprintf (key, sizeof (key), "key%d", i);
+		CHECK (gp_setting_get ("test", key, buf) == GP_OK);
+		CHECK (atoi (buf) == i);
+	}
+	CHECK (gp_setting_get ("test", "counter", buf) == GP_OK);
+	CHECK (atoi (buf) == NR_KEYS - 1);
+	CHECK (gp_setting_get ("test", "nonexistent", buf) == GP_ERROR);
+	check_settings_file ();
+
+	/* Kill writers at random points, the file must stay complete. */
+	srand (time (NULL));
+	for (round = 0; round < NR_KILLS; round++) {
+		pid_t pid = fork ();
+
+		CHECK (pid != -1);
+		if (!pid) {
+			unsigned int gen;
+
+			for (gen = 0; ; gen++) {
+				for (i = 0; i < 1000; i++) {
+					snprintf (key, sizeof (key), "crash%d", i);
+					snprintf (value, sizeof (value), "%u", gen);
+					gp_setting_set ("crash", key, value);
+				}
+				gp_setting_flush ();
+			}
+		}
+		usleep (1000 + rand () % 20000);
+		kill (pid, SIGKILL);
+		waitpid (pid, NULL, 0);
+		check_settings_file ();
+	}
+
+	unlink (settings_file);
+	snprintf (buf, sizeof (buf), "%s.tmp", settings_file);
+	unlink (buf);
+	snprintf (buf, sizeof (buf), "%s/.gphoto", home);
+	rmdir (buf);
+	rmdir (home);
+	return (0);
+#endif
+}
@@ -0,0 +1,191 @@
+/* test-upload.c
+ *
+ * Uploads a file backed by a file descriptor to the vusb virtual camera
+ * with gp_camera_folder_put_file(), and checks that the bytes stored in
+ * the camera's tree are the ones of the file and that the upload reported
+ * its progress along the way.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <gphoto2/gphoto2-camera.h>
+
+#include "vusb-camera.h"
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s\n", gp_result_as_string (res)); return (1);}}
+
+/* several of the upload chunks of the ptp2 driver, and not a multiple */
+#define SIZE	(5 * 1024 * 1024 + 777)
+#define NAME	"UPLOAD.JPG"
+
+static unsigned int	starts, updates, stops, backwards;
+static float		target, current;
+
+static unsigned int
+progress_start (GPContext *context, float t, const char *text, void *data)
+{
+	starts++;
+	target = t;
+	current = 0;
+	return (starts);
+}
+
+static void
+progress_update (GPContext *context, unsigned int id, float c, void *data)
+{
+	updates++;
+	if (c < current)
+		backwards++;
+	current = c;
+}
+
+static void
+progress_stop (GPContext *context, unsigned int id, void *data)
+{
+	stops++;
+}
+
+static unsigned char
+byte_at (unsigned long i)
+{
+	return (i * 131 + (i >> 9) * 7 + (i >> 17)) & 0xff;
+}
+
+/* Writes the file to upload, returns its descriptor */
+static int
+make_source (char *path, unsigned int len)
+{
+	const char	*tmp = getenv ("TMPDIR");
+	unsigned char	buf[65536];
+	unsigned long	i, j, n;
+	int		fd;
+
+	snprintf (path, len, "%s/gphoto2-upload-XXXXXX", tmp ? tmp : "/tmp");
+	fd = mkstemp (path);
+	if (fd == -1)
+		return (-1);
+	for (i = 0; i < SIZE; i += n) {
+		n = (SIZE - i < sizeof (buf)) ? SIZE - i : sizeof (buf);
+		for (j = 0; j < n; j++)
+			buf[j] = byte_at (i + j);
+		if (write (fd, buf, n) != (ssize_t)n) {
+			close (fd);
+			return (-1);
+		}
+	}
+	if (lseek (fd, 0, SEEK_SET) != 0) {
+		close (fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+/* Compares what the vcamera stored with what was uploaded */
+static int
+same_data (const char *path)
+{
+	unsigned char	buf[65536];
+	unsigned long	i = 0, j;
+	size_t		n;
+	FILE		*f;
+	int		same = 1;
+
+	f = fopen (path, "rb");
+	if (!f)
+		return (0);
+	while (same && (n = fread (buf, 1, sizeof (buf), f)) > 0) {
+		for (j = 0; j < n; j++)
+			if (buf[j] != byte_at (i + j)) {
+				printf ("FAIL: stored file differs at %lu\n", i + j);
+				same = 0;
+				break;
+			}
+		i += n;
+	}
+	fclose (f);
+	if (same && (i != SIZE)) {
+		printf ("FAIL: stored %lu bytes, uploaded %d\n", i, SIZE);
+		same = 0;
+	}
+	return (same);
+}
+
+int
+main (int argc, char **argv)
+{
+	Camera		*camera;
+	GPContext	*context;
+	CameraFile	*file;
+	char		tree[1024], source[1024], stored[1100];
+	int		fd, ret, failed = 0;
+
+	context = gp_context_new ();
+	CHECK (vusb_tree_new (tree, sizeof (tree), 1, 1024));
+	ret = vusb_camera_new (&camera, context);
+	if (ret == GP_ERROR_NOT_SUPPORTED) {
+		printf ("vusb port driver not available, skipping\n");
+		vusb_tree_free (tree, 1);
+		return (VUSB_SKIP);
+	}
+	CHECK (ret);
+	gp_context_set_progress_funcs (context, progress_start, progress_update,
+				       progress_stop, NULL);
+
+	fd = make_source (source, sizeof (source));
+	if (fd == -1) {
+		perror ("upload source");
+		return (1);
+	}
+	CHECK (gp_file_new_from_fd (&file, fd));
+	CHECK (gp_file_set_mime_type (file, GP_MIME_JPEG));
+	ret = gp_camera_folder_put_file (camera, VUSB_FOLDER, NAME,
+					 GP_FILE_TYPE_NORMAL, file, context);
+	gp_file_unref (file);
+	close (fd);
+	unlink (source);
+	if (ret < GP_OK) {
+		printf ("FAIL: upload returned %s\n", gp_result_as_string (ret));
+		failed++;
+	}
+
+	snprintf (stored, sizeof (stored), "%s/DCIM/100TEST/%s", tree, NAME);
+	if (!same_data (stored))
+		failed++;
+
+	/* the upload goes in chunks, each one reported */
+	if ((starts != 1) || (stops != 1) || (updates < 2) || backwards ||
+	    (target <= 0) || (current < target - 1)) {
+		printf ("FAIL: progress started %u times, stopped %u times, %u updates (%u backwards), at %.0f of %.0f\n",
+			starts, stops, updates, backwards, current, target);
+		failed++;
+	}
+
+	if (!failed)
+		printf ("uploaded %d bytes with %u progress updates\n", SIZE, updates);
+	gp_camera_exit (camera, context);
+	gp_camera_free (camera);
+	gp_context_unref (context);
+	unlink (stored);
+	vusb_tree_free (tree, 1);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,185 @@
+/* test-widget.c
+ *
+ * Builds a configuration tree of 2000 widgets, checks that the
+ * gp_widget_get_child_by_* functions find the same widgets as a plain
+ * walk over the tree, also after the tree changed, and times 100000
+ * lookups.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <gphoto2/gphoto2-widget.h>
+#include <gphoto2/gphoto2-result.h>
+
+#define SECTIONS	20
+#define PER_SECTION	99
+#define CHOICES		16
+#define LOOKUPS		100000
+
+#define CHECK(f) {int res = f; if (res < 0) {printf ("ERROR: %s failed: %s\n", #f, gp_result_as_string (res)); return (1);}}
+#define EXPECT(c) {if (!(c)) {printf ("ERROR: %s:%d: %s\n", __FILE__, __LINE__, #c); return (1);}}
+
+static double
+now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Reference lookup: depth-first walk using the public API only */
+static CameraWidget *
+walk (CameraWidget *widget, const char *name, const char *label, int id)
+{
+	CameraWidget *child, *found;
+	const char *s;
+	int x, i;
+
+	if (name) {
+		gp_widget_get_name (widget, &s);
+		if (!strcmp (s, name))
+			return widget;
+	} else if (label) {
+		gp_widget_get_label (widget, &s);
+		if (!strcmp (s, label))
+			return widget;
+	} else {
+		gp_widget_get_id (widget, &i);
+		if (i == id)
+			return widget;
+	}
+	for (x = 0; x < gp_widget_count_children (widget); x++) {
+		gp_widget_get_child (widget, x, &child);
+		if ((found = walk (child, name, label, id)))
+			return found;
+	}
+	return NULL;
+}
+
+static int
+check (CameraWidget *top, const char *name, const char *label, int id)
+{
+	CameraWidget *found = NULL, *expected = walk (top, name, label, id);
+	int r;
+
+	if (name)
+		r = gp_widget_get_child_by_name (top, name, &found);
+	else if (label)
+		r = gp_widget_get_child_by_label (top, label, &found);
+	else
+		r = gp_widget_get_child_by_id (top, id, &found);
+	if (expected ? (r != GP_OK) || (found != expected) : (r == GP_OK)) {
+		printf ("ERROR: lookup of '%s' / '%s' / %i differs from a walk\n",
+			name ? name : "", label ? label : "", id);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main (void)
+{
+	CameraWidget *window, *section, *widget, *first, *found;
+	char name[32], label[32], choice[32];
+	const char *s;
+	int i, j, k, id0, failed = 0;
+	double t;
+
+	CHECK (gp_widget_new (GP_WIDGET_WINDOW, "Camera and Driver Configuration", &window));
+	CHECK (gp_widget_set_name (window, "main"));
+	CHECK (gp_widget_get_id (window, &id0));
+	for (i = 0; i < SECTIONS; i++) {
+		sprintf (label, "Section %i", i);
+		CHECK (gp_widget_new (GP_WIDGET_SECTION, label, &section));
+		sprintf (name, "section%i", i);
+		CHECK (gp_widget_set_name (section, name));
+		CHECK (gp_widget_append (window, section));
+		for (j = 0; j < PER_SECTION; j++) {
+			/* Labels repeat across sections, names do not */
+			sprintf (label, "Setting %i", j);
+			CHECK (gp_widget_new (GP_WIDGET_RADIO, label, &widget));
+			sprintf (name, "setting%i-%i", i, j);
+			CHECK (gp_widget_set_name (widget, name));
+			CHECK (gp_widget_set_info (widget, "Some information"));
+			for (k = 0; k < CHOICES; k++) {
+				sprintf (choice, "Value %i", k * (j % 3 + 1));
+				CHECK (gp_widget_add_choice (widget, choice));
+			}
+			CHECK (gp_widget_append (section, widget));
+		}
+	}
+
+	/* Choices, labels, names and info come back as they were set */
+	CHECK (gp_widget_get_child_by_name (window, "setting7-5", &widget));
+	CHECK (gp_widget_get_label (widget, &s));
+	EXPECT (!strcmp (s, "Setting 5"));
+	CHECK (gp_widget_get_info (widget, &s));
+	EXPECT (!strcmp (s, "Some information"));
+	EXPECT (gp_widget_count_choices (widget) == CHOICES);
+	CHECK (gp_widget_get_choice (widget, CHOICES - 1, &s));
+	EXPECT (!strcmp (s, "Value 45"));
+
+	/* Index lookups agree with a walk, from the root and from sections */
+	for (k = 0; k < 3; k++) {
+		failed += check (window, "setting19-98", NULL, 0);
+		failed += check (window, NULL, "Setting 42", 0);
+		failed += check (window, NULL, NULL, id0 + 1000);
+		failed += check (window, "nonexistent", NULL, 0);
+		failed += check (window, NULL, NULL, -5);
+		CHECK (gp_widget_get_child_by_name (window, "section13", &section));
+		failed += check (section, NULL, "Setting 42", 0);
+		failed += check (section, "setting12-3", NULL, 0);
+		failed += check (section, NULL, NULL, id0 + 7);
+		failed += check (section, NULL, "Section 13", 0);
+	}
+
+	/* Renaming and appending are picked up */
+	CHECK (gp_widget_get_child_by_name (window, "setting3-3", &first));
+	CHECK (gp_widget_set_name (first, "renamed"));
+	failed += check (window, "setting3-3", NULL, 0);
+	failed += check (window, "renamed", NULL, 0);
+	failed += check (window, "renamed", NULL, 0);
+	CHECK (gp_widget_new (GP_WIDGET_TEXT, "Setting 42", &widget));
+	CHECK (gp_widget_set_name (widget, "renamed"));
+	CHECK (gp_widget_prepend (window, widget));
+	failed += check (window, "renamed", NULL, 0);
+	failed += check (window, "renamed", NULL, 0);
+	CHECK (gp_widget_get_child_by_label (window, "Setting 42", &found));
+	EXPECT (found == widget);
+	CHECK (gp_widget_set_name (first, "setting3-3"));
+	failed += check (window, "setting3-3", NULL, 0);
+	failed += check (window, "setting3-3", NULL, 0);
+	if (failed)
+		return (1);
+
+	t = now ();
+	for (i = 0; i < LOOKUPS; i++) {
+		sprintf (name, "setting%i-%i", i % SECTIONS, i % PER_SECTION);
+		CHECK (gp_widget_get_child_by_name (window, name, &widget));
+	}
+	printf ("%i lookups by name in a tree of %i widgets: %.3fs\n",
+		LOOKUPS, 1 + SECTIONS * (PER_SECTION + 1), now () - t);
+
+	CHECK (gp_widget_free (window));
+	return (0);
+}
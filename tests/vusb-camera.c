@@ -0,0 +1,243 @@
+/* vusb-camera.c
+ *
+ * Helpers for the tests that run against the vcamera of the vusb port
+ * driver.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <gphoto2/gphoto2-port-info-list.h>
+
+#include "vusb-camera.h"
+
+static void
+tree_path (char *path, unsigned int len, const char *dir, unsigned int index)
+{
+	snprintf (path, len, "%s/DCIM/100TEST/IMG_%04u.JPG", dir, index);
+}
+
+/* where the preview starts: SOI, APP1 marker and length, the EXIF
+ * header and a TIFF header without any IFD entries */
+#define PREVIEW_OFFSET	20
+
+/*
+ * Creates count JPEG files of the given size in a new temporary
+ * directory, and makes the vcamera serve them. The file contents
+ * differ from file to file and byte to byte, so any misplaced block
+ * shows up in a comparison.
+ */
+int
+vusb_tree_new (char *dir, unsigned int dirlen, unsigned int count, unsigned long size)
+{
+	return vusb_tree_new_with_previews (dir, dirlen, count, size, 0);
+}
+
+/*
+ * Like vusb_tree_new(), with a preview of preview_size bytes in the
+ * EXIF segment of each file if preview_size is not 0.
+ */
+int
+vusb_tree_new_with_previews (char *dir, unsigned int dirlen, unsigned int count,
+			     unsigned long size, unsigned long preview_size)
+{
+	const char	*tmp = getenv ("TMPDIR");
+	char		path[1024];
+	unsigned char	*buf;
+	unsigned long	i;
+	unsigned int	n, seed;
+	FILE		*f;
+
+	if ((size < 4) || (preview_size && ((preview_size < 4) ||
+	    (preview_size > 65000) || (size < PREVIEW_OFFSET + preview_size + 2))))
+		return GP_ERROR_BAD_PARAMETERS;
+	snprintf (dir, dirlen, "%s/gphoto2-vusb-XXXXXX", tmp ? tmp : "/tmp");
+	if (!mkdtemp (dir))
+		return GP_ERROR_IO;
+	snprintf (path, sizeof (path), "%s/DCIM", dir);
+	if (mkdir (path, 0755) < 0)
+		return GP_ERROR_IO;
+	snprintf (path, sizeof (path), "%s/DCIM/100TEST", dir);
+	if (mkdir (path, 0755) < 0)
+		return GP_ERROR_IO;
+
+	buf = malloc (size);
+	if (!buf)
+		return GP_ERROR_NO_MEMORY;
+	for (n = 0; n < count; n++) {
+		seed = n + 1;
+		for (i = 0; i < size; i++) {
+			seed = seed * 1103515245 + 12345;
+			buf[i] = seed >> 16;
+		}
+		buf[0] = 0xff; buf[1] = 0xd8;
+		buf[size - 2] = 0xff; buf[size - 1] = 0xd9;
+		if (preview_size) {
+			i = preview_size + PREVIEW_OFFSET - 4;
+			memcpy (buf + 2, "\xff\xe1\0\0Exif\0\0II*\0\x08\0\0\0",
+				PREVIEW_OFFSET - 2);
+			buf[4] = i >> 8;
+			buf[5] = i;
+			buf[PREVIEW_OFFSET] = 0xff;
+			buf[PREVIEW_OFFSET + 1] = 0xd8;
+			buf[PREVIEW_OFFSET + preview_size - 2] = 0xff;
+			buf[PREVIEW_OFFSET + preview_size - 1] = 0xd9;
+		}
+
+		tree_path (path, sizeof (path), dir, n);
+		f = fopen (path, "wb");
+		if (!f || (fwrite (buf, 1, size, f) != size)) {
+			if (f)
+				fclose (f);
+			free (buf);
+			return GP_ERROR_IO;
+		}
+		fclose (f);
+	}
+	free (buf);
+	return setenv ("VCAMERADIR", dir, 1) ? GP_ERROR_IO : GP_OK;
+}
+
+/* Reads back file index of the tree, to compare with a download. */
+int
+vusb_tree_read (const char *dir, unsigned int index, unsigned char **data, unsigned long *size)
+{
+	char		path[1024];
+	struct stat	st;
+	FILE		*f;
+
+	tree_path (path, sizeof (path), dir, index);
+	if (stat (path, &st) < 0)
+		return GP_ERROR_FILE_NOT_FOUND;
+	*size = st.st_size;
+	*data = malloc (*size);
+	if (!*data)
+		return GP_ERROR_NO_MEMORY;
+	f = fopen (path, "rb");
+	if (!f || (fread (*data, 1, *size, f) != *size)) {
+		if (f)
+			fclose (f);
+		free (*data);
+		return GP_ERROR_IO;
+	}
+	fclose (f);
+	return GP_OK;
+}
+
+/* Reads back the preview of file index of the tree. */
+int
+vusb_tree_read_preview (const char *dir, unsigned int index, unsigned char **data, unsigned long *size)
+{
+	unsigned char	*file;
+	unsigned long	file_size;
+	int		ret;
+
+	ret = vusb_tree_read (dir, index, &file, &file_size);
+	if (ret < GP_OK)
+		return ret;
+	if ((file_size < PREVIEW_OFFSET) || (file[2] != 0xff) || (file[3] != 0xe1)) {
+		free (file);
+		return GP_ERROR_FILE_NOT_FOUND;
+	}
+	*size = ((file[4] << 8) | file[5]) + 4 - PREVIEW_OFFSET;
+	*data = malloc (*size);
+	if (!*data) {
+		free (file);
+		return GP_ERROR_NO_MEMORY;
+	}
+	memcpy (*data, file + PREVIEW_OFFSET, *size);
+	free (file);
+	return GP_OK;
+}
+
+void
+vusb_tree_free (const char *dir, unsigned int count)
+{
+	char		path[1024];
+	unsigned int	n;
+
+	for (n = 0; n < count; n++) {
+		tree_path (path, sizeof (path), dir, n);
+		unlink (path);
+	}
+	snprintf (path, sizeof (path), "%s/DCIM/100TEST", dir);
+	rmdir (path);
+	snprintf (path, sizeof (path), "%s/DCIM", dir);
+	rmdir (path);
+	rmdir (dir);
+}
+
+/*
+ * Connects camera to the vcamera. Returns GP_ERROR_NOT_SUPPORTED when
+ * the vusb port driver is not available, which the tests report as
+ * skipped.
+ */
+int
+vusb_camera_new (Camera **camera, GPContext *context)
+{
+	CameraAbilitiesList	*al;
+	CameraAbilities		a;
+	GPPortInfoList		*il;
+	GPPortInfo		info;
+	int			m, ret;
+
+	ret = gp_port_info_list_new (&il);
+	if (ret < GP_OK)
+		return ret;
+	ret = gp_port_info_list_load (il);
+	/* only the vusb driver knows vusb: ports */
+	if (ret >= GP_OK)
+		ret = m = gp_port_info_list_lookup_path (il, "vusb:");
+	if (ret >= GP_OK)
+		ret = gp_port_info_list_get_info (il, m, &info);
+	if (ret < GP_OK) {
+		gp_port_info_list_free (il);
+		return (ret == GP_ERROR_UNKNOWN_PORT) ? GP_ERROR_NOT_SUPPORTED : ret;
+	}
+
+	ret = gp_abilities_list_new (&al);
+	if (ret >= GP_OK) {
+		ret = gp_abilities_list_load (al, context);
+		if (ret >= GP_OK)
+			ret = m = gp_abilities_list_lookup_model (al, "USB PTP Class Camera");
+		if (ret >= GP_OK)
+			ret = gp_abilities_list_get_abilities (al, m, &a);
+		gp_abilities_list_free (al);
+	}
+
+	if (ret >= GP_OK)
+		ret = gp_camera_new (camera);
+	if (ret < GP_OK) {
+		gp_port_info_list_free (il);
+		return ret;
+	}
+	gp_camera_set_abilities (*camera, a);
+	gp_camera_set_port_info (*camera, info);
+	gp_port_info_list_free (il);
+
+	ret = gp_camera_init (*camera, context);
+	if (ret < GP_OK) {
+		gp_camera_free (*camera);
+		*camera = NULL;
+	}
+	return ret;
+}
@@ -0,0 +1,42 @@
+/* vusb-camera.h
+ *
+ * Helpers for the tests that run against the vcamera of the vusb port
+ * driver. They are skipped when libgphoto2_port was built without it.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef LIBGPHOTO2_TESTS_VUSB_CAMERA_H
+#define LIBGPHOTO2_TESTS_VUSB_CAMERA_H
+
+#include <gphoto2/gphoto2-camera.h>
+
+/* exit code telling the automake test driver that a test was skipped */
+#define VUSB_SKIP	77
+
+/* where the files of the test tree show up on the camera */
+#define VUSB_FOLDER	"/store_00010001/DCIM/100TEST"
+
+int  vusb_tree_new   (char *dir, unsigned int dirlen, unsigned int count, unsigned long size);
+int  vusb_tree_new_with_previews (char *dir, unsigned int dirlen, unsigned int count,
+				  unsigned long size, unsigned long preview_size);
+int  vusb_tree_read  (const char *dir, unsigned int index, unsigned char **data, unsigned long *size);
+int  vusb_tree_read_preview (const char *dir, unsigned int index, unsigned char **data,
+			     unsigned long *size);
+void vusb_tree_free  (const char *dir, unsigned int count);
+
+int  vusb_camera_new (Camera **camera, GPContext *context);
+
+#endif /* !defined(LIBGPHOTO2_TESTS_VUSB_CAMERA_H) */